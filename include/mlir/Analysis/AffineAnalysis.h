@@ -26,8 +26,10 @@
 
 #include "mlir/Support/LogicalResult.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallVector.h"
+#include <memory>
 
 namespace mlir {
 
@@ -35,6 +37,8 @@ class AffineApplyOp;
 class AffineForOp;
 class AffineValueMap;
 class FlatAffineConstraints;
+class Function;
+class MemRefDependenceAnalysis;
 class Operation;
 class Value;
 
@@ -122,12 +126,71 @@ inline bool hasDependence(DependenceResult result) {
   return result.value == DependenceResult::HasDependence;
 }
 
+/// Caches the results of memref dependence checks within a function, along
+/// with the access functions and iteration domains they are computed from.
+/// Transformations that query the same pairs of accesses repeatedly, e.g. at
+/// every candidate loop depth or for every candidate fusion, reuse the cached
+/// results instead of rebuilding and projecting the dependence constraints.
+///
+/// The cache is not updated automatically: a transformation that changes the
+/// loops surrounding some accesses, or erases them, must call 'invalidate' on
+/// the affected operations before doing so, or at least before the next query
+/// involving them.
+class MemRefDependenceAnalysis {
+public:
+  MemRefDependenceAnalysis() = default;
+  explicit MemRefDependenceAnalysis(Function *) {}
+  ~MemRefDependenceAnalysis();
+
+  /// Checks whether 'srcAccess' and 'dstAccess' access the same memref element
+  /// at 'loopDepth', as 'checkMemrefAccessDependence' does. If
+  /// 'dependenceComponents' is non-null, it is populated with the components
+  /// of the dependence when there is one.
+  DependenceResult checkDependence(
+      const MemRefAccess &srcAccess, const MemRefAccess &dstAccess,
+      unsigned loopDepth,
+      llvm::SmallVector<DependenceComponent, 2> *dependenceComponents = nullptr,
+      bool allowRAR = false);
+
+  /// Drops the cached information of the loads and stores nested under 'op',
+  /// 'op' included, and of any pair of accesses involving them.
+  void invalidate(Operation *op);
+
+  /// Drops all the cached information.
+  void clear();
+
+  /// Returns the number of queries answered from the cache, and the number of
+  /// queries for which the dependence was checked.
+  unsigned getNumHits() const { return numHits; }
+  unsigned getNumMisses() const { return numMisses; }
+
+private:
+  struct AccessInfo;
+  struct PairResult;
+
+  /// Returns the access function and iteration domain of 'access', computing
+  /// them if they are not cached yet.
+  const AccessInfo &getAccessInfo(const MemRefAccess &access);
+
+  /// Key of a pair of accesses checked at a given depth, with or without RAR
+  /// dependences.
+  using PairKey = std::pair<std::pair<Operation *, Operation *>, unsigned>;
+
+  llvm::DenseMap<Operation *, std::unique_ptr<AccessInfo>> accessInfos;
+  llvm::DenseMap<PairKey, std::unique_ptr<PairResult>> pairResults;
+
+  unsigned numHits = 0;
+  unsigned numMisses = 0;
+};
+
 /// Returns in 'depCompsVec', dependence components for dependences between all
 /// load and store ops in loop nest rooted at 'forOp', at loop depths in range
-/// [1, maxLoopDepth].
+/// [1, maxLoopDepth]. If 'depAnalysis' is non-null, the dependences are checked
+/// through it and reuse its cached results.
 void getDependenceComponents(
     AffineForOp forOp, unsigned maxLoopDepth,
-    std::vector<llvm::SmallVector<DependenceComponent, 2>> *depCompsVec);
+    std::vector<llvm::SmallVector<DependenceComponent, 2>> *depCompsVec,
+    MemRefDependenceAnalysis *depAnalysis = nullptr);
 
 } // end namespace mlir
 
@@ -306,12 +306,18 @@ public:
   /// intersection with no simplification of any sort attempted.
   void append(const FlatAffineConstraints &other);
 
+  // Checks for emptiness of the set of integer points. The check is exact
+  // unless the branch and bound search of Simplex gives up, in which case it
+  // falls back to isEmptyByElimination().
+  // Returns true if the set is proven empty. Returns false otherwise.
+  bool isEmpty() const;
+
   // Checks for emptiness by performing variable elimination on all identifiers,
   // running the GCD test on each equality constraint, and checking for invalid
   // constraints.
   // Returns true if the GCD test fails for any equality, or if any invalid
   // constraints are discovered on any row. Returns false otherwise.
-  bool isEmpty() const;
+  bool isEmptyByElimination() const;
 
   // Runs the GCD test on all equality constraints. Returns 'true' if this test
   // fails on any equality. Returns 'false' otherwise.
@@ -0,0 +1,208 @@
+//===- Simplex.h - MLIR Simplex Class ---------------------------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// Functionality to check the emptiness of sets of affine constraints using the
+// Simplex algorithm.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_ANALYSIS_SIMPLEX_H
+#define MLIR_ANALYSIS_SIMPLEX_H
+
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "mlir/Support/MPInt.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace mlir {
+
+class FlatAffineConstraints;
+
+/// A Simplex tableau over a fixed number of variables, to which affine
+/// inequalities and equalities can be added incrementally.  It decides whether
+/// the set of constraints has a rational solution, and searches for an
+/// integer one by branch and bound.
+///
+/// The tableau is fraction free: every row holds an integer denominator, a
+/// constant and integer coefficients, and represents the unknown of the row
+/// as (constant + sum(coefficient * column unknown)) / denominator.  The
+/// entries are MPInts, so that the results are exact whatever the size of the
+/// intermediate values.
+///
+/// Constraints can be rolled back to a snapshot, which allows sharing the
+/// tableau of a base system across several queries that each add a few
+/// constraints to it:
+///
+///   Simplex simplex(baseConstraints);
+///   for (...) {
+///     unsigned snapshot = simplex.getSnapshot();
+///     simplex.addInequality(extraInequality);
+///     ... simplex.isEmpty() ...
+///     simplex.rollback(snapshot);
+///   }
+class Simplex {
+public:
+  /// Construct a Simplex over 'numVariables' variables with no constraints.
+  explicit Simplex(unsigned numVariables);
+
+  /// Construct a Simplex over the identifiers of 'constraints', holding all of
+  /// its equalities and inequalities.
+  explicit Simplex(const FlatAffineConstraints &constraints);
+
+  unsigned getNumVariables() const { return numVariables; }
+  unsigned getNumConstraints() const {
+    return unknowns.size() - numVariables;
+  }
+
+  /// Add the inequality 'sum(coeffs[i] * x_i) + coeffs.back() >= 0'. The
+  /// layout of 'coeffs' is that of the rows of FlatAffineConstraints.
+  void addInequality(ArrayRef<int64_t> coeffs);
+
+  /// Add the equality 'sum(coeffs[i] * x_i) + coeffs.back() == 0'.
+  void addEquality(ArrayRef<int64_t> coeffs);
+
+  /// Return true if the constraints have no rational solution, in which case
+  /// they have no integer solution either.
+  bool isEmpty() const { return empty; }
+
+  /// Return true if the constraints were proven to have no integer solution,
+  /// false if an integer solution was found, and None if the search gave up
+  /// after exploring 'maxBranches' branches.  The search always terminates on
+  /// bounded sets but can go on indefinitely on unbounded ones.
+  Optional<bool> isIntegerEmpty(unsigned maxBranches = kMaxBranches);
+
+  /// Return an identifier of the current set of constraints, which can be
+  /// passed to 'rollback' to remove the constraints added after this call.
+  unsigned getSnapshot() const { return undoLog.size(); }
+
+  /// Remove the constraints added since 'snapshot' was taken.
+  void rollback(unsigned snapshot);
+
+  void print(raw_ostream &os) const;
+  void dump() const;
+
+  /// The default limit on the number of branches explored by
+  /// 'isIntegerEmpty'.
+  static constexpr unsigned kMaxBranches = 1024;
+
+private:
+  /// An unknown of the tableau, i.e. either a variable or a constraint. It is
+  /// either basic and associated with a row of the tableau, or non-basic and
+  /// associated with a column, in which case its current value is zero.
+  struct Unknown {
+    Unknown(bool isRow, bool restricted, unsigned pos)
+        : isRow(isRow), restricted(restricted), pos(pos) {}
+
+    /// Whether the unknown is associated with a row or with a column.
+    bool isRow;
+
+    /// Whether the unknown is constrained to be non-negative.  This is the
+    /// case of all the constraints, and of none of the variables.
+    bool restricted;
+
+    /// The row or column the unknown is associated with.
+    unsigned pos;
+  };
+
+  /// The direction in which the value of an unknown is moved.
+  enum class Direction { Up, Down };
+
+  /// The changes that are undone by 'rollback'.
+  enum class UndoLogEntry { RemoveLastConstraint, UnmarkEmpty };
+
+  MPInt &at(unsigned row, unsigned col) {
+    return tableau[row * getNumColumns() + col];
+  }
+  const MPInt &at(unsigned row, unsigned col) const {
+    return tableau[row * getNumColumns() + col];
+  }
+  unsigned getNumColumns() const { return numVariables + 2; }
+  unsigned getNumRows() const { return rowUnknown.size(); }
+
+  Unknown &getUnknownForRow(unsigned row) { return unknowns[rowUnknown[row]]; }
+  Unknown &getUnknownForColumn(unsigned col) {
+    return unknowns[colUnknown[col]];
+  }
+  const Unknown &getUnknownForColumn(unsigned col) const {
+    return unknowns[colUnknown[col]];
+  }
+  const Unknown &getUnknownForRow(unsigned row) const {
+    return unknowns[rowUnknown[row]];
+  }
+
+  /// Add a row for the constraint 'sum(coeffs[i] * x_i) + coeffs.back() >= 0'
+  /// and try to make its value non-negative.
+  void addInequalityRow(ArrayRef<MPInt> coeffs);
+
+  /// Divide the entries of 'row' by their greatest common divisor.
+  void normalizeRow(unsigned row);
+
+  /// Swap the unknowns of 'row' and 'col' and update the tableau accordingly.
+  void pivot(unsigned row, unsigned col);
+
+  /// Find a column whose unknown can be moved so that the value of the
+  /// unknown of 'row' moves in 'direction', and the row to pivot it with so
+  /// that all the restricted unknowns stay non-negative.
+  Optional<std::pair<unsigned, unsigned>> findPivot(unsigned row,
+                                                    Direction direction) const;
+
+  /// Find the row whose restricted unknown first reaches zero when the
+  /// unknown of 'col' is moved in 'direction', ignoring 'skipRow'.
+  Optional<unsigned> findPivotRow(Optional<unsigned> skipRow,
+                                  Direction direction, unsigned col) const;
+
+  /// Pivot until the value of the restricted unknown 'index' is non-negative.
+  /// Return failure if it cannot be made non-negative.
+  LogicalResult restoreRow(unsigned index);
+
+  /// Remove the last constraint from the tableau.
+  void removeLastConstraint();
+
+  /// Return the index of a variable whose current value is not an integer.
+  Optional<unsigned> findFractionalVariable() const;
+
+  /// Branch and bound on the fractional variables, decrementing 'budget' for
+  /// each branch.
+  Optional<bool> isIntegerEmptyImpl(unsigned &budget);
+
+  /// The number of variables.  The first 'numVariables' unknowns are the
+  /// variables, and the remaining ones are the constraints in the order they
+  /// were added.
+  unsigned numVariables;
+
+  /// The tableau in row major order.  Column 0 holds the denominator of each
+  /// row and column 1 its constant.
+  SmallVector<MPInt, 64> tableau;
+
+  /// The unknowns, and the unknowns associated with each row and column.  The
+  /// first two columns are not associated with an unknown.
+  SmallVector<Unknown, 16> unknowns;
+  SmallVector<unsigned, 16> rowUnknown;
+  SmallVector<unsigned, 8> colUnknown;
+
+  /// Whether the constraints were found to have no rational solution.
+  bool empty = false;
+
+  /// The changes made to the tableau, in order.
+  SmallVector<UndoLogEntry, 16> undoLog;
+};
+
+} // end namespace mlir
+
+#endif // MLIR_ANALYSIS_SIMPLEX_H
@@ -40,6 +40,7 @@ class Block;
 class FlatAffineConstraints;
 class Location;
 struct MemRefAccess;
+class MemRefDependenceAnalysis;
 class Operation;
 class Value;
 
@@ -53,9 +54,11 @@ void getLoopIVs(Operation &op, SmallVectorImpl<AffineForOp> *loops);
 unsigned getNestingDepth(Operation &op);
 
 /// Returns in 'sequentialLoops' all sequential loops in loop nest rooted
-/// at 'forOp'.
+/// at 'forOp'. Dependences are checked through 'depAnalysis' if it is
+/// non-null.
 void getSequentialLoops(AffineForOp forOp,
-                        llvm::SmallDenseSet<Value *, 8> *sequentialLoops);
+                        llvm::SmallDenseSet<Value *, 8> *sequentialLoops,
+                        MemRefDependenceAnalysis *depAnalysis = nullptr);
 
 /// ComputationSliceState aggregates loop IVs, loop bound AffineMaps and their
 /// associated operands for a set of loops within a loop nest (typically the
@@ -277,6 +280,9 @@ struct MemRefRegion {
   FlatAffineConstraints cst;
 };
 
+/// Returns the size in bytes of an element of 'memRefType'.
+unsigned getMemRefEltSizeInBytes(MemRefType memRefType);
+
 /// Returns the size of memref data in bytes if it's statically shaped, None
 /// otherwise.
 Optional<uint64_t> getMemRefSizeInBytes(MemRefType memRefType);
@@ -296,8 +302,10 @@ unsigned getNumCommonSurroundingLoops(Operation &A, Operation &B);
 Optional<int64_t> getMemoryFootprintBytes(AffineForOp forOp,
                                           int memorySpace = -1);
 
-/// Returns true if `forOp' is a parallel loop.
-bool isLoopParallel(AffineForOp forOp);
+/// Returns true if `forOp' is a parallel loop. Dependences are checked through
+/// 'depAnalysis' if it is non-null.
+bool isLoopParallel(AffineForOp forOp,
+                    MemRefDependenceAnalysis *depAnalysis = nullptr);
 
 } // end namespace mlir
 
@@ -61,9 +61,27 @@ public:
   /// can be used, e.g., for reporting or optimization.
   /// If `sharedLibPaths` are provided, the underlying JIT-compilation will open
   /// and link the shared libraries for symbol resolution.
+  /// If `objectCacheDir` is provided, the compiled objects are persisted in
+  /// this directory and reused by later engines created for the same module,
+  /// which then skip both the `transformer` and the code generation.  Objects
+  /// are keyed by the LLVM module, the target, and `transformerKey`, which must
+  /// uniquely describe the transformation performed by `transformer`, e.g. its
+  /// optimization level.
+  /// If `lazyCompilation` is set, the module is still translated to LLVM IR
+  /// eagerly, but each function is only transformed and compiled when it is
+  /// first looked up or called.  The `transformer` is then applied to modules
+  /// containing a single function definition, which limits interprocedural
+  /// optimizations such as inlining.
+  /// If `numCompileThreads` is greater than one and compilation is not lazy,
+  /// the LLVM module is split into as many partitions, with the same caveat on
+  /// interprocedural optimizations, which are transformed and compiled
+  /// concurrently on a pool of `numCompileThreads` threads.  In this case the
+  /// `transformer` must be safe to call from multiple threads.
   static llvm::Expected<std::unique_ptr<ExecutionEngine>>
   create(Module *m, std::function<llvm::Error(llvm::Module *)> transformer = {},
-         ArrayRef<StringRef> sharedLibPaths = {});
+         ArrayRef<StringRef> sharedLibPaths = {},
+         StringRef objectCacheDir = "", StringRef transformerKey = "",
+         bool lazyCompilation = false, unsigned numCompileThreads = 1);
 
   /// Looks up a packed-argument function with the given name and returns a
   /// pointer to it.  Propagates errors in case of failure.
@@ -519,6 +519,28 @@ public:
   /// shape.
   static DenseElementsAttr get(ShapedType type, ArrayRef<APFloat> values);
 
+  /// Constructs a dense elements attribute from a buffer holding the packed
+  /// element data, in the layout returned by 'getRawData'. If 'isSplat' is
+  /// true, the buffer holds a single element. Returns null if 'type' is not a
+  /// statically shaped vector or tensor of integer or floating-point elements,
+  /// or if the size of the buffer does not match it.
+  static DenseElementsAttr getFromRawBuffer(ShapedType type,
+                                            ArrayRef<char> rawBuffer,
+                                            bool isSplat);
+
+  /// Constructs a dense elements attribute like 'getFromRawBuffer', but refers
+  /// to the buffer in place instead of copying it. The buffer must not change
+  /// and must outlive the context, e.g. by being handed to
+  /// 'MLIRContext::keepAlive', and must be aligned for the element type.
+  static DenseElementsAttr getFromUnownedRawBuffer(ShapedType type,
+                                                   ArrayRef<char> rawBuffer,
+                                                   bool isSplat);
+
+  /// Returns the number of bits used to store a single element of the given
+  /// integer or floating-point type in the raw data buffer. Elements of 1 bit
+  /// are packed, and wider elements are stored in a whole number of bytes.
+  static size_t getElementStorageBitWidth(Type eltType);
+
   /// Construct a dense elements attribute for an initializer_list of values.
   /// Each value is expected to be the same bitwidth of the element type of
   /// 'type'. 'type' must be a vector or tensor with static shape.
@@ -676,9 +698,10 @@ protected:
   static DenseElementsAttr getRaw(ShapedType type, ArrayRef<APInt> values);
 
   /// Get or create a new dense elements attribute instance with the given raw
-  /// data buffer. 'type' must be a vector or tensor with static shape.
+  /// data buffer. 'type' must be a vector or tensor with static shape. If
+  /// 'copyData' is false, the buffer must outlive the context of 'type'.
   static DenseElementsAttr getRaw(ShapedType type, ArrayRef<char> data,
-                                  bool isSplat);
+                                  bool isSplat, bool copyData = true);
 
   /// Overload of the raw 'get' method that asserts that the given type is of
   /// integer or floating-point type. This method is used to verify type
@@ -852,20 +875,29 @@ inline ::llvm::hash_code hash_value(Attribute arg) {
 /// provides simple interfaces for adding/removing/finding attributes from
 /// within a DictionaryAttr.
 ///
-/// We assume there will be relatively few attributes on a given operation
-/// (maybe a dozen or so, but not hundreds or thousands) so we use linear
-/// searches for everything.
+/// The attributes are kept sorted by name, so that lookups in larger lists
+/// are binary searches.  The first modification of the list copies its
+/// attributes into a private mutable list, which is only uniqued into a
+/// DictionaryAttr when the dictionary is requested.  This avoids uniquing the
+/// intermediate dictionaries of a sequence of modifications.
 class NamedAttributeList {
 public:
   NamedAttributeList(DictionaryAttr attrs = nullptr)
       : attrs((attrs && !attrs.empty()) ? attrs : nullptr) {}
   NamedAttributeList(ArrayRef<NamedAttribute> attributes);
-
-  /// Return the underlying dictionary attribute. This may be null, if this list
-  /// has no attributes.
-  DictionaryAttr getDictionary() const { return attrs; }
-
-  /// Return all of the attributes on this operation.
+  NamedAttributeList(const NamedAttributeList &other);
+  NamedAttributeList(NamedAttributeList &&other);
+  ~NamedAttributeList();
+  NamedAttributeList &operator=(const NamedAttributeList &other);
+  NamedAttributeList &operator=(NamedAttributeList &&other);
+
+  /// Return the underlying dictionary attribute, uniquing it if the list was
+  /// modified since it was last requested. This may be null, if this list has
+  /// no attributes.
+  DictionaryAttr getDictionary() const;
+
+  /// Return all of the attributes on this operation, sorted by name. The
+  /// returned list is invalidated when attributes are added or removed.
   ArrayRef<NamedAttribute> getAttrs() const;
 
   /// Replace the held attributes with ones provided in 'newAttrs'.
@@ -886,7 +918,19 @@ public:
   RemoveResult remove(Identifier name);
 
 private:
-  DictionaryAttr attrs;
+  using MutableAttributeList = SmallVector<NamedAttribute, 4>;
+
+  /// Return the mutable list of attributes, creating it from the dictionary
+  /// if necessary.  The dictionary is invalidated.
+  MutableAttributeList &getMutableAttrs();
+
+  /// The uniqued dictionary of the attributes.  It is null if there are no
+  /// attributes, or if the mutable list was modified since the dictionary was
+  /// last uniqued.
+  mutable DictionaryAttr attrs;
+
+  /// The mutable list of attributes sorted by name, if the list was modified.
+  std::unique_ptr<MutableAttributeList> mutableAttrs;
 };
 
 } // end namespace mlir.
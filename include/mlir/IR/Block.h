@@ -72,6 +72,7 @@ private:
 namespace mlir {
 using BlockOperand = IROperandImpl<Block>;
 
+class IRArena;
 class PredecessorIterator;
 class SuccessorIterator;
 
@@ -82,6 +83,13 @@ public:
   explicit Block() {}
   ~Block();
 
+  /// Blocks are allocated from the heap unless an arena is provided, e.g.
+  /// `new (arena) Block()`.  They are deleted as usual in both cases.
+  static void *operator new(size_t size) { return operator new(size, nullptr); }
+  static void *operator new(size_t size, IRArena *arena);
+  static void operator delete(void *ptr);
+  static void operator delete(void *ptr, IRArena *) { operator delete(ptr); }
+
   void clear() {
     // Drop all references from within this block.
     dropAllReferences();
@@ -0,0 +1,148 @@
+//===- Bytecode.h - MLIR Bytecode Format ------------------------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file defines the binary bytecode format of MLIR modules, and the entry
+// point to write a module in this format.  Bytecode files are read back by the
+// parser, which detects them from their magic number.
+//
+// A bytecode file is laid out as follows, where all the integers are encoded
+// as unsigned LEB128 varints unless noted otherwise:
+//
+//   file        ::= magic version strings types attributes locations functions
+//   strings     ::= count (size bytes)*
+//   types       ::= count (TypeCode payload)*
+//   attributes  ::= count (AttributeCode payload)*
+//   locations   ::= count (LocationCode payload)*
+//   functions   ::= count function*
+//
+// Strings, types, attributes and locations are uniqued in their tables and are
+// referred to by their index.  An entry only refers to entries of the same
+// table with a lower index.  Types and attributes without a dedicated encoding
+// are stored as the index of their textual form in the string table.
+//
+// The payload of dense elements attributes is aligned to `kPayloadAlignment`
+// bytes from the start of the file, so that it can be used in place when the
+// file is memory mapped.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_IR_BYTECODE_H
+#define MLIR_IR_BYTECODE_H
+
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace mlir {
+class Module;
+
+namespace bytecode {
+/// The magic number at the start of every bytecode file.  It starts with a
+/// byte that cannot appear at the start of a textual module.
+constexpr char kMagic[] = {'\xef', 'M', 'L', 'I', 'R', 'B', 'C', '\0'};
+
+/// The current version of the format.
+constexpr uint64_t kVersion = 1;
+
+/// The alignment of dense elements payloads, relative to the file start.
+constexpr unsigned kPayloadAlignment = 16;
+
+/// The encodings of the entries of the type table.
+enum class TypeCode : uint8_t {
+  /// The index of the textual form in the string table.
+  Textual,
+  /// bitwidth
+  Integer,
+  Index,
+  BF16,
+  F16,
+  F32,
+  F64,
+  None,
+  /// count inputs..., count results...
+  Function,
+};
+
+/// The encodings of the entries of the attribute table.
+enum class AttributeCode : uint8_t {
+  /// The index of the textual form in the string table.
+  Textual,
+  Unit,
+  BoolFalse,
+  BoolTrue,
+  /// type, zigzag-encoded value.  Only used for values of at most 64 bits.
+  Integer,
+  /// type, bits of the value.  Only used for values of at most 64 bits.
+  Float,
+  /// string
+  String,
+  /// type
+  Type,
+  /// string
+  Function,
+  /// count attributes...
+  Array,
+  /// count (string attribute)...
+  Dictionary,
+  /// type, isSplat, size, padding, payload bytes
+  DenseElements,
+};
+
+/// The encodings of the entries of the location table.
+enum class LocationCode : uint8_t {
+  Unknown,
+  /// filename string, line, column
+  FileLineCol,
+  /// name string, child location
+  Name,
+  /// callee location, caller location
+  CallSite,
+  /// count locations..., metadata attribute + 1 (or 0 if there is none)
+  Fused,
+};
+
+// The encoding of a function is:
+//
+//   function   ::= name type location attributes (attributes)* numValues
+//                  region
+//   region     ::= numBlocks (numArgs type*)* (numOps operation*)*
+//   operation  ::= name location count operand* count type* attributes
+//                  numSuccessors (block count operand*)* numRegions region*
+//   attributes ::= count (name attribute)*
+//   operand    ::= (value << 1) | isForwardReference [type]
+//
+// where there is one list of argument attributes per function input.  The
+// attribute lists are not stored as dictionaries to preserve their order.  An
+// external function has a body region with no block.
+//
+// Values are numbered per function in the order in which they are defined:
+// the arguments of all the blocks of a region are defined before the
+// operations of the region, and the results of an operation are defined
+// before its nested regions.  A use of a value that is not yet defined is a
+// forward reference, which carries the type of the value.
+
+/// Return true if `buffer` starts with the bytecode magic number.
+inline bool isBytecode(StringRef buffer) {
+  return buffer.startswith(StringRef(kMagic, sizeof(kMagic)));
+}
+} // end namespace bytecode
+
+/// Write `module` to `os` in the bytecode format.
+void writeBytecode(Module *module, raw_ostream &os);
+
+} // end namespace mlir
+
+#endif // MLIR_IR_BYTECODE_H
@@ -580,6 +580,11 @@ public:
   /// that it is receiving on.
   void setOrderIDForThread(size_t orderID);
 
+  /// Discard the diagnostics received for the order ids greater than the given
+  /// one. This allows for mirroring a single-threaded compilation that stops
+  /// processing after the element with the given id, e.g. because it failed.
+  void discardDiagnosticsAfter(size_t orderID);
+
 private:
   std::unique_ptr<detail::ParallelDiagnosticHandlerImpl> impl;
 };
@@ -23,11 +23,13 @@
 #define MLIR_IR_FUNCTION_H
 
 #include "mlir/IR/Block.h"
+#include "mlir/IR/IRArena.h"
 #include "mlir/IR/OpDefinition.h"
 #include "llvm/ADT/SmallString.h"
 
 namespace mlir {
 class BlockAndValueMapping;
+class DominanceInfo;
 class FunctionType;
 class MLIRContext;
 class Module;
@@ -75,6 +77,17 @@ public:
   /// Unlink this function from its module and delete it.
   void erase();
 
+  /// Return the arena that the operations and blocks built in this function
+  /// are allocated from, or null if they are allocated from the heap.
+  IRArena *getArena() { return arena.get(); }
+
+  /// Allocate the operations and blocks subsequently built in this function
+  /// from an arena, which is released along with the function.
+  void enableArena() {
+    if (!arena)
+      arena = new IRArena();
+  }
+
   /// Returns true if this function is external, i.e. it has no body.
   bool isExternal() { return empty(); }
 
@@ -248,8 +261,9 @@ public:
 
   /// Perform (potentially expensive) checks of invariants, used to detect
   /// compiler bugs.  On error, this reports the error through the MLIRContext
-  /// and returns failure.
-  LogicalResult verify();
+  /// and returns failure.  On success, if 'domInfo' is non-null, it is set to
+  /// the dominance information of the body that was computed by the checks.
+  LogicalResult verify(std::unique_ptr<DominanceInfo> *domInfo = nullptr);
 
   void print(raw_ostream &os);
   void dump();
@@ -311,6 +325,10 @@ private:
   /// The attributes lists for each of the function arguments.
   std::vector<NamedAttributeList> argAttrs;
 
+  /// The arena that the IR of the function is allocated from, if any.  It is
+  /// declared before the body so that it outlives it.
+  llvm::IntrusiveRefCntPtr<IRArena> arena;
+
   /// The body of the function.
   Region body;
 
@@ -0,0 +1,77 @@
+//===- IRArena.h - Arena for IR objects -------------------------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file defines the arena that operations and blocks can be allocated
+// from, so that the IR of a function is laid out contiguously and released in
+// bulk.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_IR_IRARENA_H
+#define MLIR_IR_IRARENA_H
+
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/IntrusiveRefCntPtr.h"
+#include "llvm/Support/Allocator.h"
+#include <mutex>
+
+namespace mlir {
+
+/// An arena that IR objects are bump-allocated from.  The memory of an object
+/// is not reused when the object is deallocated: it is only released when the
+/// arena itself is destroyed.
+///
+/// Every object allocated from an arena holds a reference to it, as does the
+/// owner of the arena, so that objects may safely outlive their owner, e.g.
+/// when they are moved to the body of another function.  The arena is
+/// destroyed once the owner and all the objects have released it.
+///
+/// Objects may be allocated from and deallocated to the same arena from several
+/// threads, e.g. by the builders of a parallel pattern rewrite within a
+/// function.
+class IRArena : public llvm::ThreadSafeRefCountedBase<IRArena> {
+public:
+  /// Allocate `size` bytes aligned to `alignment` from `arena`, or from the
+  /// heap if `arena` is null.
+  static void *allocate(IRArena *arena, size_t size, size_t alignment);
+
+  /// Deallocate memory returned by `allocate` with the same alignment.
+  static void deallocate(void *ptr, size_t alignment);
+
+  /// Return the arena that `ptr` was allocated from, or null if it was
+  /// allocated from the heap.
+  static IRArena *getArena(void *ptr) {
+    return reinterpret_cast<IRArena **>(ptr)[-1];
+  }
+
+  /// Return the number of bytes allocated from this arena, including the
+  /// unused space at the end of its slabs.
+  size_t getTotalMemory() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return allocator.getTotalMemory();
+  }
+
+private:
+  /// The allocator that the objects are carved from, and the mutex that
+  /// guards it.
+  llvm::BumpPtrAllocator allocator;
+  mutable std::mutex mutex;
+};
+
+} // end namespace mlir
+
+#endif // MLIR_IR_IRARENA_H
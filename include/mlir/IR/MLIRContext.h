@@ -23,6 +23,10 @@
 #include <memory>
 #include <vector>
 
+namespace llvm {
+class MemoryBuffer;
+} // end namespace llvm
+
 namespace mlir {
 class AbstractOperation;
 class DiagnosticEngine;
@@ -58,6 +62,10 @@ public:
     return static_cast<T *>(getRegisteredDialect(T::getDialectNamespace()));
   }
 
+  /// Keep the given buffer alive as long as this context, so that attributes
+  /// can refer to its contents in place instead of copying them.
+  void keepAlive(std::unique_ptr<llvm::MemoryBuffer> buffer);
+
   /// Return information about all registered operations.  This isn't very
   /// efficient: typically you should ask the operations about their properties
   /// directly.
@@ -63,10 +63,15 @@ public:
 
   /// Perform (potentially expensive) checks of invariants, used to detect
   /// compiler bugs.  On error, this reports the error through the MLIRContext
-  /// and returns failure.
-  LogicalResult verify();
-
-  void print(raw_ostream &os);
+  /// and returns failure.  If 'allowParallelism' is true and multi-threading
+  /// is enabled, the functions are verified concurrently; the diagnostics are
+  /// the same as those of a sequential verification.
+  LogicalResult verify(bool allowParallelism = true);
+
+  /// Print the module to 'os'. If 'allowParallelism' is true and
+  /// multi-threading is enabled, the functions are printed concurrently; the
+  /// output is the same as that of a sequential print.
+  void print(raw_ostream &os, bool allowParallelism = true);
   void dump();
 
 private:
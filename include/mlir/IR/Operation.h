@@ -65,10 +65,13 @@ public:
                            ArrayRef<Type> resultTypes,
                            const NamedAttributeList &attributes,
                            ArrayRef<Block *> successors, unsigned numRegions,
-                           bool resizableOperandList, MLIRContext *context);
+                           bool resizableOperandList, MLIRContext *context,
+                           IRArena *arena = nullptr);
 
-  /// Create a new Operation from the fields stored in `state`.
-  static Operation *create(const OperationState &state);
+  /// Create a new Operation from the fields stored in `state`.  The operation
+  /// is allocated from `arena` if it is provided, or from the heap otherwise.
+  static Operation *create(const OperationState &state,
+                           IRArena *arena = nullptr);
 
   /// The name of an operation is the key identifier for it.
   OperationName getName() { return name; }
@@ -153,8 +156,9 @@ public:
   /// Given an operation 'other' that is within the same parent block, return
   /// whether the current operation is before 'other' in the operation list
   /// of the parent block.
-  /// Note: This function has an average complexity of O(1), but worst case may
-  /// take O(N) where N is the number of operations within the parent block.
+  /// Note: This function has an amortized complexity of O(log(N)) when the
+  /// block is mutated between queries, where N is the number of operations
+  /// within the parent block, and of O(1) otherwise.
   bool isBeforeInBlock(Operation *other);
 
   /// Perform (potentially expensive) checks of invariants, used to detect
@@ -169,17 +173,37 @@ public:
   // Operands
   //===--------------------------------------------------------------------===//
 
-  /// Returns if the operation has a resizable operation list, i.e. operands can
-  /// be added.
+  /// Returns if the operation was created with a resizable operation list.
+  /// Operands may be added to and removed from any operation, this property
+  /// is only preserved when the operation is cloned or serialized.
   bool hasResizableOperandsList() { return getOperandStorage().isResizable(); }
 
   /// Replace the current operands of this operation with the ones provided in
-  /// 'operands'. If the operands list is not resizable, the size of 'operands'
-  /// must be less than or equal to the current number of operands.
+  /// 'operands'. The operand list is updated in place, growing its storage if
+  /// necessary.
   void setOperands(ArrayRef<Value *> operands) {
     getOperandStorage().setOperands(this, operands);
   }
 
+  /// Replace the 'length' operands starting at 'start' with the ones provided
+  /// in 'operands'. The range must not contain successor operands.
+  void setOperands(unsigned start, unsigned length,
+                   ArrayRef<Value *> operands) {
+    assert((!hasSuccessors() ||
+            start + length <= getSuccessorOperandIndex(0)) &&
+           "expected a range of non-successor operands");
+    getOperandStorage().setOperands(this, start, length, operands);
+  }
+
+  /// Insert the given operands before the operand at 'index', which must not
+  /// be a successor operand.
+  void insertOperands(unsigned index, ArrayRef<Value *> operands) {
+    setOperands(index, /*length=*/0, operands);
+  }
+
+  /// Erase the operand at 'index', which must not be a successor operand.
+  void eraseOperand(unsigned index) { setOperands(index, /*length=*/1, {}); }
+
   unsigned getNumOperands() { return getOperandStorage().size(); }
 
   Value *getOperand(unsigned idx) { return getOpOperand(idx).get(); }
@@ -349,6 +373,14 @@ public:
     --getTrailingObjects<unsigned>()[succIndex];
   }
 
+  /// Replace the operand list of the successor at 'index' with the given
+  /// operands, in place.
+  void setSuccessorOperands(unsigned index, ArrayRef<Value *> operands);
+
+  /// Append the given operands to the operand list of the successor at
+  /// 'index', in place.
+  void addSuccessorOperands(unsigned index, ArrayRef<Value *> operands);
+
   /// Get the index of the first operand of the successor at the provided
   /// index.
   unsigned getSuccessorOperandIndex(unsigned index);
@@ -454,7 +486,7 @@ private:
             const NamedAttributeList &attributes, MLIRContext *context);
 
   // Operations are deleted through the destroy() member because they are
-  // allocated with malloc.
+  // allocated with IRArena::allocate.
   ~Operation();
 
   /// Returns the operand storage object.
@@ -469,6 +501,23 @@ private:
   /// model.
   Block *getParent() const { return block; }
 
+  /// Returns true if this operation has been assigned an order index within
+  /// its parent block.
+  bool hasValidOrder() const { return orderIndex != kInvalidOrderIdx; }
+
+  /// Assign an order index to this operation if it doesn't have one, along
+  /// with the other unordered operations around it, without renumbering the
+  /// whole parent block unless its indices are exhausted.
+  void updateOrderIfNecessary();
+
+  /// The order index of an operation that was inserted into its block since
+  /// the last ordering query.
+  static constexpr unsigned kInvalidOrderIdx = -1;
+
+  /// The distance between the order indices of consecutive operations when a
+  /// block is renumbered, which leaves room for later insertions.
+  static constexpr unsigned kOrderStride = 16;
+
   /// The operation block that containts this operation.
   Block *block = nullptr;
 
@@ -477,8 +526,10 @@ private:
   Location location;
 
   /// Relative order of this operation in its parent block. Used for
-  /// O(1) local dominance checks between operations.
-  mutable unsigned orderIndex = 0;
+  /// O(1) local dominance checks between operations. The indices are sparse,
+  /// so that operations inserted into the block can be given an index between
+  /// those of their neighbors.
+  mutable unsigned orderIndex = kInvalidOrderIdx;
 
   const unsigned numResults, numSuccs, numRegions;
 
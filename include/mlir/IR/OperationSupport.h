@@ -302,125 +302,85 @@ public:
 };
 
 namespace detail {
-/// A utility class holding the information necessary to dynamically resize
-/// operands.
-struct ResizableStorage {
-  ResizableStorage(OpOperand *opBegin, unsigned numOperands)
-      : firstOpAndIsDynamic(opBegin, false), capacity(numOperands) {}
-
-  ~ResizableStorage() { cleanupStorage(); }
-
-  /// Cleanup any allocated storage.
-  void cleanupStorage() {
-    // If the storage is dynamic, then we need to free the storage.
-    if (isStorageDynamic())
-      free(firstOpAndIsDynamic.getPointer());
-  }
-
-  /// Sets the storage pointer to a new dynamically allocated block.
-  void setDynamicStorage(OpOperand *opBegin) {
-    /// Cleanup the old storage if necessary.
-    cleanupStorage();
-    firstOpAndIsDynamic.setPointerAndInt(opBegin, true);
-  }
-
-  /// Returns the current storage pointer.
-  OpOperand *getPointer() { return firstOpAndIsDynamic.getPointer(); }
-
-  /// Returns if the current storage of operands is in the trailing objects is
-  /// in a dynamically allocated memory block.
-  bool isStorageDynamic() const { return firstOpAndIsDynamic.getInt(); }
-
-  /// A pointer to the first operand element. This is either to the trailing
-  /// objects storage, or a dynamically allocated block of memory.
-  llvm::PointerIntPair<OpOperand *, 1, bool> firstOpAndIsDynamic;
-
-  // The maximum number of operands that can be currently held by the storage.
-  unsigned capacity;
-};
-
 /// This class handles the management of operation operands. Operands are
-/// stored similarly to the elements of a SmallVector except for two key
-/// differences. The first is the inline storage, which is a trailing objects
-/// array. The second is that being able to dynamically resize the operand list
-/// is optional.
+/// stored similarly to the elements of a SmallVector: the operands are held
+/// in a trailing objects array sized for the operands the operation was
+/// created with, and are moved to a dynamically allocated block of memory
+/// when the operand list grows beyond it. This allows for operands to be
+/// added to and removed from any operation in place.
 class OperandStorage final
-    : private llvm::TrailingObjects<OperandStorage, ResizableStorage,
-                                    OpOperand> {
+    : private llvm::TrailingObjects<OperandStorage, OpOperand> {
 public:
   OperandStorage(unsigned numOperands, bool resizable)
-      : numOperands(numOperands), resizable(resizable) {
-    // Initialize the resizable storage.
-    if (resizable) {
-      new (&getResizableStorage())
-          ResizableStorage(getTrailingObjects<OpOperand>(), numOperands);
-    }
-  }
+      : operands(getTrailingObjects<OpOperand>()), numOperands(numOperands),
+        resizable(resizable), capacity(numOperands) {}
 
   ~OperandStorage() {
     // Manually destruct the operands.
     for (auto &operand : getOperands())
       operand.~OpOperand();
 
-    // If the storage is resizable then destruct the utility.
-    if (resizable)
-      getResizableStorage().~ResizableStorage();
+    // If the storage is dynamic then free it.
+    if (isStorageDynamic())
+      free(operands);
   }
 
   /// Replace the operands contained in the storage with the ones provided in
   /// 'operands'.
-  void setOperands(Operation *owner, ArrayRef<Value *> operands);
+  void setOperands(Operation *owner, ArrayRef<Value *> operands) {
+    setOperands(owner, /*start=*/0, size(), operands);
+  }
+
+  /// Replace the 'length' operands starting at 'start' with the ones provided
+  /// in 'operands', shifting the operands that follow them as necessary.
+  void setOperands(Operation *owner, unsigned start, unsigned length,
+                   ArrayRef<Value *> operands);
 
   /// Erase an operand held by the storage.
   void eraseOperand(unsigned index);
 
   /// Get the operation operands held by the storage.
-  MutableArrayRef<OpOperand> getOperands() {
-    return {getRawOperands(), size()};
-  }
+  MutableArrayRef<OpOperand> getOperands() { return {operands, size()}; }
 
   /// Return the number of operands held in the storage.
   unsigned size() const { return numOperands; }
 
   /// Returns the additional size necessary for allocating this object.
-  static size_t additionalAllocSize(unsigned numOperands, bool resizable) {
-    return additionalSizeToAlloc<ResizableStorage, OpOperand>(resizable ? 1 : 0,
-                                                              numOperands);
+  static size_t additionalAllocSize(unsigned numOperands) {
+    return additionalSizeToAlloc<OpOperand>(numOperands);
   }
 
-  /// Returns if this storage is resizable.
+  /// Returns if this storage was created as resizable. This is preserved as a
+  /// property of the operation, but the operands of any storage may be
+  /// resized.
   bool isResizable() const { return resizable; }
 
 private:
-  /// Clear the storage and destroy the current operands held by the storage.
-  void clear() { numOperands = 0; }
-
-  /// Returns the current pointer for the raw operands array.
-  OpOperand *getRawOperands() {
-    return resizable ? getResizableStorage().getPointer()
-                     : getTrailingObjects<OpOperand>();
+  /// Returns if the operands are held in a dynamically allocated block of
+  /// memory rather than in the trailing objects.
+  bool isStorageDynamic() {
+    return operands != getTrailingObjects<OpOperand>();
   }
 
-  /// Returns the resizable operand utility class.
-  ResizableStorage &getResizableStorage() {
-    assert(resizable);
-    return *getTrailingObjects<ResizableStorage>();
-  }
+  /// Grow the operand storage to hold at least 'minSize' operands.
+  void grow(size_t minSize);
 
-  /// Grow the internal resizable operand storage.
-  void grow(ResizableStorage &resizeUtil, size_t minSize);
+  /// A pointer to the first operand. This is either the trailing objects
+  /// storage, or a dynamically allocated block of memory.
+  OpOperand *operands;
 
-  /// The current number of operands, and the current max operand capacity.
+  /// The current number of operands.
   unsigned numOperands : 31;
 
-  /// Whether this storage is resizable or not.
+  /// Whether this storage was created as resizable or not.
   bool resizable : 1;
 
+  /// The maximum number of operands that can be currently held by the
+  /// storage.
+  unsigned capacity;
+
   // This stuff is used by the TrailingObjects template.
-  friend llvm::TrailingObjects<OperandStorage, ResizableStorage, OpOperand>;
-  size_t numTrailingObjects(OverloadToken<ResizableStorage>) const {
-    return resizable ? 1 : 0;
-  }
+  friend llvm::TrailingObjects<OperandStorage, OpOperand>;
 };
 } // end namespace detail
 } // end namespace mlir
@@ -342,6 +342,12 @@ public:
     return block->splitBlock(before);
   }
 
+  /// This method is used to notify the rewriter that the pattern root is about
+  /// to be modified in place, before any change is made to it.  It must be
+  /// followed by a call to 'updatedRootInPlace' once the modification is done,
+  /// and allows rewriters that may backtrack to restore the root.
+  void startRootUpdate(Operation *op) { notifyRootUpdateStarted(op); }
+
   /// This method is used as the final notification hook for patterns that end
   /// up modifying the pattern root in place, by changing its operands.  This is
   /// a minor efficiency win (it avoids creating a new operation and removing
@@ -364,6 +370,10 @@ protected:
   /// notification hook for rewriters that want to know about new operations.
   virtual Operation *createOperation(const OperationState &state) = 0;
 
+  /// Notify the pattern rewriter that the specified operation is about to be
+  /// mutated in place.  This is called before the mutation is done.
+  virtual void notifyRootUpdateStarted(Operation *op) {}
+
   /// Notify the pattern rewriter that the specified operation has been mutated
   /// in place.  This is called after the mutation is done.
   virtual void notifyRootUpdated(Operation *op) {}
@@ -392,9 +402,23 @@ private:
 /// This is a vector that owns the patterns inside of it.
 using OwningRewritePatternList = std::vector<std::unique_ptr<RewritePattern>>;
 
+/// The counters collected for a single pattern while it is being applied.
+struct PatternStatistics {
+  /// The number of times the pattern was tried on an operation.
+  unsigned numAttempts = 0;
+
+  /// The number of times the pattern matched and rewrote an operation.
+  unsigned numSuccesses = 0;
+
+  /// The total time spent trying the pattern, in seconds.
+  double time = 0;
+};
+
 /// This class manages optimization and execution of a group of rewrite
 /// patterns, providing an API for finding and applying, the best match against
-/// a given node.
+/// a given node. The patterns are bucketed by their root operation name when
+/// the matcher is constructed, so that matching an operation only considers
+/// the patterns rooted at its name.
 ///
 class RewritePatternMatcher {
 public:
@@ -402,8 +426,17 @@ public:
   explicit RewritePatternMatcher(OwningRewritePatternList &&patterns);
 
   /// Try to match the given operation to a pattern and rewrite it. Return
-  /// true if any pattern matches.
-  bool matchAndRewrite(Operation *op, PatternRewriter &rewriter);
+  /// true if any pattern matches. If 'stats' is non-empty, the attempts,
+  /// successes, and time of each pattern tried are added to the entry with
+  /// the same index as the pattern within 'getPatterns'. This method does
+  /// not modify the matcher, and may be called concurrently.
+  bool matchAndRewrite(Operation *op, PatternRewriter &rewriter,
+                       MutableArrayRef<PatternStatistics> stats = {}) const;
+
+  /// Returns the patterns of this matcher, sorted by decreasing benefit.
+  ArrayRef<std::unique_ptr<RewritePattern>> getPatterns() const {
+    return patterns;
+  }
 
 private:
   RewritePatternMatcher(const RewritePatternMatcher &) = delete;
@@ -412,13 +445,54 @@ private:
   /// The group of patterns that are matched for optimization through this
   /// matcher.
   OwningRewritePatternList patterns;
+
+  /// The indices of the patterns for each root operation name, sorted by
+  /// decreasing benefit. Patterns that are impossible to match are not added.
+  llvm::DenseMap<OperationName, SmallVector<unsigned, 2>> patternsByRoot;
+};
+
+/// Statistics collected while greedily applying a set of patterns.
+struct GreedyRewriteStatistics {
+  /// The counters of a single pattern, along with the information used to
+  /// identify it.
+  struct PatternEntry {
+    /// The name of the root operation of the pattern.
+    StringRef rootName;
+
+    /// The benefit of the pattern.
+    PatternBenefit benefit;
+
+    /// The counters for the pattern.
+    PatternStatistics stats;
+  };
+
+  /// The number of regions that were simplified independently. This includes
+  /// the function body, as well as each region isolated from above.
+  unsigned numRegions = 0;
+
+  /// The total number of scans over the regions.
+  unsigned numIterations = 0;
+
+  /// The number of rescans that were skipped, as the changes made during the
+  /// previous scan were all revisited by its worklist.
+  unsigned numSkippedRescans = 0;
+
+  /// Set if the rewrite did not converge within the maximum number of scans.
+  bool hitIterationLimit = false;
+
+  /// The counters for each pattern, sorted by decreasing benefit.
+  std::vector<PatternEntry> patterns;
 };
 
 /// Rewrite the specified function by repeatedly applying the highest benefit
 /// patterns in a greedy work-list driven manner. Return true if no more
-/// patterns can be matched in the result function.
+/// patterns can be matched in the result function. The regions of operations
+/// that are isolated from above are rewritten independently, and may be
+/// rewritten concurrently. If 'stats' is provided, it is populated with the
+/// statistics of the rewrite.
 ///
-bool applyPatternsGreedily(Function &fn, OwningRewritePatternList &&patterns);
+bool applyPatternsGreedily(Function &fn, OwningRewritePatternList &&patterns,
+                           GreedyRewriteStatistics *stats = nullptr);
 
 /// Helper class to create a list of rewrite patterns given a list of their
 /// types and a list of attributes perfect-forwarded to each of the conversion
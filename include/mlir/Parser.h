@@ -22,13 +22,17 @@
 #ifndef MLIR_PARSER_H
 #define MLIR_PARSER_H
 
+#include <memory>
+
 namespace llvm {
+class MemoryBuffer;
 class SourceMgr;
 class SMDiagnostic;
 class StringRef;
 } // end namespace llvm
 
 namespace mlir {
+class Attribute;
 class Location;
 class Module;
 class MLIRContext;
@@ -37,11 +41,13 @@ class Type;
 /// This parses the file specified by the indicated SourceMgr and returns an
 /// MLIR module if it was valid.  If not, the error message is emitted through
 /// the error handler registered in the context, and a null pointer is returned.
+/// The file may either be in the textual or in the bytecode format.
 Module *parseSourceFile(const llvm::SourceMgr &sourceMgr, MLIRContext *context);
 
 /// This parses the file specified by the indicated filename and returns an
 /// MLIR module if it was valid.  If not, the error message is emitted through
 /// the error handler registered in the context, and a null pointer is returned.
+/// The payloads of a file in the bytecode format are used in place.
 Module *parseSourceFile(llvm::StringRef filename, MLIRContext *context);
 
 /// This parses the module string to a MLIR module if it was valid.  If not, the
@@ -56,6 +62,25 @@ Module *parseSourceString(llvm::StringRef moduleStr, MLIRContext *context);
 // TODO(ntv) Improve diagnostic reporting.
 Type parseType(llvm::StringRef typeStr, MLIRContext *context);
 
+/// This parses a single MLIR attribute to an MLIR context if it was valid.  If
+/// not, an error message is emitted through a new SourceMgrDiagnosticHandler
+/// constructed from a new SourceMgr with a single a MemoryBuffer wrapping
+/// `attrStr`.
+Attribute parseAttribute(llvm::StringRef attrStr, MLIRContext *context);
+
+/// This reads a module in the bytecode format from the given buffer and returns
+/// it if it was valid.  If not, the error message is emitted through the error
+/// handler registered in the context, and a null pointer is returned.  The
+/// buffer does not need to outlive the module.
+Module *parseBytecode(llvm::StringRef buffer, MLIRContext *context);
+
+/// This reads a module in the bytecode format like above, but takes ownership
+/// of the buffer.  If the buffer is suitably aligned, e.g. a memory mapped
+/// file, the payloads of dense elements attributes are used in place, and the
+/// buffer is kept alive by the context.
+Module *parseBytecode(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                      MLIRContext *context);
+
 } // end namespace mlir
 
 #endif // MLIR_PARSER_H
@@ -21,6 +21,7 @@
 #include "mlir/IR/Module.h"
 #include "mlir/Pass/PassInstrumentation.h"
 #include "mlir/Support/LLVM.h"
+#include "mlir/Support/STLExtras.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/TypeName.h"
@@ -58,6 +59,9 @@ public:
   }
   void preserve(const AnalysisID *id) { preservedIDs.insert(id); }
 
+  /// Remove the given analysis from the preserved set, if present.
+  void unpreserve(const AnalysisID *id) { preservedIDs.erase(id); }
+
   /// Returns if the given analysis has been marked as preserved. Note that this
   /// simply checks for the presence of a given analysis ID and should not be
   /// used as a general preservation checker.
@@ -76,18 +80,56 @@ private:
   SmallPtrSet<const void *, 2> preservedIDs;
 };
 
+/// Records that a cached analysis result was reused by a later pass instead of
+/// being recomputed.
+void recordAnalysisReuse();
+
 /// The abstract polymorphic base class representing an analysis.
 struct AnalysisConcept {
   virtual ~AnalysisConcept() = default;
+
+  /// Returns true if this analysis is invalidated given the set of preserved
+  /// analyses. The given set does not mark all analyses as preserved.
+  virtual bool isInvalidated(const PreservedAnalyses &pa) = 0;
+
+  /// Set when this analysis was retained through an invalidation since it was
+  /// last queried.
+  bool retainedSinceLastQuery = false;
 };
 
+/// Trait to check if an analysis provides a hook to check for invalidation
+/// beyond its own preservation, e.g. when it depends on other analyses.
+template <typename AnalysisT>
+using has_is_invalidated_t = decltype(std::declval<AnalysisT &>().isInvalidated(
+    std::declval<const PreservedAnalyses &>()));
+
 /// A derived analysis model used to hold a specific analysis object.
 template <typename AnalysisT> struct AnalysisModel : public AnalysisConcept {
   template <typename... Args>
   explicit AnalysisModel(Args &&... args)
       : analysis(std::forward<Args>(args)...) {}
 
+  /// An analysis is invalidated if it was not preserved, or if the analysis
+  /// itself reports that one of its dependencies was invalidated.
+  bool isInvalidated(const PreservedAnalyses &pa) final {
+    return !pa.isPreserved<AnalysisT>() || isInvalidatedImpl<AnalysisT>(pa);
+  }
+
   AnalysisT analysis;
+
+private:
+  template <typename T>
+  typename std::enable_if<is_detected<has_is_invalidated_t, T>::value,
+                          bool>::type
+  isInvalidatedImpl(const PreservedAnalyses &pa) {
+    return analysis.isInvalidated(pa);
+  }
+  template <typename T>
+  typename std::enable_if<!is_detected<has_is_invalidated_t, T>::value,
+                          bool>::type
+  isInvalidatedImpl(const PreservedAnalyses &) {
+    return false;
+  }
 };
 
 /// This class represents a cache of analyses for a single IR unit. All
@@ -126,6 +168,11 @@ public:
 
       if (pi)
         pi->runAfterAnalysis(getAnalysisName<AnalysisT>(), id, ir);
+    } else if (it->second->retainedSinceLastQuery) {
+      // Otherwise, the cached result was computed before the last
+      // invalidation and would have been recomputed without it.
+      it->second->retainedSinceLastQuery = false;
+      recordAnalysisReuse();
     }
     return static_cast<AnalysisModel<AnalysisT> &>(*it->second).analysis;
   }
@@ -139,6 +186,20 @@ public:
     return {static_cast<AnalysisModel<AnalysisT> &>(*res->second).analysis};
   }
 
+  /// Set the cached instance of an analysis, e.g. when it was computed as a
+  /// by-product of other work. An existing instance is updated in place, so
+  /// that any references to it remain valid.
+  template <typename AnalysisT> void setAnalysis(AnalysisT analysis) {
+    auto &cached = analyses[AnalysisID::getID<AnalysisT>()];
+    if (!cached) {
+      cached = llvm::make_unique<AnalysisModel<AnalysisT>>(std::move(analysis));
+      return;
+    }
+    static_cast<AnalysisModel<AnalysisT> &>(*cached).analysis =
+        std::move(analysis);
+    cached->retainedSinceLastQuery = false;
+  }
+
   /// Returns the IR unit that this analysis map represents.
   IRUnitT *getIRUnit() { return ir; }
   const IRUnitT *getIRUnit() const { return ir; }
@@ -149,12 +210,33 @@ public:
   /// Invalidate any cached analyses based upon the given set of preserved
   /// analyses.
   void invalidate(const detail::PreservedAnalyses &pa) {
-    // Remove any analyses not marked as preserved.
-    for (auto it = analyses.begin(), e = analyses.end(); it != e;) {
-      auto curIt = it++;
-      if (!pa.isPreserved(curIt->first))
-        analyses.erase(curIt);
+    // If all analyses were preserved, only record that they were retained.
+    if (pa.isAll()) {
+      for (auto &analysis : analyses)
+        analysis.second->retainedSinceLastQuery = true;
+      return;
     }
+
+    // Remove any analyses that were invalidated. An invalidated analysis is
+    // removed from the preserved set, so that any analyses that depend on it
+    // are invalidated as well. This is iterated to a fixed point as the map
+    // does not order analyses by their dependencies.
+    detail::PreservedAnalyses remainingPA(pa);
+    bool changed;
+    do {
+      changed = false;
+      for (auto it = analyses.begin(), e = analyses.end(); it != e;) {
+        auto curIt = it++;
+        if (!curIt->second->isInvalidated(remainingPA))
+          continue;
+        remainingPA.unpreserve(curIt->first);
+        analyses.erase(curIt);
+        changed = true;
+      }
+    } while (changed);
+
+    for (auto &analysis : analyses)
+      analysis.second->retainedSinceLastQuery = true;
   }
 
 private:
@@ -190,14 +272,14 @@ public:
     return impl->getCachedAnalysis<AnalysisT>();
   }
 
-  /// Invalidate any non preserved analyses,
-  void invalidate(const detail::PreservedAnalyses &pa) {
-    // If all analyses were preserved, then there is nothing to do here.
-    if (pa.isAll())
-      return;
-    impl->invalidate(pa);
+  // Set the cached instance of the given analysis for the current function.
+  template <typename AnalysisT> void setAnalysis(AnalysisT analysis) {
+    impl->setAnalysis<AnalysisT>(std::move(analysis));
   }
 
+  /// Invalidate any non preserved analyses,
+  void invalidate(const detail::PreservedAnalyses &pa) { impl->invalidate(pa); }
+
   /// Clear any held analyses.
   void clear() { impl->clear(); }
 
@@ -220,6 +302,44 @@ private:
   friend class ModuleAnalysisManager;
 };
 
+/// An analysis manager for a specific operation instance whose regions are
+/// isolated from above. The analyses are owned by the pass adaptor that runs
+/// over the operation, and only live for the duration of its pipeline.
+class OperationAnalysisManager {
+public:
+  OperationAnalysisManager(detail::AnalysisMap<Operation> *impl,
+                           PassInstrumentor *passInstrumentor)
+      : impl(impl), passInstrumentor(passInstrumentor) {}
+
+  // Query for the given analysis for the current operation.
+  template <typename AnalysisT> AnalysisT &getAnalysis() {
+    return impl->getAnalysis<AnalysisT>(getPassInstrumentor());
+  }
+
+  // Query for a cached entry of the given analysis on the current operation.
+  template <typename AnalysisT>
+  llvm::Optional<std::reference_wrapper<AnalysisT>> getCachedAnalysis() const {
+    return impl->getCachedAnalysis<AnalysisT>();
+  }
+
+  /// Invalidate any non preserved analyses,
+  void invalidate(const detail::PreservedAnalyses &pa) { impl->invalidate(pa); }
+
+  /// Clear any held analyses.
+  void clear() { impl->clear(); }
+
+  /// Returns a pass instrumentation object for the current operation. This
+  /// value may be null.
+  PassInstrumentor *getPassInstrumentor() const { return passInstrumentor; }
+
+private:
+  /// A reference to the analysis map owned by the running pass adaptor.
+  detail::AnalysisMap<Operation> *impl;
+
+  /// An optional instrumentation object.
+  PassInstrumentor *passInstrumentor;
+};
+
 /// An analysis manager for a specific module instance.
 class ModuleAnalysisManager {
 public:
@@ -260,8 +380,11 @@ public:
   /// Create an analysis slice for the given child function.
   FunctionAnalysisManager slice(Function *function);
 
-  /// Invalidate any non preserved analyses.
-  void invalidate(const detail::PreservedAnalyses &pa);
+  /// Invalidate any non preserved analyses. If 'changedFunctions' is provided,
+  /// the analyses of any function not within it are preserved.
+  void invalidate(const detail::PreservedAnalyses &pa,
+                  const llvm::SmallPtrSetImpl<Function *> *changedFunctions =
+                      nullptr);
 
   /// Returns a pass instrumentation object for the current module. This value
   /// may be null.
@@ -28,7 +28,7 @@ namespace mlir {
 /// derived pass object, e.g its kind and abstract PassInfo.
 class Pass {
 public:
-  enum class Kind { FunctionPass, ModulePass };
+  enum class Kind { FunctionPass, ModulePass, OperationPass };
 
   virtual ~Pass() = default;
 
@@ -59,12 +59,13 @@ private:
   virtual void anchor();
 
   /// Represents a unique identifier for the pass and its kind.
-  llvm::PointerIntPair<const PassID *, 1, Kind> passIDAndKind;
+  llvm::PointerIntPair<const PassID *, 2, Kind> passIDAndKind;
 };
 
 namespace detail {
 class FunctionPassExecutor;
 class ModulePassExecutor;
+class OperationPassExecutor;
 
 /// The state for a single execution of a pass. This provides a unified
 /// interface for accessing and initializing necessary state for pass execution.
@@ -83,6 +84,17 @@ struct PassExecutionState {
   /// The set of preserved analyses for the current execution.
   detail::PreservedAnalyses preservedAnalyses;
 };
+
+/// The state for a single execution of a module pass. Module passes may also
+/// provide the set of functions that they changed.
+struct ModulePassExecutionState
+    : public PassExecutionState<Module, ModuleAnalysisManager> {
+  using PassExecutionState<Module, ModuleAnalysisManager>::PassExecutionState;
+
+  /// The set of functions changed by the current execution, or None if the
+  /// pass did not provide one and any function may have changed.
+  llvm::Optional<llvm::SmallPtrSet<Function *, 4>> changedFunctions;
+};
 } // namespace detail
 
 /// Pass to transform a specific function within a module. Derived passes should
@@ -140,7 +152,7 @@ private:
 /// Pass to transform a module. Derived passes should not inherit from this
 /// class directly, and instead should use the CRTP ModulePass class.
 class ModulePassBase : public Pass {
-  using PassStateT = detail::PassExecutionState<Module, ModuleAnalysisManager>;
+  using PassStateT = detail::ModulePassExecutionState;
 
 public:
   static bool classof(const Pass *pass) {
@@ -182,6 +194,59 @@ private:
   friend detail::ModulePassExecutor;
 };
 
+/// Pass to transform an operation whose regions are isolated from above, e.g.
+/// a 'gpu.launch', within a function. Derived passes should not inherit from
+/// this class directly, and instead should use the CRTP OperationPass class.
+class OperationPassBase : public Pass {
+  using PassStateT =
+      detail::PassExecutionState<Operation, OperationAnalysisManager>;
+
+public:
+  static bool classof(const Pass *pass) {
+    return pass->getKind() == Kind::OperationPass;
+  }
+
+protected:
+  explicit OperationPassBase(const PassID *id)
+      : Pass(id, Kind::OperationPass) {}
+
+  /// The polymorphic API that runs the pass over the currently held operation.
+  virtual void runOnOperation() = 0;
+
+  /// A clone method to create a copy of this pass.
+  virtual OperationPassBase *clone() const = 0;
+
+  /// Return the current operation being transformed.
+  Operation &getOperation() {
+    return *getPassState().irAndPassFailed.getPointer();
+  }
+
+  /// Return the MLIR context for the current operation being transformed.
+  MLIRContext &getContext() { return *getOperation().getContext(); }
+
+  /// Returns the current pass state.
+  PassStateT &getPassState() {
+    assert(passState && "pass state was never initialized");
+    return *passState;
+  }
+
+  /// Returns the current analysis manager.
+  OperationAnalysisManager &getAnalysisManager() {
+    return getPassState().analysisManager;
+  }
+
+private:
+  /// Forwarding function to execute this pass.
+  LLVM_NODISCARD
+  LogicalResult run(Operation *op, OperationAnalysisManager &oam);
+
+  /// The current execution state for the pass.
+  llvm::Optional<PassStateT> passState;
+
+  /// Allow access to 'run'.
+  friend detail::OperationPassExecutor;
+};
+
 //===----------------------------------------------------------------------===//
 // Pass Model Definitions
 //===----------------------------------------------------------------------===//
@@ -265,6 +330,26 @@ struct FunctionPass : public detail::PassModel<Function, T, FunctionPassBase> {
   }
 };
 
+/// A model for providing operation pass specific utilities. Operation passes
+/// are run over each of the operations within a function whose regions are
+/// isolated from above, and these operations may be processed concurrently.
+///
+/// Operation passes must not:
+///   - read or modify any IR outside of the current operation, as other
+///     threads may be manipulating it concurrently.
+///   - modify the operands, results, or attributes of the current operation.
+///
+/// Derived operation passes are expected to provide the following:
+///   - A 'void runOnOperation()' method.
+template <typename T>
+struct OperationPass
+    : public detail::PassModel<Operation, T, OperationPassBase> {
+  /// A clone method to create a copy of this pass.
+  OperationPassBase *clone() const override {
+    return new T(*static_cast<const T *>(this));
+  }
+};
+
 /// A model for providing module pass specific utilities.
 ///
 /// Derived module passes are expected to provide the following:
@@ -284,6 +369,23 @@ struct ModulePass : public detail::PassModel<Module, T, ModulePassBase> {
     return this->getAnalysisManager()
         .template getCachedFunctionAnalysis<AnalysisT>(f);
   }
+
+  /// Mark the given function as changed by this pass. Once a function has been
+  /// marked, the analyses of any function that was not marked are preserved.
+  void markFunctionChanged(Function *f) {
+    auto &changedFunctions = this->getPassState().changedFunctions;
+    if (!changedFunctions)
+      changedFunctions.emplace();
+    changedFunctions->insert(f);
+  }
+
+  /// Mark that no function was changed by this pass, i.e. only the module
+  /// analyses that were not marked as preserved are invalidated.
+  void markFunctionsUnchanged() {
+    auto &changedFunctions = this->getPassState().changedFunctions;
+    if (!changedFunctions)
+      changedFunctions.emplace();
+  }
 };
 } // end namespace mlir
 
@@ -25,6 +25,7 @@
 
 namespace mlir {
 using AnalysisID = ClassID;
+struct GreedyRewriteStatistics;
 class Pass;
 
 namespace detail {
@@ -65,6 +66,14 @@ public:
   /// llvm::Any holding a pointer to the IR unit that was analyzed.
   virtual void runAfterAnalysis(llvm::StringRef name, AnalysisID *id,
                                 const llvm::Any &ir) {}
+
+  /// A callback to run after a pass has greedily applied a set of rewrite
+  /// patterns. This function takes a pointer to the pass being executed, the
+  /// statistics collected during the rewrite, as well as an llvm::Any holding
+  /// a pointer to the IR unit that was rewritten.
+  virtual void runAfterPatternRewrite(Pass *pass,
+                                      const GreedyRewriteStatistics &stats,
+                                      const llvm::Any &ir) {}
 };
 
 /// This class holds a collection of PassInstrumentation objects, and invokes
@@ -103,6 +112,13 @@ public:
     runAfterAnalysis(name, id, llvm::Any(ir));
   }
 
+  /// See PassInstrumentation::runAfterPatternRewrite for details.
+  template <typename IRUnitT>
+  void runAfterPatternRewrite(Pass *pass, const GreedyRewriteStatistics &stats,
+                              IRUnitT *ir) {
+    runAfterPatternRewrite(pass, stats, llvm::Any(ir));
+  }
+
   /// Add the given instrumentation to the collection. This takes ownership over
   /// the given pointer.
   void addInstrumentation(PassInstrumentation *pi);
@@ -125,6 +141,10 @@ private:
   void runAfterAnalysis(llvm::StringRef name, AnalysisID *id,
                         const llvm::Any &ir);
 
+  /// See PassInstrumentation::runAfterPatternRewrite for details.
+  void runAfterPatternRewrite(Pass *pass, const GreedyRewriteStatistics &stats,
+                              const llvm::Any &ir);
+
   std::unique_ptr<detail::PassInstrumentorImpl> impl;
 };
 
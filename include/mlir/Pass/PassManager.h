@@ -29,6 +29,7 @@ namespace mlir {
 class FunctionPassBase;
 class Module;
 class ModulePassBase;
+class OperationPassBase;
 class Pass;
 class PassInstrumentation;
 class PassInstrumentor;
@@ -79,6 +80,13 @@ public:
   /// executor if necessary.
   void addPass(FunctionPassBase *pass);
 
+  /// Add an operation pass to the current manager. This takes ownership over
+  /// the provided pass pointer. This will automatically create a function pass
+  /// and an operation pass executor if necessary. The pass is run over each of
+  /// the outermost operations within a function whose regions are isolated
+  /// from above.
+  void addPass(OperationPassBase *pass);
+
   //===--------------------------------------------------------------------===//
   // Instrumentations
   //===--------------------------------------------------------------------===//
@@ -106,8 +114,15 @@ public:
   void enableTiming(
       PassTimingDisplayMode displayMode = PassTimingDisplayMode::Pipeline);
 
+  /// Add an instrumentation to collect the attempts, successes, and time of
+  /// each rewrite pattern applied greedily by a pass, as well as the number of
+  /// scans needed for the rewrites to converge. The statistics are printed
+  /// when the pass manager is destroyed.
+  void enablePatternStatistics();
+
 private:
-  /// A stack of nested pass executors on sub-module IR units, e.g. function.
+  /// A stack of nested pass executors on sub-module IR units, e.g. function or
+  /// isolated operation.
   llvm::SmallVector<detail::PassExecutor *, 1> nestedExecutorStack;
 
   /// The top level module pass executor.
@@ -119,10 +134,21 @@ private:
   /// Flag that specifies if pass timing is enabled.
   bool passTiming : 1;
 
+  /// Flag that specifies if pattern statistics are enabled.
+  bool patternStatistics : 1;
+
   /// A manager for pass instrumentations.
   std::unique_ptr<PassInstrumentor> instrumentor;
 };
 
+/// Returns true if work started on the current thread may be run in parallel,
+/// i.e. if pass threading has not been disabled and the thread is not already
+/// one of several threads concurrently running a parallel pass adaptor. On
+/// such threads, utilities that process IR should run synchronously, as the
+/// threads are already in use and diagnostics are already being ordered by
+/// the adaptor.
+bool isParallelWorkAllowedOnCurrentThread();
+
 /// Register a set of useful command-line options that can be used to configure
 /// a pass manager. The values of these options can be applied via the
 /// 'applyPassManagerCLOptions' method below.
@@ -0,0 +1,172 @@
+//===- MPInt.h - Multi-precision integer ------------------------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file defines MPInt, a signed integer that never overflows. Its value is
+// held in an int64_t while it fits, and in an APInt of sufficient width
+// otherwise.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_SUPPORT_MPINT_H_
+#define MLIR_SUPPORT_MPINT_H_
+
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/Support/CheckedArithmetic.h"
+#include <limits>
+
+namespace mlir {
+
+/// A signed integer of arbitrary precision.  Operations on values that fit in
+/// 64 bits are performed with checked int64_t arithmetic, and only fall back to
+/// APInt when they overflow.  Results that fit in 64 bits again are converted
+/// back, so that the slow path is only taken while values are large.
+class MPInt {
+public:
+  MPInt(int64_t value = 0) : small(value), isLarge(false) {}
+  explicit MPInt(const APInt &value);
+
+  /// Return true if the value fits in an int64_t.
+  bool isSmall() const { return !isLarge; }
+
+  /// Return the value as an int64_t.  The value must fit in 64 bits.
+  int64_t getSmall() const {
+    assert(isSmall() && "value does not fit in 64 bits");
+    return small;
+  }
+
+  MPInt operator+(const MPInt &other) const {
+    if (isSmall() && other.isSmall())
+      if (auto result = llvm::checkedAdd(small, other.small))
+        return *result;
+    return addSlow(other);
+  }
+  MPInt operator-(const MPInt &other) const {
+    if (isSmall() && other.isSmall())
+      if (auto result = llvm::checkedSub(small, other.small))
+        return *result;
+    return subSlow(other);
+  }
+  MPInt operator*(const MPInt &other) const {
+    if (isSmall() && other.isSmall())
+      if (auto result = llvm::checkedMul(small, other.small))
+        return *result;
+    return mulSlow(other);
+  }
+  /// Division rounding towards zero.
+  MPInt operator/(const MPInt &other) const {
+    assert(other != 0 && "division by zero");
+    if (isSmall() && other.isSmall() &&
+        !(small == std::numeric_limits<int64_t>::min() && other.small == -1))
+      return small / other.small;
+    return divSlow(other);
+  }
+  /// Remainder of the division rounding towards zero.
+  MPInt operator%(const MPInt &other) const {
+    assert(other != 0 && "division by zero");
+    if (isSmall() && other.isSmall())
+      return other.small == -1 ? 0 : small % other.small;
+    return remSlow(other);
+  }
+  MPInt operator-() const {
+    if (isSmall() && small != std::numeric_limits<int64_t>::min())
+      return -small;
+    return MPInt(0) - *this;
+  }
+
+  MPInt &operator+=(const MPInt &other) { return *this = *this + other; }
+  MPInt &operator-=(const MPInt &other) { return *this = *this - other; }
+  MPInt &operator*=(const MPInt &other) { return *this = *this * other; }
+  MPInt &operator/=(const MPInt &other) { return *this = *this / other; }
+  MPInt &operator%=(const MPInt &other) { return *this = *this % other; }
+
+  /// Return -1, 0, or 1 if this value is less than, equal to, or greater than
+  /// 'other'.
+  int compare(const MPInt &other) const {
+    if (isSmall() && other.isSmall())
+      return small < other.small ? -1 : (small > other.small ? 1 : 0);
+    return compareSlow(other);
+  }
+  bool operator==(const MPInt &other) const { return compare(other) == 0; }
+  bool operator!=(const MPInt &other) const { return compare(other) != 0; }
+  bool operator<(const MPInt &other) const { return compare(other) < 0; }
+  bool operator<=(const MPInt &other) const { return compare(other) <= 0; }
+  bool operator>(const MPInt &other) const { return compare(other) > 0; }
+  bool operator>=(const MPInt &other) const { return compare(other) >= 0; }
+
+  void print(raw_ostream &os) const;
+  void dump() const;
+
+private:
+  /// Return the value as an APInt of at least 64 bits.
+  APInt getAsAPInt() const;
+
+  MPInt addSlow(const MPInt &other) const;
+  MPInt subSlow(const MPInt &other) const;
+  MPInt mulSlow(const MPInt &other) const;
+  MPInt divSlow(const MPInt &other) const;
+  MPInt remSlow(const MPInt &other) const;
+  int compareSlow(const MPInt &other) const;
+
+  /// The value, if it fits in 64 bits.
+  int64_t small;
+
+  /// The value, if it does not fit in 64 bits.
+  APInt large;
+
+  /// Whether the value is held by 'large'.
+  bool isLarge;
+};
+
+inline raw_ostream &operator<<(raw_ostream &os, const MPInt &value) {
+  value.print(os);
+  return os;
+}
+
+/// Returns the absolute value of 'value'.
+inline MPInt abs(const MPInt &value) { return value < 0 ? -value : value; }
+
+/// Returns the non-negative greatest common divisor of 'a' and 'b'.  The GCD
+/// of zero and zero is zero.
+MPInt gcd(const MPInt &a, const MPInt &b);
+
+/// Returns the non-negative least common multiple of 'a' and 'b'.
+inline MPInt lcm(const MPInt &a, const MPInt &b) {
+  if (a == 0 || b == 0)
+    return 0;
+  return abs(a / gcd(a, b) * b);
+}
+
+/// Returns 'lhs' divided by 'rhs', rounded towards negative infinity.
+inline MPInt floorDiv(const MPInt &lhs, const MPInt &rhs) {
+  MPInt quotient = lhs / rhs;
+  MPInt remainder = lhs % rhs;
+  return (remainder != 0 && (remainder < 0) != (rhs < 0)) ? quotient - 1
+                                                          : quotient;
+}
+
+/// Returns 'lhs' divided by 'rhs', rounded towards positive infinity.
+inline MPInt ceilDiv(const MPInt &lhs, const MPInt &rhs) {
+  MPInt quotient = lhs / rhs;
+  MPInt remainder = lhs % rhs;
+  return (remainder != 0 && (remainder < 0) == (rhs < 0)) ? quotient + 1
+                                                          : quotient;
+}
+
+} // end namespace mlir
+
+#endif // MLIR_SUPPORT_MPINT_H_
@@ -69,6 +69,11 @@ using has_impltype_hash_t = decltype(ImplTy::hashKey(std::declval<T>()));
 ///      that is called when erasing a storage instance. This should cleanup any
 ///      fields of the storage as necessary and not attempt to free the memory
 ///      of the storage itself.
+///
+/// The uniquer is thread-safe. Instances are partitioned into shards by hash
+/// value: lookups of existing instances never acquire a lock, and creating a
+/// new instance only locks the shard that it belongs to. As such, 'construct'
+/// must not recursively get instances from the same uniquer.
 class StorageUniquer {
 public:
   StorageUniquer();
@@ -28,14 +28,15 @@
 namespace mlir {
 class Function;
 class Operation;
+class Region;
 class Value;
 
 /// A utility class for folding operations, and unifying duplicated constants
 /// generated along the way.
 ///
 /// To make sure constants properly dominate all their uses, constants are
-/// moved to the beginning of the entry block of the function when tracked by
-/// this class.
+/// moved to the beginning of the entry block of the function, or region, when
+/// tracked by this class.
 class OperationFolder {
 public:
   /// Constructs an instance for managing constants in the given function `f`.
@@ -45,16 +46,23 @@ public:
   /// This instance does not proactively walk the operations inside `f`;
   /// instead, users must invoke the following methods to manually handle each
   /// operation of interest.
-  OperationFolder(Function *f) : function(f) {}
+  OperationFolder(Function *f);
+
+  /// Constructs an instance for managing constants in the given region, e.g.
+  /// a region that is isolated from above. Constants tracked by this instance
+  /// will be moved to the top of the entry block of `region`.
+  OperationFolder(Region *region) : region(region) {}
 
   /// Tries to perform folding on the given `op`, including unifying
   /// deduplicated constants. If successful, calls `preReplaceAction` (if
   /// provided) by passing in `op`, then replaces `op`'s uses with folded
   /// results, and returns success. If the op was completely folded it is
-  /// erased.
+  /// erased. If `inPlaceUpdate` is provided, it is set to true if the op was
+  /// instead updated in place.
   LogicalResult
   tryToFold(Operation *op,
-            std::function<void(Operation *)> preReplaceAction = {});
+            std::function<void(Operation *)> preReplaceAction = {},
+            bool *inPlaceUpdate = nullptr);
 
   /// Notifies that the given constant `op` should be remove from this
   /// OperationFolder's internal bookkeeping.
@@ -114,8 +122,8 @@ private:
   /// Moves the given constant `op` to entry block to guarantee dominance.
   void moveConstantToEntryBlock(Operation *op);
 
-  /// The function where we are managing constant.
-  Function *function;
+  /// The region where we are managing constants.
+  Region *region;
 
   /// This map keeps track of uniqued constants.
   DenseMap<std::pair<Attribute, Type>, Operation *> uniquedConstants;
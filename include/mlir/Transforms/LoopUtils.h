@@ -31,6 +31,7 @@ namespace mlir {
 class AffineMap;
 class AffineForOp;
 class Function;
+class MemRefDependenceAnalysis;
 class OpBuilder;
 class Value;
 
@@ -91,10 +92,13 @@ LogicalResult instBodySkew(AffineForOp forOp, ArrayRef<uint64_t> shifts,
                            bool unrollPrologueEpilogue = false);
 
 /// Tiles the specified band of perfectly nested loops creating tile-space loops
-/// and intra-tile loops. A band is a contiguous set of loops.
+/// and intra-tile loops. A band is a contiguous set of loops. If 'tiledNest' is
+/// non-null, it is populated with the tile-space loops followed by the
+/// intra-tile loops of the new loop nest.
 LLVM_NODISCARD
 LogicalResult tileCodeGen(MutableArrayRef<AffineForOp> band,
-                          ArrayRef<unsigned> tileSizes);
+                          ArrayRef<unsigned> tileSizes,
+                          SmallVectorImpl<AffineForOp> *tiledNest = nullptr);
 
 /// Performs loop interchange on 'forOpA' and 'forOpB'. Requires that 'forOpA'
 /// and 'forOpB' are part of a perfectly nested sequence of loops.
@@ -103,8 +107,10 @@ void interchangeLoops(AffineForOp forOpA, AffineForOp forOpB);
 /// Checks if the loop interchange permutation 'loopPermMap', of the perfectly
 /// nested sequence of loops in 'loops', would violate dependences (loop 'i' in
 /// 'loops' is mapped to location 'j = 'loopPermMap[i]' in the interchange).
-bool isValidLoopInterchangePermutation(ArrayRef<AffineForOp> loops,
-                                       ArrayRef<unsigned> loopPermMap);
+/// Dependences are checked through 'depAnalysis' if it is non-null.
+bool isValidLoopInterchangePermutation(
+    ArrayRef<AffineForOp> loops, ArrayRef<unsigned> loopPermMap,
+    MemRefDependenceAnalysis *depAnalysis = nullptr);
 
 /// Performs a sequence of loop interchanges on perfectly nested 'loops', as
 /// specified by permutation 'loopPermMap' (loop 'i' in 'loops' is mapped to
@@ -116,7 +122,11 @@ unsigned interchangeLoops(ArrayRef<AffineForOp> loops,
 // relative order among them) and moves all parallel loops to the
 // outermost (while again preserving relative order among them).
 // Returns AffineForOp of the root of the new loop nest after loop interchanges.
-AffineForOp sinkSequentialLoops(AffineForOp forOp);
+// Dependences are checked through 'depAnalysis' if it is non-null, in which
+// case its results for the nest are invalidated when loops are interchanged.
+AffineForOp
+sinkSequentialLoops(AffineForOp forOp,
+                    MemRefDependenceAnalysis *depAnalysis = nullptr);
 
 /// Sinks 'forOp' by 'loopDepth' levels by performing a series of loop
 /// interchanges. Requires that 'forOp' is part of a perfect nest with
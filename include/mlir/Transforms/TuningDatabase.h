@@ -0,0 +1,114 @@
+//===- TuningDatabase.h - Tuned loop transformation parameters --*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This header file defines a database of the parameters of loop
+// transformations found to perform best on given loop nests, e.g. by the
+// autotuner of mlir-cpu-runner, and the structural hash of loop nests that
+// keys it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_TRANSFORMS_TUNING_DATABASE_H
+#define MLIR_TRANSFORMS_TUNING_DATABASE_H
+
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/SmallVector.h"
+#include <map>
+#include <string>
+
+namespace mlir {
+
+class AffineForOp;
+
+/// Returns a hash of the structure of the loop nest rooted at 'forOp': the
+/// operations it contains, their attributes, types and regions, and how their
+/// operands are defined. The hash does not depend on the names of the values
+/// nor on the location of the loop nest, so that identical loop nests in
+/// different functions or modules have the same hash.
+uint64_t hashLoopNest(AffineForOp forOp);
+
+/// The loop transformations whose parameters are recorded in the database.
+enum class TuningParameterKind {
+  /// The tile sizes of the perfect loop nest rooted at the loop, or no
+  /// parameters if the nest is best left untiled.
+  TileSizes,
+  /// The unroll factor of an innermost loop.
+  UnrollFactor,
+  /// The unroll-and-jam factor of a loop.
+  UnrollJamFactor,
+};
+
+/// The parameters of a transformation tuned for a loop nest, and the execution
+/// time measured with them.
+struct TuningRecord {
+  SmallVector<unsigned, 6> parameters;
+  double executionTime = 0.0;
+};
+
+/// A database of tuned transformation parameters keyed by the kind of the
+/// transformation and the structural hash of the loop it is applied to. Each
+/// transformation looks its loops up when it is applied, so the recorded
+/// hashes are those of the loops as they are after the transformations that
+/// come before in the pipeline: tiling, then unroll-and-jam, then unrolling.
+///
+/// The textual form of the database holds one record per line:
+///
+///   <kind> <hash> <execution time> <parameters...>
+///
+/// where the kind is one of 'tile', 'unroll' or 'unroll-jam', the hash is
+/// hexadecimal and the parameters are separated by spaces. Lines starting with
+/// '#' are ignored.
+class TuningDatabase {
+public:
+  /// Returns the record of the loop with structural hash 'hash' for
+  /// transformation 'kind', or null if there is none.
+  const TuningRecord *lookup(TuningParameterKind kind, uint64_t hash) const;
+
+  /// Records 'parameters' for the loop with structural hash 'hash', replacing
+  /// any previous record.
+  void insert(TuningParameterKind kind, uint64_t hash,
+              ArrayRef<unsigned> parameters, double executionTime);
+
+  bool empty() const { return records.empty(); }
+  size_t size() const { return records.size(); }
+
+  /// Adds the records of the textual database 'contents'. Returns failure and
+  /// sets 'errorMessage' if it is malformed.
+  LogicalResult parse(StringRef contents, std::string *errorMessage = nullptr);
+  void print(raw_ostream &os) const;
+
+  /// Adds the records of the file 'filename', or writes the database to it.
+  LogicalResult load(StringRef filename, std::string *errorMessage = nullptr);
+  LogicalResult save(StringRef filename,
+                     std::string *errorMessage = nullptr) const;
+
+private:
+  std::map<std::pair<TuningParameterKind, uint64_t>, TuningRecord> records;
+};
+
+/// Returns the name of the file given with -tuning-db, or an empty string.
+StringRef getTuningDatabaseFilename();
+
+/// Returns the database loaded from the file given with -tuning-db, or null if
+/// there is none. The file is loaded on the first call; errors are reported on
+/// stderr and yield an empty database.
+const TuningDatabase *getCommandLineTuningDatabase();
+
+} // end namespace mlir
+
+#endif // MLIR_TRANSFORMS_TUNING_DATABASE_H
@@ -1019,7 +1019,7 @@ struct AffineForLoopBoundFolder : public OpRewritePattern<AffineForOp> {
 
   PatternMatchResult matchAndRewrite(AffineForOp forOp,
                                      PatternRewriter &rewriter) const override {
-    auto foldLowerOrUpperBound = [&forOp](bool lower) {
+    auto foldLowerOrUpperBound = [&forOp, &rewriter](bool lower) {
       // Check to see if each of the operands is the result of a constant.  If
       // so, get the value.  If not, ignore it.
       SmallVector<Attribute, 8> operandConstants;
@@ -1048,6 +1048,7 @@ struct AffineForLoopBoundFolder : public OpRewritePattern<AffineForOp> {
         maxOrMin = lower ? llvm::APIntOps::smax(maxOrMin, foldedResult)
                          : llvm::APIntOps::smin(maxOrMin, foldedResult);
       }
+      rewriter.startRootUpdate(forOp);
       lower ? forOp.setConstantLowerBound(maxOrMin.getSExtValue())
             : forOp.setConstantUpperBound(maxOrMin.getSExtValue());
       return success();
@@ -1097,11 +1098,9 @@ void AffineForOp::setLowerBound(ArrayRef<Value *> lbOperands, AffineMap map) {
   assert(lbOperands.size() == map.getNumInputs());
   assert(map.getNumResults() >= 1 && "bound map has at least one result");
 
-  SmallVector<Value *, 4> newOperands(lbOperands.begin(), lbOperands.end());
-
-  auto ubOperands = getUpperBoundOperands();
-  newOperands.append(ubOperands.begin(), ubOperands.end());
-  getOperation()->setOperands(newOperands);
+  // Replace the current lower bound operands in place.
+  getOperation()->setOperands(/*start=*/0, getLowerBoundMap().getNumInputs(),
+                              lbOperands);
 
   setAttr(getLowerBoundAttrName(), AffineMapAttr::get(map));
 }
@@ -1110,9 +1109,9 @@ void AffineForOp::setUpperBound(ArrayRef<Value *> ubOperands, AffineMap map) {
   assert(ubOperands.size() == map.getNumInputs());
   assert(map.getNumResults() >= 1 && "bound map has at least one result");
 
-  SmallVector<Value *, 4> newOperands(getLowerBoundOperands());
-  newOperands.append(ubOperands.begin(), ubOperands.end());
-  getOperation()->setOperands(newOperands);
+  // Replace the current upper bound operands in place.
+  getOperation()->setOperands(getLowerBoundMap().getNumInputs(),
+                              getUpperBoundMap().getNumInputs(), ubOperands);
 
   setAttr(getUpperBoundAttrName(), AffineMapAttr::get(map));
 }
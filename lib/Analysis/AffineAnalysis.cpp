@@ -32,6 +32,7 @@
 #include "mlir/Support/MathExtras.h"
 #include "mlir/Support/STLExtras.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -679,6 +680,71 @@ void MemRefAccess::getAccessMap(AffineValueMap *accessMap) const {
   accessMap->reset(map, operands);
 }
 
+// Checks the dependence between 'srcAccess' and 'dstAccess' given their access
+// functions and iteration domains, see checkMemrefAccessDependence below.
+static DependenceResult checkMemrefAccessDependenceImpl(
+    const MemRefAccess &srcAccess, const MemRefAccess &dstAccess,
+    const AffineValueMap &srcAccessMap, const AffineValueMap &dstAccessMap,
+    const FlatAffineConstraints &srcDomain,
+    const FlatAffineConstraints &dstDomain, unsigned loopDepth,
+    FlatAffineConstraints *dependenceConstraints,
+    llvm::SmallVector<DependenceComponent, 2> *dependenceComponents,
+    bool allowRAR) {
+  // Return 'NoDependence' if loopDepth > numCommonLoops and if the ancestor
+  // operation of 'srcAccess' does not properly dominate the ancestor
+  // operation of 'dstAccess' in the same common operation block.
+  // Note: this check is skipped if 'allowRAR' is true, because because RAR
+  // deps can exist irrespective of lexicographic ordering b/w src and dst.
+  unsigned numCommonLoops = getNumCommonLoops(srcDomain, dstDomain);
+  assert(loopDepth <= numCommonLoops + 1);
+  if (!allowRAR && loopDepth > numCommonLoops &&
+      !srcAppearsBeforeDstInAncestralBlock(srcAccess, dstAccess, srcDomain,
+                                           numCommonLoops)) {
+    return DependenceResult::NoDependence;
+  }
+  // Build dim and symbol position maps for each access from access operand
+  // Value to position in merged contstraint system.
+  ValuePositionMap valuePosMap;
+  buildDimAndSymbolPositionMaps(srcDomain, dstDomain, srcAccessMap,
+                                dstAccessMap, &valuePosMap,
+                                dependenceConstraints);
+
+  initDependenceConstraints(srcDomain, dstDomain, srcAccessMap, dstAccessMap,
+                            valuePosMap, dependenceConstraints);
+
+  assert(valuePosMap.getNumDims() ==
+         srcDomain.getNumDimIds() + dstDomain.getNumDimIds());
+
+  // Create memref access constraint by equating src/dst access functions.
+  // Note that this check is conservative, and will fail in the future when
+  // local variables for mod/div exprs are supported.
+  if (failed(addMemRefAccessConstraints(srcAccessMap, dstAccessMap, valuePosMap,
+                                        dependenceConstraints)))
+    return DependenceResult::Failure;
+
+  // Add 'src' happens before 'dst' ordering constraints.
+  addOrderingConstraints(srcDomain, dstDomain, loopDepth,
+                         dependenceConstraints);
+  // Add src and dst domain constraints.
+  addDomainConstraints(srcDomain, dstDomain, valuePosMap,
+                       dependenceConstraints);
+
+  // Return 'NoDependence' if the solution space is empty: no dependence.
+  if (dependenceConstraints->isEmpty()) {
+    return DependenceResult::NoDependence;
+  }
+
+  // Compute dependence direction vector and return true.
+  if (dependenceComponents != nullptr) {
+    computeDirectionVector(srcDomain, dstDomain, loopDepth,
+                           dependenceConstraints, dependenceComponents);
+  }
+
+  LLVM_DEBUG(llvm::dbgs() << "Dependence polyhedron:\n");
+  LLVM_DEBUG(dependenceConstraints->dump());
+  return DependenceResult::HasDependence;
+}
+
 // Builds a flat affine constraint system to check if there exists a dependence
 // between memref accesses 'srcAccess' and 'dstAccess'.
 // Returns 'NoDependence' if the accesses can be definitively shown not to
@@ -803,66 +869,119 @@ DependenceResult mlir::checkMemrefAccessDependence(
   if (failed(getInstIndexSet(dstAccess.opInst, &dstDomain)))
     return DependenceResult::Failure;
 
-  // Return 'NoDependence' if loopDepth > numCommonLoops and if the ancestor
-  // operation of 'srcAccess' does not properly dominate the ancestor
-  // operation of 'dstAccess' in the same common operation block.
-  // Note: this check is skipped if 'allowRAR' is true, because because RAR
-  // deps can exist irrespective of lexicographic ordering b/w src and dst.
-  unsigned numCommonLoops = getNumCommonLoops(srcDomain, dstDomain);
-  assert(loopDepth <= numCommonLoops + 1);
-  if (!allowRAR && loopDepth > numCommonLoops &&
-      !srcAppearsBeforeDstInAncestralBlock(srcAccess, dstAccess, srcDomain,
-                                           numCommonLoops)) {
-    return DependenceResult::NoDependence;
-  }
-  // Build dim and symbol position maps for each access from access operand
-  // Value to position in merged contstraint system.
-  ValuePositionMap valuePosMap;
-  buildDimAndSymbolPositionMaps(srcDomain, dstDomain, srcAccessMap,
-                                dstAccessMap, &valuePosMap,
-                                dependenceConstraints);
+  return checkMemrefAccessDependenceImpl(
+      srcAccess, dstAccess, srcAccessMap, dstAccessMap, srcDomain, dstDomain,
+      loopDepth, dependenceConstraints, dependenceComponents, allowRAR);
+}
 
-  initDependenceConstraints(srcDomain, dstDomain, srcAccessMap, dstAccessMap,
-                            valuePosMap, dependenceConstraints);
+/// The access function and iteration domain of a load or store operation.
+struct MemRefDependenceAnalysis::AccessInfo {
+  AffineValueMap accessMap;
+  FlatAffineConstraints domain;
+  /// Whether the iteration domain could not be computed.
+  bool failed = false;
+};
 
-  assert(valuePosMap.getNumDims() ==
-         srcDomain.getNumDimIds() + dstDomain.getNumDimIds());
+/// The cached result of a dependence check between two accesses.
+struct MemRefDependenceAnalysis::PairResult {
+  PairResult(DependenceResult result) : result(result) {}
 
-  // Create memref access constraint by equating src/dst access functions.
-  // Note that this check is conservative, and will fail in the future when
-  // local variables for mod/div exprs are supported.
-  if (failed(addMemRefAccessConstraints(srcAccessMap, dstAccessMap, valuePosMap,
-                                        dependenceConstraints)))
-    return DependenceResult::Failure;
+  DependenceResult result;
+  /// Whether 'components' holds the components of the dependence. They are
+  /// only computed for the queries that request them.
+  bool hasComponents = false;
+  llvm::SmallVector<DependenceComponent, 2> components;
+};
 
-  // Add 'src' happens before 'dst' ordering constraints.
-  addOrderingConstraints(srcDomain, dstDomain, loopDepth,
-                         dependenceConstraints);
-  // Add src and dst domain constraints.
-  addDomainConstraints(srcDomain, dstDomain, valuePosMap,
-                       dependenceConstraints);
+MemRefDependenceAnalysis::~MemRefDependenceAnalysis() {}
 
-  // Return 'NoDependence' if the solution space is empty: no dependence.
-  if (dependenceConstraints->isEmpty()) {
+const MemRefDependenceAnalysis::AccessInfo &
+MemRefDependenceAnalysis::getAccessInfo(const MemRefAccess &access) {
+  auto &info = accessInfos[access.opInst];
+  if (!info) {
+    info = llvm::make_unique<AccessInfo>();
+    access.getAccessMap(&info->accessMap);
+    info->failed = failed(getInstIndexSet(access.opInst, &info->domain));
+  }
+  return *info;
+}
+
+DependenceResult MemRefDependenceAnalysis::checkDependence(
+    const MemRefAccess &srcAccess, const MemRefAccess &dstAccess,
+    unsigned loopDepth,
+    llvm::SmallVector<DependenceComponent, 2> *dependenceComponents,
+    bool allowRAR) {
+  // These checks are cheaper than a cache lookup.
+  if (srcAccess.memref != dstAccess.memref)
     return DependenceResult::NoDependence;
+  if (!allowRAR && !isa<StoreOp>(srcAccess.opInst) &&
+      !isa<StoreOp>(dstAccess.opInst))
+    return DependenceResult::NoDependence;
+
+  PairKey key = {{srcAccess.opInst, dstAccess.opInst},
+                 (loopDepth << 1) | static_cast<unsigned>(allowRAR)};
+  auto &pair = pairResults[key];
+  if (pair && (!dependenceComponents || pair->hasComponents ||
+               !hasDependence(pair->result))) {
+    ++numHits;
+    if (dependenceComponents)
+      *dependenceComponents = pair->components;
+    return pair->result;
   }
 
-  // Compute dependence direction vector and return true.
-  if (dependenceComponents != nullptr) {
-    computeDirectionVector(srcDomain, dstDomain, loopDepth,
-                           dependenceConstraints, dependenceComponents);
+  ++numMisses;
+  const AccessInfo &srcInfo = getAccessInfo(srcAccess);
+  const AccessInfo &dstInfo = getAccessInfo(dstAccess);
+  FlatAffineConstraints dependenceConstraints;
+  llvm::SmallVector<DependenceComponent, 2> components;
+  DependenceResult result =
+      srcInfo.failed || dstInfo.failed
+          ? DependenceResult::Failure
+          : checkMemrefAccessDependenceImpl(
+                srcAccess, dstAccess, srcInfo.accessMap, dstInfo.accessMap,
+                srcInfo.domain, dstInfo.domain, loopDepth,
+                &dependenceConstraints,
+                dependenceComponents ? &components : nullptr, allowRAR);
+
+  pair = llvm::make_unique<PairResult>(result);
+  if (dependenceComponents) {
+    pair->hasComponents = true;
+    pair->components = components;
+    *dependenceComponents = std::move(components);
   }
+  return result;
+}
 
-  LLVM_DEBUG(llvm::dbgs() << "Dependence polyhedron:\n");
-  LLVM_DEBUG(dependenceConstraints->dump());
-  return DependenceResult::HasDependence;
+void MemRefDependenceAnalysis::invalidate(Operation *op) {
+  llvm::SmallPtrSet<Operation *, 8> accesses;
+  op->walk([&](Operation *nestedOp) {
+    if (isa<LoadOp>(nestedOp) || isa<StoreOp>(nestedOp)) {
+      accessInfos.erase(nestedOp);
+      accesses.insert(nestedOp);
+    }
+  });
+  if (accesses.empty())
+    return;
+
+  for (auto it = pairResults.begin(), e = pairResults.end(); it != e;) {
+    auto cur = it++;
+    if (accesses.count(cur->first.first.first) ||
+        accesses.count(cur->first.first.second))
+      pairResults.erase(cur);
+  }
+}
+
+void MemRefDependenceAnalysis::clear() {
+  accessInfos.clear();
+  pairResults.clear();
 }
 
 /// Gathers dependence components for dependences between all ops in loop nest
 /// rooted at 'forOp' at loop depths in range [1, maxLoopDepth].
 void mlir::getDependenceComponents(
     AffineForOp forOp, unsigned maxLoopDepth,
-    std::vector<llvm::SmallVector<DependenceComponent, 2>> *depCompsVec) {
+    std::vector<llvm::SmallVector<DependenceComponent, 2>> *depCompsVec,
+    MemRefDependenceAnalysis *depAnalysis) {
   // Collect all load and store ops in loop nest rooted at 'forOp'.
   SmallVector<Operation *, 8> loadAndStoreOpInsts;
   forOp.getOperation()->walk([&](Operation *opInst) {
@@ -881,10 +1000,13 @@ void mlir::getDependenceComponents(
 
         FlatAffineConstraints dependenceConstraints;
         llvm::SmallVector<DependenceComponent, 2> depComps;
-        // TODO(andydavis,bondhugula) Explore whether it would be profitable
-        // to pre-compute and store deps instead of repeatedly checking.
-        DependenceResult result = checkMemrefAccessDependence(
-            srcAccess, dstAccess, d, &dependenceConstraints, &depComps);
+        DependenceResult result =
+            depAnalysis
+                ? depAnalysis->checkDependence(srcAccess, dstAccess, d,
+                                               &depComps)
+                : checkMemrefAccessDependence(srcAccess, dstAccess, d,
+                                              &dependenceConstraints,
+                                              &depComps);
         if (hasDependence(result))
           depCompsVec->push_back(depComps);
       }
@@ -21,6 +21,7 @@
 
 #include "mlir/Analysis/AffineStructures.h"
 #include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/Simplex.h"
 #include "mlir/IR/AffineExprVisitor.h"
 #include "mlir/IR/AffineMap.h"
 #include "mlir/IR/IntegerSet.h"
@@ -1031,11 +1032,26 @@ static unsigned getBestIdToEliminate(const FlatAffineConstraints &cst,
   return minLoc;
 }
 
+// Checks for emptiness of the set with a Simplex tableau, which is exact over
+// the rationals and whose branch and bound search for integer points is exact
+// whenever it completes. Returns 'true' if the constraint system is found to
+// be empty; false otherwise.
+bool FlatAffineConstraints::isEmpty() const {
+  if (isEmptyByGCDTest() || hasInvalidConstraint())
+    return true;
+
+  Simplex simplex(*this);
+  if (Optional<bool> result = simplex.isIntegerEmpty())
+    return *result;
+  LLVM_DEBUG(llvm::dbgs() << "Simplex branch and bound gave up\n");
+  return isEmptyByElimination();
+}
+
 // Checks for emptiness of the set by eliminating identifiers successively and
 // using the GCD test (on all equality constraints) and checking for trivially
 // invalid constraints. Returns 'true' if the constraint system is found to be
 // empty; false otherwise.
-bool FlatAffineConstraints::isEmpty() const {
+bool FlatAffineConstraints::isEmptyByElimination() const {
   if (isEmptyByGCDTest() || hasInvalidConstraint())
     return true;
 
@@ -0,0 +1,329 @@
+//===- Simplex.cpp - MLIR Simplex Class -----------------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Analysis/Simplex.h"
+#include "mlir/Analysis/AffineStructures.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace mlir;
+
+constexpr unsigned Simplex::kMaxBranches;
+
+Simplex::Simplex(unsigned numVariables) : numVariables(numVariables) {
+  // The denominator and constant columns are not associated with an unknown.
+  colUnknown.append(2, ~0u);
+  for (unsigned i = 0; i < numVariables; ++i) {
+    unknowns.emplace_back(/*isRow=*/false, /*restricted=*/false, i + 2);
+    colUnknown.push_back(i);
+  }
+}
+
+Simplex::Simplex(const FlatAffineConstraints &constraints)
+    : Simplex(constraints.getNumIds()) {
+  for (unsigned i = 0, e = constraints.getNumEqualities(); i < e; ++i)
+    addEquality(constraints.getEquality(i));
+  for (unsigned i = 0, e = constraints.getNumInequalities(); i < e; ++i)
+    addInequality(constraints.getInequality(i));
+}
+
+void Simplex::addInequality(ArrayRef<int64_t> coeffs) {
+  SmallVector<MPInt, 8> mpCoeffs(coeffs.begin(), coeffs.end());
+  addInequalityRow(mpCoeffs);
+}
+
+void Simplex::addEquality(ArrayRef<int64_t> coeffs) {
+  // An equality is the conjunction of two opposite inequalities.
+  SmallVector<MPInt, 8> mpCoeffs(coeffs.begin(), coeffs.end());
+  addInequalityRow(mpCoeffs);
+  for (auto &coeff : mpCoeffs)
+    coeff = -coeff;
+  addInequalityRow(mpCoeffs);
+}
+
+void Simplex::addInequalityRow(ArrayRef<MPInt> coeffs) {
+  assert(coeffs.size() == numVariables + 1 &&
+         "incorrect number of coefficients");
+  unsigned numCols = getNumColumns();
+  unsigned row = getNumRows();
+  tableau.resize(tableau.size() + numCols, MPInt(0));
+  at(row, 0) = 1;
+  at(row, 1) = coeffs.back();
+
+  // Express the constraint in terms of the column unknowns: a variable that
+  // is a column adds to its coefficient, and a variable that is a row adds a
+  // multiple of its row.
+  for (unsigned i = 0; i < numVariables; ++i) {
+    if (coeffs[i] == 0)
+      continue;
+    const Unknown &var = unknowns[i];
+    if (!var.isRow) {
+      at(row, var.pos) += coeffs[i] * at(row, 0);
+      continue;
+    }
+
+    // Bring both rows to a common denominator before adding them.
+    MPInt denom = lcm(at(row, 0), at(var.pos, 0));
+    MPInt rowScale = denom / at(row, 0);
+    MPInt varScale = coeffs[i] * (denom / at(var.pos, 0));
+    at(row, 0) = denom;
+    for (unsigned col = 1; col < numCols; ++col)
+      at(row, col) = at(row, col) * rowScale + at(var.pos, col) * varScale;
+  }
+  normalizeRow(row);
+
+  unsigned index = unknowns.size();
+  unknowns.emplace_back(/*isRow=*/true, /*restricted=*/true, row);
+  rowUnknown.push_back(index);
+  undoLog.push_back(UndoLogEntry::RemoveLastConstraint);
+
+  // Once the constraints are known to be empty, the tableau is no longer kept
+  // consistent: the constraints added from then on are only rolled back.
+  if (!empty && failed(restoreRow(index))) {
+    empty = true;
+    undoLog.push_back(UndoLogEntry::UnmarkEmpty);
+  }
+}
+
+void Simplex::normalizeRow(unsigned row) {
+  MPInt divisor = 0;
+  for (unsigned col = 0, e = getNumColumns(); col < e; ++col) {
+    divisor = gcd(divisor, at(row, col));
+    if (divisor == 1)
+      return;
+  }
+  for (unsigned col = 0, e = getNumColumns(); col < e; ++col)
+    at(row, col) /= divisor;
+}
+
+void Simplex::pivot(unsigned pivotRow, unsigned pivotCol) {
+  Unknown &rowUnk = getUnknownForRow(pivotRow);
+  Unknown &colUnk = getUnknownForColumn(pivotCol);
+  rowUnk.isRow = false;
+  rowUnk.pos = pivotCol;
+  colUnk.isRow = true;
+  colUnk.pos = pivotRow;
+  std::swap(rowUnknown[pivotRow], colUnknown[pivotCol]);
+
+  // The pivot row 'd * r = c + a * x + ...' becomes 'a * x = d * r - c - ...'
+  // where 'a' is the new denominator, which is kept positive.
+  unsigned numCols = getNumColumns();
+  std::swap(at(pivotRow, 0), at(pivotRow, pivotCol));
+  if (at(pivotRow, 0) < 0) {
+    at(pivotRow, 0) = -at(pivotRow, 0);
+    at(pivotRow, pivotCol) = -at(pivotRow, pivotCol);
+  } else {
+    for (unsigned col = 1; col < numCols; ++col)
+      if (col != pivotCol)
+        at(pivotRow, col) = -at(pivotRow, col);
+  }
+  normalizeRow(pivotRow);
+
+  // Substitute the new expression of 'x' in the other rows.
+  for (unsigned row = 0, e = getNumRows(); row < e; ++row) {
+    if (row == pivotRow || at(row, pivotCol) == 0)
+      continue;
+    at(row, 0) *= at(pivotRow, 0);
+    for (unsigned col = 1; col < numCols; ++col) {
+      if (col == pivotCol)
+        continue;
+      at(row, col) = at(row, col) * at(pivotRow, 0) +
+                     at(row, pivotCol) * at(pivotRow, col);
+    }
+    at(row, pivotCol) *= at(pivotRow, pivotCol);
+    normalizeRow(row);
+  }
+}
+
+Optional<std::pair<unsigned, unsigned>>
+Simplex::findPivot(unsigned row, Direction direction) const {
+  Optional<unsigned> pivotCol;
+  for (unsigned col = 2, e = getNumColumns(); col < e; ++col) {
+    const MPInt &elem = at(row, col);
+    if (elem == 0)
+      continue;
+    // The value of a restricted column unknown is zero, so it can only be
+    // increased.
+    if (getUnknownForColumn(col).restricted &&
+        (elem > 0) != (direction == Direction::Up))
+      continue;
+    // Pick the column with the lowest unknown (Bland's rule), which prevents
+    // cycling.
+    if (!pivotCol || colUnknown[col] < colUnknown[*pivotCol])
+      pivotCol = col;
+  }
+  if (!pivotCol)
+    return llvm::None;
+
+  Direction colDirection =
+      (at(row, *pivotCol) > 0) == (direction == Direction::Up)
+          ? Direction::Up
+          : Direction::Down;
+  Optional<unsigned> pivotRow = findPivotRow(row, colDirection, *pivotCol);
+  return std::make_pair(pivotRow ? *pivotRow : row, *pivotCol);
+}
+
+Optional<unsigned> Simplex::findPivotRow(Optional<unsigned> skipRow,
+                                         Direction direction,
+                                         unsigned col) const {
+  Optional<unsigned> pivotRow;
+  MPInt pivotConst, pivotCoeff;
+  for (unsigned row = 0, e = getNumRows(); row < e; ++row) {
+    if (skipRow && row == *skipRow)
+      continue;
+    const MPInt &elem = at(row, col);
+    if (elem == 0 || !getUnknownForRow(row).restricted)
+      continue;
+    // Only the rows that decrease as the column moves can reach zero.
+    if ((elem > 0) == (direction == Direction::Up))
+      continue;
+
+    // The row reaches zero after the column moved by 'const / |elem|'. Pick
+    // the row that reaches it first, breaking ties by the lowest unknown.
+    MPInt coeff = abs(elem);
+    if (pivotRow) {
+      int order = (at(row, 1) * pivotCoeff).compare(pivotConst * coeff);
+      if (order > 0 || (order == 0 && rowUnknown[row] > rowUnknown[*pivotRow]))
+        continue;
+    }
+    pivotRow = row;
+    pivotConst = at(row, 1);
+    pivotCoeff = coeff;
+  }
+  return pivotRow;
+}
+
+LogicalResult Simplex::restoreRow(unsigned index) {
+  Unknown &unknown = unknowns[index];
+  assert(unknown.isRow && unknown.restricted && "expected a restricted row");
+  while (at(unknown.pos, 1) < 0) {
+    auto pivotPos = findPivot(unknown.pos, Direction::Up);
+    if (!pivotPos)
+      return failure();
+    pivot(pivotPos->first, pivotPos->second);
+    // A column unknown is zero, hence non-negative.
+    if (!unknown.isRow)
+      break;
+  }
+  return success();
+}
+
+void Simplex::removeLastConstraint() {
+  Unknown &constraint = unknowns.back();
+  unsigned numCols = getNumColumns();
+
+  // Make the constraint a row first, with a pivot that keeps the other
+  // restricted unknowns non-negative if there is one.
+  if (!constraint.isRow) {
+    unsigned col = constraint.pos;
+    Optional<unsigned> row = findPivotRow(llvm::None, Direction::Up, col);
+    if (!row)
+      row = findPivotRow(llvm::None, Direction::Down, col);
+    for (unsigned i = 0, e = getNumRows(); !row && i < e; ++i)
+      if (at(i, col) != 0)
+        row = i;
+    assert(row && "no row to pivot the constraint with");
+    pivot(*row, col);
+  }
+
+  // Swap its row with the last one and drop it.
+  unsigned lastRow = getNumRows() - 1;
+  if (constraint.pos != lastRow) {
+    for (unsigned col = 0; col < numCols; ++col)
+      std::swap(at(constraint.pos, col), at(lastRow, col));
+    std::swap(rowUnknown[constraint.pos], rowUnknown[lastRow]);
+    getUnknownForRow(constraint.pos).pos = constraint.pos;
+  }
+  tableau.resize(tableau.size() - numCols);
+  rowUnknown.pop_back();
+  unknowns.pop_back();
+}
+
+void Simplex::rollback(unsigned snapshot) {
+  assert(snapshot <= undoLog.size() && "invalid snapshot");
+  while (undoLog.size() > snapshot) {
+    switch (undoLog.pop_back_val()) {
+    case UndoLogEntry::RemoveLastConstraint:
+      removeLastConstraint();
+      break;
+    case UndoLogEntry::UnmarkEmpty:
+      empty = false;
+      break;
+    }
+  }
+}
+
+Optional<unsigned> Simplex::findFractionalVariable() const {
+  for (unsigned i = 0; i < numVariables; ++i) {
+    const Unknown &var = unknowns[i];
+    if (var.isRow && at(var.pos, 1) % at(var.pos, 0) != 0)
+      return i;
+  }
+  return llvm::None;
+}
+
+Optional<bool> Simplex::isIntegerEmpty(unsigned maxBranches) {
+  unsigned budget = maxBranches;
+  return isIntegerEmptyImpl(budget);
+}
+
+Optional<bool> Simplex::isIntegerEmptyImpl(unsigned &budget) {
+  if (empty)
+    return true;
+  Optional<unsigned> var = findFractionalVariable();
+  if (!var)
+    return false;
+  if (budget == 0)
+    return llvm::None;
+  --budget;
+
+  // Split the set on the value 'v' of the variable: every integer point has
+  // either 'x <= floor(v)', i.e. '-x + floor(v) >= 0', or 'x >= floor(v) + 1',
+  // i.e. 'x - floor(v) - 1 >= 0'.
+  const Unknown &unknown = unknowns[*var];
+  MPInt floorValue = floorDiv(at(unknown.pos, 1), at(unknown.pos, 0));
+  SmallVector<MPInt, 8> coeffs(numVariables + 1, MPInt(0));
+  unsigned snapshot = getSnapshot();
+
+  coeffs[*var] = -1;
+  coeffs.back() = floorValue;
+  addInequalityRow(coeffs);
+  Optional<bool> result = isIntegerEmptyImpl(budget);
+  rollback(snapshot);
+  if (!result || !*result)
+    return result;
+
+  coeffs[*var] = 1;
+  coeffs.back() = -(floorValue + 1);
+  addInequalityRow(coeffs);
+  result = isIntegerEmptyImpl(budget);
+  rollback(snapshot);
+  return result;
+}
+
+void Simplex::print(raw_ostream &os) const {
+  os << "rows = " << getNumRows() << ", columns = " << getNumColumns();
+  if (empty)
+    os << ", empty";
+  os << "\n";
+  for (unsigned row = 0, e = getNumRows(); row < e; ++row) {
+    for (unsigned col = 0, f = getNumColumns(); col < f; ++col)
+      os << at(row, col) << " ";
+    os << "\n";
+  }
+}
+
+void Simplex::dump() const { print(llvm::errs()); }
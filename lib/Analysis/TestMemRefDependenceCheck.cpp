@@ -76,11 +76,33 @@ getDirectionVectorStr(bool ret, unsigned numCommonLoops, unsigned loopNestDepth,
   return result;
 }
 
+// Returns true if the results and components of two dependence checks match.
+static bool
+isSameDependence(DependenceResult result,
+                 ArrayRef<DependenceComponent> dependenceComponents,
+                 DependenceResult expectedResult,
+                 ArrayRef<DependenceComponent> expectedComponents) {
+  if (result.value != expectedResult.value)
+    return false;
+  if (!hasDependence(result))
+    return true;
+  if (dependenceComponents.size() != expectedComponents.size())
+    return false;
+  for (unsigned i = 0, e = expectedComponents.size(); i < e; ++i)
+    if (dependenceComponents[i].lb != expectedComponents[i].lb ||
+        dependenceComponents[i].ub != expectedComponents[i].ub)
+      return false;
+  return true;
+}
+
 // For each access in 'loadsAndStores', runs a depence check between this
 // "source" access and all subsequent "destination" accesses in
 // 'loadsAndStores'. Emits the result of the dependence check as a note with
-// the source access.
-static void checkDependences(ArrayRef<Operation *> loadsAndStores) {
+// the source access. The checks go through 'depAnalysis', and each one is
+// repeated to exercise the cache. Emits an error if the computed or the cached
+// result differs from the one of an uncached check.
+static void checkDependences(ArrayRef<Operation *> loadsAndStores,
+                             MemRefDependenceAnalysis &depAnalysis) {
   for (unsigned i = 0, e = loadsAndStores.size(); i < e; ++i) {
     auto *srcOpInst = loadsAndStores[i];
     MemRefAccess srcAccess(srcOpInst);
@@ -91,12 +113,25 @@ static void checkDependences(ArrayRef<Operation *> loadsAndStores) {
       unsigned numCommonLoops =
           getNumCommonSurroundingLoops(*srcOpInst, *dstOpInst);
       for (unsigned d = 1; d <= numCommonLoops + 1; ++d) {
-        FlatAffineConstraints dependenceConstraints;
         llvm::SmallVector<DependenceComponent, 2> dependenceComponents;
-        DependenceResult result = checkMemrefAccessDependence(
-            srcAccess, dstAccess, d, &dependenceConstraints,
-            &dependenceComponents);
+        DependenceResult result = depAnalysis.checkDependence(
+            srcAccess, dstAccess, d, &dependenceComponents);
         assert(result.value != DependenceResult::Failure);
+        llvm::SmallVector<DependenceComponent, 2> cachedComponents;
+        DependenceResult cachedResult = depAnalysis.checkDependence(
+            srcAccess, dstAccess, d, &cachedComponents);
+        FlatAffineConstraints dependenceConstraints;
+        llvm::SmallVector<DependenceComponent, 2> uncachedComponents;
+        DependenceResult uncachedResult = checkMemrefAccessDependence(
+            srcAccess, dstAccess, d, &dependenceConstraints,
+            &uncachedComponents);
+        if (!isSameDependence(result, dependenceComponents, uncachedResult,
+                              uncachedComponents) ||
+            !isSameDependence(cachedResult, cachedComponents, uncachedResult,
+                              uncachedComponents))
+          srcOpInst->emitError("dependence from ")
+              << i << " to " << j << " at depth " << d
+              << " differs from the uncached one";
         bool ret = hasDependence(result);
         // TODO(andydavis) Print dependence type (i.e. RAW, etc) and print
         // distance vectors as: ([2, 3], [0, 10]). Also, shorten distance
@@ -120,7 +155,7 @@ void TestMemRefDependenceCheck::runOnFunction() {
       loadsAndStores.push_back(op);
   });
 
-  checkDependences(loadsAndStores);
+  checkDependences(loadsAndStores, getAnalysis<MemRefDependenceAnalysis>());
 }
 
 static PassRegistration<TestMemRefDependenceCheck>
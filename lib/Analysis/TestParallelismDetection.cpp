@@ -20,6 +20,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/AffineAnalysis.h"
 #include "mlir/Analysis/Passes.h"
 #include "mlir/Analysis/Utils.h"
 #include "mlir/IR/Builders.h"
@@ -45,8 +46,9 @@ FunctionPassBase *mlir::createParallelismDetectionTestPass() {
 void TestParallelismDetection::runOnFunction() {
   Function &f = getFunction();
   OpBuilder b(f.getBody());
+  auto &depAnalysis = getAnalysis<MemRefDependenceAnalysis>();
   f.walk<AffineForOp>([&](AffineForOp forOp) {
-    if (isLoopParallel(forOp))
+    if (isLoopParallel(forOp, &depAnalysis))
       forOp.emitRemark("parallel loop");
   });
 }
@@ -25,6 +25,7 @@
 #include "mlir/AffineOps/AffineOps.h"
 #include "mlir/Analysis/AffineAnalysis.h"
 #include "mlir/Analysis/AffineStructures.h"
+#include "mlir/Analysis/Simplex.h"
 #include "mlir/IR/Builders.h"
 #include "mlir/StandardOps/Ops.h"
 #include "llvm/ADT/DenseMap.h"
@@ -320,7 +321,7 @@ LogicalResult MemRefRegion::compute(Operation *op, unsigned loopDepth,
 }
 
 //  TODO(mlir-team): improve/complete this when we have target data.
-static unsigned getMemRefEltSizeInBytes(MemRefType memRefType) {
+unsigned mlir::getMemRefEltSizeInBytes(MemRefType memRefType) {
   auto elementType = memRefType.getElementType();
 
   unsigned sizeInBits;
@@ -395,36 +396,51 @@ LogicalResult mlir::boundCheckLoadOrStoreOp(LoadOrStoreOpPointer loadOrStoreOp,
   LLVM_DEBUG(llvm::dbgs() << "Memory region");
   LLVM_DEBUG(region.getConstraints()->dump());
 
+  // The checks along each dimension all add a single inequality to the
+  // constraints of the region, so they share its Simplex tableau.
+  const FlatAffineConstraints &regionCst = *region.getConstraints();
+  Simplex simplex(regionCst);
+  auto hasPointsWith = [&](ArrayRef<int64_t> ineq) {
+    unsigned snapshot = simplex.getSnapshot();
+    simplex.addInequality(ineq);
+    Optional<bool> isEmpty = simplex.isIntegerEmpty();
+    simplex.rollback(snapshot);
+    if (isEmpty)
+      return !*isEmpty;
+
+    // The search for integer points gave up, use the elimination based check.
+    FlatAffineConstraints cst(regionCst);
+    cst.addInequality(ineq);
+    return !cst.isEmptyByElimination();
+  };
+
   bool outOfBounds = false;
   unsigned rank = loadOrStoreOp.getMemRefType().getRank();
 
   // For each dimension, check for out of bounds.
   for (unsigned r = 0; r < rank; r++) {
-    FlatAffineConstraints ucst(*region.getConstraints());
-
     // Intersect memory region with constraint capturing out of bounds (both out
     // of upper and out of lower), and check if the constraint system is
     // feasible. If it is, there is at least one point out of bounds.
-    SmallVector<int64_t, 4> ineq(rank + 1, 0);
+    SmallVector<int64_t, 4> ineq(regionCst.getNumCols(), 0);
     int64_t dimSize = loadOrStoreOp.getMemRefType().getDimSize(r);
     // TODO(bondhugula): handle dynamic dim sizes.
     if (dimSize == -1)
       continue;
 
     // Check for overflow: d_i >= memref dim size.
-    ucst.addConstantLowerBound(r, dimSize);
-    outOfBounds = !ucst.isEmpty();
+    ineq[r] = 1;
+    ineq.back() = -dimSize;
+    outOfBounds = hasPointsWith(ineq);
     if (outOfBounds && emitError) {
       loadOrStoreOp.emitOpError()
           << "memref out of upper bound access along dimension #" << (r + 1);
     }
 
-    // Check for a negative index.
-    FlatAffineConstraints lcst(*region.getConstraints());
-    std::fill(ineq.begin(), ineq.end(), 0);
-    // d_i <= -1;
-    lcst.addConstantUpperBound(r, -1);
-    outOfBounds = !lcst.isEmpty();
+    // Check for a negative index: d_i <= -1.
+    ineq[r] = -1;
+    ineq.back() = -1;
+    outOfBounds = hasPointsWith(ineq);
     if (outOfBounds && emitError) {
       loadOrStoreOp.emitOpError()
           << "memref out of lower bound access along dimension #" << (r + 1);
@@ -964,16 +980,18 @@ Optional<int64_t> mlir::getMemoryFootprintBytes(AffineForOp forOp,
 /// Returns in 'sequentialLoops' all sequential loops in loop nest rooted
 /// at 'forOp'.
 void mlir::getSequentialLoops(
-    AffineForOp forOp, llvm::SmallDenseSet<Value *, 8> *sequentialLoops) {
+    AffineForOp forOp, llvm::SmallDenseSet<Value *, 8> *sequentialLoops,
+    MemRefDependenceAnalysis *depAnalysis) {
   forOp.getOperation()->walk([&](Operation *op) {
     if (auto innerFor = dyn_cast<AffineForOp>(op))
-      if (!isLoopParallel(innerFor))
+      if (!isLoopParallel(innerFor, depAnalysis))
         sequentialLoops->insert(innerFor.getInductionVar());
   });
 }
 
 /// Returns true if 'forOp' is parallel.
-bool mlir::isLoopParallel(AffineForOp forOp) {
+bool mlir::isLoopParallel(AffineForOp forOp,
+                          MemRefDependenceAnalysis *depAnalysis) {
   // Collect all load and store ops in loop nest rooted at 'forOp'.
   SmallVector<Operation *, 8> loadAndStoreOpInsts;
   forOp.getOperation()->walk([&](Operation *opInst) {
@@ -990,9 +1008,12 @@ bool mlir::isLoopParallel(AffineForOp forOp) {
     for (auto *dstOpInst : loadAndStoreOpInsts) {
       MemRefAccess dstAccess(dstOpInst);
       FlatAffineConstraints dependenceConstraints;
-      DependenceResult result = checkMemrefAccessDependence(
-          srcAccess, dstAccess, depth, &dependenceConstraints,
-          /*dependenceComponents=*/nullptr);
+      DependenceResult result =
+          depAnalysis
+              ? depAnalysis->checkDependence(srcAccess, dstAccess, depth)
+              : checkMemrefAccessDependence(srcAccess, dstAccess, depth,
+                                            &dependenceConstraints,
+                                            /*dependenceComponents=*/nullptr);
       if (result.value != DependenceResult::NoDependence)
         return false;
     }
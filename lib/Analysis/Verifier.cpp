@@ -35,14 +35,17 @@
 
 #include "mlir/Analysis/Dominance.h"
 #include "mlir/IR/Attributes.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Dialect.h"
 #include "mlir/IR/Function.h"
 #include "mlir/IR/Module.h"
 #include "mlir/IR/Operation.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
 using namespace mlir;
 
 namespace {
@@ -52,8 +55,10 @@ public:
   explicit OperationVerifier(MLIRContext *ctx)
       : ctx(ctx), identifierRegex("^[a-zA-Z_][a-zA-Z_0-9\\.\\$]*$") {}
 
-  /// Verify the body of the given function.
-  LogicalResult verify(Function &fn);
+  /// Verify the body of the given function. On success, if 'domInfoResult'
+  /// is non-null, it is set to the dominance information of the body.
+  LogicalResult verify(Function &fn,
+                       std::unique_ptr<DominanceInfo> *domInfoResult);
 
   /// Verify the given operation.
   LogicalResult verify(Operation &op);
@@ -104,7 +109,9 @@ private:
 } // end anonymous namespace
 
 /// Verify the body of the given function.
-LogicalResult OperationVerifier::verify(Function &fn) {
+LogicalResult
+OperationVerifier::verify(Function &fn,
+                          std::unique_ptr<DominanceInfo> *domInfoResult) {
   // Verify the body first.
   if (failed(verifyRegion(fn.getBody())))
     return failure();
@@ -113,12 +120,14 @@ LogicalResult OperationVerifier::verify(Function &fn) {
   // check.  We do this as a second pass since malformed CFG's can cause
   // dominator analysis constructure to crash and we want the verifier to be
   // resilient to malformed code.
-  DominanceInfo theDomInfo(&fn);
-  domInfo = &theDomInfo;
+  auto theDomInfo = llvm::make_unique<DominanceInfo>(&fn);
+  domInfo = theDomInfo.get();
   if (failed(verifyDominance(fn.getBody())))
     return failure();
 
   domInfo = nullptr;
+  if (domInfoResult)
+    *domInfoResult = std::move(theDomInfo);
   return success();
 }
 
@@ -292,7 +301,7 @@ LogicalResult OperationVerifier::verifyDominance(Operation &op) {
 /// Perform (potentially expensive) checks of invariants, used to detect
 /// compiler bugs.  On error, this reports the error through the MLIRContext and
 /// returns failure.
-LogicalResult Function::verify() {
+LogicalResult Function::verify(std::unique_ptr<DominanceInfo> *domInfo) {
   OperationVerifier opVerifier(getContext());
   llvm::PrettyStackTraceFormat fmt("MLIR Verifier: func @%s",
                                    getName().c_str());
@@ -353,7 +362,7 @@ LogicalResult Function::verify() {
              << i << " must match corresponding argument in function signature";
 
   // Finally, verify the body of the function.
-  return opVerifier.verify(*this);
+  return opVerifier.verify(*this, domInfo);
 }
 
 /// Perform (potentially expensive) checks of invariants, used to detect
@@ -366,11 +375,43 @@ LogicalResult Operation::verify() {
 /// Perform (potentially expensive) checks of invariants, used to detect
 /// compiler bugs.  On error, this reports the error through the MLIRContext and
 /// returns failure.
-LogicalResult Module::verify() {
-  /// Check that each function is correct.
+LogicalResult Module::verify(bool allowParallelism) {
+  std::vector<Function *> funcs;
   for (auto &fn : *this)
-    if (failed(fn.verify()))
-      return failure();
+    funcs.push_back(&fn);
 
-  return success();
+  /// Check that each function is correct.
+  if (!allowParallelism || !llvm::llvm_is_multithreaded() || funcs.size() < 2) {
+    for (auto *fn : funcs)
+      if (failed(fn->verify()))
+        return failure();
+    return success();
+  }
+
+  // Otherwise, verify the functions concurrently. A sequential verification
+  // stops at the first invalid function, so the functions after the first
+  // known failure are skipped, and the diagnostics of any that were already
+  // verified are discarded. The parallel diagnostic handler orders the
+  // remaining diagnostics deterministically.
+  ParallelDiagnosticHandler diagHandler(getContext());
+  std::atomic<size_t> firstFailure(funcs.size());
+  llvm::parallel::for_each_n(
+      llvm::parallel::par, size_t(0), funcs.size(), [&](size_t i) {
+        if (i > firstFailure)
+          return;
+        diagHandler.setOrderIDForThread(i);
+        if (succeeded(funcs[i]->verify()))
+          return;
+
+        // Record the failure if it is the first one seen so far.
+        size_t prevFailure = firstFailure;
+        while (i < prevFailure &&
+               !firstFailure.compare_exchange_weak(prevFailure, i))
+          ;
+      });
+
+  if (firstFailure == funcs.size())
+    return success();
+  diagHandler.discardDiagnosticsAfter(firstFailure);
+  return failure();
 }
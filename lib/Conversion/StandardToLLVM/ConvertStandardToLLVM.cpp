@@ -931,9 +931,7 @@ static void ensureDistinctSuccessors(Block &bb) {
           terminator->getSuccessorOperands(*position));
       builder.create<BranchOp>(terminator->getLoc(), successor.first, operands);
       terminator->setSuccessor(dummyBlock, *position);
-      for (int i = 0, e = terminator->getNumSuccessorOperands(*position); i < e;
-           ++i)
-        terminator->eraseSuccessorOperand(*position, i);
+      terminator->setSuccessorOperands(*position, llvm::None);
     }
   }
 }
@@ -24,16 +24,32 @@
 #include "mlir/IR/Module.h"
 #include "mlir/Target/LLVMIR.h"
 
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
 #include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
 #include "llvm/ExecutionEngine/Orc/IRTransformLayer.h"
+#include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
 #include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/LazyReexports.h"
 #include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include <mutex>
 
 using namespace mlir;
 using llvm::Error;
@@ -67,8 +83,155 @@ public:
 private:
   llvm::orc::ExecutionSession &session;
 };
+
+// Object cache that persists the objects produced by the JIT in a directory on
+// disk, so that later processes compiling the same module can load the object
+// instead of optimizing and generating code again.  The cache key of a module
+// is computed from its bitcode before it is transformed, together with the
+// key of the transformer, the target triple, the host CPU and the LLVM version.
+class PersistentObjectCache : public llvm::ObjectCache {
+public:
+  PersistentObjectCache(StringRef cacheDir, StringRef transformerKey)
+      : cacheDir(cacheDir), transformerKey(transformerKey) {}
+
+  // Compute the cache key of `module`, which must not have been transformed
+  // yet, and associate it with the module.  If a valid object for this key is
+  // present in the cache, load it and return true: the module must then be
+  // compiled untransformed, and `getObject` returns the loaded object.
+  // Otherwise return false: the module must be transformed, and the object
+  // compiled from it is written to the cache.
+  bool registerModule(const llvm::Module *module);
+
+  // Write the object compiled for a registered module to the cache.
+  void notifyObjectCompiled(const llvm::Module *module,
+                            llvm::MemoryBufferRef objBuffer) override;
+
+  // Return the object loaded by `registerModule` for a module, or nullptr if
+  // there was none.
+  std::unique_ptr<llvm::MemoryBuffer>
+  getObject(const llvm::Module *module) override;
+
+private:
+  // Return the path of the cache file for the module, or an empty string if
+  // the module was not registered.
+  std::string getCachePath(const llvm::Module *module);
+
+  std::string cacheDir;
+  std::string transformerKey;
+
+  // The cache keys of the registered modules, and the objects loaded for the
+  // modules that hit in the cache.  Modules may be compiled concurrently by
+  // the JIT, so accesses are guarded by the mutex.
+  llvm::DenseMap<const llvm::Module *, std::string> moduleKeys;
+  llvm::DenseMap<const llvm::Module *, std::unique_ptr<llvm::MemoryBuffer>>
+      loadedObjects;
+  std::mutex mutex;
+};
 } // end anonymous namespace
 
+bool PersistentObjectCache::registerModule(const llvm::Module *module) {
+  llvm::SmallVector<char, 0> bitcode;
+  llvm::raw_svector_ostream os(bitcode);
+  llvm::WriteBitcodeToFile(*module, os);
+
+  llvm::SHA1 hasher;
+  hasher.update(StringRef(bitcode.data(), bitcode.size()));
+  for (StringRef component :
+       {StringRef(transformerKey), StringRef(module->getTargetTriple()),
+        llvm::sys::getHostCPUName(), StringRef(LLVM_VERSION_STRING)}) {
+    // Hash the size of each component as well to keep the boundaries between
+    // the components unambiguous.
+    uint64_t size = component.size();
+    hasher.update(StringRef(reinterpret_cast<const char *>(&size),
+                            sizeof(size)));
+    hasher.update(component);
+  }
+  std::string key = llvm::toHex(hasher.final(), /*LowerCase=*/true);
+
+  llvm::SmallString<128> path(cacheDir);
+  llvm::sys::path::append(path, key + ".o");
+
+  // Decide whether the module hits in the cache here, and only here: once the
+  // transformation is skipped, the object must be available to `getObject`,
+  // or the untransformed module would be compiled and its object written
+  // under the key of the transformed one.  A missing, unreadable or malformed
+  // file is a miss, and is overwritten by the object compiled for the module.
+  std::unique_ptr<llvm::MemoryBuffer> object;
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*FileSize=*/-1,
+                                            /*RequiresNullTerminator=*/false);
+  if (buffer) {
+    auto objectFile = llvm::object::ObjectFile::createObjectFile(
+        (*buffer)->getMemBufferRef());
+    if (objectFile)
+      object = std::move(*buffer);
+    else
+      llvm::consumeError(objectFile.takeError());
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!object) {
+    moduleKeys[module] = key;
+    loadedObjects.erase(module);
+    return false;
+  }
+  // The object of a hit is not written back to the cache.
+  moduleKeys.erase(module);
+  loadedObjects[module] = std::move(object);
+  return true;
+}
+
+std::string PersistentObjectCache::getCachePath(const llvm::Module *module) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = moduleKeys.find(module);
+  if (it == moduleKeys.end())
+    return "";
+  llvm::SmallString<128> path(cacheDir);
+  llvm::sys::path::append(path, it->second + ".o");
+  return path.str();
+}
+
+void PersistentObjectCache::notifyObjectCompiled(
+    const llvm::Module *module, llvm::MemoryBufferRef objBuffer) {
+  std::string path = getCachePath(module);
+  if (path.empty())
+    return;
+
+  // Failing to populate the cache is not an error: the object is still used
+  // by the JIT, it will just be compiled again by the next process.
+  if (llvm::sys::fs::create_directories(cacheDir))
+    return;
+
+  // Write the object to a unique temporary file first and rename it into
+  // place, so that concurrent processes never observe a partial object.
+  int fd;
+  llvm::SmallString<128> tmpPath;
+  if (llvm::sys::fs::createUniqueFile(path + "-%%%%%%.tmp", fd, tmpPath))
+    return;
+  {
+    llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+    os << objBuffer.getBuffer();
+    os.close();
+    if (os.has_error()) {
+      os.clear_error();
+      llvm::sys::fs::remove(tmpPath);
+      return;
+    }
+  }
+  if (llvm::sys::fs::rename(tmpPath, path))
+    llvm::sys::fs::remove(tmpPath);
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+PersistentObjectCache::getObject(const llvm::Module *module) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = loadedObjects.find(module);
+  if (it == loadedObjects.end())
+    return nullptr;
+  auto object = std::move(it->second);
+  loadedObjects.erase(it);
+  return object;
+}
+
 namespace mlir {
 namespace impl {
 
@@ -126,16 +289,25 @@ public:
   // using the data layout provided as `dataLayout`.
   // Setup the object layer to use our custom memory manager in order to
   // resolve calls to library functions present in the process.
+  // If `objectCacheDir` is not empty, compiled objects are persisted in this
+  // directory, keyed by the input module and `transformerKey`.
   OrcJIT(llvm::orc::JITTargetMachineBuilder machineBuilder,
          llvm::DataLayout layout, IRTransformer transform,
-         ArrayRef<StringRef> sharedLibPaths)
+         ArrayRef<StringRef> sharedLibPaths, StringRef objectCacheDir,
+         StringRef transformerKey)
       : irTransformer(transform),
+        objectCache(objectCacheDir.empty()
+                        ? nullptr
+                        : llvm::make_unique<PersistentObjectCache>(
+                              objectCacheDir, transformerKey)),
+        compileFunction(llvm::orc::ConcurrentIRCompiler(machineBuilder,
+                                                        objectCache.get())),
         objectLayer(
             session,
             [this]() { return llvm::make_unique<MemoryManager>(session); }),
-        compileLayer(
-            session, objectLayer,
-            llvm::orc::ConcurrentIRCompiler(std::move(machineBuilder))),
+        compileLayer(session, objectLayer,
+                     llvm::orc::ConcurrentIRCompiler(std::move(machineBuilder),
+                                                     objectCache.get())),
         transformLayer(session, compileLayer, makeIRTransformFunction()),
         dataLayout(layout), mangler(session, this->dataLayout),
         threadSafeCtx(llvm::make_unique<llvm::LLVMContext>()) {
@@ -144,9 +316,12 @@ public:
     loadLibraries(sharedLibPaths);
   }
 
-  // Create a JIT engine for the current host.
+  // Create a JIT engine for the current host.  If `lazy` is set, functions
+  // are only transformed and compiled when they are first called or looked up.
   static Expected<std::unique_ptr<OrcJIT>>
-  createDefault(IRTransformer transformer, ArrayRef<StringRef> sharedLibPaths) {
+  createDefault(IRTransformer transformer, ArrayRef<StringRef> sharedLibPaths,
+                StringRef objectCacheDir, StringRef transformerKey,
+                bool lazy) {
     auto machineBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
     if (!machineBuilder)
       return machineBuilder.takeError();
@@ -155,14 +330,29 @@ public:
     if (!dataLayout)
       return dataLayout.takeError();
 
-    return llvm::make_unique<OrcJIT>(std::move(*machineBuilder),
-                                     std::move(*dataLayout), transformer,
-                                     sharedLibPaths);
+    llvm::Triple triple = machineBuilder->getTargetTriple();
+    auto jit = llvm::make_unique<OrcJIT>(std::move(*machineBuilder),
+                                         std::move(*dataLayout), transformer,
+                                         sharedLibPaths, objectCacheDir,
+                                         transformerKey);
+    if (lazy)
+      if (auto err = jit->enableLazyCompilation(triple))
+        return std::move(err);
+    return std::move(jit);
   }
 
-  // Add an LLVM module to the main library managed by the JIT engine.
-  Error addModule(std::unique_ptr<llvm::Module> M) {
-    return transformLayer.add(
+  // Add an LLVM module to the main library managed by the JIT engine.  If
+  // `numThreads` is greater than one and the JIT is not lazy, the module is
+  // split into this many partitions, which are transformed and compiled
+  // concurrently.
+  Error addModule(std::unique_ptr<llvm::Module> M, unsigned numThreads) {
+    if (numThreads > 1 && !codLayer)
+      return addModuleInParallel(std::move(M), numThreads);
+
+    llvm::orc::IRLayer &topLayer =
+        codLayer ? static_cast<llvm::orc::IRLayer &>(*codLayer)
+                 : transformLayer;
+    return topLayer.add(
         session.getMainJITDylib(),
         llvm::orc::ThreadSafeModule(std::move(M), threadSafeCtx));
   }
@@ -173,31 +363,58 @@ public:
   }
 
 private:
-  // Wrap the `irTransformer` into a function that can be called by the
-  // IRTranformLayer.  If `irTransformer` is not set up, return the module as
-  // is without errors.
+  // Apply the `irTransformer` to the module.  If `irTransformer` is not set
+  // up, or if the object for the module was loaded from the object cache,
+  // leave the module as is without errors.
+  Error transformModule(llvm::Module *module) {
+    // The cache key is computed before the transformation, so that a cache hit
+    // skips the optimization as well as the code generation.
+    bool isCached = objectCache && objectCache->registerModule(module);
+    if (!irTransformer || isCached)
+      return Error::success();
+    return irTransformer(module);
+  }
+
+  // Wrap `transformModule` into a function that can be called by the
+  // IRTranformLayer.
   llvm::orc::IRTransformLayer::TransformFunction makeIRTransformFunction() {
     return [this](llvm::orc::ThreadSafeModule module,
                   const llvm::orc::MaterializationResponsibility &resp)
                -> Expected<llvm::orc::ThreadSafeModule> {
       (void)resp;
-      if (!irTransformer)
-        return std::move(module);
-      if (Error err = irTransformer(module.getModule()))
+      if (Error err = transformModule(module.getModule()))
         return std::move(err);
       return std::move(module);
     };
   }
 
+  // Split the module into `numThreads` partitions, transform and compile them
+  // on a thread pool, and add the resulting objects to the main library.
+  Error addModuleInParallel(std::unique_ptr<llvm::Module> module,
+                            unsigned numThreads);
+
   // Iterate over shareLibPaths and load the corresponding libraries for symbol
   // resolution.
   void loadLibraries(ArrayRef<StringRef> sharedLibPaths);
 
+  // Stack a compile-on-demand layer on top of the transform layer.  Modules
+  // added to the JIT afterwards are split into one partition per function, and
+  // each function is emitted behind a stub that transforms and compiles the
+  // function on its first call.
+  Error enableLazyCompilation(const llvm::Triple &triple);
+
   IRTransformer irTransformer;
+  std::unique_ptr<PersistentObjectCache> objectCache;
+  // The compiler used for the partitions of modules compiled in parallel,
+  // which bypass the compile layer.
+  llvm::orc::IRCompileLayer::CompileFunction compileFunction;
   llvm::orc::ExecutionSession session;
   llvm::orc::RTDyldObjectLinkingLayer objectLayer;
   llvm::orc::IRCompileLayer compileLayer;
   llvm::orc::IRTransformLayer transformLayer;
+  // The lazy compilation layers, only set up in lazy mode.
+  std::unique_ptr<llvm::orc::LazyCallThroughManager> lazyCallThroughManager;
+  std::unique_ptr<llvm::orc::CompileOnDemandLayer> codLayer;
   llvm::DataLayout dataLayout;
   llvm::orc::MangleAndInterner mangler;
   llvm::orc::ThreadSafeContext threadSafeCtx;
@@ -228,6 +445,83 @@ void mlir::impl::OrcJIT::loadLibraries(ArrayRef<StringRef> sharedLibPaths) {
   }
 }
 
+Error mlir::impl::OrcJIT::addModuleInParallel(
+    std::unique_ptr<llvm::Module> module, unsigned numThreads) {
+  // Split the module by function.  Each partition keeps declarations of the
+  // globals defined in the other partitions, and local symbols referenced
+  // across partitions are externalized.  The partitions are created in the
+  // context of the original module, which cannot be shared across threads, so
+  // they are serialized and later parsed into a fresh context by each thread.
+  std::vector<llvm::SmallVector<char, 0>> partitions;
+  llvm::SplitModule(std::move(module), numThreads,
+                    [&](std::unique_ptr<llvm::Module> partition) {
+                      partitions.emplace_back();
+                      llvm::raw_svector_ostream os(partitions.back());
+                      llvm::WriteBitcodeToFile(*partition, os);
+                    });
+
+  // Transform and compile the partitions concurrently.
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> objects(partitions.size());
+  std::mutex errorMutex;
+  Error result = Error::success();
+  auto recordError = [&](Error err) {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    result = llvm::joinErrors(std::move(result), std::move(err));
+  };
+  {
+    llvm::ThreadPool threadPool(numThreads);
+    for (unsigned i = 0, e = partitions.size(); i != e; ++i) {
+      threadPool.async([&, i] {
+        auto &partition = partitions[i];
+        llvm::LLVMContext context;
+        auto partitionModule = llvm::parseBitcodeFile(
+            llvm::MemoryBufferRef(
+                StringRef(partition.data(), partition.size()), "partition"),
+            context);
+        if (!partitionModule)
+          return recordError(partitionModule.takeError());
+        if (Error err = transformModule(partitionModule->get()))
+          return recordError(std::move(err));
+        auto object = compileFunction(**partitionModule);
+        if (!object)
+          return recordError(object.takeError());
+        objects[i] = std::move(*object);
+      });
+    }
+    threadPool.wait();
+  }
+  if (result)
+    return result;
+
+  // Link the objects into the main library.
+  for (auto &object : objects)
+    if (Error err = objectLayer.add(session.getMainJITDylib(),
+                                    std::move(object)))
+      return err;
+  return Error::success();
+}
+
+// Called by the lazy compilation stubs when a function could not be compiled.
+static void reportLazyCompilationFailure() {
+  llvm::report_fatal_error("lazy JIT compilation failed");
+}
+
+Error mlir::impl::OrcJIT::enableLazyCompilation(const llvm::Triple &triple) {
+  auto callThroughManager = llvm::orc::createLocalLazyCallThroughManager(
+      triple, session,
+      llvm::pointerToJITTargetAddress(&reportLazyCompilationFailure));
+  if (!callThroughManager)
+    return callThroughManager.takeError();
+  lazyCallThroughManager = std::move(*callThroughManager);
+
+  // The default partitioning of the compile-on-demand layer only emits the
+  // requested functions, so each function is compiled on its own.
+  codLayer = llvm::make_unique<llvm::orc::CompileOnDemandLayer>(
+      session, transformLayer, *lazyCallThroughManager,
+      llvm::orc::createLocalIndirectStubsManagerBuilder(triple));
+  return Error::success();
+}
+
 // Wrap a string into an llvm::StringError.
 static inline Error make_string_error(const llvm::Twine &message) {
   return llvm::make_error<llvm::StringError>(message.str(),
@@ -324,9 +618,13 @@ ExecutionEngine::~ExecutionEngine() = default;
 Expected<std::unique_ptr<ExecutionEngine>>
 ExecutionEngine::create(Module *m,
                         std::function<llvm::Error(llvm::Module *)> transformer,
-                        ArrayRef<StringRef> sharedLibPaths) {
+                        ArrayRef<StringRef> sharedLibPaths,
+                        StringRef objectCacheDir, StringRef transformerKey,
+                        bool lazyCompilation, unsigned numCompileThreads) {
   auto engine = llvm::make_unique<ExecutionEngine>();
-  auto expectedJIT = impl::OrcJIT::createDefault(transformer, sharedLibPaths);
+  auto expectedJIT =
+      impl::OrcJIT::createDefault(transformer, sharedLibPaths, objectCacheDir,
+                                  transformerKey, lazyCompilation);
   if (!expectedJIT)
     return expectedJIT.takeError();
 
@@ -339,7 +637,8 @@ ExecutionEngine::create(Module *m,
   setupTargetTriple(llvmModule.get());
   packFunctionArguments(llvmModule.get());
 
-  if (auto err = (*expectedJIT)->addModule(std::move(llvmModule)))
+  if (auto err = (*expectedJIT)->addModule(std::move(llvmModule),
+                                           numCompileThreads))
     return std::move(err);
   engine->jit = std::move(*expectedJIT);
 
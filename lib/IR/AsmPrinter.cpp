@@ -42,7 +42,9 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Regex.h"
+#include "llvm/Support/Threading.h"
 using namespace mlir;
 
 void Identifier::print(raw_ostream &os) const { os << str(); }
@@ -78,6 +80,13 @@ static llvm::cl::opt<bool>
                        llvm::cl::desc("Print the generic op form"),
                        llvm::cl::init(false), llvm::cl::Hidden);
 
+// Print the functions of a module sequentially, even if multi-threading is
+// enabled.
+static llvm::cl::opt<bool> disablePrinterThreading(
+    "mlir-disable-printer-threading",
+    llvm::cl::desc("Print the functions of a module sequentially"),
+    llvm::cl::init(false), llvm::cl::Hidden);
+
 namespace {
 /// A special index constant used for non-kind attribute aliases.
 static constexpr int kNonAttrKindAlias = -1;
@@ -334,7 +343,7 @@ public:
     interleave(c.begin(), c.end(), each_fn, [&]() { os << ", "; });
   }
 
-  void print(Module *module);
+  void print(Module *module, bool allowParallelism = true);
   void printAttributeAndType(Attribute attr) {
     printAttributeOptionalType(attr, /*includeType=*/true);
   }
@@ -453,14 +462,41 @@ void ModulePrinter::printLocationInternal(Location loc, bool pretty) {
   }
 }
 
-void ModulePrinter::print(Module *module) {
+void ModulePrinter::print(Module *module, bool allowParallelism) {
   // Output the aliases at the top level.
   state.printAttributeAliases(os);
   state.printTypeAliases(os);
 
-  // Print the module.
+  // Print the module sequentially if there is no parallelism to exploit.
+  if (!allowParallelism || disablePrinterThreading ||
+      !llvm::llvm_is_multithreaded() || module->getFunctions().size() < 2) {
+    for (auto &fn : *module)
+      print(&fn);
+    return;
+  }
+
+  // Otherwise, print the functions concurrently into separate buffers that are
+  // then written in order. Printing a function only reads the module state,
+  // and values are numbered per function, so the output is identical to that
+  // of a sequential print. The functions are processed in windows, so that the
+  // output is streamed and only the text of a window is buffered at a time.
+  std::vector<Function *> funcs;
   for (auto &fn : *module)
-    print(&fn);
+    funcs.push_back(&fn);
+  size_t windowSize = 4 * std::max(1u, llvm::hardware_concurrency());
+  std::vector<std::string> buffers(std::min(windowSize, funcs.size()));
+  for (size_t start = 0, e = funcs.size(); start < e; start += windowSize) {
+    size_t end = std::min(e, start + windowSize);
+    llvm::parallel::for_each_n(
+        llvm::parallel::par, start, end, [&](size_t i) {
+          llvm::raw_string_ostream bufferOS(buffers[i - start]);
+          ModulePrinter(bufferOS, state).print(funcs[i]);
+        });
+    for (size_t i = start; i != end; ++i) {
+      os << buffers[i - start];
+      buffers[i - start].clear();
+    }
+  }
 }
 
 /// Print a floating point value in a way that the parser will be able to
@@ -1720,10 +1756,10 @@ void Function::print(raw_ostream &os) {
 
 void Function::dump() { print(llvm::errs()); }
 
-void Module::print(raw_ostream &os) {
+void Module::print(raw_ostream &os, bool allowParallelism) {
   ModuleState state(getContext());
   state.initialize(this);
-  ModulePrinter(os, state).print(this);
+  ModulePrinter(os, state).print(this, allowParallelism);
 }
 
 void Module::dump() { print(llvm::errs()); }
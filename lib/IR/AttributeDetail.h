@@ -355,6 +355,10 @@ struct DenseElementsAttributeStorage : public AttributeStorage {
 
     /// A boolean that indicates if this data is a splat or not.
     bool isSplat;
+
+    /// A boolean that indicates if the data must be copied into the storage,
+    /// or if it outlives the context and can be referred to in place.
+    bool copyData = true;
   };
 
   DenseElementsAttributeStorage(ShapedType ty, ArrayRef<char> data,
@@ -430,6 +434,15 @@ struct DenseElementsAttributeStorage : public AttributeStorage {
     return KeyTy(ty, firstElt, hashVal, /*isSplat=*/true);
   }
 
+  /// Construct a key as above, for data that is only copied into the storage
+  /// if 'copyData' is true.
+  static KeyTy getKey(ShapedType ty, ArrayRef<char> data, bool isKnownSplat,
+                      bool copyData) {
+    KeyTy key = getKey(ty, data, isKnownSplat);
+    key.copyData = copyData;
+    return key;
+  }
+
   /// Construct a key with a set of boolean data.
   static KeyTy getKeyForBoolData(ShapedType ty, ArrayRef<char> data,
                                  size_t numElements) {
@@ -473,11 +486,16 @@ struct DenseElementsAttributeStorage : public AttributeStorage {
   /// Construct a new storage instance.
   static DenseElementsAttributeStorage *
   construct(AttributeStorageAllocator &allocator, KeyTy key) {
-    // If the data buffer is non-empty, we copy it into the allocator.
-    ArrayRef<char> data = allocator.copyInto(key.data);
+    // If the data buffer is non-empty, we copy it into the allocator unless it
+    // outlives the context. Boolean splats are always copied, as they are
+    // modified below.
+    bool isBoolSplat = key.isSplat && key.type.getElementTypeBitWidth() == 1;
+    ArrayRef<char> data = key.data;
+    if (key.copyData || isBoolSplat)
+      data = allocator.copyInto(key.data);
 
     // If this is a boolean splat, make sure only the first bit is used.
-    if (key.isSplat && key.type.getElementTypeBitWidth() == 1)
+    if (isBoolSplat)
       const_cast<char &>(data.front()) &= 1;
 
     return new (allocator.allocate<DenseElementsAttributeStorage>())
@@ -158,18 +158,51 @@ ArrayRef<NamedAttribute> DictionaryAttr::getValue() const {
   return getImpl()->getElements();
 }
 
+/// Lists with at most this many attributes are searched linearly, which is
+/// cheaper than a binary search for them.
+static constexpr unsigned kLinearSearchThreshold = 8;
+
+/// Return the first attribute in the sorted list 'attrs' whose name is not
+/// ordered before 'name'.
+static const NamedAttribute *findAttrPos(ArrayRef<NamedAttribute> attrs,
+                                         StringRef name) {
+  return std::lower_bound(attrs.begin(), attrs.end(), name,
+                          [](const NamedAttribute &attr, StringRef name) {
+                            return attr.first.strref() < name;
+                          });
+}
+
+/// Return the attribute with the given name in the sorted list 'attrs', or
+/// null if there is none.
+static Attribute lookupSortedAttr(ArrayRef<NamedAttribute> attrs,
+                                  StringRef name) {
+  if (attrs.size() <= kLinearSearchThreshold) {
+    for (auto &elt : attrs)
+      if (elt.first.is(name))
+        return elt.second;
+    return nullptr;
+  }
+  auto *it = findAttrPos(attrs, name);
+  return (it != attrs.end() && it->first.is(name)) ? it->second : nullptr;
+}
+static Attribute lookupSortedAttr(ArrayRef<NamedAttribute> attrs,
+                                  Identifier name) {
+  // Identifiers are uniqued, so small lists are searched by pointer.
+  if (attrs.size() <= kLinearSearchThreshold) {
+    for (auto &elt : attrs)
+      if (elt.first == name)
+        return elt.second;
+    return nullptr;
+  }
+  return lookupSortedAttr(attrs, name.strref());
+}
+
 /// Return the specified attribute if present, null otherwise.
 Attribute DictionaryAttr::get(StringRef name) const {
-  for (auto elt : getValue())
-    if (elt.first.is(name))
-      return elt.second;
-  return nullptr;
+  return lookupSortedAttr(getValue(), name);
 }
 Attribute DictionaryAttr::get(Identifier name) const {
-  for (auto elt : getValue())
-    if (elt.first == name)
-      return elt.second;
-  return nullptr;
+  return lookupSortedAttr(getValue(), name);
 }
 
 DictionaryAttr::iterator DictionaryAttr::begin() const {
@@ -562,6 +595,52 @@ DenseElementsAttr DenseElementsAttr::get(ShapedType type,
   return getRaw(type, intValues);
 }
 
+/// Returns true if 'rawBuffer' holds the packed element data of a dense
+/// elements attribute of the given type.
+static bool isValidRawBuffer(ShapedType type, ArrayRef<char> rawBuffer,
+                             bool isSplat) {
+  if (!(type.isa<RankedTensorType>() || type.isa<VectorType>()) ||
+      !type.hasStaticShape())
+    return false;
+  Type eltType = type.getElementType();
+  if (!eltType.isa<IntegerType>() && !eltType.isa<FloatType>())
+    return false;
+
+  size_t storageBitWidth =
+      DenseElementsAttr::getElementStorageBitWidth(eltType);
+  size_t numElements = isSplat ? 1 : type.getNumElements();
+  return rawBuffer.size() ==
+         llvm::divideCeil(storageBitWidth * numElements, CHAR_BIT);
+}
+
+/// Constructs a dense elements attribute from a buffer holding the packed
+/// element data. Returns null if the type or the size of the buffer is invalid.
+DenseElementsAttr DenseElementsAttr::getFromRawBuffer(ShapedType type,
+                                                      ArrayRef<char> rawBuffer,
+                                                      bool isSplat) {
+  if (!isValidRawBuffer(type, rawBuffer, isSplat))
+    return {};
+  return getRaw(type, rawBuffer, isSplat);
+}
+
+/// Constructs a dense elements attribute that refers to a buffer outliving the
+/// context in place. Returns null if the type or the size of the buffer is
+/// invalid.
+DenseElementsAttr
+DenseElementsAttr::getFromUnownedRawBuffer(ShapedType type,
+                                           ArrayRef<char> rawBuffer,
+                                           bool isSplat) {
+  if (!isValidRawBuffer(type, rawBuffer, isSplat))
+    return {};
+  return getRaw(type, rawBuffer, isSplat, /*copyData=*/false);
+}
+
+/// Returns the number of bits used to store a single element of the given
+/// type in the raw data buffer.
+size_t DenseElementsAttr::getElementStorageBitWidth(Type eltType) {
+  return getDenseElementStorageWidth(getDenseElementBitwidth(eltType));
+}
+
 // Constructs a dense elements attribute from an array of raw APInt values.
 // Each APInt value is expected to have the same bitwidth as the element type
 // of 'type'.
@@ -581,12 +660,13 @@ DenseElementsAttr DenseElementsAttr::getRaw(ShapedType type,
 }
 
 DenseElementsAttr DenseElementsAttr::getRaw(ShapedType type,
-                                            ArrayRef<char> data, bool isSplat) {
+                                            ArrayRef<char> data, bool isSplat,
+                                            bool copyData) {
   assert((type.isa<RankedTensorType>() || type.isa<VectorType>()) &&
          "type must be ranked tensor or vector");
   assert(type.hasStaticShape() && "type must have static shape");
   return Base::get(type.getContext(), StandardAttributes::DenseElements, type,
-                   data, isSplat);
+                   data, isSplat, copyData);
 }
 
 /// Check the information for a c++ data type, check if this type is valid for
@@ -948,12 +1028,50 @@ NamedAttributeList::NamedAttributeList(ArrayRef<NamedAttribute> attributes) {
   setAttrs(attributes);
 }
 
+NamedAttributeList::NamedAttributeList(const NamedAttributeList &other) {
+  *this = other;
+}
+NamedAttributeList::NamedAttributeList(NamedAttributeList &&other) = default;
+NamedAttributeList::~NamedAttributeList() = default;
+
+NamedAttributeList &NamedAttributeList::
+operator=(const NamedAttributeList &other) {
+  if (this == &other)
+    return *this;
+
+  // Share the dictionary of 'other' if it is up to date, otherwise copy its
+  // mutable list so that the dictionary is only uniqued on demand.
+  attrs = other.attrs;
+  if (attrs || !other.mutableAttrs)
+    mutableAttrs.reset();
+  else
+    mutableAttrs.reset(new MutableAttributeList(*other.mutableAttrs));
+  return *this;
+}
+NamedAttributeList &NamedAttributeList::
+operator=(NamedAttributeList &&other) = default;
+
+/// Return the underlying dictionary attribute, uniquing it if the list was
+/// modified since it was last requested.
+DictionaryAttr NamedAttributeList::getDictionary() const {
+  // The mutable list is kept, so that references to its attributes remain
+  // valid.
+  if (!attrs && mutableAttrs && !mutableAttrs->empty())
+    attrs = DictionaryAttr::get(*mutableAttrs,
+                                mutableAttrs->front().second.getContext());
+  return attrs;
+}
+
 ArrayRef<NamedAttribute> NamedAttributeList::getAttrs() const {
+  if (mutableAttrs)
+    return *mutableAttrs;
   return attrs ? attrs.getValue() : llvm::None;
 }
 
 /// Replace the held attributes with ones provided in 'newAttrs'.
 void NamedAttributeList::setAttrs(ArrayRef<NamedAttribute> attributes) {
+  mutableAttrs.reset();
+
   // Don't create an attribute list if there are no attributes.
   if (attributes.empty())
     attrs = nullptr;
@@ -963,12 +1081,24 @@ void NamedAttributeList::setAttrs(ArrayRef<NamedAttribute> attributes) {
 
 /// Return the specified attribute if present, null otherwise.
 Attribute NamedAttributeList::get(StringRef name) const {
-  return attrs ? attrs.get(name) : nullptr;
+  return lookupSortedAttr(getAttrs(), name);
 }
 
 /// Return the specified attribute if present, null otherwise.
 Attribute NamedAttributeList::get(Identifier name) const {
-  return attrs ? attrs.get(name) : nullptr;
+  return lookupSortedAttr(getAttrs(), name);
+}
+
+/// Return the mutable list of attributes, creating it from the dictionary if
+/// necessary.  The dictionary is invalidated.
+auto NamedAttributeList::getMutableAttrs() -> MutableAttributeList & {
+  if (!mutableAttrs) {
+    auto origAttrs = getAttrs();
+    mutableAttrs.reset(
+        new MutableAttributeList(origAttrs.begin(), origAttrs.end()));
+  }
+  attrs = nullptr;
+  return *mutableAttrs;
 }
 
 /// If the an attribute exists with the specified name, change it to the new
@@ -976,40 +1106,36 @@ Attribute NamedAttributeList::get(Identifier name) const {
 void NamedAttributeList::set(Identifier name, Attribute value) {
   assert(value && "attributes may never be null");
 
-  // If we already have this attribute, replace it.
-  auto origAttrs = getAttrs();
-  SmallVector<NamedAttribute, 8> newAttrs(origAttrs.begin(), origAttrs.end());
-  for (auto &elt : newAttrs)
-    if (elt.first == name) {
-      elt.second = value;
-      attrs = DictionaryAttr::get(newAttrs, value.getContext());
-      return;
-    }
+  // Setting an attribute to its current value is a no-op, don't invalidate
+  // the dictionary for it.
+  if (get(name) == value)
+    return;
 
-  // Otherwise, add it.
-  newAttrs.push_back({name, value});
-  attrs = DictionaryAttr::get(newAttrs, value.getContext());
+  // If we already have this attribute, replace it.  Otherwise, insert it at
+  // its sorted position.
+  auto &attrList = getMutableAttrs();
+  auto *pos = const_cast<NamedAttribute *>(
+      findAttrPos(attrList, name.strref()));
+  if (pos != attrList.end() && pos->first == name)
+    pos->second = value;
+  else
+    attrList.insert(pos, NamedAttribute(name, value));
 }
 
 /// Remove the attribute with the specified name if it exists.  The return
 /// value indicates whether the attribute was present or not.
 auto NamedAttributeList::remove(Identifier name) -> RemoveResult {
-  auto origAttrs = getAttrs();
-  for (unsigned i = 0, e = origAttrs.size(); i != e; ++i) {
-    if (origAttrs[i].first == name) {
-      // Handle the simple case of removing the only attribute in the list.
-      if (e == 1) {
-        attrs = nullptr;
-        return RemoveResult::Removed;
-      }
+  if (!get(name))
+    return RemoveResult::NotFound;
 
-      SmallVector<NamedAttribute, 8> newAttrs;
-      newAttrs.reserve(origAttrs.size() - 1);
-      newAttrs.append(origAttrs.begin(), origAttrs.begin() + i);
-      newAttrs.append(origAttrs.begin() + i + 1, origAttrs.end());
-      attrs = DictionaryAttr::get(newAttrs, newAttrs[0].second.getContext());
-      return RemoveResult::Removed;
-    }
+  // Handle the simple case of removing the only attribute in the list.
+  if (getAttrs().size() == 1) {
+    attrs = nullptr;
+    mutableAttrs.reset();
+    return RemoveResult::Removed;
   }
-  return RemoveResult::NotFound;
+
+  auto &attrList = getMutableAttrs();
+  attrList.erase(findAttrPos(attrList, name.strref()));
+  return RemoveResult::Removed;
 }
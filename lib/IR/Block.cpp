@@ -17,6 +17,7 @@
 
 #include "mlir/IR/Block.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/IRArena.h"
 #include "mlir/IR/Operation.h"
 using namespace mlir;
 
@@ -42,6 +43,14 @@ Block::~Block() {
   llvm::DeleteContainerPointers(arguments);
 }
 
+void *Block::operator new(size_t size, IRArena *arena) {
+  return IRArena::allocate(arena, size, alignof(Block));
+}
+
+void Block::operator delete(void *ptr) {
+  IRArena::deallocate(ptr, alignof(Block));
+}
+
 Region *Block::getParent() { return parentValidInstOrderPair.getPointer(); }
 
 /// Returns the closest surrounding operation that contains this block or
@@ -130,6 +139,9 @@ bool Block::verifyInstOrder() {
 
   Operation *prev = nullptr;
   for (auto &i : *this) {
+    // Operations inserted since the last ordering query have no index yet.
+    if (!i.hasValidOrder())
+      continue;
     // The previous operation must have a smaller order index than the next as
     // it appears earlier in the list.
     if (prev && prev->orderIndex >= i.orderIndex)
@@ -143,11 +155,13 @@ bool Block::verifyInstOrder() {
 void Block::recomputeInstOrder() {
   parentValidInstOrderPair.setInt(true);
 
-  // TODO(riverriddle) Have non-congruent indices to reduce the number of times
-  // an insert invalidates the list.
+  // Leave room between the indices, so that operations inserted later can be
+  // ordered without renumbering the block.
   unsigned orderIndex = 0;
-  for (auto &op : *this)
-    op.orderIndex = orderIndex++;
+  for (auto &op : *this) {
+    op.orderIndex = orderIndex;
+    orderIndex += Operation::kOrderStride;
+  }
 }
 
 Block *PredecessorIterator::operator*() const {
@@ -330,12 +330,21 @@ AffineMap Builder::getShiftedAffineMap(AffineMap map, int64_t shift) {
 
 OpBuilder::~OpBuilder() {}
 
+/// Return the arena of the function that contains `region`, or null if the
+/// IR built within it should be allocated from the heap.
+static IRArena *getArenaFor(Region *region) {
+  for (; region; region = region->getContainingRegion())
+    if (auto *function = region->getContainingFunction())
+      return function->getArena();
+  return nullptr;
+}
+
 /// Add new block and set the insertion point to the end of it.  If an
 /// 'insertBefore' block is passed, the block will be placed before the
 /// specified block.  If not, the block will be appended to the end of the
 /// current function.
 Block *OpBuilder::createBlock(Block *insertBefore) {
-  Block *b = new Block();
+  Block *b = new (getArenaFor(region)) Block();
 
   // If we are supposed to insert before a specific block, do so, otherwise add
   // the block to the end of the function.
@@ -351,7 +360,7 @@ Block *OpBuilder::createBlock(Block *insertBefore) {
 /// Create an operation given the fields represented as an OperationState.
 Operation *OpBuilder::createOperation(const OperationState &state) {
   assert(block && "createOperation() called without setting builder's block");
-  auto *op = Operation::create(state);
+  auto *op = Operation::create(state, getArenaFor(block->getParent()));
   block->getOperations().insert(insertPoint, op);
   return op;
 }
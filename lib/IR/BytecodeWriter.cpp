@@ -0,0 +1,601 @@
+//===- BytecodeWriter.cpp - MLIR Bytecode Writer --------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements the writer of the binary bytecode format of modules.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/Bytecode.h"
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Module.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/StandardTypes.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace mlir;
+using namespace mlir::bytecode;
+
+namespace {
+/// This class writes a module in the bytecode format.  The module is first
+/// walked to populate the string, type, attribute and location tables, which
+/// are then emitted before the functions that refer to them.
+class BytecodeWriter {
+public:
+  explicit BytecodeWriter(raw_ostream &os) : os(os), saver(allocator) {}
+
+  void write(Module *module);
+
+private:
+  //===--------------------------------------------------------------------===//
+  // Table population
+  //===--------------------------------------------------------------------===//
+
+  /// Return the index of the given entry, adding it and its dependencies to
+  /// the tables if necessary.
+  unsigned getIndex(StringRef str);
+  unsigned getIndex(Type type);
+  unsigned getIndex(Attribute attr);
+  unsigned getIndex(Location loc);
+
+  /// Return the index of the textual form of the given type or attribute.
+  template <typename T> unsigned getTextualIndex(T entry);
+
+  /// Add the entries referred to by the given IR to the tables, and number the
+  /// values and blocks that it defines.
+  void populate(ArrayRef<NamedAttribute> attrs);
+  void populate(Function &function);
+  void populate(Region &region, unsigned &nextValueId);
+
+  //===--------------------------------------------------------------------===//
+  // Emission
+  //===--------------------------------------------------------------------===//
+
+  void emitByte(uint8_t byte) {
+    os << static_cast<char>(byte);
+    ++offset;
+  }
+  void emitBytes(StringRef bytes) {
+    os << bytes;
+    offset += bytes.size();
+  }
+  void emitVarInt(uint64_t value) {
+    offset += llvm::encodeULEB128(value, os);
+  }
+  void emitZigZagVarInt(int64_t value) {
+    emitVarInt((static_cast<uint64_t>(value) << 1) ^
+               static_cast<uint64_t>(value >> 63));
+  }
+
+  void emitTypeEntry(Type type);
+  void emitAttributeEntry(Attribute attr);
+  void emitLocationEntry(Location loc);
+
+  void emit(ArrayRef<NamedAttribute> attrs);
+  void emit(Function &function);
+  void emit(Region &region);
+  void emit(Operation &op);
+  void emit(Value *value);
+
+  /// The stream to write to, and the number of bytes written so far.
+  raw_ostream &os;
+  uint64_t offset = 0;
+
+  /// The storage of the textual forms of types and attributes.
+  llvm::BumpPtrAllocator allocator;
+  llvm::StringSaver saver;
+
+  /// The tables of the module, and the indices of their entries.
+  std::vector<StringRef> strings;
+  std::vector<Type> types;
+  std::vector<Attribute> attributes;
+  std::vector<Location> locations;
+  llvm::DenseMap<StringRef, unsigned> stringIndices;
+  llvm::DenseMap<Type, unsigned> typeIndices;
+  llvm::DenseMap<Attribute, unsigned> attributeIndices;
+  llvm::DenseMap<Location, unsigned> locationIndices;
+
+  /// The index of the textual form of the types and attributes stored as
+  /// text, keyed by their opaque pointer.
+  llvm::DenseMap<const void *, unsigned> textualIndices;
+
+  /// The number of each value and block.  Values are numbered per function,
+  /// and blocks per region.
+  llvm::DenseMap<Value *, unsigned> valueIds;
+  llvm::DenseMap<Block *, unsigned> blockIds;
+
+  /// The number of values of each function.
+  llvm::DenseMap<Function *, unsigned> numFunctionValues;
+
+  /// The number of values of the function being emitted that have been
+  /// defined so far.
+  unsigned numDefinedValues = 0;
+};
+} // end anonymous namespace
+
+//===----------------------------------------------------------------------===//
+// Table population
+//===----------------------------------------------------------------------===//
+
+unsigned BytecodeWriter::getIndex(StringRef str) {
+  auto it = stringIndices.find(str);
+  if (it != stringIndices.end())
+    return it->second;
+  strings.push_back(str);
+  return stringIndices[str] = strings.size() - 1;
+}
+
+template <typename T> unsigned BytecodeWriter::getTextualIndex(T entry) {
+  const void *key = entry.getAsOpaquePointer();
+  auto it = textualIndices.find(key);
+  if (it != textualIndices.end())
+    return it->second;
+
+  std::string str;
+  llvm::raw_string_ostream strOS(str);
+  entry.print(strOS);
+  return textualIndices[key] = getIndex(saver.save(strOS.str()));
+}
+
+unsigned BytecodeWriter::getIndex(Type type) {
+  auto it = typeIndices.find(type);
+  if (it != typeIndices.end())
+    return it->second;
+
+  // Add the dependencies before the type itself.
+  switch (type.getKind()) {
+  case StandardTypes::Integer:
+  case StandardTypes::Index:
+  case StandardTypes::BF16:
+  case StandardTypes::F16:
+  case StandardTypes::F32:
+  case StandardTypes::F64:
+  case StandardTypes::None:
+    break;
+  case Type::Kind::Function: {
+    auto funcType = type.cast<FunctionType>();
+    for (Type input : funcType.getInputs())
+      getIndex(input);
+    for (Type result : funcType.getResults())
+      getIndex(result);
+    break;
+  }
+  default:
+    getTextualIndex(type);
+    break;
+  }
+
+  types.push_back(type);
+  return typeIndices[type] = types.size() - 1;
+}
+
+/// Returns true if the given attribute is stored in its textual form.
+static bool isTextualAttribute(Attribute attr) {
+  switch (attr.getKind()) {
+  case StandardAttributes::Unit:
+  case StandardAttributes::Bool:
+  case StandardAttributes::Float:
+  case StandardAttributes::String:
+  case StandardAttributes::Type:
+  case StandardAttributes::Function:
+  case StandardAttributes::Array:
+  case StandardAttributes::Dictionary:
+  case StandardAttributes::DenseElements:
+    return false;
+  case StandardAttributes::Integer:
+    return attr.cast<IntegerAttr>().getValue().getBitWidth() > 64;
+  default:
+    return true;
+  }
+}
+
+unsigned BytecodeWriter::getIndex(Attribute attr) {
+  auto it = attributeIndices.find(attr);
+  if (it != attributeIndices.end())
+    return it->second;
+
+  // Add the dependencies before the attribute itself.
+  if (isTextualAttribute(attr)) {
+    getTextualIndex(attr);
+  } else {
+    switch (attr.getKind()) {
+    case StandardAttributes::Integer:
+    case StandardAttributes::Float:
+    case StandardAttributes::DenseElements:
+      getIndex(attr.getType());
+      break;
+    case StandardAttributes::String:
+      getIndex(attr.cast<StringAttr>().getValue());
+      break;
+    case StandardAttributes::Type:
+      getIndex(attr.cast<TypeAttr>().getValue());
+      break;
+    case StandardAttributes::Function:
+      getIndex(attr.cast<FunctionAttr>().getValue());
+      break;
+    case StandardAttributes::Array:
+      for (Attribute element : attr.cast<ArrayAttr>().getValue())
+        getIndex(element);
+      break;
+    case StandardAttributes::Dictionary:
+      populate(attr.cast<DictionaryAttr>().getValue());
+      break;
+    default:
+      break;
+    }
+  }
+
+  attributes.push_back(attr);
+  return attributeIndices[attr] = attributes.size() - 1;
+}
+
+unsigned BytecodeWriter::getIndex(Location loc) {
+  auto it = locationIndices.find(loc);
+  if (it != locationIndices.end())
+    return it->second;
+
+  // Add the dependencies before the location itself.
+  switch (loc.getKind()) {
+  case Location::Kind::UnknownLocation:
+    break;
+  case Location::Kind::FileLineColLocation:
+    getIndex(loc.cast<FileLineColLoc>().getFilename());
+    break;
+  case Location::Kind::NameLocation: {
+    auto nameLoc = loc.cast<NameLoc>();
+    getIndex(nameLoc.getName().strref());
+    getIndex(nameLoc.getChildLoc());
+    break;
+  }
+  case Location::Kind::CallSiteLocation: {
+    auto callSiteLoc = loc.cast<CallSiteLoc>();
+    getIndex(callSiteLoc.getCallee());
+    getIndex(callSiteLoc.getCaller());
+    break;
+  }
+  case Location::Kind::FusedLocation: {
+    auto fusedLoc = loc.cast<FusedLoc>();
+    for (Location child : fusedLoc.getLocations())
+      getIndex(child);
+    if (Attribute metadata = fusedLoc.getMetadata())
+      getIndex(metadata);
+    break;
+  }
+  }
+
+  locations.push_back(loc);
+  return locationIndices[loc] = locations.size() - 1;
+}
+
+void BytecodeWriter::populate(ArrayRef<NamedAttribute> attrs) {
+  for (auto &attr : attrs) {
+    getIndex(attr.first.strref());
+    getIndex(attr.second);
+  }
+}
+
+void BytecodeWriter::populate(Function &function) {
+  getIndex(function.getName().strref());
+  getIndex(function.getType());
+  getIndex(function.getLoc());
+  populate(function.getAttrs());
+  for (unsigned i = 0, e = function.getNumArguments(); i != e; ++i)
+    populate(function.getArgAttrs(i));
+
+  unsigned nextValueId = 0;
+  populate(function.getBody(), nextValueId);
+  numFunctionValues[&function] = nextValueId;
+}
+
+void BytecodeWriter::populate(Region &region, unsigned &nextValueId) {
+  // Number the blocks and their arguments first, in the order in which they
+  // are defined by the reader.
+  unsigned nextBlockId = 0;
+  for (Block &block : region) {
+    blockIds[&block] = nextBlockId++;
+    for (auto *arg : block.getArguments()) {
+      getIndex(arg->getType());
+      valueIds[arg] = nextValueId++;
+    }
+  }
+
+  for (Block &block : region) {
+    for (Operation &op : block) {
+      getIndex(op.getName().getStringRef());
+      getIndex(op.getLoc());
+      for (auto *result : op.getResults()) {
+        getIndex(result->getType());
+        valueIds[result] = nextValueId++;
+      }
+      populate(op.getAttrs());
+      for (Region &nested : op.getRegions())
+        populate(nested, nextValueId);
+    }
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Emission
+//===----------------------------------------------------------------------===//
+
+void BytecodeWriter::emitTypeEntry(Type type) {
+  switch (type.getKind()) {
+  case StandardTypes::Integer:
+    emitByte(static_cast<uint8_t>(TypeCode::Integer));
+    emitVarInt(type.cast<IntegerType>().getWidth());
+    return;
+  case StandardTypes::Index:
+    emitByte(static_cast<uint8_t>(TypeCode::Index));
+    return;
+  case StandardTypes::BF16:
+    emitByte(static_cast<uint8_t>(TypeCode::BF16));
+    return;
+  case StandardTypes::F16:
+    emitByte(static_cast<uint8_t>(TypeCode::F16));
+    return;
+  case StandardTypes::F32:
+    emitByte(static_cast<uint8_t>(TypeCode::F32));
+    return;
+  case StandardTypes::F64:
+    emitByte(static_cast<uint8_t>(TypeCode::F64));
+    return;
+  case StandardTypes::None:
+    emitByte(static_cast<uint8_t>(TypeCode::None));
+    return;
+  case Type::Kind::Function: {
+    auto funcType = type.cast<FunctionType>();
+    emitByte(static_cast<uint8_t>(TypeCode::Function));
+    emitVarInt(funcType.getNumInputs());
+    for (Type input : funcType.getInputs())
+      emitVarInt(getIndex(input));
+    emitVarInt(funcType.getNumResults());
+    for (Type result : funcType.getResults())
+      emitVarInt(getIndex(result));
+    return;
+  }
+  default:
+    emitByte(static_cast<uint8_t>(TypeCode::Textual));
+    emitVarInt(getTextualIndex(type));
+    return;
+  }
+}
+
+void BytecodeWriter::emitAttributeEntry(Attribute attr) {
+  if (isTextualAttribute(attr)) {
+    emitByte(static_cast<uint8_t>(AttributeCode::Textual));
+    emitVarInt(getTextualIndex(attr));
+    return;
+  }
+
+  switch (attr.getKind()) {
+  case StandardAttributes::Unit:
+    emitByte(static_cast<uint8_t>(AttributeCode::Unit));
+    return;
+  case StandardAttributes::Bool:
+    emitByte(static_cast<uint8_t>(attr.cast<BoolAttr>().getValue()
+                                      ? AttributeCode::BoolTrue
+                                      : AttributeCode::BoolFalse));
+    return;
+  case StandardAttributes::Integer:
+    emitByte(static_cast<uint8_t>(AttributeCode::Integer));
+    emitVarInt(getIndex(attr.getType()));
+    emitZigZagVarInt(attr.cast<IntegerAttr>().getValue().getSExtValue());
+    return;
+  case StandardAttributes::Float:
+    emitByte(static_cast<uint8_t>(AttributeCode::Float));
+    emitVarInt(getIndex(attr.getType()));
+    emitVarInt(
+        attr.cast<FloatAttr>().getValue().bitcastToAPInt().getZExtValue());
+    return;
+  case StandardAttributes::String:
+    emitByte(static_cast<uint8_t>(AttributeCode::String));
+    emitVarInt(getIndex(attr.cast<StringAttr>().getValue()));
+    return;
+  case StandardAttributes::Type:
+    emitByte(static_cast<uint8_t>(AttributeCode::Type));
+    emitVarInt(getIndex(attr.cast<TypeAttr>().getValue()));
+    return;
+  case StandardAttributes::Function:
+    emitByte(static_cast<uint8_t>(AttributeCode::Function));
+    emitVarInt(getIndex(attr.cast<FunctionAttr>().getValue()));
+    return;
+  case StandardAttributes::Array: {
+    auto elements = attr.cast<ArrayAttr>().getValue();
+    emitByte(static_cast<uint8_t>(AttributeCode::Array));
+    emitVarInt(elements.size());
+    for (Attribute element : elements)
+      emitVarInt(getIndex(element));
+    return;
+  }
+  case StandardAttributes::Dictionary:
+    emitByte(static_cast<uint8_t>(AttributeCode::Dictionary));
+    emit(attr.cast<DictionaryAttr>().getValue());
+    return;
+  case StandardAttributes::DenseElements: {
+    auto denseAttr = attr.cast<DenseElementsAttr>();
+    ArrayRef<char> data = denseAttr.getRawData();
+    emitByte(static_cast<uint8_t>(AttributeCode::DenseElements));
+    emitVarInt(getIndex(attr.getType()));
+    emitByte(denseAttr.isSplat());
+    emitVarInt(data.size());
+
+    // Pad the payload so that it can be used in place by the reader.
+    while (offset % kPayloadAlignment != 0)
+      emitByte(0);
+    emitBytes(StringRef(data.data(), data.size()));
+    return;
+  }
+  default:
+    llvm_unreachable("unexpected attribute kind");
+  }
+}
+
+void BytecodeWriter::emitLocationEntry(Location loc) {
+  switch (loc.getKind()) {
+  case Location::Kind::UnknownLocation:
+    emitByte(static_cast<uint8_t>(LocationCode::Unknown));
+    return;
+  case Location::Kind::FileLineColLocation: {
+    auto fileLoc = loc.cast<FileLineColLoc>();
+    emitByte(static_cast<uint8_t>(LocationCode::FileLineCol));
+    emitVarInt(getIndex(fileLoc.getFilename()));
+    emitVarInt(fileLoc.getLine());
+    emitVarInt(fileLoc.getColumn());
+    return;
+  }
+  case Location::Kind::NameLocation: {
+    auto nameLoc = loc.cast<NameLoc>();
+    emitByte(static_cast<uint8_t>(LocationCode::Name));
+    emitVarInt(getIndex(nameLoc.getName().strref()));
+    emitVarInt(getIndex(nameLoc.getChildLoc()));
+    return;
+  }
+  case Location::Kind::CallSiteLocation: {
+    auto callSiteLoc = loc.cast<CallSiteLoc>();
+    emitByte(static_cast<uint8_t>(LocationCode::CallSite));
+    emitVarInt(getIndex(callSiteLoc.getCallee()));
+    emitVarInt(getIndex(callSiteLoc.getCaller()));
+    return;
+  }
+  case Location::Kind::FusedLocation: {
+    auto fusedLoc = loc.cast<FusedLoc>();
+    emitByte(static_cast<uint8_t>(LocationCode::Fused));
+    emitVarInt(fusedLoc.getLocations().size());
+    for (Location child : fusedLoc.getLocations())
+      emitVarInt(getIndex(child));
+    Attribute metadata = fusedLoc.getMetadata();
+    emitVarInt(metadata ? getIndex(metadata) + 1 : 0);
+    return;
+  }
+  }
+}
+
+void BytecodeWriter::emit(ArrayRef<NamedAttribute> attrs) {
+  emitVarInt(attrs.size());
+  for (auto &attr : attrs) {
+    emitVarInt(getIndex(attr.first.strref()));
+    emitVarInt(getIndex(attr.second));
+  }
+}
+
+void BytecodeWriter::emit(Function &function) {
+  emitVarInt(getIndex(function.getName().strref()));
+  emitVarInt(getIndex(function.getType()));
+  emitVarInt(getIndex(function.getLoc()));
+  emit(function.getAttrs());
+  for (unsigned i = 0, e = function.getNumArguments(); i != e; ++i)
+    emit(function.getArgAttrs(i));
+  emitVarInt(numFunctionValues[&function]);
+
+  numDefinedValues = 0;
+  emit(function.getBody());
+}
+
+void BytecodeWriter::emit(Region &region) {
+  emitVarInt(region.getBlocks().size());
+  for (Block &block : region) {
+    emitVarInt(block.getNumArguments());
+    for (auto *arg : block.getArguments())
+      emitVarInt(getIndex(arg->getType()));
+    numDefinedValues += block.getNumArguments();
+  }
+
+  for (Block &block : region) {
+    emitVarInt(block.getOperations().size());
+    for (Operation &op : block)
+      emit(op);
+  }
+}
+
+void BytecodeWriter::emit(Operation &op) {
+  emitVarInt(getIndex(op.getName().getStringRef()));
+  emitVarInt(getIndex(op.getLoc()));
+
+  // The resizability of the operand list is stored along with the number of
+  // operands.
+  auto operands = op.getNonSuccessorOperands();
+  uint64_t numOperands = std::distance(operands.begin(), operands.end());
+  emitVarInt((numOperands << 1) | op.hasResizableOperandsList());
+  for (auto *operand : operands)
+    emit(operand);
+
+  emitVarInt(op.getNumResults());
+  for (auto *result : op.getResults())
+    emitVarInt(getIndex(result->getType()));
+  numDefinedValues += op.getNumResults();
+
+  emit(op.getAttrs());
+
+  emitVarInt(op.getNumSuccessors());
+  for (unsigned i = 0, e = op.getNumSuccessors(); i != e; ++i) {
+    emitVarInt(blockIds[op.getSuccessor(i)]);
+    emitVarInt(op.getNumSuccessorOperands(i));
+    for (auto *operand : op.getSuccessorOperands(i))
+      emit(operand);
+  }
+
+  emitVarInt(op.getNumRegions());
+  for (Region &region : op.getRegions())
+    emit(region);
+}
+
+void BytecodeWriter::emit(Value *value) {
+  unsigned id = valueIds[value];
+  bool isForwardReference = id >= numDefinedValues;
+  emitVarInt((static_cast<uint64_t>(id) << 1) | isForwardReference);
+  if (isForwardReference)
+    emitVarInt(getIndex(value->getType()));
+}
+
+void BytecodeWriter::write(Module *module) {
+  for (Function &function : *module)
+    populate(function);
+
+  emitBytes(StringRef(kMagic, sizeof(kMagic)));
+  emitVarInt(kVersion);
+
+  emitVarInt(strings.size());
+  for (StringRef str : strings) {
+    emitVarInt(str.size());
+    emitBytes(str);
+  }
+
+  // The entries only refer to entries with a lower index, which were all
+  // added while populating the tables, so the tables do not grow while they
+  // are emitted.
+  emitVarInt(types.size());
+  for (Type type : types)
+    emitTypeEntry(type);
+  emitVarInt(attributes.size());
+  for (Attribute attr : attributes)
+    emitAttributeEntry(attr);
+  emitVarInt(locations.size());
+  for (Location loc : locations)
+    emitLocationEntry(loc);
+
+  emitVarInt(module->getFunctions().size());
+  for (Function &function : *module)
+    emit(function);
+}
+
+void mlir::writeBytecode(Module *module, raw_ostream &os) {
+  BytecodeWriter(os).write(module);
+}
@@ -761,6 +761,16 @@ struct ParallelDiagnosticHandlerImpl : public llvm::PrettyStackTraceEntry {
     threadToOrderID[tid] = orderID;
   }
 
+  /// Discard the diagnostics of the order ids greater than the given one.
+  void discardDiagnosticsAfter(size_t orderID) {
+    llvm::sys::SmartScopedLock<true> lock(mutex);
+    diagnostics.erase(std::remove_if(diagnostics.begin(), diagnostics.end(),
+                                     [&](const ThreadDiagnostic &diag) {
+                                       return diag.id > orderID;
+                                     }),
+                      diagnostics.end());
+  }
+
   /// Dump the current diagnostics that were inflight.
   void print(raw_ostream &os) const override {
     // Early exit if there are no diagnostics, this is the common case.
@@ -820,3 +830,8 @@ ParallelDiagnosticHandler::~ParallelDiagnosticHandler() {}
 void ParallelDiagnosticHandler::setOrderIDForThread(size_t orderID) {
   impl->setOrderIDForThread(orderID);
 }
+
+/// Discard the diagnostics of the order ids greater than the given one.
+void ParallelDiagnosticHandler::discardDiagnosticsAfter(size_t orderID) {
+  impl->discardDiagnosticsAfter(orderID);
+}
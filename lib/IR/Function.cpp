@@ -25,19 +25,32 @@
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Twine.h"
+#include "llvm/Support/CommandLine.h"
 
 using namespace mlir;
 
+static llvm::cl::opt<bool> clFunctionArenas(
+    "mlir-function-arenas",
+    llvm::cl::desc("Allocate the operations and blocks built in each function "
+                   "from an arena released along with the function"),
+    llvm::cl::init(false), llvm::cl::Hidden);
+
 Function::Function(Location location, StringRef name, FunctionType type,
                    ArrayRef<NamedAttribute> attrs)
     : name(Identifier::get(name, type.getContext())), location(location),
-      type(type), attrs(attrs), argAttrs(type.getNumInputs()), body(this) {}
+      type(type), attrs(attrs), argAttrs(type.getNumInputs()), body(this) {
+  if (clFunctionArenas)
+    enableArena();
+}
 
 Function::Function(Location location, StringRef name, FunctionType type,
                    ArrayRef<NamedAttribute> attrs,
                    ArrayRef<NamedAttributeList> argAttrs)
     : name(Identifier::get(name, type.getContext())), location(location),
-      type(type), attrs(attrs), argAttrs(argAttrs), body(this) {}
+      type(type), attrs(attrs), argAttrs(argAttrs), body(this) {
+  if (clFunctionArenas)
+    enableArena();
+}
 
 MLIRContext *Function::getContext() { return getType().getContext(); }
 
@@ -0,0 +1,62 @@
+//===- IRArena.cpp - Arena for IR objects ---------------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/IR/IRArena.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+
+using namespace mlir;
+
+/// Return the size of the header that precedes an object with the given
+/// alignment.  The header holds the arena that the object was allocated from,
+/// so that it can be deallocated without knowing where it came from.
+static size_t getHeaderSize(size_t alignment) {
+  return llvm::alignTo(sizeof(IRArena *), alignment);
+}
+
+void *IRArena::allocate(IRArena *arena, size_t size, size_t alignment) {
+  assert(alignment <= alignof(std::max_align_t) &&
+         "over-aligned IR objects are not supported");
+  size_t headerSize = getHeaderSize(alignment);
+
+  char *rawMem;
+  if (arena) {
+    {
+      std::lock_guard<std::mutex> lock(arena->mutex);
+      rawMem = static_cast<char *>(arena->allocator.Allocate(
+          headerSize + size, std::max(alignment, alignof(IRArena *))));
+    }
+    arena->Retain();
+  } else {
+    rawMem = static_cast<char *>(malloc(headerSize + size));
+  }
+
+  char *ptr = rawMem + headerSize;
+  reinterpret_cast<IRArena **>(ptr)[-1] = arena;
+  return ptr;
+}
+
+void IRArena::deallocate(void *ptr, size_t alignment) {
+  // The memory of arena objects is only reclaimed with the arena itself.
+  if (IRArena *arena = getArena(ptr)) {
+    arena->Release();
+    return;
+  }
+  free(static_cast<char *>(ptr) - getHeaderSize(alignment));
+}
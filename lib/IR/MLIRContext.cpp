@@ -38,8 +38,10 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/RWMutex.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
 #include <memory>
 
 using namespace mlir;
@@ -48,31 +50,109 @@ using namespace mlir::detail;
 using llvm::hash_combine;
 using llvm::hash_combine_range;
 
+namespace {
+/// A uniquing table whose instances are partitioned into a fixed number of
+/// stripes by hash value. Each stripe has its own lock and allocator, so that
+/// threads creating unrelated instances do not contend with each other.
+template <typename ContainerT> struct StripedUniquingTable {
+  /// The number of stripes, this must be a power of two.
+  static constexpr unsigned kNumStripesLog2 = 4;
+
+  struct Stripe {
+    /// A mutex used to keep access to this stripe thread-safe.
+    llvm::sys::SmartRWMutex<true> mutex;
+
+    /// The allocator used for instances within this stripe.
+    llvm::BumpPtrAllocator allocator;
+
+    /// The uniqued instances within this stripe.
+    ContainerT container;
+  };
+
+  StripedUniquingTable() : id(nextTableID++) {}
+
+  /// Returns the stripe responsible for the given hash value. The hash is mixed
+  /// before selecting the stripe so that the bits used to pick a stripe are
+  /// independent of those used to index into the container.
+  Stripe &getStripe(unsigned hashValue) {
+    return stripes[(hashValue * 0x9E3779B9u) >> (32 - kNumStripesLog2)];
+  }
+
+  /// A process-wide unique identifier for this table. This is used to validate
+  /// the per-thread front caches, as table addresses may be reused.
+  const uint64_t id;
+
+  Stripe stripes[1 << kNumStripesLog2];
+
+private:
+  static std::atomic<uint64_t> nextTableID;
+};
+template <typename ContainerT>
+constexpr unsigned StripedUniquingTable<ContainerT>::kNumStripesLog2;
+template <typename ContainerT>
+std::atomic<uint64_t> StripedUniquingTable<ContainerT>::nextTableID(1);
+
+/// A per-thread cache placed in front of a uniquing table, holding instances
+/// that have already been uniqued by the current thread. Lookups that hit in
+/// the cache do not touch any shared state. Each thread has a single cache per
+/// container type, which holds the instances of one table at a time and is
+/// reset when used with a different table or when it grows too large.
+template <typename ContainerT> struct ThreadLocalFrontCache {
+  /// The maximum number of entries held before the cache is reset.
+  static constexpr unsigned kMaxEntries = 4096;
+
+  /// Returns the cache of the current thread for the table with the given id.
+  static ContainerT &get(uint64_t tableID) {
+    static thread_local ThreadLocalFrontCache cache;
+    if (cache.tableID != tableID || cache.container.size() >= kMaxEntries) {
+      cache.container.clear();
+      cache.tableID = tableID;
+    }
+    return cache.container;
+  }
+
+  uint64_t tableID = 0;
+  ContainerT container;
+};
+} // end anonymous namespace
+
 /// A utility function to safely get or create a uniqued instance within the
-/// given set container.
+/// given striped set container.
 template <typename ValueT, typename DenseInfoT, typename KeyT,
           typename ConstructorFn>
-static ValueT safeGetOrCreate(DenseSet<ValueT, DenseInfoT> &container,
-                              KeyT &&key, llvm::sys::SmartRWMutex<true> &mutex,
-                              ConstructorFn &&constructorFn) {
-  { // Check for an existing instance in read-only mode.
-    llvm::sys::SmartScopedReader<true> instanceLock(mutex);
-    auto it = container.find_as(key);
-    if (it != container.end())
-      return *it;
-  }
+static ValueT
+safeGetOrCreate(StripedUniquingTable<DenseSet<ValueT, DenseInfoT>> &table,
+                KeyT &&key, ConstructorFn &&constructorFn) {
+  // Check the front cache of this thread for an existing instance.
+  auto &cache =
+      ThreadLocalFrontCache<DenseSet<ValueT, DenseInfoT>>::get(table.id);
+  auto cacheIt = cache.find_as(key);
+  if (cacheIt != cache.end())
+    return *cacheIt;
+
+  auto &stripe = table.getStripe(DenseInfoT::getHashValue(key));
+  ValueT result = [&]() -> ValueT {
+    { // Check for an existing instance in read-only mode.
+      llvm::sys::SmartScopedReader<true> instanceLock(stripe.mutex);
+      auto it = stripe.container.find_as(key);
+      if (it != stripe.container.end())
+        return *it;
+    }
 
-  // Aquire a writer-lock so that we can safely create the new instance.
-  llvm::sys::SmartScopedWriter<true> instanceLock(mutex);
+    // Aquire a writer-lock so that we can safely create the new instance.
+    llvm::sys::SmartScopedWriter<true> instanceLock(stripe.mutex);
 
-  // Check for an existing instance again here, because another writer thread
-  // may have already created one.
-  auto existing = container.insert_as(ValueT(), key);
-  if (!existing.second)
-    return *existing.first;
+    // Check for an existing instance again here, because another writer thread
+    // may have already created one.
+    auto existing = stripe.container.insert_as(ValueT(), key);
+    if (!existing.second)
+      return *existing.first;
 
-  // Otherwise, construct a new instance of the value.
-  return *existing.first = constructorFn();
+    // Otherwise, construct a new instance of the value.
+    return *existing.first = constructorFn(stripe.allocator);
+  }();
+  cache.insert(result);
+  return result;
 }
 
 /// A utility function to thread-safely get or create a uniqued instance within
@@ -104,30 +184,43 @@ ValueT safeGetOrCreate(std::vector<ValueT> &container, unsigned position,
 }
 
 /// A utility function to safely get or create a uniqued instance within the
-/// given map container.
+/// given striped map container.
 template <typename ContainerTy, typename KeyT, typename ConstructorFn>
 static typename ContainerTy::mapped_type
-safeGetOrCreate(ContainerTy &container, KeyT &&key,
-                llvm::sys::SmartRWMutex<true> &mutex,
+safeGetOrCreate(StripedUniquingTable<ContainerTy> &table, KeyT &&key,
                 ConstructorFn &&constructorFn) {
-  { // Check for an existing instance in read-only mode.
-    llvm::sys::SmartScopedReader<true> instanceLock(mutex);
-    auto it = container.find(key);
-    if (it != container.end())
-      return it->second;
-  }
+  using KeyInfoT = DenseMapInfo<typename ContainerTy::key_type>;
+
+  // Check the front cache of this thread for an existing instance.
+  auto &cache = ThreadLocalFrontCache<ContainerTy>::get(table.id);
+  auto cacheIt = cache.find(key);
+  if (cacheIt != cache.end())
+    return cacheIt->second;
+
+  auto &stripe = table.getStripe(KeyInfoT::getHashValue(key));
+  using ValueT = typename ContainerTy::mapped_type;
+  ValueT result = [&]() -> ValueT {
+    { // Check for an existing instance in read-only mode.
+      llvm::sys::SmartScopedReader<true> instanceLock(stripe.mutex);
+      auto it = stripe.container.find(key);
+      if (it != stripe.container.end())
+        return it->second;
+    }
 
-  // Aquire a writer-lock so that we can safely create the new instance.
-  llvm::sys::SmartScopedWriter<true> instanceLock(mutex);
+    // Aquire a writer-lock so that we can safely create the new instance.
+    llvm::sys::SmartScopedWriter<true> instanceLock(stripe.mutex);
 
-  // Check for an existing instance again here, because another writer thread
-  // may have already created one.
-  auto *&result = container[key];
-  if (result)
-    return result;
+    // Check for an existing instance again here, because another writer thread
+    // may have already created one.
+    auto *&instance = stripe.container[key];
+    if (instance)
+      return instance;
 
-  // Otherwise, construct a new instance of the value.
-  return result = constructorFn();
+    // Otherwise, construct a new instance of the value.
+    return instance = constructorFn(stripe.allocator);
+  }();
+  cache.insert({key, result});
+  return result;
 }
 
 namespace {
@@ -254,35 +347,34 @@ public:
   // Location uniquing
   //===--------------------------------------------------------------------===//
 
-  // Location allocator and mutex for thread safety.
-  llvm::BumpPtrAllocator locationAllocator;
-  llvm::sys::SmartRWMutex<true> locationMutex;
-
   /// The singleton for UnknownLoc.
   UnknownLocationStorage theUnknownLoc;
 
   /// FileLineColLoc uniquing.
-  DenseMap<std::tuple<const char *, unsigned, unsigned>,
-           FileLineColLocationStorage *>
+  StripedUniquingTable<DenseMap<std::tuple<const char *, unsigned, unsigned>,
+                                FileLineColLocationStorage *>>
       fileLineColLocs;
 
   /// NameLocation uniquing.
-  DenseMap<const char *, NameLocationStorage *> nameLocs;
+  StripedUniquingTable<DenseMap<const char *, NameLocationStorage *>> nameLocs;
 
   /// CallLocation uniquing.
-  DenseSet<CallSiteLocationStorage *, CallSiteLocationKeyInfo> callLocs;
+  StripedUniquingTable<
+      DenseSet<CallSiteLocationStorage *, CallSiteLocationKeyInfo>>
+      callLocs;
 
   /// FusedLoc uniquing.
   using FusedLocations = DenseSet<FusedLocationStorage *, FusedLocKeyInfo>;
-  FusedLocations fusedLocs;
+  StripedUniquingTable<FusedLocations> fusedLocs;
 
   //===--------------------------------------------------------------------===//
   // Identifier uniquing
   //===--------------------------------------------------------------------===//
 
-  // Identifier allocator and mutex for thread safety.
-  llvm::BumpPtrAllocator identifierAllocator;
-  llvm::sys::SmartRWMutex<true> identifierMutex;
+  /// These are identifiers uniqued into this MLIRContext. Each stripe owns the
+  /// allocator for the string data of its identifiers.
+  using IdentifierMap = llvm::StringMap<char, llvm::BumpPtrAllocator>;
+  StripedUniquingTable<IdentifierMap> identifiers;
 
   //===--------------------------------------------------------------------===//
   // Diagnostics
@@ -309,24 +401,27 @@ public:
   /// attributes and types.
   DenseMap<const ClassID *, Dialect *> registeredDialectSymbols;
 
-  /// These are identifiers uniqued into this MLIRContext.
-  llvm::StringMap<char, llvm::BumpPtrAllocator &> identifiers;
+  /// These are the buffers kept alive by this MLIRContext, e.g. the memory
+  /// mapped files referred to by attributes in place. They are declared before
+  /// the uniquers, so that they are destroyed after them.
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> keptAliveBuffers;
 
   //===--------------------------------------------------------------------===//
   // Affine uniquing
   //===--------------------------------------------------------------------===//
 
-  // Affine allocator and mutex for thread safety.
+  // Affine allocator and mutex for thread safety of integer sets that are not
+  // uniqued.
   llvm::BumpPtrAllocator affineAllocator;
   llvm::sys::SmartRWMutex<true> affineMutex;
 
   // Affine map uniquing.
   using AffineMapSet = DenseSet<AffineMap, AffineMapKeyInfo>;
-  AffineMapSet affineMaps;
+  StripedUniquingTable<AffineMapSet> affineMaps;
 
   // Integer set uniquing.
   using IntegerSets = DenseSet<IntegerSet, IntegerSetKeyInfo>;
-  IntegerSets integerSets;
+  StripedUniquingTable<IntegerSets> integerSets;
 
   // Affine expression uniqui'ing.
   StorageUniquer affineUniquer;
@@ -341,8 +436,6 @@ public:
   //===--------------------------------------------------------------------===//
   StorageUniquer attributeUniquer;
 
-public:
-  MLIRContextImpl() : identifiers(identifierAllocator) {}
 };
 } // end namespace mlir
 
@@ -435,6 +528,12 @@ Dialect *MLIRContext::getRegisteredDialect(StringRef name) {
   return nullptr;
 }
 
+/// Keep the given buffer alive as long as this context.
+void MLIRContext::keepAlive(std::unique_ptr<llvm::MemoryBuffer> buffer) {
+  llvm::sys::SmartScopedWriter<true> lock(getImpl().contextMutex);
+  getImpl().keptAliveBuffers.push_back(std::move(buffer));
+}
+
 /// Register this dialect object with the specified context.  The context
 /// takes ownership of the heap allocated dialect.
 void Dialect::registerDialect(MLIRContext *context) {
@@ -534,19 +633,30 @@ Identifier Identifier::get(StringRef str, MLIRContext *context) {
   assert(str.find('\0') == StringRef::npos &&
          "Cannot create an identifier with a nul character");
 
-  auto &impl = context->getImpl();
-
-  { // Check for an existing identifier in read-only mode.
-    llvm::sys::SmartScopedReader<true> contextLock(impl.identifierMutex);
-    auto it = impl.identifiers.find(str);
-    if (it != impl.identifiers.end())
-      return Identifier(it->getKeyData());
-  }
+  auto &identifiers = context->getImpl().identifiers;
+
+  // Check the front cache of this thread for an existing identifier. The cache
+  // keys reference the string data owned by the context.
+  auto &cache = ThreadLocalFrontCache<DenseSet<StringRef>>::get(identifiers.id);
+  auto cacheIt = cache.find(str);
+  if (cacheIt != cache.end())
+    return Identifier(cacheIt->data());
+
+  auto &stripe = identifiers.getStripe(llvm::hash_value(str));
+  const char *data = [&]() -> const char * {
+    { // Check for an existing identifier in read-only mode.
+      llvm::sys::SmartScopedReader<true> contextLock(stripe.mutex);
+      auto it = stripe.container.find(str);
+      if (it != stripe.container.end())
+        return it->getKeyData();
+    }
 
-  // Aquire a writer-lock so that we can safely create the new instance.
-  llvm::sys::SmartScopedWriter<true> contextLock(impl.identifierMutex);
-  auto it = impl.identifiers.insert({str, char()}).first;
-  return Identifier(it->getKeyData());
+    // Aquire a writer-lock so that we can safely create the new instance.
+    llvm::sys::SmartScopedWriter<true> contextLock(stripe.mutex);
+    return stripe.container.insert({str, char()}).first->getKeyData();
+  }();
+  cache.insert(StringRef(data, str.size()));
+  return Identifier(data);
 }
 
 //===----------------------------------------------------------------------===//
@@ -563,10 +673,11 @@ FileLineColLoc FileLineColLoc::get(Identifier filename, unsigned line,
 
   // Safely get or create a location instance.
   auto key = std::make_tuple(filename.data(), line, column);
-  return safeGetOrCreate(impl.fileLineColLocs, key, impl.locationMutex, [&] {
-    return new (impl.locationAllocator.Allocate<FileLineColLocationStorage>())
-        FileLineColLocationStorage(filename, line, column);
-  });
+  return safeGetOrCreate(
+      impl.fileLineColLocs, key, [&](llvm::BumpPtrAllocator &allocator) {
+        return new (allocator.Allocate<FileLineColLocationStorage>())
+            FileLineColLocationStorage(filename, line, column);
+      });
 }
 
 NameLoc NameLoc::get(Identifier name, Location child, MLIRContext *context) {
@@ -575,10 +686,11 @@ NameLoc NameLoc::get(Identifier name, Location child, MLIRContext *context) {
          "a NameLoc cannot be used as a child of another NameLoc");
 
   // Safely get or create a location instance.
-  return safeGetOrCreate(impl.nameLocs, name.data(), impl.locationMutex, [&] {
-    return new (impl.locationAllocator.Allocate<NameLocationStorage>())
-        NameLocationStorage(name, child);
-  });
+  return safeGetOrCreate(
+      impl.nameLocs, name.data(), [&](llvm::BumpPtrAllocator &allocator) {
+        return new (allocator.Allocate<NameLocationStorage>())
+            NameLocationStorage(name, child);
+      });
 }
 
 CallSiteLoc CallSiteLoc::get(Location callee, Location caller,
@@ -587,10 +699,11 @@ CallSiteLoc CallSiteLoc::get(Location callee, Location caller,
 
   // Safely get or create a location instance.
   auto key = std::make_pair(callee, caller);
-  return safeGetOrCreate(impl.callLocs, key, impl.locationMutex, [&] {
-    return new (impl.locationAllocator.Allocate<CallSiteLocationStorage>())
-        CallSiteLocationStorage(callee, caller);
-  });
+  return safeGetOrCreate(
+      impl.callLocs, key, [&](llvm::BumpPtrAllocator &allocator) {
+        return new (allocator.Allocate<CallSiteLocationStorage>())
+            CallSiteLocationStorage(callee, caller);
+      });
 }
 
 Location FusedLoc::get(ArrayRef<Location> locs, Attribute metadata,
@@ -625,17 +738,17 @@ Location FusedLoc::get(ArrayRef<Location> locs, Attribute metadata,
 
   // Safely get or create a location instance.
   auto key = std::make_pair(locs, metadata);
-  return safeGetOrCreate(impl.fusedLocs, key, impl.locationMutex, [&] {
+  auto constructorFn = [&](llvm::BumpPtrAllocator &allocator) {
     auto byteSize =
         FusedLocationStorage::totalSizeToAlloc<Location>(locs.size());
-    auto rawMem = impl.locationAllocator.Allocate(
-        byteSize, alignof(FusedLocationStorage));
+    auto rawMem = allocator.Allocate(byteSize, alignof(FusedLocationStorage));
     auto result = new (rawMem) FusedLocationStorage(locs.size(), metadata);
 
     std::uninitialized_copy(locs.begin(), locs.end(),
                             result->getTrailingObjects<Location>());
     return result;
-  });
+  };
+  return safeGetOrCreate(impl.fusedLocs, key, constructorFn);
 }
 
 //===----------------------------------------------------------------------===//
@@ -700,16 +813,17 @@ AffineMap AffineMap::get(unsigned dimCount, unsigned symbolCount,
   auto key = std::make_tuple(dimCount, symbolCount, results);
 
   // Safely get or create an AffineMap instance.
-  return safeGetOrCreate(impl.affineMaps, key, impl.affineMutex, [&] {
-    auto *res = impl.affineAllocator.Allocate<detail::AffineMapStorage>();
+  auto constructorFn = [&](llvm::BumpPtrAllocator &allocator) {
+    auto *res = allocator.Allocate<detail::AffineMapStorage>();
 
     // Copy the results into the bump pointer.
-    results = copyArrayRefInto(impl.affineAllocator, results);
+    results = copyArrayRefInto(allocator, results);
 
     // Initialize the memory using placement new.
     new (res) detail::AffineMapStorage{dimCount, symbolCount, results};
     return AffineMap(res);
-  });
+  };
+  return safeGetOrCreate(impl.affineMaps, key, constructorFn);
 }
 
 //===----------------------------------------------------------------------===//
@@ -727,12 +841,12 @@ IntegerSet IntegerSet::get(unsigned dimCount, unsigned symbolCount,
   auto &impl = constraints[0].getContext()->getImpl();
 
   // A utility function to construct a new IntegerSetStorage instance.
-  auto constructorFn = [&] {
-    auto *res = impl.affineAllocator.Allocate<detail::IntegerSetStorage>();
+  auto constructorFn = [&](llvm::BumpPtrAllocator &allocator) {
+    auto *res = allocator.Allocate<detail::IntegerSetStorage>();
 
     // Copy the results and equality flags into the bump pointer.
-    constraints = copyArrayRefInto(impl.affineAllocator, constraints);
-    eqFlags = copyArrayRefInto(impl.affineAllocator, eqFlags);
+    constraints = copyArrayRefInto(allocator, constraints);
+    eqFlags = copyArrayRefInto(allocator, eqFlags);
 
     // Initialize the memory using placement new.
     new (res)
@@ -744,12 +858,11 @@ IntegerSet IntegerSet::get(unsigned dimCount, unsigned symbolCount,
   // threads may simulatenously access existing instances.
   if (constraints.size() < IntegerSet::kUniquingThreshold) {
     auto key = std::make_tuple(dimCount, symbolCount, constraints, eqFlags);
-    return safeGetOrCreate(impl.integerSets, key, impl.affineMutex,
-                           constructorFn);
+    return safeGetOrCreate(impl.integerSets, key, constructorFn);
   }
 
   // Otherwise, aquire a writer-lock so that we can safely create the new
   // instance.
   llvm::sys::SmartScopedWriter<true> affineLock(impl.affineMutex);
-  return constructorFn();
+  return constructorFn(impl.affineAllocator);
 }
@@ -20,6 +20,7 @@
 #include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Dialect.h"
 #include "mlir/IR/Function.h"
+#include "mlir/IR/IRArena.h"
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/OpDefinition.h"
 #include "mlir/IR/OpImplementation.h"
@@ -112,11 +113,12 @@ Operation *Operation::create(Location location, OperationName name,
 }
 
 /// Create a new Operation from operation state.
-Operation *Operation::create(const OperationState &state) {
+Operation *Operation::create(const OperationState &state, IRArena *arena) {
   unsigned numRegions = state.regions.size();
-  Operation *op = create(state.location, state.name, state.operands,
-                         state.types, state.attributes, state.successors,
-                         numRegions, state.resizableOperandList, state.context);
+  Operation *op =
+      create(state.location, state.name, state.operands, state.types,
+             NamedAttributeList(state.attributes), state.successors,
+             numRegions, state.resizableOperandList, state.context, arena);
   for (unsigned i = 0; i < numRegions; ++i)
     if (state.regions[i])
       op->getRegion(i).takeBody(*state.regions[i]);
@@ -130,7 +132,8 @@ Operation *Operation::create(Location location, OperationName name,
                              ArrayRef<Type> resultTypes,
                              const NamedAttributeList &attributes,
                              ArrayRef<Block *> successors, unsigned numRegions,
-                             bool resizableOperandList, MLIRContext *context) {
+                             bool resizableOperandList, MLIRContext *context,
+                             IRArena *arena) {
   unsigned numSuccessors = successors.size();
 
   // Input operands are nullptr-separated for each successor, the null operands
@@ -142,10 +145,10 @@ Operation *Operation::create(Location location, OperationName name,
                                    detail::OperandStorage>(
       resultTypes.size(), numSuccessors, numSuccessors, numRegions,
       /*detail::OperandStorage*/ 1);
-  byteSize += llvm::alignTo(detail::OperandStorage::additionalAllocSize(
-                                numOperands, resizableOperandList),
-                            alignof(Operation));
-  void *rawMem = malloc(byteSize);
+  byteSize +=
+      llvm::alignTo(detail::OperandStorage::additionalAllocSize(numOperands),
+                    alignof(Operation));
+  void *rawMem = IRArena::allocate(arena, byteSize, alignof(Operation));
 
   // Create the new Operation.
   auto op =
@@ -234,7 +237,7 @@ Operation::Operation(Location location, OperationName name, unsigned numResults,
       numRegions(numRegions), name(name), attrs(attributes) {}
 
 // Operations are deleted through the destroy() member because they are
-// allocated via malloc.
+// allocated via IRArena::allocate.
 Operation::~Operation() {
   assert(block == nullptr && "operation destroyed but still in a block");
 
@@ -256,15 +259,16 @@ Operation::~Operation() {
 /// Destroy this operation or one of its subclasses.
 void Operation::destroy() {
   this->~Operation();
-  free(this);
+  IRArena::deallocate(this, alignof(Operation));
 }
 
 /// Return the context this operation is associated with.
 MLIRContext *Operation::getContext() {
   // If the op has an attribute, a result type, or an operand type, we have a
   // constant time way to get to the context.
-  if (auto dict = attrs.getDictionary())
-    return dict.getContext();
+  auto attrList = attrs.getAttrs();
+  if (!attrList.empty())
+    return attrList.front().second.getContext();
   if (getNumResults())
     return getResult(0)->getType().getContext();
   if (getNumOperands())
@@ -341,21 +345,108 @@ InFlightDiagnostic Operation::emitRemark(const Twine &message) {
   return getContext()->emitRemark(getLoc(), message);
 }
 
+constexpr unsigned Operation::kInvalidOrderIdx;
+constexpr unsigned Operation::kOrderStride;
+
+/// The factor by which the density allowed for a range of order indices
+/// grows when the size of the range is halved. This must be in the range
+/// (1, 2): larger factors renumber smaller ranges, but lower the number of
+/// operations, (2 / factor)^32, that a block can hold before its whole range
+/// of indices is considered too dense.
+static constexpr double kOrderDensityGrowth = 1.2;
+
 /// Given an operation 'other' that is within the same parent block, return
 /// whether the current operation is before 'other' in the operation list
 /// of the parent block.
-/// Note: This function has an average complexity of O(1), but worst case may
-/// take O(N) where N is the number of operations within the parent block.
+/// Note: This function has an amortized complexity of O(log(N)) when the
+/// block is mutated between queries, where N is the number of operations
+/// within the parent block, and of O(1) otherwise.
 bool Operation::isBeforeInBlock(Operation *other) {
   assert(block && "Operations without parent blocks have no order.");
   assert(other && other->block == block &&
          "Expected other operation to have the same parent block.");
-  // Recompute the parent ordering if necessary.
-  if (!block->isInstOrderValid())
+  // Recompute the parent ordering if necessary. Otherwise, only order the
+  // operations that were inserted since the last query.
+  if (!block->isInstOrderValid()) {
     block->recomputeInstOrder();
+  } else {
+    updateOrderIfNecessary();
+    other->updateOrderIfNecessary();
+  }
   return orderIndex < other->orderIndex;
 }
 
+/// Assign an order index to this operation if it doesn't have one, along with
+/// the other unordered operations around it.
+void Operation::updateOrderIfNecessary() {
+  assert(block && "expected valid parent");
+  if (hasValidOrder())
+    return;
+
+  // Find the run of unordered operations containing this one. The operations
+  // around the run are ordered, so the run is given indices between theirs.
+  Operation *first = this, *last = this;
+  uint64_t numUnordered = 1;
+  for (; first->getPrevNode() && !first->getPrevNode()->hasValidOrder();
+       first = first->getPrevNode())
+    ++numUnordered;
+  for (; last->getNextNode() && !last->getNextNode()->hasValidOrder();
+       last = last->getNextNode())
+    ++numUnordered;
+  Operation *prev = first->getPrevNode(), *next = last->getNextNode();
+
+  // If there is room between the indices of the neighbors of the run, spread
+  // the run evenly between them.
+  int64_t lower = prev ? int64_t(prev->orderIndex) : -1;
+  int64_t upper = next ? int64_t(next->orderIndex) : int64_t(kInvalidOrderIdx);
+  int64_t step = std::min<int64_t>(kOrderStride,
+                                   (upper - lower) / (numUnordered + 1));
+  if (step != 0) {
+    for (Operation *op = first; op != next; op = op->getNextNode())
+      op->orderIndex = lower += step;
+    return;
+  }
+
+  // Otherwise, find the smallest aligned range of indices around the run that
+  // is sparse enough, and spread the operations of the range evenly over it.
+  // The density allowed for a range decreases with its size, which bounds the
+  // amortized number of renumbered operations per insertion to O(log(N)), as
+  // described in "Two Simplified Algorithms for Maintaining Order in a List"
+  // by Bender et al.
+  uint64_t anchor = prev ? prev->orderIndex : 0;
+  double maxNumOps = 1;
+  for (unsigned bits = 1; bits <= 32; ++bits) {
+    maxNumOps *= 2 / kOrderDensityGrowth;
+    uint64_t rangeBegin = (anchor >> bits) << bits;
+    uint64_t rangeEnd = std::min<uint64_t>(rangeBegin + (uint64_t(1) << bits),
+                                           kInvalidOrderIdx);
+
+    // Collect the operations ordered within the range, along with the
+    // unordered operations that follow them.
+    Operation *rangeFirst = first, *rangeLast = last;
+    uint64_t numOps = numUnordered;
+    for (Operation *op = prev; op && op->orderIndex >= rangeBegin;
+         op = op->getPrevNode(), ++numOps)
+      rangeFirst = op;
+    for (Operation *op = next;
+         op && (!op->hasValidOrder() || op->orderIndex < rangeEnd);
+         op = op->getNextNode(), ++numOps)
+      rangeLast = op;
+    if (numOps > maxNumOps)
+      continue;
+
+    uint64_t rangeStep = (rangeEnd - rangeBegin) / numOps;
+    uint64_t index = rangeBegin;
+    for (Operation *op = rangeFirst, *end = rangeLast->getNextNode();
+         op != end; op = op->getNextNode(), index += rangeStep)
+      op->orderIndex = index;
+    return;
+  }
+
+  // The indices are exhausted, renumber the whole block.
+  block->recomputeInstOrder();
+}
+
 //===----------------------------------------------------------------------===//
 // ilist_traits for Operation
 //===----------------------------------------------------------------------===//
@@ -402,8 +493,8 @@ void llvm::ilist_traits<::mlir::Operation>::addNodeToList(Operation *op) {
   assert(!op->getBlock() && "already in a operation block!");
   op->block = getContainingBlock();
 
-  // Invalidate the block ordering.
-  op->block->invalidateInstOrder();
+  // The operation is given an order index on the next ordering query.
+  op->orderIndex = Operation::kInvalidOrderIdx;
 }
 
 /// This is a trait method invoked when a operation is removed from a block.
@@ -419,17 +510,15 @@ void llvm::ilist_traits<::mlir::Operation>::transferNodesFromList(
     ilist_traits<Operation> &otherList, op_iterator first, op_iterator last) {
   Block *curParent = getContainingBlock();
 
-  // Invalidate the ordering of the parent block.
-  curParent->invalidateInstOrder();
-
-  // If we are transferring operations within the same block, the block
-  // pointer doesn't need to be updated.
-  if (curParent == otherList.getContainingBlock())
-    return;
-
-  // Update the 'block' member of each operation.
-  for (; first != last; ++first)
-    first->block = curParent;
+  // Invalidate the order index of each operation. If we are transferring
+  // operations within the same block, the block pointer doesn't need to be
+  // updated. Otherwise, update the 'block' member of each operation.
+  bool sameBlock = curParent == otherList.getContainingBlock();
+  for (; first != last; ++first) {
+    first->orderIndex = Operation::kInvalidOrderIdx;
+    if (!sameBlock)
+      first->block = curParent;
+  }
 }
 
 /// Remove this operation (and its descendants) from its Block and delete
@@ -493,6 +582,25 @@ void Operation::setSuccessor(Block *block, unsigned index) {
   getBlockOperands()[index].set(block);
 }
 
+void Operation::setSuccessorOperands(unsigned index,
+                                     ArrayRef<Value *> operands) {
+  assert(index < getNumSuccessors());
+  unsigned &numSuccOperands = getTrailingObjects<unsigned>()[index];
+  getOperandStorage().setOperands(this, getSuccessorOperandIndex(index),
+                                  numSuccOperands, operands);
+  numSuccOperands = operands.size();
+}
+
+void Operation::addSuccessorOperands(unsigned index,
+                                     ArrayRef<Value *> operands) {
+  assert(index < getNumSuccessors());
+  unsigned &numSuccOperands = getTrailingObjects<unsigned>()[index];
+  getOperandStorage().setOperands(
+      this, getSuccessorOperandIndex(index) + numSuccOperands,
+      /*length=*/0, operands);
+  numSuccOperands += operands.size();
+}
+
 auto Operation::getNonSuccessorOperands() -> operand_range {
   return {operand_iterator(this, 0),
           operand_iterator(this, hasSuccessors() ? getSuccessorOperandIndex(0)
@@ -67,47 +67,47 @@ void OperationState::addRegion(std::unique_ptr<Region> &&region) {
 // OperandStorage
 //===----------------------------------------------------------------------===//
 
-/// Replace the operands contained in the storage with the ones provided in
-/// 'operands'.
-void detail::OperandStorage::setOperands(Operation *owner,
-                                         ArrayRef<Value *> operands) {
-  // If the number of operands is less than or equal to the current amount, we
-  // can just update in place.
-  if (operands.size() <= numOperands) {
-    auto opOperands = getOperands();
-
-    // If the number of new operands is less than the current count, then remove
-    // any extra operands.
-    for (unsigned i = operands.size(); i != numOperands; ++i)
-      opOperands[i].~OpOperand();
-
-    // Set the operands in place.
-    numOperands = operands.size();
-    for (unsigned i = 0; i != numOperands; ++i)
-      opOperands[i].set(operands[i]);
+/// Replace the 'length' operands starting at 'start' with the ones provided
+/// in 'operands', shifting the operands that follow them as necessary.
+void detail::OperandStorage::setOperands(Operation *owner, unsigned start,
+                                         unsigned length,
+                                         ArrayRef<Value *> newOperands) {
+  assert(start + length <= size() && "invalid operand range");
+  unsigned newSize = size() - length + newOperands.size();
+
+  // Update the operands that are replaced in place.
+  unsigned numReplaced = std::min<unsigned>(length, newOperands.size());
+  for (unsigned i = 0; i != numReplaced; ++i)
+    operands[start + i].set(newOperands[i]);
+  unsigned insertPos = start + numReplaced;
+  if (newOperands.size() == length)
     return;
-  }
-
-  // Otherwise, we need to be resizable.
-  assert(resizable && "Only resizable operations may add operands");
 
-  // Grow the capacity if necessary.
-  auto &resizeUtil = getResizableStorage();
-  if (resizeUtil.capacity < operands.size())
-    grow(resizeUtil, operands.size());
+  // If there are fewer new operands, shift down the operands that follow the
+  // range and destroy the extra ones.
+  if (newOperands.size() < length) {
+    std::move(operands + start + length, operands + size(),
+              operands + insertPos);
+    for (unsigned i = newSize, e = size(); i != e; ++i)
+      operands[i].~OpOperand();
+    numOperands = newSize;
+    return;
+  }
 
-  // Set the operands.
-  OpOperand *opBegin = getRawOperands();
-  for (unsigned i = 0; i != numOperands; ++i)
-    opBegin[i].set(operands[i]);
-  for (unsigned e = operands.size(); numOperands != e; ++numOperands)
-    new (&opBegin[numOperands]) OpOperand(owner, operands[numOperands]);
+  // Otherwise, construct the additional operands at the end of the storage,
+  // growing it if necessary, and rotate them into place.
+  if (capacity < newSize)
+    grow(newSize);
+  for (unsigned i = size(), e = newSize; i != e; ++i)
+    new (&operands[i])
+        OpOperand(owner, newOperands[numReplaced + i - size()]);
+  std::rotate(operands + insertPos, operands + size(), operands + newSize);
+  numOperands = newSize;
 }
 
 /// Erase an operand held by the storage.
 void detail::OperandStorage::eraseOperand(unsigned index) {
   assert(index < size());
-  auto operands = getOperands();
   --numOperands;
 
   // Shift all operands down by 1 if the operand to remove is not at the end.
@@ -116,22 +116,24 @@ void detail::OperandStorage::eraseOperand(unsigned index) {
   operands[numOperands].~OpOperand();
 }
 
-/// Grow the internal operand storage.
-void detail::OperandStorage::grow(ResizableStorage &resizeUtil,
-                                  size_t minSize) {
+/// Grow the operand storage to hold at least 'minSize' operands.
+void detail::OperandStorage::grow(size_t minSize) {
   // Allocate a new storage array.
-  resizeUtil.capacity =
-      std::max(size_t(llvm::NextPowerOf2(resizeUtil.capacity + 2)), minSize);
+  capacity = std::max(size_t(llvm::NextPowerOf2(capacity + 2)), minSize);
   OpOperand *newStorage = static_cast<OpOperand *>(
-      llvm::safe_malloc(resizeUtil.capacity * sizeof(OpOperand)));
+      llvm::safe_malloc(capacity * sizeof(OpOperand)));
 
   // Move the current operands to the new storage.
-  auto operands = getOperands();
-  std::uninitialized_copy(std::make_move_iterator(operands.begin()),
-                          std::make_move_iterator(operands.end()), newStorage);
-
-  // Destroy the original operands and update the resizable storage pointer.
-  for (auto &operand : operands)
+  auto currentOperands = getOperands();
+  std::uninitialized_copy(std::make_move_iterator(currentOperands.begin()),
+                          std::make_move_iterator(currentOperands.end()),
+                          newStorage);
+
+  // Destroy the original operands and free the previous storage if it was
+  // dynamically allocated.
+  for (auto &operand : currentOperands)
     operand.~OpOperand();
-  resizeUtil.setDynamicStorage(newStorage);
+  if (isStorageDynamic())
+    free(operands);
+  operands = newStorage;
 }
@@ -18,6 +18,7 @@
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/Value.h"
+#include <chrono>
 using namespace mlir;
 
 PatternBenefit::PatternBenefit(unsigned benefit) : representation(benefit) {
@@ -154,21 +155,47 @@ RewritePatternMatcher::RewritePatternMatcher(
                       const std::unique_ptr<RewritePattern> &r) {
                      return r->getBenefit() < l->getBenefit();
                    });
+
+  // Bucket the patterns by their root kind, ignoring any that are impossible
+  // to match. The buckets inherit the benefit order from the sorted list.
+  for (unsigned i = 0, e = this->patterns.size(); i != e; ++i) {
+    auto &pattern = this->patterns[i];
+    if (!pattern->getBenefit().isImpossibleToMatch())
+      patternsByRoot[pattern->getRootKind()].push_back(i);
+  }
 }
 
 /// Try to match the given operation to a pattern and rewrite it.
-bool RewritePatternMatcher::matchAndRewrite(Operation *op,
-                                            PatternRewriter &rewriter) {
-  for (auto &pattern : patterns) {
-    // Ignore patterns that are for the wrong root or are impossible to match.
-    if (pattern->getRootKind() != op->getName() ||
-        pattern->getBenefit().isImpossibleToMatch())
-      continue;
+bool RewritePatternMatcher::matchAndRewrite(
+    Operation *op, PatternRewriter &rewriter,
+    MutableArrayRef<PatternStatistics> stats) const {
+  auto it = patternsByRoot.find(op->getName());
+  if (it == patternsByRoot.end())
+    return false;
+
+  for (unsigned index : it->second) {
+    auto &pattern = patterns[index];
 
     // Try to match and rewrite this pattern. The patterns are sorted by
     // benefit, so if we match we can immediately rewrite and return.
-    if (pattern->matchAndRewrite(op, rewriter))
+    if (stats.empty()) {
+      if (pattern->matchAndRewrite(op, rewriter))
+        return true;
+      continue;
+    }
+
+    // Otherwise, also record the attempt along with its time.
+    auto start = std::chrono::steady_clock::now();
+    bool matched = bool(pattern->matchAndRewrite(op, rewriter));
+    auto &patternStats = stats[index];
+    patternStats.time += std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+    ++patternStats.numAttempts;
+    if (matched) {
+      ++patternStats.numSuccesses;
       return true;
+    }
   }
   return false;
 }
@@ -0,0 +1,813 @@
+//===- BytecodeReader.cpp - MLIR Bytecode Reader --------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements the reader of the binary bytecode format of modules.
+// The strings of the module are referred to in the input buffer while the
+// module is built, and are copied when they are uniqued in the context.  When
+// the context keeps the buffer alive, e.g. a memory mapped file, the aligned
+// payloads of dense elements attributes are used in place, so that they are
+// only paged in when they are accessed.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/Bytecode.h"
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/StandardTypes.h"
+#include "mlir/Parser.h"
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+using namespace mlir;
+using namespace mlir::bytecode;
+
+namespace {
+/// This class reads a module in the bytecode format.
+class BytecodeReader {
+public:
+  /// If `payloadsInPlace` is true, the buffer outlives the context and the
+  /// dense elements payloads may refer to it.
+  BytecodeReader(StringRef buffer, MLIRContext *context, bool payloadsInPlace)
+      : buffer(buffer), pos(0), context(context),
+        payloadsInPlace(payloadsInPlace) {}
+
+  ~BytecodeReader();
+
+  /// Read the module, or return null if the bytecode is invalid.
+  std::unique_ptr<Module> read();
+
+  /// Return true if an attribute may refer to the buffer, even if reading the
+  /// module failed.
+  bool isBufferUsedInPlace() const { return bufferUsedInPlace; }
+
+private:
+  /// Emit an error about invalid bytecode and return failure.
+  LogicalResult emitError(const Twine &message) {
+    context->emitError(UnknownLoc::get(context),
+                       "invalid bytecode: " + message);
+    return failure();
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Primitive values
+  //===--------------------------------------------------------------------===//
+
+  LogicalResult readByte(uint8_t &result);
+  LogicalResult readVarInt(uint64_t &result);
+  LogicalResult readVarInt(unsigned &result);
+  LogicalResult readZigZagVarInt(int64_t &result);
+  LogicalResult readBytes(uint64_t size, StringRef &result);
+
+  /// Read the number of elements of a list that follows in the file.  Each
+  /// element takes at least one byte, so a count larger than the number of
+  /// bytes left is reported as an error before any storage is allocated.
+  LogicalResult readCount(uint64_t &result);
+  LogicalResult readCount(unsigned &result);
+
+  /// Read an index into `table` and return the corresponding entry.
+  template <typename T>
+  LogicalResult readIndex(ArrayRef<T> table, StringRef tableName, T &result);
+
+  LogicalResult read(StringRef &result) {
+    return readIndex<StringRef>(strings, "string", result);
+  }
+  LogicalResult read(Type &result) {
+    return readIndex<Type>(types, "type", result);
+  }
+  LogicalResult read(Attribute &result) {
+    return readIndex<Attribute>(attributes, "attribute", result);
+  }
+  LogicalResult read(Location &result) {
+    return readIndex<Location>(locations, "location", result);
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Tables
+  //===--------------------------------------------------------------------===//
+
+  LogicalResult readTables();
+  LogicalResult readTypeEntry(Type &result);
+  LogicalResult readAttributeEntry(Attribute &result);
+  LogicalResult readLocationEntry(Location &result);
+
+  //===--------------------------------------------------------------------===//
+  // IR
+  //===--------------------------------------------------------------------===//
+
+  LogicalResult readAttributeList(SmallVectorImpl<NamedAttribute> &result);
+  LogicalResult readFunction(Module *module);
+  LogicalResult readRegion(Region &region);
+  LogicalResult readOperation(Block *block, ArrayRef<Block *> regionBlocks);
+  LogicalResult readOperand(Value *&result);
+
+  /// Define the next value of the current function, replacing the uses of its
+  /// forward reference placeholder if there is one.
+  LogicalResult defineValue(Value *value);
+
+  /// The buffer being read, and the current position within it.
+  StringRef buffer;
+  size_t pos;
+
+  MLIRContext *context;
+
+  /// Whether the dense elements payloads may refer to the buffer, and whether
+  /// one of them does.
+  bool payloadsInPlace;
+  bool bufferUsedInPlace = false;
+
+  /// The tables of the module.
+  std::vector<StringRef> strings;
+  std::vector<Type> types;
+  std::vector<Attribute> attributes;
+  std::vector<Location> locations;
+
+  /// The values of the current function.  Values that are not yet defined are
+  /// either null or a forward reference placeholder.
+  std::vector<Value *> values;
+  unsigned numDefinedValues = 0;
+
+  /// The arena that the IR of the current function is allocated from, if any.
+  IRArena *arena = nullptr;
+
+  /// The operations holding the forward reference placeholders that have not
+  /// been replaced yet.
+  llvm::SmallPtrSet<Operation *, 4> placeholders;
+};
+} // end anonymous namespace
+
+BytecodeReader::~BytecodeReader() {
+  // The placeholders only remain on failure, once the module and the uses of
+  // the placeholders have been destroyed.
+  for (Operation *placeholder : placeholders)
+    placeholder->destroy();
+}
+
+//===----------------------------------------------------------------------===//
+// Primitive values
+//===----------------------------------------------------------------------===//
+
+LogicalResult BytecodeReader::readByte(uint8_t &result) {
+  if (pos == buffer.size())
+    return emitError("unexpected end of file");
+  result = static_cast<uint8_t>(buffer[pos++]);
+  return success();
+}
+
+LogicalResult BytecodeReader::readVarInt(uint64_t &result) {
+  result = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    uint8_t byte;
+    if (failed(readByte(byte)))
+      return failure();
+    if (shift >= 64 || (shift == 63 && (byte & 0x7f) > 1))
+      return emitError("varint overflow");
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return success();
+  }
+}
+
+LogicalResult BytecodeReader::readVarInt(unsigned &result) {
+  uint64_t value;
+  if (failed(readVarInt(value)))
+    return failure();
+  if (value > std::numeric_limits<unsigned>::max())
+    return emitError("integer overflow");
+  result = value;
+  return success();
+}
+
+LogicalResult BytecodeReader::readZigZagVarInt(int64_t &result) {
+  uint64_t value;
+  if (failed(readVarInt(value)))
+    return failure();
+  result = static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+  return success();
+}
+
+LogicalResult BytecodeReader::readBytes(uint64_t size, StringRef &result) {
+  if (size > buffer.size() - pos)
+    return emitError("unexpected end of file");
+  result = buffer.substr(pos, size);
+  pos += size;
+  return success();
+}
+
+LogicalResult BytecodeReader::readCount(uint64_t &result) {
+  if (failed(readVarInt(result)))
+    return failure();
+  if (result > buffer.size() - pos)
+    return emitError("invalid count " + Twine(result));
+  return success();
+}
+
+LogicalResult BytecodeReader::readCount(unsigned &result) {
+  uint64_t count;
+  if (failed(readCount(count)))
+    return failure();
+  if (count > std::numeric_limits<unsigned>::max())
+    return emitError("integer overflow");
+  result = count;
+  return success();
+}
+
+template <typename T>
+LogicalResult BytecodeReader::readIndex(ArrayRef<T> table, StringRef tableName,
+                                        T &result) {
+  uint64_t index;
+  if (failed(readVarInt(index)))
+    return failure();
+  if (index >= table.size())
+    return emitError("invalid " + tableName + " index " + Twine(index));
+  result = table[index];
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// Tables
+//===----------------------------------------------------------------------===//
+
+LogicalResult BytecodeReader::readTables() {
+  uint64_t count;
+  if (failed(readCount(count)))
+    return failure();
+  strings.reserve(count);
+  for (uint64_t i = 0; i != count; ++i) {
+    uint64_t size;
+    StringRef str;
+    if (failed(readVarInt(size)) || failed(readBytes(size, str)))
+      return failure();
+    strings.push_back(str);
+  }
+
+  // The table entries only refer to the entries before them, so each entry is
+  // added to its table before the next one is read.
+  if (failed(readCount(count)))
+    return failure();
+  for (uint64_t i = 0; i != count; ++i) {
+    Type type;
+    if (failed(readTypeEntry(type)))
+      return failure();
+    types.push_back(type);
+  }
+
+  if (failed(readCount(count)))
+    return failure();
+  for (uint64_t i = 0; i != count; ++i) {
+    Attribute attr;
+    if (failed(readAttributeEntry(attr)))
+      return failure();
+    attributes.push_back(attr);
+  }
+
+  if (failed(readCount(count)))
+    return failure();
+  for (uint64_t i = 0; i != count; ++i) {
+    Location loc = UnknownLoc::get(context);
+    if (failed(readLocationEntry(loc)))
+      return failure();
+    locations.push_back(loc);
+  }
+  return success();
+}
+
+LogicalResult BytecodeReader::readTypeEntry(Type &result) {
+  uint8_t code;
+  if (failed(readByte(code)))
+    return failure();
+
+  switch (static_cast<TypeCode>(code)) {
+  case TypeCode::Textual: {
+    StringRef str;
+    if (failed(read(str)))
+      return failure();
+    result = parseType(str, context);
+    return success(result != nullptr);
+  }
+  case TypeCode::Integer: {
+    unsigned width;
+    if (failed(readVarInt(width)))
+      return failure();
+    if (width == 0 || width > IntegerType::kMaxWidth)
+      return emitError("invalid integer width " + Twine(width));
+    result = IntegerType::get(width, context);
+    return success();
+  }
+  case TypeCode::Index:
+    result = IndexType::get(context);
+    return success();
+  case TypeCode::BF16:
+    result = FloatType::getBF16(context);
+    return success();
+  case TypeCode::F16:
+    result = FloatType::getF16(context);
+    return success();
+  case TypeCode::F32:
+    result = FloatType::getF32(context);
+    return success();
+  case TypeCode::F64:
+    result = FloatType::getF64(context);
+    return success();
+  case TypeCode::None:
+    result = NoneType::get(context);
+    return success();
+  case TypeCode::Function: {
+    SmallVector<Type, 4> inputs, results;
+    for (auto *list : {&inputs, &results}) {
+      unsigned count;
+      if (failed(readCount(count)))
+        return failure();
+      list->resize(count);
+      for (Type &type : *list)
+        if (failed(read(type)))
+          return failure();
+    }
+    result = FunctionType::get(inputs, results, context);
+    return success();
+  }
+  }
+  return emitError("unknown type code " + Twine(code));
+}
+
+LogicalResult BytecodeReader::readAttributeEntry(Attribute &result) {
+  uint8_t code;
+  if (failed(readByte(code)))
+    return failure();
+
+  switch (static_cast<AttributeCode>(code)) {
+  case AttributeCode::Textual: {
+    StringRef str;
+    if (failed(read(str)))
+      return failure();
+    result = parseAttribute(str, context);
+    return success(result != nullptr);
+  }
+  case AttributeCode::Unit:
+    result = UnitAttr::get(context);
+    return success();
+  case AttributeCode::BoolFalse:
+  case AttributeCode::BoolTrue:
+    result = BoolAttr::get(code == uint8_t(AttributeCode::BoolTrue), context);
+    return success();
+  case AttributeCode::Integer: {
+    Type type;
+    int64_t value;
+    if (failed(read(type)) || failed(readZigZagVarInt(value)))
+      return failure();
+    if (!type.isIndex() && !type.isa<IntegerType>())
+      return emitError("invalid integer attribute type");
+    result = IntegerAttr::get(type, value);
+    return success();
+  }
+  case AttributeCode::Float: {
+    Type type;
+    uint64_t bits;
+    if (failed(read(type)) || failed(readVarInt(bits)))
+      return failure();
+    auto floatType = type.dyn_cast<FloatType>();
+    if (!floatType)
+      return emitError("invalid float attribute type");
+    // The bits are those of the APFloat of the value, which is wider than the
+    // type for bf16.
+    APInt intBits(
+        APFloat::semanticsSizeInBits(floatType.getFloatSemantics()), bits);
+    result = FloatAttr::get(type, APFloat(floatType.getFloatSemantics(),
+                                          intBits));
+    return success();
+  }
+  case AttributeCode::String: {
+    StringRef str;
+    if (failed(read(str)))
+      return failure();
+    result = StringAttr::get(str, context);
+    return success();
+  }
+  case AttributeCode::Type: {
+    Type type;
+    if (failed(read(type)))
+      return failure();
+    result = TypeAttr::get(type);
+    return success();
+  }
+  case AttributeCode::Function: {
+    StringRef name;
+    if (failed(read(name)))
+      return failure();
+    result = FunctionAttr::get(name, context);
+    return success();
+  }
+  case AttributeCode::Array: {
+    unsigned count;
+    if (failed(readCount(count)))
+      return failure();
+    SmallVector<Attribute, 4> elements(count);
+    for (Attribute &element : elements)
+      if (failed(read(element)))
+        return failure();
+    result = ArrayAttr::get(elements, context);
+    return success();
+  }
+  case AttributeCode::Dictionary: {
+    SmallVector<NamedAttribute, 4> elements;
+    if (failed(readAttributeList(elements)))
+      return failure();
+    result = DictionaryAttr::get(elements, context);
+    return success();
+  }
+  case AttributeCode::DenseElements: {
+    Type type;
+    uint8_t isSplat;
+    uint64_t size;
+    if (failed(read(type)) || failed(readByte(isSplat)) ||
+        failed(readVarInt(size)))
+      return failure();
+
+    // Skip the padding.
+    StringRef padding, payload;
+    size_t alignedPos = llvm::alignTo(pos, kPayloadAlignment);
+    if (failed(readBytes(alignedPos - pos, padding)) ||
+        failed(readBytes(size, payload)))
+      return failure();
+
+    auto shapedType = type.dyn_cast<ShapedType>();
+    if (!shapedType)
+      return emitError("invalid dense elements attribute");
+
+    // The payload is used in place if the buffer outlives the context and the
+    // payload is aligned in memory, i.e. the buffer itself is aligned, and is
+    // copied into the storage of the attribute otherwise.
+    ArrayRef<char> data(payload.data(), payload.size());
+    bool isAligned =
+        reinterpret_cast<uintptr_t>(payload.data()) % kPayloadAlignment == 0;
+    bool inPlace = payloadsInPlace && isAligned;
+    result = inPlace ? DenseElementsAttr::getFromUnownedRawBuffer(
+                           shapedType, data, isSplat != 0)
+                     : DenseElementsAttr::getFromRawBuffer(shapedType, data,
+                                                           isSplat != 0);
+    if (!result)
+      return emitError("invalid dense elements attribute");
+    bufferUsedInPlace |= inPlace;
+    return success();
+  }
+  }
+  return emitError("unknown attribute code " + Twine(code));
+}
+
+LogicalResult BytecodeReader::readLocationEntry(Location &result) {
+  uint8_t code;
+  if (failed(readByte(code)))
+    return failure();
+
+  switch (static_cast<LocationCode>(code)) {
+  case LocationCode::Unknown:
+    result = UnknownLoc::get(context);
+    return success();
+  case LocationCode::FileLineCol: {
+    StringRef filename;
+    unsigned line, column;
+    if (failed(read(filename)) || failed(readVarInt(line)) ||
+        failed(readVarInt(column)))
+      return failure();
+    result = FileLineColLoc::get(filename, line, column, context);
+    return success();
+  }
+  case LocationCode::Name: {
+    StringRef name;
+    Location child = UnknownLoc::get(context);
+    if (failed(read(name)) || failed(read(child)))
+      return failure();
+    result = NameLoc::get(Identifier::get(name, context), child, context);
+    return success();
+  }
+  case LocationCode::CallSite: {
+    Location callee = UnknownLoc::get(context);
+    Location caller = UnknownLoc::get(context);
+    if (failed(read(callee)) || failed(read(caller)))
+      return failure();
+    result = CallSiteLoc::get(callee, caller, context);
+    return success();
+  }
+  case LocationCode::Fused: {
+    unsigned count;
+    if (failed(readCount(count)))
+      return failure();
+    SmallVector<Location, 4> locs(count, UnknownLoc::get(context));
+    for (Location &loc : locs)
+      if (failed(read(loc)))
+        return failure();
+
+    // The metadata is stored with an offset of one, zero meaning that there
+    // is no metadata.
+    uint64_t metadataIndex;
+    if (failed(readVarInt(metadataIndex)))
+      return failure();
+    Attribute metadata;
+    if (metadataIndex != 0) {
+      if (metadataIndex > attributes.size())
+        return emitError("invalid attribute index");
+      metadata = attributes[metadataIndex - 1];
+    }
+    result = FusedLoc::get(locs, metadata, context);
+    return success();
+  }
+  }
+  return emitError("unknown location code " + Twine(code));
+}
+
+//===----------------------------------------------------------------------===//
+// IR
+//===----------------------------------------------------------------------===//
+
+LogicalResult
+BytecodeReader::readAttributeList(SmallVectorImpl<NamedAttribute> &result) {
+  unsigned count;
+  if (failed(readCount(count)))
+    return failure();
+  result.reserve(count);
+  for (unsigned i = 0; i != count; ++i) {
+    StringRef name;
+    Attribute attr;
+    if (failed(read(name)) || failed(read(attr)))
+      return failure();
+    result.emplace_back(Identifier::get(name, context), attr);
+  }
+  return success();
+}
+
+LogicalResult BytecodeReader::readFunction(Module *module) {
+  StringRef name;
+  Type type;
+  Location loc = UnknownLoc::get(context);
+  SmallVector<NamedAttribute, 4> attrs;
+  if (failed(read(name)) || failed(read(type)) || failed(read(loc)) ||
+      failed(readAttributeList(attrs)))
+    return failure();
+  auto funcType = type.dyn_cast<FunctionType>();
+  if (!funcType)
+    return emitError("invalid function type");
+
+  SmallVector<NamedAttributeList, 4> argAttrs;
+  argAttrs.reserve(funcType.getNumInputs());
+  for (unsigned i = 0, e = funcType.getNumInputs(); i != e; ++i) {
+    SmallVector<NamedAttribute, 4> argAttrList;
+    if (failed(readAttributeList(argAttrList)))
+      return failure();
+    argAttrs.emplace_back(argAttrList);
+  }
+
+  // Every value is defined by a block argument or an operation result, which
+  // both take at least one byte.
+  unsigned numValues;
+  if (failed(readCount(numValues)))
+    return failure();
+  values.assign(numValues, nullptr);
+  numDefinedValues = 0;
+
+  auto *function = new Function(loc, name, funcType, attrs, argAttrs);
+  module->getFunctions().push_back(function);
+  arena = function->getArena();
+  if (failed(readRegion(function->getBody())))
+    return failure();
+  if (numDefinedValues != numValues)
+    return emitError("unexpected number of values in function @" + name);
+  return success();
+}
+
+LogicalResult BytecodeReader::readRegion(Region &region) {
+  // Create all the blocks upfront, so that successors may refer to them.
+  unsigned numBlocks;
+  if (failed(readCount(numBlocks)))
+    return failure();
+  SmallVector<Block *, 4> blocks;
+  blocks.reserve(numBlocks);
+  for (unsigned i = 0; i != numBlocks; ++i) {
+    auto *block = new (arena) Block();
+    region.push_back(block);
+    blocks.push_back(block);
+
+    unsigned numArgs;
+    if (failed(readVarInt(numArgs)))
+      return failure();
+    for (unsigned j = 0; j != numArgs; ++j) {
+      Type type;
+      if (failed(read(type)) || failed(defineValue(block->addArgument(type))))
+        return failure();
+    }
+  }
+
+  for (Block *block : blocks) {
+    unsigned numOps;
+    if (failed(readVarInt(numOps)))
+      return failure();
+    for (unsigned i = 0; i != numOps; ++i)
+      if (failed(readOperation(block, blocks)))
+        return failure();
+  }
+  return success();
+}
+
+LogicalResult BytecodeReader::readOperation(Block *block,
+                                            ArrayRef<Block *> regionBlocks) {
+  StringRef name;
+  Location loc = UnknownLoc::get(context);
+  if (failed(read(name)) || failed(read(loc)))
+    return failure();
+  OperationState state(context, loc, name);
+
+  // The resizability of the operand list is stored along with the number of
+  // operands.
+  uint64_t operandInfo;
+  if (failed(readVarInt(operandInfo)))
+    return failure();
+  if ((operandInfo >> 1) > buffer.size() - pos)
+    return emitError("invalid count " + Twine(operandInfo >> 1));
+  state.resizableOperandList = operandInfo & 1;
+  state.operands.resize(operandInfo >> 1);
+  for (Value *&operand : state.operands)
+    if (failed(readOperand(operand)))
+      return failure();
+
+  unsigned numResults;
+  if (failed(readCount(numResults)))
+    return failure();
+  state.types.resize(numResults);
+  for (Type &type : state.types)
+    if (failed(read(type)))
+      return failure();
+
+  if (failed(readAttributeList(state.attributes)))
+    return failure();
+
+  unsigned numSuccessors;
+  if (failed(readVarInt(numSuccessors)))
+    return failure();
+  for (unsigned i = 0; i != numSuccessors; ++i) {
+    unsigned blockIndex, numOperands;
+    if (failed(readVarInt(blockIndex)) || failed(readCount(numOperands)))
+      return failure();
+    if (blockIndex >= regionBlocks.size())
+      return emitError("invalid successor index " + Twine(blockIndex));
+    SmallVector<Value *, 4> operands(numOperands);
+    for (Value *&operand : operands)
+      if (failed(readOperand(operand)))
+        return failure();
+    state.addSuccessor(regionBlocks[blockIndex], operands);
+  }
+
+  unsigned numRegions;
+  if (failed(readCount(numRegions)))
+    return failure();
+  for (unsigned i = 0; i != numRegions; ++i)
+    state.addRegion();
+
+  // The results are defined before the nested regions are read.
+  Operation *op = Operation::create(state, arena);
+  block->push_back(op);
+  for (auto *result : op->getResults())
+    if (failed(defineValue(result)))
+      return failure();
+  for (Region &region : op->getRegions())
+    if (failed(readRegion(region)))
+      return failure();
+  return success();
+}
+
+LogicalResult BytecodeReader::readOperand(Value *&result) {
+  uint64_t operandInfo;
+  if (failed(readVarInt(operandInfo)))
+    return failure();
+  uint64_t id = operandInfo >> 1;
+  bool isForwardReference = operandInfo & 1;
+  if (id >= values.size())
+    return emitError("invalid value number " + Twine(id));
+
+  if (!isForwardReference) {
+    if (id >= numDefinedValues)
+      return emitError("use of undefined value " + Twine(id));
+    result = values[id];
+    return success();
+  }
+
+  Type type;
+  if (failed(read(type)))
+    return failure();
+  if (id < numDefinedValues)
+    return emitError("invalid forward reference to value " + Twine(id));
+
+  // Create a placeholder for the value on its first forward reference.  The
+  // placeholders are operations with an unregistered name, which only provide
+  // a def/use chain until the value is defined.
+  if (!values[id]) {
+    auto *placeholder = Operation::create(
+        UnknownLoc::get(context), OperationName("placeholder", context),
+        /*operands=*/{}, type, /*attributes=*/llvm::None, /*successors=*/{},
+        /*numRegions=*/0, /*resizableOperandList=*/false, context);
+    placeholders.insert(placeholder);
+    values[id] = placeholder->getResult(0);
+  } else if (values[id]->getType() != type) {
+    return emitError("type mismatch in forward references to value " +
+                     Twine(id));
+  }
+  result = values[id];
+  return success();
+}
+
+LogicalResult BytecodeReader::defineValue(Value *value) {
+  if (numDefinedValues == values.size())
+    return emitError("too many values in function");
+
+  Value *&entry = values[numDefinedValues++];
+  if (entry) {
+    if (entry->getType() != value->getType())
+      return emitError("type mismatch between value and forward reference");
+    Operation *placeholder = entry->getDefiningOp();
+    entry->replaceAllUsesWith(value);
+    placeholders.erase(placeholder);
+    placeholder->destroy();
+  }
+  entry = value;
+  return success();
+}
+
+std::unique_ptr<Module> BytecodeReader::read() {
+  StringRef magic;
+  uint64_t version;
+  if (failed(readBytes(sizeof(kMagic), magic)))
+    return nullptr;
+  if (!isBytecode(magic)) {
+    emitError("invalid magic number");
+    return nullptr;
+  }
+  if (failed(readVarInt(version)))
+    return nullptr;
+  if (version != kVersion) {
+    emitError("unsupported version " + Twine(version));
+    return nullptr;
+  }
+
+  if (failed(readTables()))
+    return nullptr;
+
+  std::unique_ptr<Module> module(new Module(context));
+  unsigned numFunctions;
+  if (failed(readVarInt(numFunctions)))
+    return nullptr;
+  for (unsigned i = 0; i != numFunctions; ++i)
+    if (failed(readFunction(module.get())))
+      return nullptr;
+  if (pos != buffer.size()) {
+    emitError("unexpected data after the last function");
+    return nullptr;
+  }
+  return module;
+}
+
+/// Verify `module`, and release it if it is valid.
+static Module *verifyModule(std::unique_ptr<Module> module) {
+  if (!module)
+    return nullptr;
+
+  // Make sure the module has no other structural problems detected by the
+  // verifier.
+  if (failed(module->verify()))
+    return nullptr;
+  return module.release();
+}
+
+Module *mlir::parseBytecode(StringRef buffer, MLIRContext *context) {
+  return verifyModule(
+      BytecodeReader(buffer, context, /*payloadsInPlace=*/false).read());
+}
+
+Module *mlir::parseBytecode(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                            MLIRContext *context) {
+  BytecodeReader reader(buffer->getBuffer(), context,
+                        /*payloadsInPlace=*/true);
+  std::unique_ptr<Module> module = reader.read();
+
+  // The attributes that refer to the buffer are uniqued in the context, so the
+  // context keeps it alive whether the module is valid or not.
+  if (reader.isBufferUsedInPlace())
+    context->keepAlive(std::move(buffer));
+  return verifyModule(std::move(module));
+}
@@ -25,6 +25,8 @@
 #include "mlir/IR/AffineMap.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Bytecode.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/IntegerSet.h"
 #include "mlir/IR/Location.h"
 #include "mlir/IR/MLIRContext.h"
@@ -36,16 +38,27 @@
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/SMLoc.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Threading.h"
 #include <algorithm>
+#include <atomic>
 using namespace mlir;
 using llvm::MemoryBuffer;
 using llvm::SMLoc;
 using llvm::SourceMgr;
 
+// Parse the function bodies of a module concurrently when multi-threading is
+// enabled.
+static llvm::cl::opt<bool> parallelParse(
+    "mlir-parallel-parse",
+    llvm::cl::desc("Parse the function bodies of a module in parallel"),
+    llvm::cl::init(false), llvm::cl::Hidden);
+
 namespace {
 class Parser;
 
@@ -53,24 +66,45 @@ class Parser;
 // ParserState
 //===----------------------------------------------------------------------===//
 
+/// This class contains the symbols defined at the top level of a module, which
+/// are shared by the parser states of the module.
+struct SymbolState {
+  // A map from attribute alias identifier to Attribute.
+  llvm::StringMap<Attribute> attributeAliasDefinitions;
+
+  // A map from type alias identifier to Type.
+  llvm::StringMap<Type> typeAliasDefinitions;
+};
+
 /// This class refers to all of the state maintained globally by the parser,
 /// such as the current lexer position etc. The Parser base class provides
 /// methods to access this.
 class ParserState {
 public:
-  ParserState(const llvm::SourceMgr &sourceMgr, MLIRContext *ctx)
-      : context(ctx), lex(sourceMgr, ctx), curToken(lex.lexToken()) {}
+  ParserState(const llvm::SourceMgr &sourceMgr, MLIRContext *ctx,
+              SymbolState &symbols)
+      : symbols(symbols), context(ctx), lex(sourceMgr, ctx),
+        curToken(lex.lexToken()) {}
 
-  // A map from attribute alias identifier to Attribute.
-  llvm::StringMap<Attribute> attributeAliasDefinitions;
+  /// Create a state that starts lexing the main buffer at 'startPtr'.
+  ParserState(const llvm::SourceMgr &sourceMgr, MLIRContext *ctx,
+              SymbolState &symbols, const char *startPtr)
+      : symbols(symbols), context(ctx), lex(sourceMgr, ctx),
+        curToken(lexTokenAt(startPtr)) {}
 
-  // A map from type alias identifier to Type.
-  llvm::StringMap<Type> typeAliasDefinitions;
+  // The top-level symbols of the module.
+  SymbolState &symbols;
 
 private:
   ParserState(const ParserState &) = delete;
   void operator=(const ParserState &) = delete;
 
+  /// Lex the token starting at the given position.
+  Token lexTokenAt(const char *ptr) {
+    lex.resetPointer(ptr);
+    return lex.lexToken();
+  }
+
   friend class Parser;
 
   // The context we're parsing into.
@@ -582,7 +616,7 @@ Type Parser::parseComplexType() {
 ///
 Type Parser::parseExtendedType() {
   return parseExtendedSymbol<Type>(
-      *this, Token::exclamation_identifier, state.typeAliasDefinitions,
+      *this, Token::exclamation_identifier, state.symbols.typeAliasDefinitions,
       [&](StringRef dialectName, StringRef symbolData, Location loc) -> Type {
         // If we found a registered dialect, then ask it to parse the type.
         if (auto *dialect = state.context->getRegisteredDialect(dialectName))
@@ -1087,7 +1121,7 @@ Parser::parseAttributeDict(SmallVectorImpl<NamedAttribute> &attributes) {
 ///
 Attribute Parser::parseExtendedAttr(Type type) {
   Attribute attr = parseExtendedSymbol<Attribute>(
-      *this, Token::hash_identifier, state.attributeAliasDefinitions,
+      *this, Token::hash_identifier, state.symbols.attributeAliasDefinitions,
       [&](StringRef dialectName, StringRef symbolData,
           Location loc) -> Attribute {
         // If we found a registered dialect, then ask it to parse the attribute.
@@ -1198,17 +1232,35 @@ Attribute Parser::parseOpaqueElementsAttr() {
 }
 
 namespace {
+/// This class parses the elements of a tensor literal, and writes them
+/// directly into a buffer with the layout of the raw data of dense elements
+/// attributes, so that no attribute is created for the individual elements.
 class TensorLiteralParser {
 public:
-  TensorLiteralParser(Parser &p, Type eltTy) : p(p), eltTy(eltTy) {}
+  TensorLiteralParser(Parser &p, Type eltTy, int64_t numElementsHint = 0)
+      : p(p), eltTy(eltTy), numElementsHint(numElementsHint) {
+    if (eltTy.isa<IntegerType>() || eltTy.isa<FloatType>())
+      storageBitWidth = DenseElementsAttr::getElementStorageBitWidth(eltTy);
+  }
 
   ParseResult parse() {
+    if (!storageBitWidth)
+      return p.emitError("expected integer or floating point element type");
     if (p.getToken().is(Token::l_square))
       return parseList(shape);
     return parseElement();
   }
 
-  ArrayRef<Attribute> getValues() const { return storage; }
+  /// Parse a hex string holding the raw data of the elements of `type`, or of
+  /// a single element if the literal is a splat.
+  ParseResult parseHexBlob(ShapedType type);
+
+  /// Build a dense elements attribute of the given type from the parsed
+  /// elements.
+  DenseElementsAttr getAttr(ShapedType type) const {
+    return DenseElementsAttr::getFromRawBuffer(type, rawData,
+                                               /*isSplat=*/numElements == 1);
+  }
 
   ArrayRef<int64_t> getShape() const { return shape; }
 
@@ -1227,44 +1279,164 @@ private:
   ///   parseList([[1, [2, 3]], [4, [5]]]) -> Failure
   ParseResult parseList(llvm::SmallVectorImpl<int64_t> &dims);
 
+  /// Append the bits of an element to the raw data.
+  void appendElement(const APInt &value);
+
+  /// Reserve the raw data of the elements expected from the type of the
+  /// literal, but not more than the rest of the source can hold: every element
+  /// but the last one takes at least two characters.
+  void reserveRawData();
+
   Parser &p;
   Type eltTy;
   SmallVector<int64_t, 4> shape;
-  std::vector<Attribute> storage;
+
+  /// The number of elements of the type of the literal, if known.
+  int64_t numElementsHint;
+
+  /// The number of bits used to store each element in the raw data.
+  size_t storageBitWidth = 0;
+
+  /// The packed data of the parsed elements, and their number.
+  std::vector<char> rawData;
+  int64_t numElements = 0;
 };
 } // namespace
 
+void TensorLiteralParser::reserveRawData() {
+  llvm::SMLoc loc = p.getToken().getLoc();
+  const llvm::SourceMgr &sourceMgr = p.getSourceMgr();
+  unsigned bufferId = sourceMgr.FindBufferContainingLoc(loc);
+  if (!bufferId)
+    return;
+  const char *bufferEnd = sourceMgr.getMemoryBuffer(bufferId)->getBufferEnd();
+  int64_t maxNumElements =
+      numElements + (bufferEnd - loc.getPointer()) / 2 + 1;
+  int64_t numReserved = std::min(numElementsHint, maxNumElements);
+  rawData.reserve(llvm::divideCeil(storageBitWidth * numReserved, CHAR_BIT));
+}
+
+void TensorLiteralParser::appendElement(const APInt &value) {
+  // The storage is only reserved once the literal is known not to be a splat.
+  if (numElements == 1 && numElementsHint > 1)
+    reserveRawData();
+
+  size_t bitPos = numElements * storageBitWidth;
+  rawData.resize(llvm::divideCeil(bitPos + storageBitWidth, CHAR_BIT));
+  ++numElements;
+
+  // Boolean elements are packed as bits, the new bytes are zero initialized.
+  if (storageBitWidth == 1) {
+    if (value.isOneValue())
+      rawData[bitPos / CHAR_BIT] |= (1 << (bitPos % CHAR_BIT));
+    return;
+  }
+
+  // Otherwise, the element is stored in whole bytes.
+  std::copy_n(reinterpret_cast<const char *>(value.getRawData()),
+              llvm::divideCeil(value.getBitWidth(), CHAR_BIT),
+              rawData.data() + bitPos / CHAR_BIT);
+}
+
 ParseResult TensorLiteralParser::parseElement() {
   switch (p.getToken().getKind()) {
   case Token::floatliteral:
   case Token::integer:
   case Token::minus:
   case Token::kw_true:
-  case Token::kw_false: {
-    auto result = p.parseAttribute(eltTy);
-    if (!result)
-      return failure();
-    // check result matches the element type.
-    switch (eltTy.getKind()) {
-    case StandardTypes::BF16:
-    case StandardTypes::F16:
-    case StandardTypes::F32:
-    case StandardTypes::F64: {
-      assert(result.isa<FloatAttr>());
-      break;
-    }
-    case StandardTypes::Integer:
-      assert(result.isa<BoolAttr>() || result.isa<IntegerAttr>());
-      break;
-    default:
-      llvm_unreachable("expected integer or float tensor element");
-    }
-    storage.push_back(result);
+  case Token::kw_false:
     break;
-  }
   default:
     return p.emitError("expected element literal of primitive type");
   }
+
+  // Parse a boolean element.
+  if (p.getToken().isAny(Token::kw_true, Token::kw_false)) {
+    if (!eltTy.isInteger(1))
+      return p.emitError("expected i1 type for 'true' or 'false' values");
+    appendElement(APInt(1, p.getToken().is(Token::kw_true)));
+    p.consumeToken();
+    return success();
+  }
+
+  bool isNegative = p.consumeIf(Token::minus);
+
+  // Parse an integer element.
+  if (p.getToken().is(Token::integer)) {
+    auto val = p.getToken().getUInt64IntegerValue();
+    if (!val.hasValue() || (isNegative ? (int64_t)-val.getValue() >= 0
+                                       : (int64_t)val.getValue() < 0))
+      return p.emitError("integer constant out of range for attribute");
+    if (!eltTy.isa<IntegerType>())
+      return p.emitError("integer value not valid for specified type");
+
+    APInt apInt(eltTy.getIntOrFloatBitWidth(), *val, isNegative);
+    if (apInt != *val)
+      return p.emitError("integer constant out of range for attribute");
+    appendElement(isNegative ? -apInt : apInt);
+    p.consumeToken(Token::integer);
+    return success();
+  }
+
+  // Parse a floating point element.
+  if (p.getToken().is(Token::floatliteral)) {
+    auto val = p.getToken().getFloatingPointValue();
+    if (!val.hasValue())
+      return p.emitError("floating point value too large for attribute");
+    if (!eltTy.isa<FloatType>())
+      return p.emitError("floating point value not valid for specified type");
+
+    // Convert the value to the semantics of the element type, as done when
+    // creating a FloatAttr.
+    bool losesInfo;
+    APFloat apFloat(isNegative ? -val.getValue() : val.getValue());
+    apFloat.convert(eltTy.cast<FloatType>().getFloatSemantics(),
+                    APFloat::rmNearestTiesToEven, &losesInfo);
+    appendElement(apFloat.bitcastToAPInt());
+    p.consumeToken(Token::floatliteral);
+    return success();
+  }
+
+  return p.emitError("expected constant integer or floating point value");
+}
+
+/// Parse a hex blob holding the raw data of the elements. The data is decoded
+/// directly into the raw data buffer.
+///
+///   hex-blob ::= `"0x` hex-digit* `"`
+///
+ParseResult TensorLiteralParser::parseHexBlob(ShapedType type) {
+  if (!storageBitWidth)
+    return p.emitError("expected integer or floating point element type");
+
+  // Hex digits never need unescaping, so the spelling of the token is used
+  // directly instead of copying its string value.
+  StringRef hex = p.getTokenSpelling().drop_front().drop_back();
+  if (!hex.startswith("0x"))
+    return p.emitError("hex elements literal should start with '0x'");
+  hex = hex.drop_front(2);
+  if (hex.size() % 2 != 0 || !llvm::all_of(hex, llvm::isHexDigit))
+    return p.emitError("hex elements literal should only contain pairs of "
+                       "hex digits");
+
+  // The blob holds either all the elements, or a single splat element.
+  size_t numBytes = hex.size() / 2;
+  int64_t typeNumElements = type.getNumElements();
+  if (numBytes ==
+      llvm::divideCeil(storageBitWidth * typeNumElements, CHAR_BIT)) {
+    numElements = typeNumElements;
+  } else if (numBytes == llvm::divideCeil(storageBitWidth, CHAR_BIT)) {
+    numElements = 1;
+  } else {
+    return p.emitError() << "hex elements literal has " << numBytes
+                         << " bytes, which does not match type " << type;
+  }
+
+  rawData.resize(numBytes);
+  for (size_t i = 0; i != numBytes; ++i)
+    rawData[i] = (llvm::hexDigitValue(hex[2 * i]) << 4) |
+                 llvm::hexDigitValue(hex[2 * i + 1]);
+  p.consumeToken(Token::string);
   return success();
 }
 
@@ -1318,6 +1490,7 @@ TensorLiteralParser::parseList(llvm::SmallVectorImpl<int64_t> &dims) {
 /// Parse a dense elements attribute.
 ///
 ///   dense-attr-list ::= `[` attribute-value `]`
+///                     | hex-blob
 ///   attribute-value ::= integer-literal
 ///                     | float-literal
 ///                     | `[` (attribute-value (`,` attribute-value)*)? `]`
@@ -1337,23 +1510,28 @@ Attribute Parser::parseDenseElementsAttr() {
   if (parseToken(Token::comma, "expected ',' after elements literal type"))
     return nullptr;
 
-  TensorLiteralParser literalParser(*this, type.getElementType());
-  if (literalParser.parse())
-    return nullptr;
+  TensorLiteralParser literalParser(*this, type.getElementType(),
+                                    type.getNumElements());
+  if (getToken().is(Token::string)) {
+    if (literalParser.parseHexBlob(type))
+      return nullptr;
+  } else {
+    if (literalParser.parse())
+      return nullptr;
 
-  if (!literalParser.getShape().empty() &&
-      literalParser.getShape() != type.getShape()) {
-    emitError() << "inferred shape of elements literal (["
-                << literalParser.getShape() << "]) does not match type (["
-                << type.getShape() << "])";
-    return nullptr;
+    if (!literalParser.getShape().empty() &&
+        literalParser.getShape() != type.getShape()) {
+      emitError() << "inferred shape of elements literal (["
+                  << literalParser.getShape() << "]) does not match type (["
+                  << type.getShape() << "])";
+      return nullptr;
+    }
   }
 
   if (parseToken(Token::greater, "expected '>'"))
     return nullptr;
 
-  return builder.getDenseElementsAttr(type, literalParser.getValues())
-      .cast<DenseElementsAttr>();
+  return literalParser.getAttr(type);
 }
 
 /// Shaped type for elements attribute.
@@ -1409,7 +1587,7 @@ Attribute Parser::parseSparseElementsAttr() {
     // Otherwise, set the shape to the one parsed by the literal parser.
     indicesType = RankedTensorType::get(indiceParser.getShape(), indiceEltType);
   }
-  auto indices = DenseElementsAttr::get(indicesType, indiceParser.getValues());
+  auto indices = indiceParser.getAttr(indicesType);
 
   if (parseToken(Token::comma, "expected ','"))
     return nullptr;
@@ -1427,7 +1605,7 @@ Attribute Parser::parseSparseElementsAttr() {
       valuesParser.getShape().empty()
           ? RankedTensorType::get({indicesType.getDimSize(0)}, valuesEltType)
           : RankedTensorType::get(valuesParser.getShape(), valuesEltType);
-  auto values = DenseElementsAttr::get(valuesType, valuesParser.getValues());
+  auto values = valuesParser.getAttr(valuesType);
 
   /// Sanity check.
   if (valuesType.getRank() != 1)
@@ -2316,6 +2494,16 @@ public:
   /// Parse an operation instance that is in the op-defined custom form.
   Operation *parseCustomOperation();
 
+  /// Create an operation from 'state' at the current insertion point.  The
+  /// operations nested in regions that are not yet attached are allocated
+  /// from the arena of the function as well, unlike with the builder.
+  Operation *createOperation(const OperationState &state) {
+    auto *op = Operation::create(state, function->getArena());
+    opBuilder.getInsertionBlock()->getOperations().insert(
+        opBuilder.getInsertionPoint(), op);
+    return op;
+  }
+
   //===--------------------------------------------------------------------===//
   // Region Parsing
   //===--------------------------------------------------------------------===//
@@ -2912,7 +3100,7 @@ Operation *OperationParser::parseGenericOperation() {
     result.addSuccessor(successor, operands);
   }
 
-  return opBuilder.createOperation(result);
+  return createOperation(result);
 }
 
 namespace {
@@ -3340,7 +3528,7 @@ Operation *OperationParser::parseCustomOperation() {
     return nullptr;
 
   // Otherwise, we succeeded.  Use the state it parsed as our op information.
-  return opBuilder.createOperation(opState);
+  return createOperation(opState);
 }
 
 //===----------------------------------------------------------------------===//
@@ -3367,7 +3555,7 @@ ParseResult OperationParser::parseRegion(
   pushSSANameScope();
 
   // Parse the first block directly to allow for it to be unnamed.
-  Block *block = new Block();
+  Block *block = new (function->getArena()) Block();
 
   // Add arguments to the entry block.
   if (!entryArguments.empty()) {
@@ -3484,7 +3672,7 @@ ParseResult OperationParser::parseBlockBody(Block *block) {
 Block *OperationParser::getBlockNamed(StringRef name, SMLoc loc) {
   auto &blockAndLoc = getBlockInfoByName(name);
   if (!blockAndLoc.first) {
-    blockAndLoc = {new Block(), loc};
+    blockAndLoc = {new (function->getArena()) Block(), loc};
     insertForwardRef(blockAndLoc.first, loc);
   }
 
@@ -3499,7 +3687,7 @@ Block *OperationParser::defineBlockNamed(StringRef name, SMLoc loc,
   if (!blockAndLoc.first) {
     // If the caller provided a block, use it.  Otherwise create a new one.
     if (!existing)
-      existing = new Block();
+      existing = new (function->getArena()) Block();
     blockAndLoc.first = existing;
     blockAndLoc.second = loc;
     return blockAndLoc.first;
@@ -3560,7 +3748,37 @@ public:
 
   ParseResult parseModule(Module *module);
 
+  /// Parse the module, parsing the function bodies concurrently. On failure,
+  /// the diagnostics are discarded and the module is left partially parsed:
+  /// the module is expected to be parsed again sequentially to report the
+  /// errors exactly as a sequential parse does.
+  ParseResult parseModuleInParallel(Module *module);
+
 private:
+  /// The body of a function that was skipped by the pre-scan of a parallel
+  /// parse.
+  struct DeferredFunctionBody {
+    Function *function;
+    SmallVector<std::pair<OperationParser::SSAUseInfo, Type>, 4> entryArgs;
+    /// The location of the '{' starting the body.
+    SMLoc braceLoc;
+    /// The start of the token following the '}' ending the body.
+    const char *endPtr;
+  };
+
+  /// Parse a single top-level entity. If 'deferredBodies' is non-null, the
+  /// function bodies are skipped and recorded instead of being parsed.
+  ParseResult parseTopLevelEntity(
+      Module *module,
+      std::vector<DeferredFunctionBody> *deferredBodies = nullptr);
+
+  /// Skip over a function body by matching its braces, without parsing it.
+  ParseResult skipFunctionBody();
+
+  /// Parse a function body that was skipped by the pre-scan, starting from a
+  /// new parser state.
+  ParseResult parseDeferredFunctionBody(DeferredFunctionBody &body);
+
   /// Parse an attribute alias declaration.
   ParseResult parseAttributeAliasDef();
 
@@ -3576,7 +3794,9 @@ private:
       StringRef &name, FunctionType &type,
       SmallVectorImpl<std::pair<SMLoc, StringRef>> &argNames,
       SmallVectorImpl<SmallVector<NamedAttribute, 2>> &argAttrs);
-  ParseResult parseFunc(Module *module);
+  ParseResult
+  parseFunc(Module *module,
+            std::vector<DeferredFunctionBody> *deferredBodies = nullptr);
 };
 } // end anonymous namespace
 
@@ -3589,7 +3809,7 @@ ParseResult ModuleParser::parseAttributeAliasDef() {
   StringRef aliasName = getTokenSpelling().drop_front();
 
   // Check for redefinitions.
-  if (getState().attributeAliasDefinitions.count(aliasName) > 0)
+  if (getState().symbols.attributeAliasDefinitions.count(aliasName) > 0)
     return emitError("redefinition of attribute alias id '" + aliasName + "'");
 
   // Make sure this isn't invading the dialect attribute namespace.
@@ -3608,7 +3828,7 @@ ParseResult ModuleParser::parseAttributeAliasDef() {
   if (!attr)
     return failure();
 
-  getState().attributeAliasDefinitions[aliasName] = attr;
+  getState().symbols.attributeAliasDefinitions[aliasName] = attr;
   return success();
 }
 
@@ -3621,7 +3841,7 @@ ParseResult ModuleParser::parseTypeAliasDef() {
   StringRef aliasName = getTokenSpelling().drop_front();
 
   // Check for redefinitions.
-  if (getState().typeAliasDefinitions.count(aliasName) > 0)
+  if (getState().symbols.typeAliasDefinitions.count(aliasName) > 0)
     return emitError("redefinition of type alias id '" + aliasName + "'");
 
   // Make sure this isn't invading the dialect type namespace.
@@ -3642,7 +3862,7 @@ ParseResult ModuleParser::parseTypeAliasDef() {
     return failure();
 
   // Register this alias with the parser state.
-  getState().typeAliasDefinitions.try_emplace(aliasName, aliasedType);
+  getState().symbols.typeAliasDefinitions.try_emplace(aliasName, aliasedType);
   return success();
 }
 
@@ -3740,7 +3960,9 @@ ParseResult ModuleParser::parseFunctionSignature(
 ///   function-body ::= `{` block+ `}`
 ///   function-attributes ::= `attributes` attribute-dict
 ///
-ParseResult ModuleParser::parseFunc(Module *module) {
+ParseResult
+ModuleParser::parseFunc(Module *module,
+                        std::vector<DeferredFunctionBody> *deferredBodies) {
   consumeToken();
 
   StringRef name;
@@ -3789,6 +4011,15 @@ ParseResult ModuleParser::parseFunc(Module *module) {
         type.getInput(i));
   }
 
+  // Defer the parsing of the body if requested.
+  if (deferredBodies) {
+    if (skipFunctionBody())
+      return failure();
+    deferredBodies->push_back({function, std::move(entryArgs), braceLoc,
+                               getToken().getLoc().getPointer()});
+    return success();
+  }
+
   // Parse the function body.
   auto parser = OperationParser(getState(), function);
   if (parser.parseRegion(function->getBody(), entryArgs))
@@ -3801,42 +4032,132 @@ ParseResult ModuleParser::parseFunc(Module *module) {
   return parser.finalize(braceLoc);
 }
 
-/// This is the top-level module parser.
-ParseResult ModuleParser::parseModule(Module *module) {
-  while (1) {
+/// Skip over a function body by matching its braces, without parsing it.
+/// Braces are always balanced in a valid body, as those that appear in
+/// strings are part of string tokens.
+ParseResult ModuleParser::skipFunctionBody() {
+  consumeToken(Token::l_brace);
+  for (unsigned depth = 1; depth != 0; consumeToken()) {
     switch (getToken().getKind()) {
-    default:
-      emitError("expected a top level entity");
-      return failure();
-
-    // If we got to the end of the file, then we're done.
     case Token::eof:
-      return success();
-
-    // If we got an error token, then the lexer already emitted an error, just
-    // stop.  Someday we could introduce error recovery if there was demand
-    // for it.
+      return emitError("expected '}' at end of function body");
     case Token::error:
       return failure();
-
-    // Parse an attribute alias.
-    case Token::hash_identifier:
-      if (parseAttributeAliasDef())
-        return failure();
+    case Token::l_brace:
+      ++depth;
       break;
-
-    // Parse a type alias.
-    case Token::exclamation_identifier:
-      if (parseTypeAliasDef())
-        return failure();
+    case Token::r_brace:
+      --depth;
       break;
-
-    case Token::kw_func:
-      if (parseFunc(module))
-        return failure();
+    default:
       break;
     }
   }
+  return success();
+}
+
+/// Parse a function body that was skipped by the pre-scan, starting from a
+/// new parser state.
+ParseResult
+ModuleParser::parseDeferredFunctionBody(DeferredFunctionBody &body) {
+  ParserState bodyState(getSourceMgr(), getContext(), getState().symbols,
+                        body.braceLoc.getPointer());
+  OperationParser parser(bodyState, body.function);
+  if (parser.parseRegion(body.function->getBody(), body.entryArgs))
+    return failure();
+
+  // Verify that a valid function body was parsed.
+  if (body.function->empty())
+    return parser.emitError(body.braceLoc, "function must have a body");
+  if (parser.finalize(body.braceLoc))
+    return failure();
+
+  // Check that the parser stopped where the pre-scan did.
+  return success(parser.getToken().getLoc().getPointer() == body.endPtr);
+}
+
+/// Parse a single top-level entity.
+ParseResult ModuleParser::parseTopLevelEntity(
+    Module *module, std::vector<DeferredFunctionBody> *deferredBodies) {
+  switch (getToken().getKind()) {
+  default:
+    return emitError("expected a top level entity");
+
+  // If we got an error token, then the lexer already emitted an error, just
+  // stop.  Someday we could introduce error recovery if there was demand
+  // for it.
+  case Token::error:
+    return failure();
+
+  // Parse an attribute alias.
+  case Token::hash_identifier:
+    return parseAttributeAliasDef();
+
+  // Parse a type alias.
+  case Token::exclamation_identifier:
+    return parseTypeAliasDef();
+
+  case Token::kw_func:
+    return parseFunc(module, deferredBodies);
+  }
+}
+
+/// This is the top-level module parser.
+ParseResult ModuleParser::parseModule(Module *module) {
+  // If we got to the end of the file, then we're done.
+  while (getToken().isNot(Token::eof))
+    if (parseTopLevelEntity(module))
+      return failure();
+  return success();
+}
+
+/// Parse the module, parsing the function bodies concurrently.
+///
+/// A pre-scan first parses the top-level entities other than the function
+/// bodies, which are skipped by matching their braces. The bodies are then
+/// parsed in parallel, each from its own parser state, into the functions
+/// created by the pre-scan, so that the functions are kept in order.
+ParseResult ModuleParser::parseModuleInParallel(Module *module) {
+  // The diagnostics are ordered as in a sequential parse: the entities before
+  // the body 'i' have the order id '2*i+1', and the body has '2*i+2'. The
+  // order id 0 is left unused so that all the diagnostics can be discarded.
+  ParallelDiagnosticHandler diagHandler(getContext());
+  auto discardAndFail = [&] {
+    diagHandler.discardDiagnosticsAfter(0);
+    return failure();
+  };
+
+  std::vector<DeferredFunctionBody> bodies;
+  while (getToken().isNot(Token::eof)) {
+    diagHandler.setOrderIDForThread(2 * bodies.size() + 1);
+
+    // The aliases defined after a function body are not visible from it in a
+    // sequential parse, but would be visible from a deferred one.
+    if (!bodies.empty() &&
+        getToken().isAny(Token::hash_identifier, Token::exclamation_identifier))
+      return discardAndFail();
+
+    if (parseTopLevelEntity(module, &bodies))
+      return discardAndFail();
+  }
+
+  // Encode a location before parsing concurrently, so that the source manager
+  // builds its cache of line offsets on this thread.
+  (void)getEncodedSourceLocation(getToken().getLoc());
+
+  std::atomic<bool> bodyFailed(false);
+  llvm::parallel::for_each_n(
+      llvm::parallel::par, size_t(0), bodies.size(), [&](size_t i) {
+        if (bodyFailed)
+          return;
+        diagHandler.setOrderIDForThread(2 * i + 2);
+        if (parseDeferredFunctionBody(bodies[i]))
+          bodyFailed = true;
+      });
+
+  // On failure, drop the diagnostics: a body that failed may be preceded by a
+  // body that was not parsed, which could have failed first.
+  return bodyFailed ? discardAndFail() : success();
 }
 
 //===----------------------------------------------------------------------===//
@@ -3846,13 +4167,31 @@ ParseResult ModuleParser::parseModule(Module *module) {
 /// null.
 Module *mlir::parseSourceFile(const llvm::SourceMgr &sourceMgr,
                               MLIRContext *context) {
+  // Modules in the bytecode format are read by the bytecode reader.
+  StringRef buffer =
+      sourceMgr.getMemoryBuffer(sourceMgr.getMainFileID())->getBuffer();
+  if (bytecode::isBytecode(buffer))
+    return parseBytecode(buffer, context);
 
   // This is the result module we are parsing into.
   std::unique_ptr<Module> module(new Module(context));
 
-  ParserState state(sourceMgr, context);
-  if (ModuleParser(state).parseModule(module.get())) {
-    return nullptr;
+  // Try to parse the function bodies in parallel if requested. If this fails,
+  // parse the module again sequentially to report the errors.
+  bool parsed = false;
+  if (parallelParse && llvm::llvm_is_multithreaded()) {
+    SymbolState symbols;
+    ParserState state(sourceMgr, context, symbols);
+    parsed = succeeded(ModuleParser(state).parseModuleInParallel(module.get()));
+    if (!parsed)
+      module.reset(new Module(context));
+  }
+
+  if (!parsed) {
+    SymbolState symbols;
+    ParserState state(sourceMgr, context, symbols);
+    if (ModuleParser(state).parseModule(module.get()))
+      return nullptr;
   }
 
   // Make sure the parse module has no other structural problems detected by
@@ -3874,6 +4213,10 @@ Module *mlir::parseSourceFile(StringRef filename, MLIRContext *context) {
     return nullptr;
   }
 
+  // Modules in the bytecode format may refer to the file in place.
+  if (bytecode::isBytecode((*file_or_err)->getBuffer()))
+    return parseBytecode(std::move(*file_or_err), context);
+
   // Load the MLIR module.
   llvm::SourceMgr source_mgr;
   source_mgr.AddNewSourceBuffer(std::move(*file_or_err), llvm::SMLoc());
@@ -3899,6 +4242,19 @@ Type mlir::parseType(llvm::StringRef typeStr, MLIRContext *context) {
                                  /*RequiresNullTerminator=*/false);
   sourceMgr.AddNewSourceBuffer(std::move(memBuffer), SMLoc());
   SourceMgrDiagnosticHandler sourceMgrHandler(sourceMgr, context);
-  ParserState state(sourceMgr, context);
+  SymbolState symbols;
+  ParserState state(sourceMgr, context, symbols);
   return Parser(state).parseType();
 }
+
+Attribute mlir::parseAttribute(llvm::StringRef attrStr, MLIRContext *context) {
+  SourceMgr sourceMgr;
+  auto memBuffer =
+      MemoryBuffer::getMemBuffer(attrStr, /*BufferName=*/"<mlir_attr_buffer>",
+                                 /*RequiresNullTerminator=*/false);
+  sourceMgr.AddNewSourceBuffer(std::move(memBuffer), SMLoc());
+  SourceMgrDiagnosticHandler sourceMgrHandler(sourceMgr, context);
+  SymbolState symbols;
+  ParserState state(sourceMgr, context, symbols);
+  return Parser(state).parseAttribute();
+}
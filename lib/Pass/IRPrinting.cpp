@@ -66,7 +66,15 @@ static void printIR(const llvm::Any &ir, bool printModuleScope,
 
     // Print the function name and a newline before the Module.
     out << " (function: " << function->getName() << ")\n";
-    function->getModule()->print(out);
+    function->getModule()->print(out, isParallelWorkAllowedOnCurrentThread());
+    return;
+  }
+  if (printModuleScope && llvm::any_isa<Operation *>(ir)) {
+    Function *function = llvm::any_cast<Operation *>(ir)->getFunction();
+
+    // Print the parent function name and a newline before the Module.
+    out << " (function: " << function->getName() << ")\n";
+    function->getModule()->print(out, isParallelWorkAllowedOnCurrentThread());
     return;
   }
 
@@ -79,6 +87,13 @@ static void printIR(const llvm::Any &ir, bool printModuleScope,
     return;
   }
 
+  // Print the given operation.
+  if (llvm::any_isa<Operation *>(ir)) {
+    llvm::any_cast<Operation *>(ir)->print(out);
+    out << "\n";
+    return;
+  }
+
   // Print the given module.
   assert(llvm::any_isa<Module *>(ir) && "unexpected IR unit");
   llvm::any_cast<Module *>(ir)->print(out);
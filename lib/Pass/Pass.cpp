@@ -21,22 +21,46 @@
 
 #include "mlir/Pass/Pass.h"
 #include "PassDetail.h"
+#include "mlir/Analysis/Dominance.h"
 #include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Module.h"
 #include "mlir/Pass/PassManager.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/Parallel.h"
 #include "llvm/Support/Threading.h"
+#include <chrono>
+#include <deque>
+#include <numeric>
+
+#define DEBUG_TYPE "pass-manager"
 
 using namespace mlir;
 using namespace mlir::detail;
 
+STATISTIC(NumAnalysisReuses,
+          "Number of analysis recomputations avoided by reusing cached "
+          "results across passes");
+
 static llvm::cl::opt<bool>
     disableThreads("disable-pass-threading",
                    llvm::cl::desc("Disable multithreading in the pass manager"),
                    llvm::cl::init(false));
 
+static llvm::cl::opt<unsigned> numPassThreads(
+    "pass-threads",
+    llvm::cl::desc("Number of threads used to run function pipelines in "
+                   "parallel, 0 uses the hardware concurrency"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<bool> printPassThreadStatistics(
+    "pass-thread-statistics",
+    llvm::cl::desc("Display the utilization of each pass thread after every "
+                   "parallel function pipeline"),
+    llvm::cl::init(false));
+
 //===----------------------------------------------------------------------===//
 // Pass
 //===----------------------------------------------------------------------===//
@@ -88,8 +112,10 @@ LogicalResult ModulePassBase::run(Module *module, ModuleAnalysisManager &mam) {
   // Invoke the virtual runOnModule function.
   runOnModule();
 
-  // Invalidate any non preserved analyses.
-  mam.invalidate(passState->preservedAnalyses);
+  // Invalidate any non preserved analyses of the module and of the functions
+  // that the pass changed.
+  mam.invalidate(passState->preservedAnalyses,
+                 passState->changedFunctions.getPointer());
 
   // Instrument after the pass has run.
   bool passFailed = passState->irAndPassFailed.getInt();
@@ -104,6 +130,36 @@ LogicalResult ModulePassBase::run(Module *module, ModuleAnalysisManager &mam) {
   return failure(passFailed);
 }
 
+/// Forwarding function to execute this pass.
+LogicalResult OperationPassBase::run(Operation *op,
+                                     OperationAnalysisManager &oam) {
+  // Initialize the pass state.
+  passState.emplace(op, oam);
+
+  // Instrument before the pass has run.
+  auto pi = oam.getPassInstrumentor();
+  if (pi)
+    pi->runBeforePass(this, op);
+
+  // Invoke the virtual runOnOperation function.
+  runOnOperation();
+
+  // Invalidate any non preserved analyses.
+  oam.invalidate(passState->preservedAnalyses);
+
+  // Instrument after the pass has run.
+  bool passFailed = passState->irAndPassFailed.getInt();
+  if (pi) {
+    if (passFailed)
+      pi->runAfterPassFailed(this, op);
+    else
+      pi->runAfterPass(this, op);
+  }
+
+  // Return if the pass signaled a failure.
+  return failure(passFailed);
+}
+
 //===----------------------------------------------------------------------===//
 // PassExecutor
 //===----------------------------------------------------------------------===//
@@ -124,6 +180,23 @@ LogicalResult detail::FunctionPassExecutor::run(Function *function,
   return success();
 }
 
+OperationPassExecutor::OperationPassExecutor(const OperationPassExecutor &rhs)
+    : PassExecutor(Kind::OperationExecutor) {
+  for (auto &pass : rhs.passes)
+    addPass(pass->clone());
+}
+
+/// Run all of the passes in this manager over the current operation.
+LogicalResult
+detail::OperationPassExecutor::run(Operation *op,
+                                   OperationAnalysisManager &oam) {
+  // Run each of the held passes.
+  for (auto &pass : passes)
+    if (failed(pass->run(op, oam)))
+      return failure();
+  return success();
+}
+
 /// Run all of the passes in this manager over the current module.
 LogicalResult detail::ModulePassExecutor::run(Module *module,
                                               ModuleAnalysisManager &mam) {
@@ -138,20 +211,27 @@ LogicalResult detail::ModulePassExecutor::run(Module *module,
 // ModuleToFunctionPassAdaptor
 //===----------------------------------------------------------------------===//
 
+/// Set while the current thread is running a worker of a parallel adaptor with
+/// more than one worker. Nested parallel adaptors run synchronously on such
+/// threads, as the threads are already in use and the diagnostics are already
+/// being ordered by the outer adaptor.
+static thread_local bool isParallelAdaptorWorker = false;
+
+/// Returns true if work started on the current thread may be run in parallel.
+bool mlir::isParallelWorkAllowedOnCurrentThread() {
+  return !disableThreads && llvm::llvm_is_multithreaded() &&
+         !isParallelAdaptorWorker;
+}
+
 /// Utility to run the given function and analysis manager on a provided
 /// function pass executor.
 static LogicalResult runFunctionPipeline(FunctionPassExecutor &fpe,
                                          Function *func,
                                          FunctionAnalysisManager &fam) {
-  // Run the function pipeline over the provided function.
-  auto result = fpe.run(func, fam);
-
-  // Clear out any computed function analyses. These analyses won't be used
-  // any more in this pipeline, and this helps reduce the current working set
-  // of memory. If preserving these analyses becomes important in the future
-  // we can re-evalutate this.
-  fam.clear();
-  return result;
+  // Run the function pipeline over the provided function. The analyses that
+  // remain cached were preserved by the passes of the pipeline, and are kept
+  // for any later pipelines over the function.
+  return fpe.run(func, fam);
 }
 
 /// Run the held function pipeline over all non-external functions within the
@@ -167,63 +247,329 @@ void ModuleToFunctionPassAdaptor::runOnModule() {
     auto fam = mam.slice(&func);
     if (failed(runFunctionPipeline(fpe, &func, fam)))
       return signalPassFailure();
+  }
+
+  // The function analyses were already invalidated by the pipeline.
+  markFunctionsUnchanged();
+}
 
-    // Clear out any computed function analyses. These analyses won't be used
-    // any more in this pipeline, and this helps reduce the current working set
-    // of memory. If preserving these analyses becomes important in the future
-    // we can re-evalutate this.
-    fam.clear();
+/// Estimate the cost of running a pipeline over the operations within the
+/// given region. Each operation contributes its region nesting depth, so that
+/// the bodies of loops and other nested constructs weigh more than straight
+/// line code.
+static uint64_t estimateRegionCost(Region &region, unsigned depth) {
+  uint64_t cost = 0;
+  for (auto &block : region) {
+    for (auto &op : block) {
+      cost += depth;
+      for (auto &nestedRegion : op.getRegions())
+        cost += estimateRegionCost(nestedRegion, depth + 1);
+    }
   }
+  return cost;
 }
 
-// Run the held function pipeline synchronously across the functions within
+namespace {
+/// A set of per-worker queues of function indices. Each worker pops work from
+/// the front of its own queue, and steals from the back of the queues of other
+/// workers once its own queue is exhausted.
+class FunctionWorkQueues {
+public:
+  explicit FunctionWorkQueues(unsigned numWorkers) : queues(numWorkers) {}
+
+  /// Push a function index onto the back of the queue for the given worker.
+  void push(unsigned worker, unsigned funcIndex) {
+    queues[worker].items.push_back(funcIndex);
+  }
+
+  /// Pop the next function index for the given worker. Returns false if there
+  /// is no remaining work in any queue. 'stolen' is set to true if the index
+  /// was taken from the queue of another worker.
+  bool pop(unsigned worker, unsigned &funcIndex, bool &stolen) {
+    // Check the queue of this worker first.
+    stolen = false;
+    if (popFront(queues[worker], funcIndex))
+      return true;
+
+    // Otherwise, try to steal the cheapest work of another worker.
+    stolen = true;
+    for (unsigned i = 1, e = queues.size(); i != e; ++i)
+      if (popBack(queues[(worker + i) % e], funcIndex))
+        return true;
+    return false;
+  }
+
+private:
+  struct WorkerQueue {
+    llvm::sys::SmartMutex<true> mutex;
+    std::deque<unsigned> items;
+  };
+
+  static bool popFront(WorkerQueue &queue, unsigned &funcIndex) {
+    llvm::sys::SmartScopedLock<true> queueLock(queue.mutex);
+    if (queue.items.empty())
+      return false;
+    funcIndex = queue.items.front();
+    queue.items.pop_front();
+    return true;
+  }
+  static bool popBack(WorkerQueue &queue, unsigned &funcIndex) {
+    llvm::sys::SmartScopedLock<true> queueLock(queue.mutex);
+    if (queue.items.empty())
+      return false;
+    funcIndex = queue.items.back();
+    queue.items.pop_back();
+    return true;
+  }
+
+  std::vector<WorkerQueue> queues;
+};
+} // end anonymous namespace
+
+/// Print the worker statistics of the given parallel adaptor.
+static void
+printWorkerStatistics(ModuleToFunctionPassAdaptorParallel &adaptor) {
+  auto &os = llvm::errs();
+  os << "===" << std::string(73, '-') << "===\n"
+     << "                   Function pipeline thread utilization\n"
+     << "===" << std::string(73, '-') << "===\n";
+  os << llvm::format("  Total Execution Time: %5.4f seconds\n\n",
+                     adaptor.getLastRunTime());
+  os << "  Worker  Functions  Steals   Busy Time  Utilization\n";
+  double totalTime = adaptor.getLastRunTime();
+  for (auto it : llvm::enumerate(adaptor.getWorkerStatistics())) {
+    auto &stats = it.value();
+    double utilization = totalTime > 0 ? stats.busyTime / totalTime : 0;
+    os << llvm::format("  %6u  %9u  %6u  %9.4fs  %10.1f%%\n",
+                       unsigned(it.index()), stats.numFunctions,
+                       stats.numSteals, stats.busyTime, utilization * 100);
+  }
+  os.flush();
+}
+
+// Run the held function pipeline asynchronously across the functions within
 // the module.
 void ModuleToFunctionPassAdaptorParallel::runOnModule() {
+  using Clock = std::chrono::steady_clock;
+  auto elapsedSeconds = [](Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  };
+  auto runStart = Clock::now();
   ModuleAnalysisManager &mam = getAnalysisManager();
 
-  // Create the async executors if they haven't been created, or if the main
-  // function pipeline has changed.
-  if (asyncExecutors.empty() || asyncExecutors.front().size() != fpe.size())
-    asyncExecutors = {llvm::hardware_concurrency(), fpe};
-
   // Run a prepass over the module to collect the functions to execute a over.
   // This ensures that an analysis manager exists for each function, as well as
-  // providing a queue of functions to execute over.
+  // providing the cost of each function used to order the execution.
   std::vector<std::pair<Function *, FunctionAnalysisManager>> funcAMPairs;
-  for (auto &func : getModule())
-    if (!func.isExternal())
-      funcAMPairs.emplace_back(&func, mam.slice(&func));
+  std::vector<uint64_t> funcCosts;
+  for (auto &func : getModule()) {
+    if (func.isExternal())
+      continue;
+    funcAMPairs.emplace_back(&func, mam.slice(&func));
+    funcCosts.push_back(estimateRegionCost(func.getBody(), /*depth=*/1));
+  }
+
+  // Compute the number of workers to use.
+  unsigned numWorkers =
+      numPassThreads ? numPassThreads : llvm::hardware_concurrency();
+  numWorkers = std::max(1u, std::min<unsigned>(numWorkers, funcAMPairs.size()));
+
+  // Create the async executors if they haven't been created, or if the main
+  // function pipeline has changed.
+  if (asyncExecutors.size() < numWorkers ||
+      asyncExecutors.front().size() != fpe.size())
+    asyncExecutors = {std::max<size_t>(numWorkers, asyncExecutors.size()), fpe};
+  if (numWorkers > 1 && threadPoolSize < numWorkers - 1) {
+    threadPool.reset(new llvm::ThreadPool(numWorkers - 1));
+    threadPoolSize = numWorkers - 1;
+  }
+
+  // Order the functions by decreasing cost, so that the most expensive
+  // functions start first and do not become stragglers. The functions are
+  // then dealt round-robin to the worker queues.
+  std::vector<unsigned> schedule(funcAMPairs.size());
+  std::iota(schedule.begin(), schedule.end(), 0);
+  std::stable_sort(schedule.begin(), schedule.end(),
+                   [&](unsigned lhs, unsigned rhs) {
+                     return funcCosts[lhs] > funcCosts[rhs];
+                   });
+  FunctionWorkQueues workQueues(numWorkers);
+  for (unsigned i = 0, e = schedule.size(); i != e; ++i)
+    workQueues.push(i % numWorkers, schedule[i]);
 
   // A parallel diagnostic handler that provides deterministic diagnostic
   // ordering.
   ParallelDiagnosticHandler diagHandler(&getContext());
 
-  // An index for the current function/analysis manager pair.
-  std::atomic<unsigned> funcIt(0);
+  // An atomic failure variable for the async executors.
+  std::atomic<bool> passFailed(false);
+  workerStats.assign(numWorkers, WorkerStatistics());
+  auto runWorker = [&](unsigned worker) {
+    isParallelAdaptorWorker = numWorkers > 1;
+    auto &executor = asyncExecutors[worker];
+    auto &stats = workerStats[worker];
+    unsigned funcIndex;
+    bool stolen;
+    while (!passFailed && workQueues.pop(worker, funcIndex, stolen)) {
+      auto funcStart = Clock::now();
+
+      // Set the function id for this thread in the diagnostic handler. The
+      // id is the position of the function within the module, which keeps
+      // the diagnostic order independent of the schedule.
+      diagHandler.setOrderIDForThread(funcIndex);
+
+      // Run the executor over the current function.
+      auto &it = funcAMPairs[funcIndex];
+      if (failed(runFunctionPipeline(executor, it.first, it.second)))
+        passFailed = true;
+
+      stats.busyTime += elapsedSeconds(funcStart);
+      ++stats.numFunctions;
+      stats.numSteals += stolen;
+    }
+    isParallelAdaptorWorker = false;
+  };
+
+  // Run the first worker on this thread, and the rest on the thread pool.
+  for (unsigned worker = 1; worker < numWorkers; ++worker)
+    threadPool->async(runWorker, worker);
+  runWorker(/*worker=*/0);
+  if (threadPool)
+    threadPool->wait();
+
+  lastRunTime = elapsedSeconds(runStart);
+  if (printPassThreadStatistics)
+    printWorkerStatistics(*this);
+
+  // Signal a failure if any of the executors failed.
+  if (passFailed)
+    signalPassFailure();
+
+  // The function analyses were already invalidated by the pipelines.
+  markFunctionsUnchanged();
+}
+
+//===----------------------------------------------------------------------===//
+// FunctionToOperationPassAdaptor
+//===----------------------------------------------------------------------===//
+
+/// Returns true if the regions of the given operation are isolated from
+/// above, either by definition or by the current structure of the IR.
+static bool hasIsolatedRegions(Operation &op) {
+  if (op.getNumRegions() == 0)
+    return false;
+  if (op.isKnownIsolatedFromAbove())
+    return true;
+  return llvm::all_of(op.getRegions(), [](Region &region) {
+    return !region.empty() && region.isIsolatedFromAbove();
+  });
+}
+
+/// Collect the outermost operations, in pre-order, nested within the given
+/// region whose regions are isolated from above.
+static void collectIsolatedOperations(Region &region,
+                                      std::vector<Operation *> &ops) {
+  for (auto &block : region) {
+    for (auto &op : block) {
+      if (hasIsolatedRegions(op)) {
+        ops.push_back(&op);
+        continue;
+      }
+      for (auto &nestedRegion : op.getRegions())
+        collectIsolatedOperations(nestedRegion, ops);
+    }
+  }
+}
+
+/// Utility to run the given operation and analysis map on a provided operation
+/// pass executor.
+static LogicalResult runOperationPipeline(OperationPassExecutor &ope,
+                                          Operation *op,
+                                          detail::AnalysisMap<Operation> &map,
+                                          PassInstrumentor *pi) {
+  OperationAnalysisManager oam(&map, pi);
+  auto result = ope.run(op, oam);
+
+  // Clear out any computed operation analyses, they are not used after the
+  // pipeline has run.
+  oam.clear();
+  return result;
+}
+
+/// Run the held operation pipeline over all isolated operations within the
+/// function.
+void FunctionToOperationPassAdaptor::runOnFunction() {
+  auto *pi = getAnalysisManager().getPassInstrumentor();
+  std::vector<Operation *> ops;
+  collectIsolatedOperations(getFunction().getBody(), ops);
+  for (auto *op : ops) {
+    detail::AnalysisMap<Operation> analyses(op);
+    if (failed(runOperationPipeline(ope, op, analyses, pi)))
+      return signalPassFailure();
+  }
+}
+
+// Run the held operation pipeline asynchronously across the isolated
+// operations within the function.
+void FunctionToOperationPassAdaptorParallel::runOnFunction() {
+  auto *pi = getAnalysisManager().getPassInstrumentor();
+
+  // Collect the operations to execute over, along with an analysis map for
+  // each of them.
+  std::vector<Operation *> ops;
+  collectIsolatedOperations(getFunction().getBody(), ops);
+  std::vector<std::unique_ptr<detail::AnalysisMap<Operation>>> analyses;
+  analyses.reserve(ops.size());
+  for (auto *op : ops)
+    analyses.emplace_back(new detail::AnalysisMap<Operation>(op));
+
+  // If there is at most one operation, or this function is already being
+  // processed on a worker of a parallel adaptor, run the pipeline
+  // synchronously.
+  if (ops.size() <= 1 || isParallelAdaptorWorker) {
+    for (unsigned i = 0, e = ops.size(); i != e; ++i)
+      if (failed(runOperationPipeline(ope, ops[i], *analyses[i], pi)))
+        return signalPassFailure();
+    return;
+  }
+
+  // Create the async executors if they haven't been created, or if the main
+  // operation pipeline has changed.
+  if (asyncExecutors.empty() || asyncExecutors.front().size() != ope.size())
+    asyncExecutors = {llvm::hardware_concurrency(), ope};
+
+  // A parallel diagnostic handler that provides deterministic diagnostic
+  // ordering.
+  ParallelDiagnosticHandler diagHandler(&getContext());
+
+  // An index for the current operation.
+  std::atomic<unsigned> opIt(0);
 
   // An atomic failure variable for the async executors.
   std::atomic<bool> passFailed(false);
   llvm::parallel::for_each(
       llvm::parallel::par, asyncExecutors.begin(),
       std::next(asyncExecutors.begin(),
-                std::min(asyncExecutors.size(), funcAMPairs.size())),
-      [&](FunctionPassExecutor &executor) {
-        for (auto e = funcAMPairs.size(); !passFailed && funcIt < e;) {
-          // Get the next available function index.
-          unsigned nextID = funcIt++;
+                std::min(asyncExecutors.size(), ops.size())),
+      [&](OperationPassExecutor &executor) {
+        isParallelAdaptorWorker = true;
+        for (auto e = ops.size(); !passFailed && opIt < e;) {
+          // Get the next available operation index.
+          unsigned nextID = opIt++;
           if (nextID >= e)
             break;
 
-          // Set the function id for this thread in the diagnostic handler.
+          // Set the operation id for this thread in the diagnostic handler.
           diagHandler.setOrderIDForThread(nextID);
 
-          // Run the executor over the current function.
-          auto &it = funcAMPairs[nextID];
-          if (failed(runFunctionPipeline(executor, it.first, it.second))) {
+          // Run the executor over the current operation.
+          if (failed(runOperationPipeline(executor, ops[nextID],
+                                          *analyses[nextID], pi))) {
             passFailed = true;
             break;
           }
         }
+        isParallelAdaptorWorker = false;
       });
 
   // Signal a failure if any of the executors failed.
@@ -239,8 +585,13 @@ namespace {
 /// Pass to verify a function and signal failure if necessary.
 class FunctionVerifier : public FunctionPass<FunctionVerifier> {
   void runOnFunction() {
-    if (failed(getFunction().verify()))
+    // The dominance information computed by the verifier is up to date, so
+    // it is cached for the passes that follow instead of being recomputed.
+    std::unique_ptr<DominanceInfo> domInfo;
+    if (failed(getFunction().verify(&domInfo)))
       signalPassFailure();
+    else if (domInfo)
+      getAnalysisManager().setAnalysis(std::move(*domInfo));
     markAllAnalysesPreserved();
   }
 };
@@ -248,7 +599,7 @@ class FunctionVerifier : public FunctionPass<FunctionVerifier> {
 /// Pass to verify a module and signal failure if necessary.
 class ModuleVerifier : public ModulePass<ModuleVerifier> {
   void runOnModule() {
-    if (failed(getModule().verify()))
+    if (failed(getModule().verify(isParallelWorkAllowedOnCurrentThread())))
       signalPassFailure();
     markAllAnalysesPreserved();
   }
@@ -257,7 +608,7 @@ class ModuleVerifier : public ModulePass<ModuleVerifier> {
 
 PassManager::PassManager(bool verifyPasses)
     : mpe(new ModulePassExecutor()), verifyPasses(verifyPasses),
-      passTiming(false) {}
+      passTiming(false), patternStatistics(false) {}
 
 PassManager::~PassManager() {}
 
@@ -277,6 +628,9 @@ void PassManager::addPass(Pass *pass) {
   case Pass::Kind::ModulePass:
     addPass(cast<ModulePassBase>(pass));
     break;
+  case Pass::Kind::OperationPass:
+    addPass(cast<OperationPassBase>(pass));
+    break;
   }
 }
 
@@ -295,6 +649,11 @@ void PassManager::addPass(ModulePassBase *pass) {
 /// provided pass pointer. This will automatically create a function pass
 /// executor if necessary.
 void PassManager::addPass(FunctionPassBase *pass) {
+  // Function passes are not nested within an operation pipeline.
+  while (!nestedExecutorStack.empty() &&
+         isa<detail::OperationPassExecutor>(nestedExecutorStack.back()))
+    nestedExecutorStack.pop_back();
+
   detail::FunctionPassExecutor *fpe;
   if (nestedExecutorStack.empty()) {
     /// Create an executor adaptor for this pass.
@@ -321,6 +680,35 @@ void PassManager::addPass(FunctionPassBase *pass) {
     fpe->addPass(new FunctionVerifier());
 }
 
+/// Add an operation pass to the current manager. This takes ownership over the
+/// provided pass pointer. This will automatically create a function pass and an
+/// operation pass executor if necessary.
+void PassManager::addPass(OperationPassBase *pass) {
+  detail::OperationPassExecutor *ope;
+  if (!nestedExecutorStack.empty() &&
+      isa<detail::OperationPassExecutor>(nestedExecutorStack.back())) {
+    ope = cast<detail::OperationPassExecutor>(nestedExecutorStack.back());
+  } else {
+    /// Create an executor adaptor for this pass.
+    FunctionPassBase *adaptor;
+    if (disableThreads || !llvm::llvm_is_multithreaded()) {
+      // If multi-threading is disabled, then create a synchronous adaptor.
+      auto *syncAdaptor = new FunctionToOperationPassAdaptor();
+      ope = &syncAdaptor->getOperationExecutor();
+      adaptor = syncAdaptor;
+    } else {
+      auto *asyncAdaptor = new FunctionToOperationPassAdaptorParallel();
+      ope = &asyncAdaptor->getOperationExecutor();
+      adaptor = asyncAdaptor;
+    }
+    addPass(adaptor);
+
+    /// Add the executor to the stack.
+    nestedExecutorStack.push_back(ope);
+  }
+  ope->addPass(pass);
+}
+
 /// Add the provided instrumentation to the pass manager. This takes ownership
 /// over the given pointer.
 void PassManager::addInstrumentation(PassInstrumentation *pi) {
@@ -352,26 +740,48 @@ FunctionAnalysisManager ModuleAnalysisManager::slice(Function *func) {
 }
 
 /// Invalidate any non preserved analyses.
-void ModuleAnalysisManager::invalidate(const detail::PreservedAnalyses &pa) {
-  // If all analyses were preserved, then there is nothing to do here.
-  if (pa.isAll())
-    return;
-
+void ModuleAnalysisManager::invalidate(
+    const detail::PreservedAnalyses &pa,
+    const llvm::SmallPtrSetImpl<Function *> *changedFunctions) {
   // Invalidate the module analyses directly.
   moduleAnalyses.invalidate(pa);
 
-  // If no analyses were preserved, then just simply clear out the function
-  // analysis results.
-  if (pa.isNone()) {
+  // If no analyses were preserved and any function may have changed, then
+  // just simply clear out the function analysis results.
+  if (pa.isNone() && !changedFunctions) {
     functionAnalyses.clear();
     return;
   }
 
-  // Otherwise, invalidate each function analyses.
-  for (auto &analysisPair : functionAnalyses)
-    analysisPair.second->invalidate(pa);
+  // Drop the analyses of any functions that were erased from the module, as a
+  // new function may later be allocated at the same address.
+  if (!pa.isAll() || changedFunctions) {
+    llvm::SmallPtrSet<Function *, 16> liveFunctions;
+    for (auto &func : *moduleAnalyses.getIRUnit())
+      liveFunctions.insert(&func);
+    for (auto it = functionAnalyses.begin(), e = functionAnalyses.end();
+         it != e;) {
+      auto curIt = it++;
+      if (!liveFunctions.count(curIt->first))
+        functionAnalyses.erase(curIt);
+    }
+  }
+
+  // Invalidate the analyses of each changed function. The analyses of
+  // unchanged functions are all preserved.
+  detail::PreservedAnalyses unchangedPA;
+  unchangedPA.preserveAll();
+  for (auto &analysisPair : functionAnalyses) {
+    Function *func = analysisPair.first;
+    bool changed = !changedFunctions || changedFunctions->count(func);
+    analysisPair.second->invalidate(changed ? pa : unchangedPA);
+  }
 }
 
+/// Records that a cached analysis result was reused by a later pass instead of
+/// being recomputed.
+void detail::recordAnalysisReuse() { ++NumAnalysisReuses; }
+
 //===----------------------------------------------------------------------===//
 // PassInstrumentation
 //===----------------------------------------------------------------------===//
@@ -434,6 +844,14 @@ void PassInstrumentor::runAfterAnalysis(llvm::StringRef name, AnalysisID *id,
     instr->runAfterAnalysis(name, id, ir);
 }
 
+/// See PassInstrumentation::runAfterPatternRewrite for details.
+void PassInstrumentor::runAfterPatternRewrite(
+    Pass *pass, const GreedyRewriteStatistics &stats, const llvm::Any &ir) {
+  llvm::sys::SmartScopedLock<true> instrumentationLock(impl->mutex);
+  for (auto &instr : llvm::reverse(impl->instrumentations))
+    instr->runAfterPatternRewrite(pass, stats, ir);
+}
+
 /// Add the given instrumentation to the collection. This takes ownership over
 /// the given pointer.
 void PassInstrumentor::addInstrumentation(PassInstrumentation *pi) {
@@ -18,6 +18,7 @@
 #define MLIR_PASS_PASSDETAIL_H_
 
 #include "mlir/Pass/Pass.h"
+#include "llvm/Support/ThreadPool.h"
 
 namespace mlir {
 namespace detail {
@@ -29,7 +30,7 @@ namespace detail {
 /// The abstract base pass executor class.
 class PassExecutor {
 public:
-  enum Kind { FunctionExecutor, ModuleExecutor };
+  enum Kind { FunctionExecutor, ModuleExecutor, OperationExecutor };
   explicit PassExecutor(Kind kind) : kind(kind) {}
 
   /// Get the kind of this executor.
@@ -65,6 +66,32 @@ private:
   std::vector<std::unique_ptr<FunctionPassBase>> passes;
 };
 
+/// A pass executor that contains a list of passes over an operation whose
+/// regions are isolated from above.
+class OperationPassExecutor : public PassExecutor {
+public:
+  OperationPassExecutor() : PassExecutor(Kind::OperationExecutor) {}
+  OperationPassExecutor(OperationPassExecutor &&) = default;
+  OperationPassExecutor(const OperationPassExecutor &rhs);
+
+  /// Run the executor on the given operation.
+  LogicalResult run(Operation *op, OperationAnalysisManager &oam);
+
+  /// Add a pass to the current executor. This takes ownership over the provided
+  /// pass pointer.
+  void addPass(OperationPassBase *pass) { passes.emplace_back(pass); }
+
+  /// Returns the number of passes held by this executor.
+  size_t size() const { return passes.size(); }
+
+  static bool classof(const PassExecutor *pe) {
+    return pe->getKind() == Kind::OperationExecutor;
+  }
+
+private:
+  std::vector<std::unique_ptr<OperationPassBase>> passes;
+};
+
 /// A pass executor that contains a list of passes over a module unit.
 class ModulePassExecutor : public PassExecutor {
 public:
@@ -113,9 +140,24 @@ private:
 
 /// An adaptor module pass used to run function passes over all of the
 /// non-external functions of a module asynchronously across multiple threads.
+/// Functions are scheduled by decreasing estimated cost onto a set of workers,
+/// each with its own queue, and idle workers steal from the queues of others.
 class ModuleToFunctionPassAdaptorParallel
     : public ModulePass<ModuleToFunctionPassAdaptorParallel> {
 public:
+  /// Execution statistics for a single worker of the adaptor, collected during
+  /// the last run.
+  struct WorkerStatistics {
+    /// The number of functions processed by this worker.
+    unsigned numFunctions = 0;
+
+    /// The number of functions that this worker stole from another worker.
+    unsigned numSteals = 0;
+
+    /// The total wall time, in seconds, spent running function pipelines.
+    double busyTime = 0;
+  };
+
   /// Run the held function pipeline over all non-external functions within the
   /// module.
   void runOnModule() override;
@@ -123,13 +165,78 @@ public:
   /// Returns the function pass executor for this adaptor.
   FunctionPassExecutor &getFunctionExecutor() { return fpe; }
 
+  /// Returns the per-worker statistics of the last run of this adaptor.
+  ArrayRef<WorkerStatistics> getWorkerStatistics() const { return workerStats; }
+
+  /// Returns the wall time, in seconds, of the last run of this adaptor.
+  double getLastRunTime() const { return lastRunTime; }
+
 private:
   // The main function pass executor for this adaptor.
   FunctionPassExecutor fpe;
 
   // A set of executors, cloned from the main executor, that run asynchronously
-  // on different threads.
+  // on different threads. There is one executor per worker.
   std::vector<FunctionPassExecutor> asyncExecutors;
+
+  // The thread pool used to run all but the first worker, the first worker
+  // runs on the thread executing the adaptor.
+  std::unique_ptr<llvm::ThreadPool> threadPool;
+  unsigned threadPoolSize = 0;
+
+  // The statistics for each worker, and the total wall time, of the last run.
+  std::vector<WorkerStatistics> workerStats;
+  double lastRunTime = 0;
+};
+
+//===----------------------------------------------------------------------===//
+// FunctionToOperationPassAdaptor
+//===----------------------------------------------------------------------===//
+
+/// An adaptor function pass used to run operation passes over all of the
+/// outermost operations within a function whose regions are isolated from
+/// above, synchronously on a single thread.
+class FunctionToOperationPassAdaptor
+    : public FunctionPass<FunctionToOperationPassAdaptor> {
+public:
+  /// Run the held operation pipeline over all isolated operations within the
+  /// function.
+  void runOnFunction() override;
+
+  /// Returns the operation pass executor for this adaptor.
+  OperationPassExecutor &getOperationExecutor() { return ope; }
+
+private:
+  OperationPassExecutor ope;
+};
+
+/// An adaptor function pass used to run operation passes over all of the
+/// outermost operations within a function whose regions are isolated from
+/// above, asynchronously across multiple threads. If the adaptor is itself
+/// running on a worker of another parallel adaptor, the operations are
+/// processed synchronously as the threads are already in use.
+class FunctionToOperationPassAdaptorParallel
+    : public FunctionPass<FunctionToOperationPassAdaptorParallel> {
+public:
+  FunctionToOperationPassAdaptorParallel() = default;
+  FunctionToOperationPassAdaptorParallel(
+      const FunctionToOperationPassAdaptorParallel &rhs)
+      : ope(rhs.ope) {}
+
+  /// Run the held operation pipeline over all isolated operations within the
+  /// function.
+  void runOnFunction() override;
+
+  /// Returns the operation pass executor for this adaptor.
+  OperationPassExecutor &getOperationExecutor() { return ope; }
+
+private:
+  // The main operation pass executor for this adaptor.
+  OperationPassExecutor ope;
+
+  // A set of executors, cloned from the main executor, that run asynchronously
+  // on different threads.
+  std::vector<OperationPassExecutor> asyncExecutors;
 };
 
 /// Utility function to return if a pass refers to an
@@ -139,11 +246,19 @@ inline bool isModuleToFunctionAdaptorPass(Pass *pass) {
          isa<ModuleToFunctionPassAdaptor>(pass);
 }
 
+/// Utility function to return if a pass refers to an
+/// FunctionToOperationPassAdaptor instance.
+inline bool isFunctionToOperationAdaptorPass(Pass *pass) {
+  return isa<FunctionToOperationPassAdaptorParallel>(pass) ||
+         isa<FunctionToOperationPassAdaptor>(pass);
+}
+
 /// Utility function to return if a pass refers to an adaptor pass. Adaptor
 /// passes are those that internally execute a pipeline, such as the
 /// ModuleToFunctionPassAdaptor.
 inline bool isAdaptorPass(Pass *pass) {
-  return isModuleToFunctionAdaptorPass(pass);
+  return isModuleToFunctionAdaptorPass(pass) ||
+         isFunctionToOperationAdaptorPass(pass);
 }
 
 } // end namespace detail
@@ -50,6 +50,11 @@ struct PassManagerOptions {
 
   /// Add a pass timing instrumentation if enabled by 'pass-timing' flags.
   void addTimingInstrumentation(PassManager &pm);
+
+  //===--------------------------------------------------------------------===//
+  // Pattern Statistics
+  //===--------------------------------------------------------------------===//
+  llvm::cl::opt<bool> patternStatistics;
 };
 } // end anonymous namespace
 
@@ -89,7 +94,15 @@ PassManagerOptions::PassManagerOptions()
               clEnumValN(PassTimingDisplayMode::List, "list",
                          "display the results in a list sorted by total time"),
               clEnumValN(PassTimingDisplayMode::Pipeline, "pipeline",
-                         "display the results with a nested pipeline view"))) {}
+                         "display the results with a nested pipeline view"))),
+
+      //===----------------------------------------------------------------===//
+      // Pattern Statistics
+      //===----------------------------------------------------------------===//
+      patternStatistics(
+          "pass-pattern-statistics",
+          llvm::cl::desc("Display the attempts, successes, and time of each "
+                         "rewrite pattern applied greedily by a pass")) {}
 
 /// Add an IR printing instrumentation if enabled by any 'print-ir' flags.
 void PassManagerOptions::addPrinterInstrumentation(PassManager &pm) {
@@ -146,6 +159,10 @@ void mlir::applyPassManagerCLOptions(PassManager &pm) {
   // Add the IR printing instrumentation.
   (*options)->addPrinterInstrumentation(pm);
 
+  // Add the pattern statistics instrumentation.
+  if ((*options)->patternStatistics)
+    pm.enablePatternStatistics();
+
   // Note: The pass timing instrumentation should be added last to avoid any
   // potential "ghost" timing from other instrumentations being unintentionally
   // included in the timing results.
@@ -227,6 +227,8 @@ void PassTiming::startPassTimer(Pass *pass) {
   Timer *timer = getTimer(pass, [pass] {
     if (isModuleToFunctionAdaptorPass(pass))
       return StringRef("Function Pipeline");
+    if (isFunctionToOperationAdaptorPass(pass))
+      return StringRef("Operation Pipeline");
     return pass->getName();
   });
 
@@ -249,9 +251,10 @@ void PassTiming::runAfterPass(Pass *pass, const llvm::Any &) {
   assert(!activeTimers.empty() && "expected active timer");
   Timer *timer = activeTimers.pop_back_val();
 
-  // If this is an ModuleToFunctionPassAdaptorParallel, then we need to merge in
-  // the timing data for the other threads.
-  if (isa<ModuleToFunctionPassAdaptorParallel>(pass)) {
+  // If this is a parallel adaptor, then we need to merge in the timing data for
+  // the other threads.
+  if (isa<ModuleToFunctionPassAdaptorParallel>(pass) ||
+      isa<FunctionToOperationPassAdaptorParallel>(pass)) {
     // The asychronous pipeline timers should exist as children of root timers
     // for other threads.
     for (auto &rootTimer : llvm::make_early_inc_range(rootTimers)) {
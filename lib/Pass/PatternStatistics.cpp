@@ -0,0 +1,159 @@
+//===- PatternStatistics.cpp - Rewrite Pattern Statistics -----------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements an instrumentation that collects the statistics of the
+// rewrite patterns applied greedily by passes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Pass/PassManager.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include <map>
+#include <tuple>
+
+using namespace mlir;
+
+constexpr llvm::StringLiteral kPatternStatisticsDescription =
+    "... Pattern rewrite statistics ...";
+
+namespace {
+/// The statistics of the pattern rewrites of a single pass.
+struct PassPatternStatistics {
+  /// The identifier of a pattern: its index within the sorted pattern list of
+  /// the pass, its root operation name, and its benefit.
+  using PatternKey = std::tuple<unsigned, StringRef, unsigned>;
+
+  /// The number of greedy rewrites run by the pass.
+  unsigned numRewrites = 0;
+
+  /// The accumulated convergence statistics of the rewrites.
+  unsigned numRegions = 0;
+  unsigned numIterations = 0;
+  unsigned numSkippedRescans = 0;
+  unsigned numUnconverged = 0;
+
+  /// The accumulated counters of each pattern.
+  std::map<PatternKey, PatternStatistics> patterns;
+};
+
+struct PatternStatisticsInstrumentation : public PassInstrumentation {
+  ~PatternStatisticsInstrumentation() { print(); }
+
+  /// Accumulate the statistics of a rewrite.
+  void runAfterPatternRewrite(Pass *pass, const GreedyRewriteStatistics &stats,
+                              const llvm::Any &) override;
+
+  /// Print and clear the collected statistics.
+  void print();
+
+  /// The statistics for each pass, keyed by the pass name in the order that
+  /// they were first seen.
+  llvm::MapVector<StringRef, PassPatternStatistics> passStats;
+};
+} // end anonymous namespace
+
+/// Accumulate the statistics of a rewrite.
+void PatternStatisticsInstrumentation::runAfterPatternRewrite(
+    Pass *pass, const GreedyRewriteStatistics &stats, const llvm::Any &) {
+  auto &result = passStats[pass->getName()];
+  ++result.numRewrites;
+  result.numRegions += stats.numRegions;
+  result.numIterations += stats.numIterations;
+  result.numSkippedRescans += stats.numSkippedRescans;
+  result.numUnconverged += stats.hitIterationLimit;
+
+  for (unsigned i = 0, e = stats.patterns.size(); i != e; ++i) {
+    auto &entry = stats.patterns[i];
+    if (entry.stats.numAttempts == 0)
+      continue;
+    unsigned benefit = entry.benefit.isImpossibleToMatch()
+                           ? 0
+                           : entry.benefit.getBenefit();
+    auto &patternStats =
+        result.patterns[std::make_tuple(i, entry.rootName, benefit)];
+    patternStats.numAttempts += entry.stats.numAttempts;
+    patternStats.numSuccesses += entry.stats.numSuccesses;
+    patternStats.time += entry.stats.time;
+  }
+}
+
+/// Print and clear the collected statistics.
+void PatternStatisticsInstrumentation::print() {
+  if (passStats.empty())
+    return;
+  auto os = llvm::CreateInfoOutputFile();
+
+  // Print the heading information.
+  *os << "===" << std::string(73, '-') << "===\n";
+  unsigned padding = (80 - kPatternStatisticsDescription.size()) / 2;
+  os->indent(padding) << kPatternStatisticsDescription << '\n';
+  *os << "===" << std::string(73, '-') << "===\n";
+
+  for (auto &it : passStats) {
+    auto &stats = it.second;
+    *os << it.first << '\n';
+    *os << llvm::format("  Rewrites: %u, Regions: %u, Scans: %u, "
+                        "Skipped rescans: %u, Unconverged: %u\n",
+                        stats.numRewrites, stats.numRegions,
+                        stats.numIterations, stats.numSkippedRescans,
+                        stats.numUnconverged);
+    if (stats.patterns.empty())
+      continue;
+
+    // Print the patterns in order of decreasing time, so that the patterns
+    // that burn the most time are listed first.
+    using PatternEntry = std::pair<PassPatternStatistics::PatternKey,
+                                   PatternStatistics>;
+    std::vector<PatternEntry> patterns(stats.patterns.begin(),
+                                       stats.patterns.end());
+    std::stable_sort(patterns.begin(), patterns.end(),
+                     [](const PatternEntry &lhs, const PatternEntry &rhs) {
+                       return lhs.second.time > rhs.second.time;
+                     });
+
+    *os << "  ---Attempts---  ---Successes---  ---Time (s)---  "
+           "--- Pattern ---\n";
+    for (auto &pattern : patterns) {
+      *os << llvm::format("  %14u  %15u  %14.4f  ",
+                          pattern.second.numAttempts,
+                          pattern.second.numSuccesses, pattern.second.time);
+      *os << '#' << std::get<0>(pattern.first) << ' '
+          << std::get<1>(pattern.first) << " (benefit "
+          << std::get<2>(pattern.first) << ")\n";
+    }
+  }
+  os->flush();
+  passStats.clear();
+}
+
+//===----------------------------------------------------------------------===//
+// PassManager
+//===----------------------------------------------------------------------===//
+
+/// Add an instrumentation to collect the statistics of greedily applied
+/// rewrite patterns.
+void PassManager::enablePatternStatistics() {
+  // Check if pattern statistics are already enabled.
+  if (patternStatistics)
+    return;
+  addInstrumentation(new PatternStatisticsInstrumentation());
+  patternStatistics = true;
+}
@@ -151,6 +151,7 @@ struct MemRefCastFolder : public RewritePattern {
   }
 
   void rewrite(Operation *op, PatternRewriter &rewriter) const override {
+    rewriter.startRootUpdate(op);
     for (unsigned i = 0, e = op->getNumOperands(); i != e; ++i)
       if (auto *memref = op->getOperand(i)->getDefiningOp())
         if (auto cast = dyn_cast<MemRefCastOp>(memref))
@@ -0,0 +1,110 @@
+//===- MPInt.cpp - Multi-precision integer --------------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Support/MPInt.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+using namespace mlir;
+
+MPInt::MPInt(const APInt &value) : small(0), isLarge(false) {
+  if (value.getMinSignedBits() <= 64)
+    small = value.getSExtValue();
+  else {
+    large = value;
+    isLarge = true;
+  }
+}
+
+APInt MPInt::getAsAPInt() const {
+  return isLarge ? large : APInt(64, small, /*isSigned=*/true);
+}
+
+/// Sign extend 'lhs' and 'rhs' to the same width, which is at least
+/// 'minWidth'.
+static void extendToCommonWidth(APInt &lhs, APInt &rhs, unsigned minWidth) {
+  unsigned width =
+      std::max(std::max(lhs.getBitWidth(), rhs.getBitWidth()), minWidth);
+  lhs = lhs.sextOrSelf(width);
+  rhs = rhs.sextOrSelf(width);
+}
+
+MPInt MPInt::addSlow(const MPInt &other) const {
+  APInt lhs = getAsAPInt(), rhs = other.getAsAPInt();
+  // One extra bit is enough to hold the sum.
+  extendToCommonWidth(lhs, rhs,
+                      std::max(lhs.getBitWidth(), rhs.getBitWidth()) + 1);
+  return MPInt(lhs + rhs);
+}
+
+MPInt MPInt::subSlow(const MPInt &other) const {
+  APInt lhs = getAsAPInt(), rhs = other.getAsAPInt();
+  extendToCommonWidth(lhs, rhs,
+                      std::max(lhs.getBitWidth(), rhs.getBitWidth()) + 1);
+  return MPInt(lhs - rhs);
+}
+
+MPInt MPInt::mulSlow(const MPInt &other) const {
+  APInt lhs = getAsAPInt(), rhs = other.getAsAPInt();
+  // The product needs at most as many bits as both operands together.
+  extendToCommonWidth(lhs, rhs, lhs.getBitWidth() + rhs.getBitWidth());
+  return MPInt(lhs * rhs);
+}
+
+MPInt MPInt::divSlow(const MPInt &other) const {
+  APInt lhs = getAsAPInt(), rhs = other.getAsAPInt();
+  // The extra bit holds the quotient of the minimum value divided by -1.
+  extendToCommonWidth(lhs, rhs,
+                      std::max(lhs.getBitWidth(), rhs.getBitWidth()) + 1);
+  return MPInt(lhs.sdiv(rhs));
+}
+
+MPInt MPInt::remSlow(const MPInt &other) const {
+  APInt lhs = getAsAPInt(), rhs = other.getAsAPInt();
+  extendToCommonWidth(lhs, rhs, 0);
+  return MPInt(lhs.srem(rhs));
+}
+
+int MPInt::compareSlow(const MPInt &other) const {
+  APInt lhs = getAsAPInt(), rhs = other.getAsAPInt();
+  extendToCommonWidth(lhs, rhs, 0);
+  return lhs.slt(rhs) ? -1 : (lhs.sgt(rhs) ? 1 : 0);
+}
+
+void MPInt::print(raw_ostream &os) const {
+  if (isLarge)
+    os << large;
+  else
+    os << small;
+}
+
+void MPInt::dump() const { print(llvm::errs()); }
+
+MPInt mlir::gcd(const MPInt &a, const MPInt &b) {
+  MPInt x = abs(a), y = abs(b);
+  if (x.isSmall() && y.isSmall())
+    return static_cast<int64_t>(
+        llvm::GreatestCommonDivisor64(x.getSmall(), y.getSmall()));
+
+  // Euclid's algorithm, which quickly brings the values back to 64 bits.
+  while (y != 0) {
+    MPInt remainder = x % y;
+    x = y;
+    y = remainder;
+  }
+  return x;
+}
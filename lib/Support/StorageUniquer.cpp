@@ -18,91 +18,241 @@
 #include "mlir/Support/StorageUniquer.h"
 #include "mlir/Support/LLVM.h"
 #include "llvm/Support/Allocator.h"
-#include "llvm/Support/RWMutex.h"
+#include "llvm/Support/Mutex.h"
+#include <algorithm>
+#include <atomic>
 
 using namespace mlir;
 using namespace mlir::detail;
 
-namespace mlir {
-namespace detail {
-/// This is the implementation of the StorageUniquer class.
-struct StorageUniquerImpl {
-  using BaseStorage = StorageUniquer::BaseStorage;
-  using StorageAllocator = StorageUniquer::StorageAllocator;
+namespace {
+using BaseStorage = StorageUniquer::BaseStorage;
+using StorageAllocator = StorageUniquer::StorageAllocator;
 
-  /// A lookup key for derived instances of storage objects.
-  struct LookupKey {
-    /// The known derived kind for the storage.
-    unsigned kind;
+/// A lookup key for derived instances of storage objects.
+struct LookupKey {
+  /// The known derived kind for the storage.
+  unsigned kind;
 
-    /// The known hash value of the key.
-    unsigned hashValue;
+  /// The known hash value of the key.
+  unsigned hashValue;
 
-    /// An equality function for comparing with an existing storage instance.
-    llvm::function_ref<bool(const BaseStorage *)> isEqual;
-  };
+  /// An equality function for comparing with an existing storage instance.
+  llvm::function_ref<bool(const BaseStorage *)> isEqual;
+};
 
-  /// A utility wrapper object representing a hashed storage object. This class
-  /// contains a storage object and an existing computed hash value.
-  struct HashedStorage {
-    unsigned hashValue;
-    BaseStorage *storage;
-  };
+/// A single slot within a shard table. The hash value of a slot is written
+/// before the storage is published, and a published slot is never written to
+/// again other than to mark it as erased. This allows for readers to probe a
+/// table without holding any locks.
+struct StorageSlot {
+  StorageSlot() : storage(nullptr), hashValue(0) {}
 
-  /// Get or create an instance of a complex derived type.
-  BaseStorage *
-  getOrCreate(unsigned kind, unsigned hashValue,
-              llvm::function_ref<bool(const BaseStorage *)> isEqual,
-              llvm::function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
-    LookupKey lookupKey{kind, hashValue, isEqual};
+  std::atomic<BaseStorage *> storage;
+  unsigned hashValue;
+};
 
-    // Check for an existing instance in read-only mode.
-    {
-      llvm::sys::SmartScopedReader<true> typeLock(mutex);
-      auto it = storageTypes.find_as(lookupKey);
-      if (it != storageTypes.end())
-        return it->storage;
+/// An open addressed hash table of storage instances. The capacity of the table
+/// is always a power of two, and the table is never filled beyond 3/4 of its
+/// capacity so that a probe sequence is guaranteed to terminate.
+struct StorageTable {
+  explicit StorageTable(unsigned capacity)
+      : mask(capacity - 1), slots(new StorageSlot[capacity]) {
+    assert(llvm::isPowerOf2_32(capacity) && "expected power of 2 capacity");
+  }
+
+  unsigned getCapacity() const { return mask + 1; }
+
+  /// Returns the storage marker used for erased slots.
+  static BaseStorage *getTombstone() {
+    return DenseMapInfo<BaseStorage *>::getTombstoneKey();
+  }
+
+  /// Probe the table for the given key. Returns the slot holding a matching
+  /// storage instance if one exists, otherwise returns the empty slot that
+  /// terminated the probe sequence.
+  StorageSlot &probe(const LookupKey &key) const {
+    unsigned index = key.hashValue & mask;
+    for (unsigned probeAmt = 1;; index = (index + probeAmt++) & mask) {
+      StorageSlot &slot = slots[index];
+      BaseStorage *storage = slot.storage.load(std::memory_order_acquire);
+      if (!storage)
+        return slot;
+      if (storage == getTombstone() || slot.hashValue != key.hashValue)
+        continue;
+      // If the lookup kind matches the kind of the storage, then invoke the
+      // equality function on the lookup key.
+      if (storage->getKind() == key.kind && key.isEqual(storage))
+        return slot;
     }
+  }
 
-    // Acquire a writer-lock so that we can safely create the new type instance.
-    llvm::sys::SmartScopedWriter<true> typeLock(mutex);
+  unsigned mask;
+  std::unique_ptr<StorageSlot[]> slots;
+};
 
-    // Check for an existing instance again here, because another writer thread
-    // may have already created one.
-    auto existing = storageTypes.insert_as({}, lookupKey);
-    if (!existing.second)
-      return existing.first->storage;
-
-    // Otherwise, construct and initialize the derived storage for this type
-    // instance.
-    BaseStorage *storage = initializeStorage(kind, ctorFn);
-    *existing.first = HashedStorage{hashValue, storage};
-    return storage;
+/// A shard of the uniquer. Each shard holds a distinct subset of the storage
+/// instances, selected by hash value, along with the allocator used to create
+/// them. Lookups of existing instances are lock-free, the shard mutex is only
+/// acquired when a new instance must be created or an instance erased.
+struct StorageShard {
+  StorageShard() : table(nullptr) {}
+
+  /// Lookup an existing storage instance without acquiring the shard lock.
+  /// Returns nullptr if no instance is found.
+  BaseStorage *lookup(const LookupKey &key) const {
+    StorageTable *currentTable = table.load(std::memory_order_acquire);
+    if (!currentTable)
+      return nullptr;
+    return currentTable->probe(key).storage.load(std::memory_order_acquire);
   }
 
-  /// Get or create an instance of a simple derived type.
+  /// Get or create an instance of a storage object. The shard lock must not be
+  /// held by the caller.
   BaseStorage *
-  getOrCreate(unsigned kind,
+  getOrCreate(const LookupKey &key,
               llvm::function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
-    // Check for an existing instance in read-only mode.
-    {
-      llvm::sys::SmartScopedReader<true> typeLock(mutex);
-      auto it = simpleTypes.find(kind);
-      if (it != simpleTypes.end())
-        return it->second;
-    }
+    // Check for an existing instance in lock-free mode.
+    if (BaseStorage *storage = lookup(key))
+      return storage;
 
-    // Acquire a writer-lock so that we can safely create the new type instance.
-    llvm::sys::SmartScopedWriter<true> typeLock(mutex);
+    // Acquire the shard lock so that we can safely create the new instance.
+    llvm::sys::SmartScopedLock<true> shardLock(mutex);
 
     // Check for an existing instance again here, because another writer thread
     // may have already created one.
-    auto &result = simpleTypes[kind];
-    if (result)
-      return result;
+    if (StorageTable *currentTable = table.load(std::memory_order_relaxed)) {
+      StorageSlot &slot = currentTable->probe(key);
+      if (BaseStorage *storage = slot.storage.load(std::memory_order_relaxed))
+        return storage;
+    }
+
+    // Otherwise, construct the derived storage for this instance.
+    BaseStorage *storage = ctorFn(allocator);
+    insert(key, storage);
+    return storage;
+  }
+
+  /// Erase an instance of a storage object.
+  void erase(const LookupKey &key,
+             llvm::function_ref<void(BaseStorage *)> cleanupFn) {
+    llvm::sys::SmartScopedLock<true> shardLock(mutex);
+    StorageTable *currentTable = table.load(std::memory_order_relaxed);
+    if (!currentTable)
+      return;
+    StorageSlot &slot = currentTable->probe(key);
+    BaseStorage *storage = slot.storage.load(std::memory_order_relaxed);
+    if (!storage)
+      return;
+
+    // Cleanup the storage and remove it from the table.
+    cleanupFn(storage);
+    slot.storage.store(StorageTable::getTombstone(), std::memory_order_release);
+    --numEntries;
+    ++numTombstones;
+  }
+
+  /// Insert a new storage instance into the table, growing it if necessary.
+  /// The shard lock must be held by the caller.
+  void insert(const LookupKey &key, BaseStorage *storage) {
+    StorageTable *currentTable = table.load(std::memory_order_relaxed);
+    unsigned capacity = currentTable ? currentTable->getCapacity() : 0;
+    if ((numEntries + numTombstones + 1) * 4 > capacity * 3)
+      currentTable = grow(numEntries * 2 < capacity ? capacity : capacity * 2);
+
+    StorageSlot &slot = currentTable->probe(key);
+    slot.hashValue = key.hashValue;
+    slot.storage.store(storage, std::memory_order_release);
+    ++numEntries;
+  }
+
+  /// Rehash the live entries of the table into a new table of the given
+  /// capacity and publish it. Readers may still be probing the previous table,
+  /// so it is kept alive until the shard is destroyed.
+  StorageTable *grow(unsigned newCapacity) {
+    newCapacity = std::max(newCapacity, kMinCapacity);
+    tables.emplace_back(new StorageTable(newCapacity));
+    StorageTable *newTable = tables.back().get();
+
+    if (StorageTable *oldTable = table.load(std::memory_order_relaxed)) {
+      for (unsigned i = 0, e = oldTable->getCapacity(); i != e; ++i) {
+        StorageSlot &oldSlot = oldTable->slots[i];
+        BaseStorage *storage = oldSlot.storage.load(std::memory_order_relaxed);
+        if (!storage || storage == StorageTable::getTombstone())
+          continue;
+        unsigned index = oldSlot.hashValue & newTable->mask;
+        for (unsigned probeAmt = 1;
+             newTable->slots[index].storage.load(std::memory_order_relaxed);
+             index = (index + probeAmt++) & newTable->mask)
+          ;
+        newTable->slots[index].hashValue = oldSlot.hashValue;
+        newTable->slots[index].storage.store(storage,
+                                             std::memory_order_relaxed);
+      }
+    }
+
+    // Publish the new table to readers.
+    table.store(newTable, std::memory_order_release);
+    numTombstones = 0;
+    return newTable;
+  }
+
+  /// The minimum capacity of a shard table.
+  static constexpr unsigned kMinCapacity = 16;
+
+  /// The current table of the shard. This is the only field that is accessed
+  /// on the lock-free lookup path, so it is kept at the front of the shard.
+  std::atomic<StorageTable *> table;
+
+  /// The number of live and erased entries within the current table.
+  unsigned numEntries = 0, numTombstones = 0;
+
+  /// All of the tables ever created for this shard, including the current one.
+  std::vector<std::unique_ptr<StorageTable>> tables;
+
+  /// Allocator to use when constructing derived instances in this shard.
+  StorageAllocator allocator;
 
-    // Otherwise, create and return a new storage instance.
-    return result = initializeStorage(kind, ctorFn);
+  /// A mutex used to serialize the creation and erasure of instances.
+  llvm::sys::SmartMutex<true> mutex;
+};
+constexpr unsigned StorageShard::kMinCapacity;
+} // end anonymous namespace
+
+namespace mlir {
+namespace detail {
+/// This is the implementation of the StorageUniquer class. Storage instances
+/// are distributed across a fixed number of shards by hash value, so that
+/// threads uniquing unrelated instances do not contend with each other.
+struct StorageUniquerImpl {
+  /// The number of shards, this must be a power of two.
+  static constexpr unsigned kNumShardsLog2 = 5;
+
+  /// Get or create an instance of a complex derived type.
+  BaseStorage *
+  getOrCreate(unsigned kind, unsigned hashValue,
+              llvm::function_ref<bool(const BaseStorage *)> isEqual,
+              llvm::function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
+    LookupKey lookupKey{kind, hashValue, isEqual};
+    return getShard(hashValue).getOrCreate(
+        lookupKey, [&](StorageAllocator &allocator) {
+          return initializeStorage(kind, allocator, ctorFn);
+        });
+  }
+
+  /// Get or create an instance of a simple derived type. Simple types are
+  /// uniqued solely by their kind, so any existing instance of the same kind is
+  /// equal.
+  BaseStorage *
+  getOrCreate(unsigned kind,
+              llvm::function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
+    unsigned hashValue = llvm::hash_value(kind);
+    auto isEqual = [](const BaseStorage *) { return true; };
+    LookupKey lookupKey{kind, hashValue, isEqual};
+    return getShard(hashValue).getOrCreate(
+        lookupKey, [&](StorageAllocator &allocator) {
+          return initializeStorage(kind, allocator, ctorFn);
+        });
   }
 
   /// Erase an instance of a complex derived type.
@@ -110,70 +260,29 @@ struct StorageUniquerImpl {
              llvm::function_ref<bool(const BaseStorage *)> isEqual,
              llvm::function_ref<void(BaseStorage *)> cleanupFn) {
     LookupKey lookupKey{kind, hashValue, isEqual};
-
-    // Acquire a writer-lock so that we can safely erase the type instance.
-    llvm::sys::SmartScopedWriter<true> typeLock(mutex);
-    auto existing = storageTypes.find_as(lookupKey);
-    if (existing == storageTypes.end())
-      return;
-
-    // Cleanup the storage and remove it from the map.
-    cleanupFn(existing->storage);
-    storageTypes.erase(existing);
+    getShard(hashValue).erase(lookupKey, cleanupFn);
   }
 
-  //===--------------------------------------------------------------------===//
-  // Instance Storage
-  //===--------------------------------------------------------------------===//
-
   /// Utility to create and initialize a storage instance.
   BaseStorage *initializeStorage(
-      unsigned kind,
+      unsigned kind, StorageAllocator &allocator,
       llvm::function_ref<BaseStorage *(StorageAllocator &)> ctorFn) {
     BaseStorage *storage = ctorFn(allocator);
     storage->kind = kind;
     return storage;
   }
 
-  /// Storage info for derived TypeStorage objects.
-  struct StorageKeyInfo : DenseMapInfo<HashedStorage> {
-    static HashedStorage getEmptyKey() {
-      return HashedStorage{0, DenseMapInfo<BaseStorage *>::getEmptyKey()};
-    }
-    static HashedStorage getTombstoneKey() {
-      return HashedStorage{0, DenseMapInfo<BaseStorage *>::getTombstoneKey()};
-    }
-
-    static unsigned getHashValue(const HashedStorage &key) {
-      return key.hashValue;
-    }
-    static unsigned getHashValue(LookupKey key) { return key.hashValue; }
-
-    static bool isEqual(const HashedStorage &lhs, const HashedStorage &rhs) {
-      return lhs.storage == rhs.storage;
-    }
-    static bool isEqual(const LookupKey &lhs, const HashedStorage &rhs) {
-      if (isEqual(rhs, getEmptyKey()) || isEqual(rhs, getTombstoneKey()))
-        return false;
-      // If the lookup kind matches the kind of the storage, then invoke the
-      // equality function on the lookup key.
-      return lhs.kind == rhs.storage->getKind() && lhs.isEqual(rhs.storage);
-    }
-  };
-
-  // Unique types with specific hashing or storage constraints.
-  using StorageTypeSet = llvm::DenseSet<HashedStorage, StorageKeyInfo>;
-  StorageTypeSet storageTypes;
-
-  // Unique types with just the kind.
-  DenseMap<unsigned, BaseStorage *> simpleTypes;
-
-  // Allocator to use when constructing derived type instances.
-  StorageUniquer::StorageAllocator allocator;
+  /// Returns the shard responsible for the given hash value. The high bits of
+  /// the hash are used to select the shard, as the low bits are used to index
+  /// into the shard table.
+  StorageShard &getShard(unsigned hashValue) {
+    return shards[hashValue >> (32 - kNumShardsLog2)];
+  }
 
-  // A mutex to keep type uniquing thread-safe.
-  llvm::sys::SmartRWMutex<true> mutex;
+  /// The shards holding the storage instances.
+  StorageShard shards[1 << kNumShardsLog2];
 };
+constexpr unsigned StorageUniquerImpl::kNumShardsLog2;
 } // end namespace detail
 } // namespace mlir
 
@@ -16,21 +16,27 @@
 // =============================================================================
 //
 // This transformation pass performs a simple common sub-expression elimination
-// algorithm on operations within a function.
+// algorithm on operations within a function. Loads are also eliminated when
+// the same memref location was loaded or stored before with no possibly
+// aliasing write in between, which is tracked with generations of the memory.
 //
 //===----------------------------------------------------------------------===//
 
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/AffineAnalysis.h"
 #include "mlir/Analysis/Dominance.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Builders.h"
 #include "mlir/IR/Function.h"
 #include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
 #include "mlir/Support/Functional.h"
 #include "mlir/Transforms/Passes.h"
 #include "mlir/Transforms/Utils.h"
 #include "llvm/ADT/DenseMapInfo.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/ScopedHashTable.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/RecyclingAllocator.h"
 #include <deque>
@@ -79,8 +85,107 @@ struct SimpleOperationInfo : public llvm::DenseMapInfo<Operation *> {
                       rhs->result_type_begin());
   }
 };
+
+/// Hashes memref accesses based upon the location that they access.
+struct MemRefAccessInfo : public llvm::DenseMapInfo<const MemRefAccess *> {
+  static unsigned getHashValue(const MemRefAccess *access) {
+    return hash_combine(
+        access->memref,
+        hash_combine_range(access->indices.begin(), access->indices.end()));
+  }
+  static bool isEqual(const MemRefAccess *lhs, const MemRefAccess *rhs) {
+    if (lhs == rhs)
+      return true;
+    if (lhs == getTombstoneKey() || lhs == getEmptyKey() ||
+        rhs == getTombstoneKey() || rhs == getEmptyKey())
+      return false;
+    return lhs->memref == rhs->memref && lhs->indices == rhs->indices;
+  }
+};
+
+/// The value known to be held by a memref location, along with the memory
+/// generation at which it was known. A value initialized instance has no
+/// value.
+struct KnownMemoryValue {
+  Value *value;
+  unsigned generation;
+};
+
+/// The memory that a memref refers to. Distinct allocations don't alias each
+/// other, nor the arguments of the function, which may alias each other.
+struct MemoryOrigin {
+  enum Kind { Allocation, Argument, Unknown };
+
+  Kind kind;
+  /// The allocation that the memref refers to, for the Allocation kind.
+  Value *allocation;
+};
+
+/// The memory that a set of operations may write to.
+struct WriteSummary {
+  /// Merge the writes of 'other' into this summary.
+  void merge(const WriteSummary &other) {
+    hasUnknownWrite |= other.hasUnknownWrite;
+    hasArgumentWrite |= other.hasArgumentWrite;
+    allocationWrites.insert(other.allocationWrites.begin(),
+                            other.allocationWrites.end());
+  }
+
+  /// Whether the operations may write to any memref.
+  bool hasUnknownWrite = false;
+  /// Whether the operations may write to the arguments of the function.
+  bool hasArgumentWrite = false;
+  /// The distinct allocations that the operations may write to.
+  llvm::SmallSetVector<Value *, 4> allocationWrites;
+};
 } // end anonymous namespace
 
+/// Returns the memory that 'memref' refers to.
+static MemoryOrigin getMemoryOrigin(Value *memref) {
+  while (auto castOp = dyn_cast_or_null<MemRefCastOp>(memref->getDefiningOp()))
+    memref = castOp.getOperand();
+
+  if (auto *defOp = memref->getDefiningOp()) {
+    if (isa<AllocOp>(defOp))
+      return {MemoryOrigin::Allocation, memref};
+    return {MemoryOrigin::Unknown, nullptr};
+  }
+
+  // The arguments of the entry block of the function can't alias the memory
+  // allocated within it, but those of other blocks may.
+  Block *owner = cast<BlockArgument>(memref)->getOwner();
+  if (owner->getParent()->getContainingOp() || !owner->hasNoPredecessors() ||
+      owner != &owner->getParent()->front())
+    return {MemoryOrigin::Unknown, nullptr};
+  return {MemoryOrigin::Argument, nullptr};
+}
+
+/// Add the writes of an operation, excluding those of the operations it holds,
+/// to 'summary'.
+static void addWrites(Operation *op, WriteSummary &summary) {
+  if (auto storeOp = dyn_cast<StoreOp>(op)) {
+    MemoryOrigin origin = getMemoryOrigin(storeOp.getMemRef());
+    switch (origin.kind) {
+    case MemoryOrigin::Allocation:
+      summary.allocationWrites.insert(origin.allocation);
+      return;
+    case MemoryOrigin::Argument:
+      summary.hasArgumentWrite = true;
+      return;
+    case MemoryOrigin::Unknown:
+      summary.hasUnknownWrite = true;
+      return;
+    }
+  }
+  if (isa<LoadOp>(op) || op->hasNoSideEffect() || op->isKnownTerminator())
+    return;
+  // The effects of these operations are those of the operations they hold.
+  if (isa<AffineForOp>(op) || isa<AffineIfOp>(op))
+    return;
+  // Conservatively assume that any other operation may write to any memref.
+  summary.hasUnknownWrite = true;
+}
+
 namespace {
 /// Simple common sub-expression elimination.
 struct CSE : public FunctionPass<CSE> {
@@ -93,28 +198,78 @@ struct CSE : public FunctionPass<CSE> {
       llvm::ScopedHashTableVal<Operation *, Operation *>>;
   using ScopedMapTy = llvm::ScopedHashTable<Operation *, Operation *,
                                             SimpleOperationInfo, AllocatorTy>;
+  using MemoryAllocatorTy = llvm::RecyclingAllocator<
+      llvm::BumpPtrAllocator,
+      llvm::ScopedHashTableVal<const MemRefAccess *, KnownMemoryValue>>;
+  using ScopedMemoryMapTy =
+      llvm::ScopedHashTable<const MemRefAccess *, KnownMemoryValue,
+                            MemRefAccessInfo, MemoryAllocatorTy>;
+
+  /// Represents a single entry in the depth first traversal of the dominance
+  /// trees of the regions of a function. A block is simplified in steps, as
+  /// the regions held by its operations are simplified when they are reached.
+  struct StackNode {
+    StackNode(ScopedMapTy &knownValues, ScopedMemoryMapTy &knownMemoryValues,
+              Block *block, DominanceInfoNode *node)
+        : scope(knownValues), memoryScope(knownMemoryValues), block(block),
+          node(node), nextOp(block->begin()) {
+      if (node)
+        childIterator = node->begin();
+    }
 
-  /// Represents a single entry in the depth first traversal of a CFG.
-  struct CFGStackNode {
-    CFGStackNode(ScopedMapTy &knownValues, DominanceInfoNode *node)
-        : scope(knownValues), node(node), childIterator(node->begin()),
-          processed(false) {}
-
-    /// Scope for the known values.
+    /// Scopes for the known values and memory values.
     ScopedMapTy::ScopeTy scope;
+    ScopedMemoryMapTy::ScopeTy memoryScope;
 
+    /// The block to simplify, and its dominance tree node, which is null if
+    /// the block is the only one of its region.
+    Block *block;
     DominanceInfoNode *node;
-    DominanceInfoNode::iterator childIterator;
 
-    /// If this node has been fully processed yet or not.
-    bool processed;
+    /// The next operation of the block to simplify.
+    Block::iterator nextOp;
+
+    /// The next child of the dominance tree node to simplify.
+    DominanceInfoNode::iterator childIterator;
   };
+  using StackTy = std::deque<std::unique_ptr<StackNode>>;
 
   /// Attempt to eliminate a redundant operation. Returns true if the operation
   /// was marked for removal, false otherwise.
   bool simplifyOperation(Operation *op);
 
-  void simplifyBlock(DominanceInfo &domInfo, Block *bb);
+  /// Attempt to eliminate a redundant load or store, and update the state of
+  /// the memory with the effects of the operation otherwise. Returns true if
+  /// the operation was marked for removal, false otherwise.
+  bool simplifyMemoryOperation(Operation *op);
+
+  /// Update the state of the memory with the effects of an operation,
+  /// excluding those of the operations it holds.
+  void recordEffects(Operation *op);
+
+  /// Update the state of the memory with the writes of 'summary'.
+  void recordWrites(const WriteSummary &summary);
+
+  /// Compute the writes held by each affine.for operation of 'region' into
+  /// 'loopWrites'.
+  void summarizeLoopWrites(Region &region);
+
+  /// Record a write to a memref of the given origin.
+  void recordWrite(MemoryOrigin origin);
+
+  /// Record a write that may have written to any memref.
+  void recordUnknownWrite() { recordWrite({MemoryOrigin::Unknown, nullptr}); }
+
+  /// Returns true if a value known at the given generation is still held by
+  /// a location of a memref of the given origin.
+  bool isKnownValueValid(MemoryOrigin origin, unsigned knownGeneration);
+
+  /// Push the entry node of a region to simplify onto the stack.
+  void pushRegion(StackTy &stack, DominanceInfo &domInfo, Region &region);
+
+  /// Push a block to simplify onto the stack.
+  void pushBlock(StackTy &stack, Block *block, DominanceInfoNode *node);
+
   void simplifyRegion(DominanceInfo &domInfo, Region &region);
 
   void runOnFunction() override;
@@ -123,6 +278,31 @@ private:
   /// A scoped hash table of defining operations within a function.
   ScopedMapTy knownValues;
 
+  /// A scoped hash table of the values known to be held by memref locations.
+  ScopedMemoryMapTy knownMemoryValues;
+
+  /// The accesses of the loads and stores that were simplified. They are
+  /// referred to by the keys of 'knownMemoryValues'.
+  std::deque<MemRefAccess> accesses;
+
+  /// The current generation of the memory, which is incremented by each write.
+  unsigned generation = 0;
+
+  /// The generation of the last write that may have written to any memref.
+  unsigned lastUnknownWrite = 0;
+
+  /// The generation of the last write to an argument of the function.
+  unsigned lastArgumentWrite = 0;
+
+  /// The generation of the last write to any distinct allocation.
+  unsigned lastAllocationWrite = 0;
+
+  /// The generation of the last write to each distinct allocation.
+  llvm::DenseMap<Value *, unsigned> lastWrites;
+
+  /// The writes of the operations held by each affine.for operation.
+  llvm::DenseMap<Operation *, WriteSummary> loopWrites;
+
   /// Operations marked as dead and to be erased.
   std::vector<Operation *> opsToErase;
 };
@@ -136,8 +316,8 @@ bool CSE::simplifyOperation(Operation *op) {
   if (op->getNumRegions() != 0)
     return false;
 
-  // TODO(riverriddle) We currently only eliminate non side-effecting
-  // operations.
+  // Only non side-effecting operations are eliminated here, loads and stores
+  // are simplified with the known state of the memory.
   if (!op->hasNoSideEffect())
     return false;
 
@@ -170,56 +350,217 @@ bool CSE::simplifyOperation(Operation *op) {
   return false;
 }
 
-void CSE::simplifyBlock(DominanceInfo &domInfo, Block *bb) {
-  for (auto &i : *bb) {
-    // If the operation is simplified, we don't process any held regions.
-    if (simplifyOperation(&i))
+/// Attempt to eliminate a redundant load or store.
+bool CSE::simplifyMemoryOperation(Operation *op) {
+  if (!isa<LoadOp>(op) && !isa<StoreOp>(op)) {
+    recordEffects(op);
+    return false;
+  }
+
+  accesses.emplace_back(op);
+  const MemRefAccess *access = &accesses.back();
+  MemoryOrigin origin = getMemoryOrigin(access->memref);
+  KnownMemoryValue known = knownMemoryValues.lookup(access);
+  bool isKnown = known.value && isKnownValueValid(origin, known.generation);
+
+  // If the location is known to hold a value, then replace the load with it.
+  if (auto loadOp = dyn_cast<LoadOp>(op)) {
+    if (isKnown) {
+      op->getResult(0)->replaceAllUsesWith(known.value);
+      opsToErase.push_back(op);
+      accesses.pop_back();
+      return true;
+    }
+    knownMemoryValues.insert(access, {loadOp.getResult(), generation});
+    return false;
+  }
+
+  // If the location is known to already hold the stored value, then the store
+  // is redundant. Otherwise, the stored value can be forwarded to the loads
+  // that follow.
+  auto storeOp = cast<StoreOp>(op);
+  if (isKnown && known.value == storeOp.getValueToStore()) {
+    opsToErase.push_back(op);
+    accesses.pop_back();
+    return true;
+  }
+  recordWrite(origin);
+  knownMemoryValues.insert(access, {storeOp.getValueToStore(), generation});
+  return false;
+}
+
+/// Update the state of the memory with the effects of an operation, excluding
+/// those of the operations it holds.
+void CSE::recordEffects(Operation *op) {
+  if (auto storeOp = dyn_cast<StoreOp>(op))
+    return recordWrite(getMemoryOrigin(storeOp.getMemRef()));
+  WriteSummary summary;
+  addWrites(op, summary);
+  recordWrites(summary);
+}
+
+/// Update the state of the memory with the writes of 'summary'.
+void CSE::recordWrites(const WriteSummary &summary) {
+  if (summary.hasUnknownWrite)
+    recordUnknownWrite();
+  if (summary.hasArgumentWrite)
+    recordWrite({MemoryOrigin::Argument, nullptr});
+  for (Value *allocation : summary.allocationWrites)
+    recordWrite({MemoryOrigin::Allocation, allocation});
+}
+
+/// Compute the writes held by each affine.for operation of 'region'. The
+/// operations are visited once, children before parents, and the writes of
+/// each operation are merged into the summary of its parent, so that deep
+/// loop nests neither recurse nor visit their operations once per loop.
+void CSE::summarizeLoopWrites(Region &region) {
+  // Order the operations so that each one comes after its parent.
+  std::vector<Operation *> ops;
+  SmallVector<Block *, 8> worklist;
+  for (Block &block : region)
+    worklist.push_back(&block);
+  while (!worklist.empty()) {
+    for (Operation &op : *worklist.pop_back_val()) {
+      ops.push_back(&op);
+      for (Region &nested : op.getRegions())
+        for (Block &block : nested)
+          worklist.push_back(&block);
+    }
+  }
+
+  for (Operation *op : llvm::reverse(ops)) {
+    Operation *parent = op->getParentOp();
+    if (!parent)
+      continue;
+    WriteSummary &parentSummary = loopWrites[parent];
+    addWrites(op, parentSummary);
+    auto it = loopWrites.find(op);
+    if (it == loopWrites.end())
       continue;
+    parentSummary.merge(it->second);
+    // Only the summaries of the loops are looked up while simplifying.
+    if (!isa<AffineForOp>(op))
+      loopWrites.erase(it);
+  }
+}
 
-    // Simplify any held blocks.
-    for (auto &region : i.getRegions())
-      simplifyRegion(domInfo, region);
+/// Record a write to a memref of the given origin.
+void CSE::recordWrite(MemoryOrigin origin) {
+  ++generation;
+  switch (origin.kind) {
+  case MemoryOrigin::Allocation:
+    lastAllocationWrite = generation;
+    lastWrites[origin.allocation] = generation;
+    break;
+  case MemoryOrigin::Argument:
+    lastArgumentWrite = generation;
+    break;
+  case MemoryOrigin::Unknown:
+    lastUnknownWrite = generation;
+    break;
   }
 }
 
-void CSE::simplifyRegion(DominanceInfo &domInfo, Region &region) {
+/// Returns true if a value known at the given generation is still held by a
+/// location of a memref of the given origin.
+bool CSE::isKnownValueValid(MemoryOrigin origin, unsigned knownGeneration) {
+  if (knownGeneration < lastUnknownWrite)
+    return false;
+  switch (origin.kind) {
+  case MemoryOrigin::Allocation:
+    return knownGeneration >= lastWrites.lookup(origin.allocation);
+  case MemoryOrigin::Argument:
+    return knownGeneration >= lastArgumentWrite;
+  case MemoryOrigin::Unknown:
+    // A memref of unknown origin may alias any other memref.
+    return knownGeneration >= lastArgumentWrite &&
+           knownGeneration >= lastAllocationWrite;
+  }
+  llvm_unreachable("unknown memory origin");
+}
+
+/// Push a block to simplify onto the stack.
+void CSE::pushBlock(StackTy &stack, Block *block, DominanceInfoNode *node) {
+  // The memory values known in the dominator of the block are only valid if
+  // it is reached from it directly. The writes on other paths to the block,
+  // e.g. along a back edge, are not seen before the block is simplified.
+  if (!block->hasNoPredecessors()) {
+    Block *pred = block->getSinglePredecessor();
+    if (!pred || !node || !node->getIDom() ||
+        pred != node->getIDom()->getBlock())
+      recordUnknownWrite();
+  }
+  stack.emplace_back(llvm::make_unique<StackNode>(
+      knownValues, knownMemoryValues, block, node));
+}
+
+/// Push the entry node of a region to simplify onto the stack.
+void CSE::pushRegion(StackTy &stack, DominanceInfo &domInfo, Region &region) {
   // If the region is empty there is nothing to do.
   if (region.empty())
     return;
 
   // If the region only contains one block, then simplify it directly.
-  if (std::next(region.begin()) == region.end()) {
-    ScopedMapTy::ScopeTy scope(knownValues);
-    simplifyBlock(domInfo, &region.front());
-    return;
-  }
+  if (std::next(region.begin()) == region.end())
+    return pushBlock(stack, &region.front(), /*node=*/nullptr);
 
+  auto *rootNode = domInfo.getRootNode(&region);
+  pushBlock(stack, rootNode->getBlock(), rootNode);
+}
+
+void CSE::simplifyRegion(DominanceInfo &domInfo, Region &region) {
   // Note, deque is being used here because there was significant performance
   // gains over vector when the container becomes very large due to the
   // specific access patterns. If/when these performance issues are no
   // longer a problem we can change this to vector. For more information see
   // the llvm mailing list discussion on this:
   // http://lists.llvm.org/pipermail/llvm-commits/Week-of-Mon-20120116/135228.html
-  std::deque<std::unique_ptr<CFGStackNode>> stack;
-
-  // Process the nodes of the dom tree for this region.
-  stack.emplace_back(llvm::make_unique<CFGStackNode>(
-      knownValues, domInfo.getRootNode(&region)));
+  //
+  // The regions held by operations are simplified with the same stack, so
+  // that deeply nested regions don't exhaust the native stack.
+  StackTy stack;
+  pushRegion(stack, domInfo, region);
 
   while (!stack.empty()) {
     auto &currentNode = stack.back();
 
-    // Check to see if we need to process this node.
-    if (!currentNode->processed) {
-      currentNode->processed = true;
-      simplifyBlock(domInfo, currentNode->node->getBlock());
+    // Simplify the operations of the block, up to the next operation that
+    // holds regions.
+    if (currentNode->nextOp != currentNode->block->end()) {
+      Operation &op = *currentNode->nextOp++;
+
+      // If the operation is simplified, we don't process any held regions.
+      if (simplifyOperation(&op))
+        continue;
+      if (op.getNumRegions() == 0) {
+        simplifyMemoryOperation(&op);
+        continue;
+      }
+
+      // The body of a loop may be executed again after the writes that it
+      // holds, so these are recorded before the body is simplified. The
+      // regions of the other operations are not known to be executed in
+      // place, so any write is assumed.
+      if (isa<AffineForOp>(op)) {
+        auto it = loopWrites.find(&op);
+        if (it != loopWrites.end())
+          recordWrites(it->second);
+      } else if (!isa<AffineIfOp>(op)) {
+        recordUnknownWrite();
+      }
+
+      // Simplify any held regions, in order. The nodes are pushed in reverse
+      // order, so their scopes are still properly nested.
+      for (auto &nested : llvm::reverse(op.getRegions()))
+        pushRegion(stack, domInfo, nested);
+      continue;
     }
 
     // Otherwise, check to see if we need to process a child node.
-    if (currentNode->childIterator != currentNode->node->end()) {
+    if (currentNode->node &&
+        currentNode->childIterator != currentNode->node->end()) {
       auto *childNode = *(currentNode->childIterator++);
-      stack.emplace_back(
-          llvm::make_unique<CFGStackNode>(knownValues, childNode));
+      pushBlock(stack, childNode->getBlock(), childNode);
     } else {
       // Finally, if the node and all of its children have been processed
       // then we delete the node.
@@ -229,7 +570,11 @@ void CSE::simplifyRegion(DominanceInfo &domInfo, Region &region) {
 }
 
 void CSE::runOnFunction() {
+  summarizeLoopWrites(getFunction().getBody());
   simplifyRegion(getAnalysis<DominanceInfo>(), getFunction().getBody());
+  accesses.clear();
+  lastWrites.clear();
+  loopWrites.clear();
 
   // If no operations were erased, then we mark all analyses as preserved.
   if (opsToErase.empty()) {
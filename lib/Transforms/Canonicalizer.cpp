@@ -49,7 +49,16 @@ void Canonicalizer::runOnFunction() {
   for (auto *op : context->getRegisteredOperations())
     op->getCanonicalizationPatterns(patterns, context);
 
-  applyPatternsGreedily(func, std::move(patterns));
+  // If there is an instrumentation, collect the rewrite statistics and report
+  // them to it.
+  auto *pi = getAnalysisManager().getPassInstrumentor();
+  if (!pi) {
+    applyPatternsGreedily(func, std::move(patterns));
+    return;
+  }
+  GreedyRewriteStatistics stats;
+  applyPatternsGreedily(func, std::move(patterns), &stats);
+  pi->runAfterPatternRewrite(this, stats, &func);
 }
 
 /// Create a Canonicalizer pass.
@@ -24,6 +24,7 @@
 #include "mlir/Transforms/Utils.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -31,6 +32,10 @@ using namespace mlir;
 
 #define DEBUG_TYPE "dialect-conversion"
 
+STATISTIC(NumRootUpdatesInPlace,
+          "Number of operation recreations avoided by updating the operation "
+          "in place");
+
 //===----------------------------------------------------------------------===//
 // ArgConverter
 //===----------------------------------------------------------------------===//
@@ -244,9 +249,10 @@ constexpr StringLiteral ArgConverter::kCastName;
 /// This is useful when saving and undoing a set of rewrites.
 struct RewriterState {
   RewriterState(unsigned numCreatedOperations, unsigned numReplacements,
-                unsigned numBlockActions)
+                unsigned numBlockActions, unsigned numRootUpdates)
       : numCreatedOperations(numCreatedOperations),
-        numReplacements(numReplacements), numBlockActions(numBlockActions) {}
+        numReplacements(numReplacements), numBlockActions(numBlockActions),
+        numRootUpdates(numRootUpdates) {}
 
   /// The current number of created operations.
   unsigned numCreatedOperations;
@@ -256,6 +262,61 @@ struct RewriterState {
 
   /// The current number of block actions performed.
   unsigned numBlockActions;
+
+  /// The current number of operations updated in place.
+  unsigned numRootUpdates;
+};
+
+/// The state of an operation before it was updated in place, which is used to
+/// restore the operation if the update is undone.
+class RootUpdate {
+public:
+  explicit RootUpdate(Operation *op)
+      : op(op), loc(op->getLoc()), attrs(op->getAttrList()),
+        operands(op->operand_begin(), op->operand_end()) {
+    for (unsigned i = 0, e = op->getNumSuccessors(); i != e; ++i) {
+      successors.push_back(op->getSuccessor(i));
+      numSuccessorOperands.push_back(op->getNumSuccessorOperands(i));
+    }
+  }
+
+  /// Return the operation that was updated.
+  Operation *getOperation() const { return op; }
+
+  /// Restore the operation to the state it was in before the update.
+  void reset() {
+    op->setLoc(loc);
+    op->setAttrList(attrs);
+
+    // Restore the successors and their operands, then the operands that
+    // precede them.
+    ArrayRef<Value *> remaining = operands;
+    for (unsigned i = successors.size(); i-- != 0;) {
+      unsigned numOperands = numSuccessorOperands[i];
+      op->setSuccessor(successors[i], i);
+      op->setSuccessorOperands(i, remaining.take_back(numOperands));
+      remaining = remaining.drop_back(numOperands);
+    }
+    unsigned numNonSuccessorOperands = op->hasSuccessors()
+                                           ? op->getSuccessorOperandIndex(0)
+                                           : op->getNumOperands();
+    op->setOperands(/*start=*/0, numNonSuccessorOperands, remaining);
+  }
+
+private:
+  /// The operation that was updated.
+  Operation *op;
+
+  /// The location and attributes of the operation.
+  Location loc;
+  NamedAttributeList attrs;
+
+  /// The operands of the operation, including those of its successors.
+  SmallVector<Value *, 8> operands;
+
+  /// The successors of the operation and their number of operands.
+  SmallVector<Block *, 2> successors;
+  SmallVector<unsigned, 2> numSuccessorOperands;
 };
 
 /// This class implements a pattern rewriter for ConversionPattern
@@ -309,7 +370,7 @@ struct DialectConversionRewriter final : public PatternRewriter {
   /// Return the current state of the rewriter.
   RewriterState getCurrentState() {
     return RewriterState(createdOps.size(), replacements.size(),
-                         blockActions.size());
+                         blockActions.size(), rootUpdates.size());
   }
 
   /// Reset the state of the rewriter to a previously saved point.
@@ -320,6 +381,10 @@ struct DialectConversionRewriter final : public PatternRewriter {
         mapping.erase(result);
     replacements.resize(state.numReplacements);
 
+    // Restore the operations updated in place, before erasing the created
+    // operations that they may use.
+    undoRootUpdates(state.numRootUpdates);
+
     // Pop all of the newly created operations.
     while (createdOps.size() != state.numCreatedOperations)
       createdOps.pop_back_val()->erase();
@@ -328,6 +393,21 @@ struct DialectConversionRewriter final : public PatternRewriter {
     undoBlockActions(state.numBlockActions);
   }
 
+  /// Restore the operations updated in place one by one in reverse order until
+  /// "numUpdatesToKeep" updates remain.
+  void undoRootUpdates(unsigned numUpdatesToKeep = 0) {
+    while (rootUpdates.size() != numUpdatesToKeep)
+      rootUpdates.pop_back_val().reset();
+  }
+
+  /// Returns true if the given operation was updated in place since the given
+  /// state.
+  bool wasUpdatedInPlace(Operation *op, RewriterState state) {
+    return llvm::any_of(
+        llvm::drop_begin(rootUpdates, state.numRootUpdates),
+        [&](const RootUpdate &update) { return update.getOperation() == op; });
+  }
+
   /// Undo the block actions (motions, splits) one by one in reverse order until
   /// "numActionsToKeep" actions remains.
   void undoBlockActions(unsigned numActionsToKeep = 0) {
@@ -359,6 +439,10 @@ struct DialectConversionRewriter final : public PatternRewriter {
   void discardRewrites() {
     argConverter.discardRewrites();
 
+    // Restore the operations updated in place, before erasing the created
+    // operations that they may use.
+    undoRootUpdates();
+
     // Remove any newly created ops.
     for (auto *op : createdOps) {
       op->dropAllDefinedValueUses();
@@ -371,6 +455,8 @@ struct DialectConversionRewriter final : public PatternRewriter {
   /// Apply all requested operation rewrites. This method is invoked when the
   /// conversion process succeeds.
   LogicalResult applyRewrites() {
+    NumRootUpdatesInPlace += rootUpdates.size();
+
     // Apply all of the rewrites replacements requested during conversion.
     for (auto &repl : replacements) {
       for (unsigned i = 0, e = repl.newValues.size(); i != e; ++i)
@@ -438,12 +524,23 @@ struct DialectConversionRewriter final : public PatternRewriter {
     return result;
   }
 
+  /// PatternRewriter hook for starting to update the root operation in-place.
+  /// The state of the operation is saved, so that the update can be undone.
+  void notifyRootUpdateStarted(Operation *op) override {
+    rootUpdates.emplace_back(op);
+  }
+
   /// PatternRewriter hook for updating the root operation in-place.
   void notifyRootUpdated(Operation *op) override {
-    // The rewriter caches changes to the IR to allow for operating in-place and
-    // backtracking. The rewrite is currently not capable of backtracking
-    // in-place modifications.
-    llvm_unreachable("in-place operation updates are not supported");
+    assert(wasUpdateStarted(op) &&
+           "expected 'startRootUpdate' to be called before the update");
+  }
+
+  /// Returns true if the update of the given operation was started.
+  bool wasUpdateStarted(Operation *op) {
+    return llvm::any_of(rootUpdates, [&](const RootUpdate &update) {
+      return update.getOperation() == op;
+    });
   }
 
   /// Remap the given operands to those with potentially different types.
@@ -469,6 +566,9 @@ struct DialectConversionRewriter final : public PatternRewriter {
 
   /// Ordered list of block operations (creations, splits, motions).
   SmallVector<BlockAction, 4> blockActions;
+
+  /// Ordered list of the saved states of the operations updated in place.
+  SmallVector<RootUpdate, 4> rootUpdates;
 };
 } // end anonymous namespace
 
@@ -648,6 +748,13 @@ OperationLegalizer::legalizePattern(Operation *op, RewritePattern *pattern,
     }
   }
 
+  // If the operation was updated in place, it must now be legal as well.
+  if (rewriter.wasUpdatedInPlace(op, curState) &&
+      failed(legalize(op, rewriter))) {
+    LLVM_DEBUG(llvm::dbgs() << "-- FAIL: Updated operation was illegal.\n");
+    return cleanupFailure();
+  }
+
   appliedPatterns.erase(pattern);
   return success();
 }
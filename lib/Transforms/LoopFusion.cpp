@@ -41,6 +41,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include <iomanip>
 #include <sstream>
+#include <tuple>
 #define DEBUG_TYPE "affine-loop-fusion"
 
 using llvm::SetVector;
@@ -77,11 +78,26 @@ static llvm::cl::opt<unsigned long long> clFusionLocalBufThreshold(
                    "memory space"),
     llvm::cl::cat(clOptionsCategory));
 
+/// Chooses the fusions of a function together, from the candidate fusions that
+/// save the most memory traffic, instead of greedily in program order.
+static llvm::cl::opt<bool> clFusionGlobalPlanner(
+    "fusion-global-planner",
+    llvm::cl::desc("Plan the fusions of each function globally instead of "
+                   "fusing greedily"),
+    llvm::cl::cat(clOptionsCategory));
+
+static llvm::cl::opt<bool> clFusionReport(
+    "fusion-report",
+    llvm::cl::desc("Report the number of fusions of each function and the "
+                   "memory traffic they are estimated to save"),
+    llvm::cl::cat(clOptionsCategory));
+
 namespace {
 
 /// Loop fusion pass. This pass currently supports a greedy fusion policy,
 /// which fuses loop nests with single-writer/single-reader memref dependences
-/// with the goal of improving locality.
+/// with the goal of improving locality, and a global policy, which plans the
+/// fusions of a function together with the same goal (-fusion-global-planner).
 
 // TODO(andydavis) Support fusion of source loop nests which write to multiple
 // memrefs, where each memref can have multiple users (if profitable).
@@ -778,7 +794,8 @@ static unsigned getInnermostCommonLoopDepth(ArrayRef<Operation *> ops) {
 // Returns the maximum loop depth at which no dependences between 'loadOpInsts'
 // and 'storeOpInsts' are satisfied.
 static unsigned getMaxLoopDepth(ArrayRef<Operation *> loadOpInsts,
-                                ArrayRef<Operation *> storeOpInsts) {
+                                ArrayRef<Operation *> storeOpInsts,
+                                MemRefDependenceAnalysis &depAnalysis) {
   // Merge loads and stores into the same array.
   SmallVector<Operation *, 2> ops(loadOpInsts.begin(), loadOpInsts.end());
   ops.append(storeOpInsts.begin(), storeOpInsts.end());
@@ -802,11 +819,8 @@ static unsigned getMaxLoopDepth(ArrayRef<Operation *> loadOpInsts,
       unsigned numCommonLoops =
           getNumCommonSurroundingLoops(*srcOpInst, *dstOpInst);
       for (unsigned d = 1; d <= numCommonLoops + 1; ++d) {
-        FlatAffineConstraints dependenceConstraints;
-        // TODO(andydavis) Cache dependence analysis results, check cache here.
-        DependenceResult result = checkMemrefAccessDependence(
-            srcAccess, dstAccess, d, &dependenceConstraints,
-            /*dependenceComponents=*/nullptr);
+        DependenceResult result =
+            depAnalysis.checkDependence(srcAccess, dstAccess, d);
         if (hasDependence(result)) {
           // Store minimum loop depth and break because we want the min 'd' at
           // which there is a dependence.
@@ -824,27 +838,14 @@ static unsigned getMaxLoopDepth(ArrayRef<Operation *> loadOpInsts,
 // outermost (while again preserving relative order among them).
 // This can increase the loop depth at which we can fuse a slice, since we are
 // pushing loop carried dependence to a greater depth in the loop nest.
-static void sinkSequentialLoops(MemRefDependenceGraph::Node *node) {
+static void sinkSequentialLoops(MemRefDependenceGraph::Node *node,
+                                MemRefDependenceAnalysis &depAnalysis) {
   assert(isa<AffineForOp>(node->op));
-  AffineForOp newRootForOp = sinkSequentialLoops(cast<AffineForOp>(node->op));
+  AffineForOp newRootForOp =
+      sinkSequentialLoops(cast<AffineForOp>(node->op), &depAnalysis);
   node->op = newRootForOp.getOperation();
 }
 
-//  TODO(mlir-team): improve/complete this when we have target data.
-unsigned getMemRefEltSizeInBytes(MemRefType memRefType) {
-  auto elementType = memRefType.getElementType();
-
-  unsigned sizeInBits;
-  if (elementType.isIntOrFloat()) {
-    sizeInBits = elementType.getIntOrFloatBitWidth();
-  } else {
-    auto vectorType = elementType.cast<VectorType>();
-    sizeInBits =
-        vectorType.getElementTypeBitWidth() * vectorType.getNumElements();
-  }
-  return llvm::divideCeil(sizeInBits, 8);
-}
-
 // Creates and returns a private (single-user) memref for fused loop rooted
 // at 'forOp', with (potentially reduced) memref size based on the
 // MemRefRegion written to by 'srcStoreOpInst' at depth 'dstLoopDepth'.
@@ -1032,6 +1033,38 @@ static bool canFuseSrcWhichWritesToLiveOut(unsigned srcId, unsigned dstId,
   return true;
 }
 
+// The estimates of the fusion cost model for a slice of a source loop nest
+// fused into a destination loop nest at a given depth.
+struct FusionEstimate {
+  // The size of the region written by the source loop nest, and by the slice.
+  int64_t srcWriteRegionSizeBytes = 0;
+  int64_t sliceWriteRegionSizeBytes = 0;
+  // For input-reuse fusion, the size of the region read by both loop nests.
+  int64_t srcReadRegionSizeBytes = 0;
+  // The computation added by the fusion, as a fraction of the computation of
+  // the unfused loop nests.
+  double additionalComputeFraction = 0.0;
+};
+
+// Returns the number of bytes of memory traffic that a fusion is estimated to
+// save. An input-reuse fusion reads the shared region once instead of twice.
+// A producer-consumer fusion which creates a private memref writes and reads
+// a slice-sized region instead of the region written by the source loop nest,
+// which is still written if the source loop nest is kept for its other users.
+// Without a private memref, the destination reads the region right after the
+// slice writes it instead of after the whole source loop nest.
+static int64_t getTrafficSavedBytes(const FusionEstimate &estimate,
+                                    bool isInputReuse, bool privatizesMemRef,
+                                    bool removesSrc) {
+  if (isInputReuse)
+    return estimate.srcReadRegionSizeBytes;
+  int64_t srcBytes = estimate.srcWriteRegionSizeBytes;
+  int64_t sliceBytes = estimate.sliceWriteRegionSizeBytes;
+  if (!privatizesMemRef)
+    return srcBytes;
+  return removesSrc ? 2 * (srcBytes - sliceBytes) : srcBytes - 2 * sliceBytes;
+}
+
 // Checks the profitability of fusing a backwards slice of the loop nest
 // surrounding 'srcOpInst' into the loop nest surrounding 'dstLoadOpInsts'.
 // The argument 'srcStoreOpInst' is used to calculate the storage reduction on
@@ -1044,7 +1077,8 @@ static bool canFuseSrcWhichWritesToLiveOut(unsigned srcId, unsigned dstId,
 // that the write region is the same after input-reuse fusion.
 // Returns true if it is profitable to fuse the candidate loop nests. Returns
 // false otherwise. `dstLoopDepth` is set to the most profitable depth at which
-// to materialize the source loop nest slice.
+// to materialize the source loop nest slice, and 'estimate', if non-null, to
+// the estimates of the cost model at that depth.
 // The profitability model executes the following steps:
 // *) Computes the backward computation slice at 'srcOpInst'. This
 //    computation slice of the loop nest surrounding 'srcOpInst' is
@@ -1074,7 +1108,9 @@ static bool isFusionProfitable(Operation *srcOpInst, Operation *srcStoreOpInst,
                                ArrayRef<Operation *> dstLoadOpInsts,
                                ArrayRef<Operation *> dstStoreOpInsts,
                                ComputationSliceState *sliceState,
-                               unsigned *dstLoopDepth, bool maximalFusion) {
+                               unsigned *dstLoopDepth, bool maximalFusion,
+                               MemRefDependenceAnalysis &depAnalysis,
+                               FusionEstimate *estimate = nullptr) {
   LLVM_DEBUG({
     llvm::dbgs() << "Checking whether fusion is profitable between:\n";
     llvm::dbgs() << " " << *srcOpInst << " and \n";
@@ -1105,7 +1141,7 @@ static bool isFusionProfitable(Operation *srcOpInst, Operation *srcStoreOpInst,
   // and still satisfy dest loop nest dependences, for producer-consumer fusion.
   unsigned maxDstLoopDepth =
       (srcOpInst == srcStoreOpInst)
-          ? getMaxLoopDepth(dstLoadOpInsts, dstStoreOpInsts)
+          ? getMaxLoopDepth(dstLoadOpInsts, dstStoreOpInsts, depAnalysis)
           : dstLoopIVs.size();
   if (maxDstLoopDepth == 0) {
     LLVM_DEBUG(llvm::dbgs() << "Can't fuse: maxDstLoopDepth == 0 .\n");
@@ -1306,7 +1342,6 @@ static bool isFusionProfitable(Operation *srcOpInst, Operation *srcStoreOpInst,
       100.0 * (minFusedLoopNestComputeCost /
                    (static_cast<double>(srcLoopNestCost) + dstLoopNestCost) -
                1);
-  (void)additionalComputeFraction;
   LLVM_DEBUG({
     std::stringstream msg;
     msg << " fusion is most profitable at depth " << *dstLoopDepth << " with "
@@ -1319,6 +1354,22 @@ static bool isFusionProfitable(Operation *srcOpInst, Operation *srcStoreOpInst,
     llvm::dbgs() << msg.str();
   });
 
+  if (estimate) {
+    estimate->srcWriteRegionSizeBytes = srcWriteRegionSizeBytes;
+    estimate->sliceWriteRegionSizeBytes = sliceMemEstimate.getValue();
+    estimate->additionalComputeFraction = additionalComputeFraction / 100.0;
+    // For input-reuse fusion, the region read by 'srcOpInst' is read once for
+    // both loop nests.
+    estimate->srcReadRegionSizeBytes = 0;
+    if (srcOpInst != srcStoreOpInst) {
+      MemRefRegion srcReadRegion(srcOpInst->getLoc());
+      if (succeeded(srcReadRegion.compute(srcOpInst, /*loopDepth=*/0))) {
+        if (auto size = srcReadRegion.getRegionSize())
+          estimate->srcReadRegionSizeBytes = size.getValue();
+      }
+    }
+  }
+
   // Update return parameter 'sliceState' with 'bestSliceState'.
   ComputationSliceState *bestSliceState = &sliceStates[*dstLoopDepth - 1];
   sliceState->lbs = bestSliceState->lbs;
@@ -1340,6 +1391,21 @@ static bool isFusionProfitable(Operation *srcOpInst, Operation *srcStoreOpInst,
   return true;
 }
 
+// A fusion of the loop nest of node 'srcId' into the loop nest of node 'dstId'
+// along 'memref', as evaluated by the cost model before any fusion happens.
+struct FusionCandidate {
+  unsigned srcId;
+  unsigned dstId;
+  Value *memref;
+  // True for input-reuse fusion of sibling loop nests which both load from
+  // 'memref', false for producer-consumer fusion.
+  bool isSibling;
+  // True if the source loop nest is expected to be removed after the fusion.
+  bool removesSrc;
+  int64_t trafficSavedBytes;
+  double additionalComputeFraction;
+};
+
 // GreedyFusion greedily fuses loop nests which have a producer/consumer or
 // input-reuse relationship on a memref, with the goal of improving locality.
 //
@@ -1400,13 +1466,22 @@ public:
   // If true, ignore any additional (redundant) computation tolerance threshold
   // that would have prevented fusion.
   bool maximalFusion;
+  // Cache of the dependence checks between the accesses of the function. The
+  // loop nests that are transformed are invalidated before they are modified.
+  MemRefDependenceAnalysis &depAnalysis;
+  // The number of loop nest pairs fused, and the memory traffic that these
+  // fusions are estimated to save.
+  unsigned numFusions = 0;
+  int64_t trafficSavedBytes = 0;
 
   using Node = MemRefDependenceGraph::Node;
 
   GreedyFusion(MemRefDependenceGraph *mdg, unsigned localBufSizeThreshold,
-               Optional<unsigned> fastMemorySpace, bool maximalFusion)
+               Optional<unsigned> fastMemorySpace, bool maximalFusion,
+               MemRefDependenceAnalysis &depAnalysis)
       : mdg(mdg), localBufSizeThreshold(localBufSizeThreshold),
-        fastMemorySpace(fastMemorySpace), maximalFusion(maximalFusion) {}
+        fastMemorySpace(fastMemorySpace), maximalFusion(maximalFusion),
+        depAnalysis(depAnalysis) {}
 
   // Initializes 'worklist' with nodes from 'mdg'
   void init() {
@@ -1435,6 +1510,55 @@ public:
     eraseUnusedMemRefAllocations();
   }
 
+  // Performs the fusions of 'plan' in order. Each fusion is checked again when
+  // it is performed, as the earlier fusions may have made it illegal or
+  // unprofitable, and is skipped if so. The ids of the candidates are those of
+  // the nodes before any fusion: a removed source node is replaced by the node
+  // it was fused into.
+  void runPlan(ArrayRef<FusionCandidate> plan) {
+    DenseMap<unsigned, unsigned> fusedInto;
+    auto getCurrentId = [&](unsigned id) {
+      for (auto it = fusedInto.find(id); it != fusedInto.end();
+           it = fusedInto.find(id))
+        id = it->second;
+      return id;
+    };
+
+    for (const FusionCandidate &candidate : plan) {
+      unsigned srcId = getCurrentId(candidate.srcId);
+      unsigned dstId = getCurrentId(candidate.dstId);
+      if (srcId == dstId || mdg->nodes.count(srcId) == 0 ||
+          mdg->nodes.count(dstId) == 0)
+        continue;
+      auto *srcNode = mdg->getNode(srcId);
+      auto *dstNode = mdg->getNode(dstId);
+      if (!isa<AffineForOp>(srcNode->op) || !isa<AffineForOp>(dstNode->op))
+        continue;
+
+      if (candidate.isSibling) {
+        if (dstNode->getLoadOpCount(candidate.memref) == 0 ||
+            !canFuseWithSibNode(srcNode, dstNode, candidate.memref))
+          continue;
+        fuseSiblings(srcId, dstId, candidate.memref);
+      } else {
+        sinkSequentialLoops(dstNode, depAnalysis);
+        SmallVector<Operation *, 4> dstLoadOpInsts;
+        dstNode->getLoadOpsForMemref(candidate.memref, &dstLoadOpInsts);
+        if (dstLoadOpInsts.empty() ||
+            !mdg->hasEdge(srcId, dstId, candidate.memref))
+          continue;
+        Value *privateMemRef;
+        fuseProducerConsumer(
+            srcId, dstId, candidate.memref, dstLoadOpInsts,
+            /*maxSrcUserCount=*/std::numeric_limits<unsigned>::max(),
+            &privateMemRef);
+      }
+      if (mdg->nodes.count(srcId) == 0)
+        fusedInto[srcId] = dstId;
+    }
+    eraseUnusedMemRefAllocations();
+  }
+
   void fuseProducerConsumerNodes(unsigned maxSrcUserCount) {
     init();
     while (!worklist.empty()) {
@@ -1454,7 +1578,7 @@ public:
       // while preserving relative order. This can increase the maximum loop
       // depth at which we can fuse a slice of a producer loop nest into a
       // consumer loop nest.
-      sinkSequentialLoops(dstNode);
+      sinkSequentialLoops(dstNode, depAnalysis);
 
       SmallVector<Operation *, 4> loads = dstNode->loads;
       SmallVector<Operation *, 4> dstLoadOpInsts;
@@ -1480,149 +1604,181 @@ public:
           srcNodeIds.push_back(srcEdge.id);
         }
         for (unsigned srcId : srcNodeIds) {
-          // Skip if this node was removed (fused into another node).
-          if (mdg->nodes.count(srcId) == 0)
-            continue;
-          // Get 'srcNode' from which to attempt fusion into 'dstNode'.
-          auto *srcNode = mdg->getNode(srcId);
-          // Skip if 'srcNode' is not a loop nest.
-          if (!isa<AffineForOp>(srcNode->op))
-            continue;
-          // Skip if 'srcNode' has more than one store to any memref.
-          // TODO(andydavis) Support fusing multi-output src loop nests.
-          if (srcNode->stores.size() != 1)
+          Value *privateMemRef;
+          if (!fuseProducerConsumer(srcId, dstId, memref, dstLoadOpInsts,
+                                    maxSrcUserCount, &privateMemRef))
             continue;
+          if (privateMemRef)
+            visitedMemrefs.insert(privateMemRef);
+
+          // Add new load ops to current Node load op list 'loads' to
+          // continue fusing based on new operands.
+          for (auto *loadOpInst : mdg->getNode(dstId)->loads) {
+            auto *loadMemRef = cast<LoadOp>(loadOpInst).getMemRef();
+            if (visitedMemrefs.count(loadMemRef) == 0)
+              loads.push_back(loadOpInst);
+          }
 
-          // Skip if 'srcNode' writes to any live in or escaping memrefs,
-          // and cannot be fused.
-          bool writesToLiveInOrOut =
-              mdg->writesToLiveInOrEscapingMemrefs(srcNode->id);
-          if (writesToLiveInOrOut &&
-              !canFuseSrcWhichWritesToLiveOut(srcId, dstId, memref, mdg))
+          // Skip if 'srcNode' was fused and removed.
+          if (mdg->nodes.count(srcId) == 0)
             continue;
+          // Add remaining users of 'oldMemRef' back on the worklist (if not
+          // already there), as its replacement with a local/private memref
+          // has reduced dependences on 'oldMemRef' which may have created
+          // new fusion opportunities.
+          if (mdg->outEdges.count(srcId) > 0) {
+            SmallVector<MemRefDependenceGraph::Edge, 2> oldOutEdges =
+                mdg->outEdges[srcId];
+            for (auto &outEdge : oldOutEdges) {
+              if (outEdge.value == memref &&
+                  worklistSet.count(outEdge.id) == 0) {
+                worklist.push_back(outEdge.id);
+                worklistSet.insert(outEdge.id);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
 
-          // Skip if 'srcNode' out edge count on 'memref' > 'maxSrcUserCount'.
-          if (mdg->getOutEdgeCount(srcNode->id, memref) > maxSrcUserCount)
-            continue;
+  // Attempts to fuse a slice of the producer node 'srcId' into the consumer
+  // node 'dstId' along 'memref', which is loaded by 'dstLoadOpInsts' in
+  // 'dstId'. Returns true if the slice was fused, in which case
+  // 'privateMemRef' is set to the private memref which replaces 'memref' in
+  // 'dstId' if one was created, and to null otherwise. 'srcId' is removed
+  // from the graph if it has no remaining users.
+  bool fuseProducerConsumer(unsigned srcId, unsigned dstId, Value *memref,
+                            ArrayRef<Operation *> dstLoadOpInsts,
+                            unsigned maxSrcUserCount, Value **privateMemRef) {
+    *privateMemRef = nullptr;
+    // Skip if this node was removed (fused into another node).
+    if (mdg->nodes.count(srcId) == 0)
+      return false;
+    // Get 'srcNode' from which to attempt fusion into 'dstNode'.
+    auto *srcNode = mdg->getNode(srcId);
+    auto *dstNode = mdg->getNode(dstId);
+    // Skip if 'srcNode' is not a loop nest.
+    if (!isa<AffineForOp>(srcNode->op))
+      return false;
+    // Skip if 'srcNode' has more than one store to any memref.
+    // TODO(andydavis) Support fusing multi-output src loop nests.
+    if (srcNode->stores.size() != 1)
+      return false;
 
-          // Compute an operation list insertion point for the fused loop
-          // nest which preserves dependences.
-          Operation *insertPointInst =
-              mdg->getFusedLoopNestInsertionPoint(srcNode->id, dstNode->id);
-          if (insertPointInst == nullptr)
-            continue;
+    // Skip if 'srcNode' writes to any live in or escaping memrefs,
+    // and cannot be fused.
+    bool writesToLiveInOrOut = mdg->writesToLiveInOrEscapingMemrefs(srcId);
+    if (writesToLiveInOrOut &&
+        !canFuseSrcWhichWritesToLiveOut(srcId, dstId, memref, mdg))
+      return false;
 
-          // Get unique 'srcNode' store op.
-          auto *srcStoreOpInst = srcNode->stores.front();
-          // Gather 'dstNode' store ops to 'memref'.
-          SmallVector<Operation *, 2> dstStoreOpInsts;
-          for (auto *storeOpInst : dstNode->stores)
-            if (cast<StoreOp>(storeOpInst).getMemRef() == memref)
-              dstStoreOpInsts.push_back(storeOpInst);
-
-          unsigned bestDstLoopDepth;
-          mlir::ComputationSliceState sliceState;
-          // Check if fusion would be profitable.
-          if (!isFusionProfitable(srcStoreOpInst, srcStoreOpInst,
-                                  dstLoadOpInsts, dstStoreOpInsts, &sliceState,
-                                  &bestDstLoopDepth, maximalFusion))
-            continue;
-          // TODO(andydavis) Remove the following test code when canFuseLoops
-          // is fully functional.
-          mlir::ComputationSliceState sliceUnion;
-          if (!maximalFusion) {
-            FusionResult result = mlir::canFuseLoops(
-                cast<AffineForOp>(srcNode->op), cast<AffineForOp>(dstNode->op),
-                bestDstLoopDepth, &sliceUnion);
-            assert(result.value == FusionResult::Success);
-            (void)result;
-          }
-          // Fuse computation slice of 'srcLoopNest' into 'dstLoopNest'.
-          auto sliceLoopNest = mlir::insertBackwardComputationSlice(
-              srcStoreOpInst, dstLoadOpInsts[0], bestDstLoopDepth, &sliceState);
-          if (sliceLoopNest) {
-            LLVM_DEBUG(llvm::dbgs() << "\tslice loop nest:\n"
-                                    << *sliceLoopNest.getOperation() << "\n");
-            // Move 'dstAffineForOp' before 'insertPointInst' if needed.
-            auto dstAffineForOp = cast<AffineForOp>(dstNode->op);
-            if (insertPointInst != dstAffineForOp.getOperation()) {
-              dstAffineForOp.getOperation()->moveBefore(insertPointInst);
-            }
-            // Update edges between 'srcNode' and 'dstNode'.
-            mdg->updateEdges(srcNode->id, dstNode->id, memref);
-
-            // Collect slice loop stats.
-            LoopNestStateCollector sliceCollector;
-            sliceCollector.collect(sliceLoopNest.getOperation());
-            // Promote single iteration slice loops to single IV value.
-            for (auto forOp : sliceCollector.forOps) {
-              promoteIfSingleIteration(forOp);
-            }
-            if (!writesToLiveInOrOut) {
-              // Create private memref for 'memref' in 'dstAffineForOp'.
-              SmallVector<Operation *, 4> storesForMemref;
-              for (auto *storeOpInst : sliceCollector.storeOpInsts) {
-                if (cast<StoreOp>(storeOpInst).getMemRef() == memref)
-                  storesForMemref.push_back(storeOpInst);
-              }
-              assert(storesForMemref.size() == 1);
-              auto *newMemRef = createPrivateMemRef(
-                  dstAffineForOp, storesForMemref[0], bestDstLoopDepth,
-                  fastMemorySpace, localBufSizeThreshold);
-              visitedMemrefs.insert(newMemRef);
-              // Create new node in dependence graph for 'newMemRef' alloc op.
-              unsigned newMemRefNodeId =
-                  mdg->addNode(newMemRef->getDefiningOp());
-              // Add edge from 'newMemRef' node to dstNode.
-              mdg->addEdge(newMemRefNodeId, dstId, newMemRef);
-            }
+    // Skip if 'srcNode' out edge count on 'memref' > 'maxSrcUserCount'.
+    if (mdg->getOutEdgeCount(srcId, memref) > maxSrcUserCount)
+      return false;
 
-            // Collect dst loop stats after memref privatizaton transformation.
-            LoopNestStateCollector dstLoopCollector;
-            dstLoopCollector.collect(dstAffineForOp.getOperation());
+    // Compute an operation list insertion point for the fused loop
+    // nest which preserves dependences.
+    Operation *insertPointInst =
+        mdg->getFusedLoopNestInsertionPoint(srcId, dstId);
+    if (insertPointInst == nullptr)
+      return false;
 
-            // Add new load ops to current Node load op list 'loads' to
-            // continue fusing based on new operands.
-            for (auto *loadOpInst : dstLoopCollector.loadOpInsts) {
-              auto *loadMemRef = cast<LoadOp>(loadOpInst).getMemRef();
-              if (visitedMemrefs.count(loadMemRef) == 0)
-                loads.push_back(loadOpInst);
-            }
+    // Get unique 'srcNode' store op.
+    auto *srcStoreOpInst = srcNode->stores.front();
+    // Gather 'dstNode' store ops to 'memref'.
+    SmallVector<Operation *, 2> dstStoreOpInsts;
+    dstNode->getStoreOpsForMemref(memref, &dstStoreOpInsts);
+
+    unsigned bestDstLoopDepth;
+    mlir::ComputationSliceState sliceState;
+    FusionEstimate estimate;
+    // Check if fusion would be profitable.
+    if (!isFusionProfitable(srcStoreOpInst, srcStoreOpInst, dstLoadOpInsts,
+                            dstStoreOpInsts, &sliceState, &bestDstLoopDepth,
+                            maximalFusion, depAnalysis, &estimate))
+      return false;
+    // TODO(andydavis) Remove the following test code when canFuseLoops
+    // is fully functional.
+    mlir::ComputationSliceState sliceUnion;
+    if (!maximalFusion) {
+      FusionResult result = mlir::canFuseLoops(
+          cast<AffineForOp>(srcNode->op), cast<AffineForOp>(dstNode->op),
+          bestDstLoopDepth, &sliceUnion);
+      assert(result.value == FusionResult::Success);
+      (void)result;
+    }
+    // Fuse computation slice of 'srcLoopNest' into 'dstLoopNest'.
+    auto sliceLoopNest = mlir::insertBackwardComputationSlice(
+        srcStoreOpInst, dstLoadOpInsts[0], bestDstLoopDepth, &sliceState);
+    if (!sliceLoopNest)
+      return false;
 
-            // Clear and add back loads and stores.
-            mdg->clearNodeLoadAndStores(dstNode->id);
-            mdg->addToNode(dstId, dstLoopCollector.loadOpInsts,
-                           dstLoopCollector.storeOpInsts);
-            // Remove old src loop nest if it no longer has outgoing dependence
-            // edges, and if it does not write to a memref which escapes the
-            // function. If 'writesToLiveInOrOut' is true, then 'srcNode' has
-            // been fused into 'dstNode' and write region of 'dstNode' covers
-            // the write region of 'srcNode', and 'srcNode' has no other users
-            // so it is safe to remove.
-            if (writesToLiveInOrOut || mdg->canRemoveNode(srcNode->id)) {
-              mdg->removeNode(srcNode->id);
-              srcNode->op->erase();
-            } else {
-              // Add remaining users of 'oldMemRef' back on the worklist (if not
-              // already there), as its replacement with a local/private memref
-              // has reduced dependences on 'oldMemRef' which may have created
-              // new fusion opportunities.
-              if (mdg->outEdges.count(srcNode->id) > 0) {
-                SmallVector<MemRefDependenceGraph::Edge, 2> oldOutEdges =
-                    mdg->outEdges[srcNode->id];
-                for (auto &outEdge : oldOutEdges) {
-                  if (outEdge.value == memref &&
-                      worklistSet.count(outEdge.id) == 0) {
-                    worklist.push_back(outEdge.id);
-                    worklistSet.insert(outEdge.id);
-                  }
-                }
-              }
-            }
-          }
-        }
+    LLVM_DEBUG(llvm::dbgs() << "\tslice loop nest:\n"
+                            << *sliceLoopNest.getOperation() << "\n");
+    // The accesses of 'dstNode' are moved and privatized below.
+    depAnalysis.invalidate(dstNode->op);
+    // Move 'dstAffineForOp' before 'insertPointInst' if needed.
+    auto dstAffineForOp = cast<AffineForOp>(dstNode->op);
+    if (insertPointInst != dstAffineForOp.getOperation()) {
+      dstAffineForOp.getOperation()->moveBefore(insertPointInst);
+    }
+    // Update edges between 'srcNode' and 'dstNode'.
+    mdg->updateEdges(srcId, dstId, memref);
+
+    // Collect slice loop stats.
+    LoopNestStateCollector sliceCollector;
+    sliceCollector.collect(sliceLoopNest.getOperation());
+    // Promote single iteration slice loops to single IV value.
+    for (auto forOp : sliceCollector.forOps) {
+      promoteIfSingleIteration(forOp);
+    }
+    if (!writesToLiveInOrOut) {
+      // Create private memref for 'memref' in 'dstAffineForOp'.
+      SmallVector<Operation *, 4> storesForMemref;
+      for (auto *storeOpInst : sliceCollector.storeOpInsts) {
+        if (cast<StoreOp>(storeOpInst).getMemRef() == memref)
+          storesForMemref.push_back(storeOpInst);
       }
+      assert(storesForMemref.size() == 1);
+      auto *newMemRef = createPrivateMemRef(
+          dstAffineForOp, storesForMemref[0], bestDstLoopDepth,
+          fastMemorySpace, localBufSizeThreshold);
+      *privateMemRef = newMemRef;
+      // Create new node in dependence graph for 'newMemRef' alloc op. This
+      // may invalidate the pointers to the nodes of the graph.
+      unsigned newMemRefNodeId = mdg->addNode(newMemRef->getDefiningOp());
+      // Add edge from 'newMemRef' node to dstNode.
+      mdg->addEdge(newMemRefNodeId, dstId, newMemRef);
+    }
+
+    // Collect dst loop stats after memref privatizaton transformation.
+    LoopNestStateCollector dstLoopCollector;
+    dstLoopCollector.collect(dstAffineForOp.getOperation());
+
+    // Clear and add back loads and stores.
+    mdg->clearNodeLoadAndStores(dstId);
+    mdg->addToNode(dstId, dstLoopCollector.loadOpInsts,
+                   dstLoopCollector.storeOpInsts);
+    // Remove old src loop nest if it no longer has outgoing dependence
+    // edges, and if it does not write to a memref which escapes the
+    // function. If 'writesToLiveInOrOut' is true, then 'srcNode' has
+    // been fused into 'dstNode' and write region of 'dstNode' covers
+    // the write region of 'srcNode', and 'srcNode' has no other users
+    // so it is safe to remove.
+    bool removesSrc = writesToLiveInOrOut || mdg->canRemoveNode(srcId);
+    ++numFusions;
+    trafficSavedBytes +=
+        getTrafficSavedBytes(estimate, /*isInputReuse=*/false,
+                             /*privatizesMemRef=*/!writesToLiveInOrOut,
+                             removesSrc);
+    if (removesSrc) {
+      Operation *srcOp = mdg->getNode(srcId)->op;
+      mdg->removeNode(srcId);
+      depAnalysis.invalidate(srcOp);
+      srcOp->erase();
     }
+    return true;
   }
 
   // Visits each node in the graph, and for each node, attempts to fuse it with
@@ -1651,64 +1807,108 @@ public:
   void fuseWithSiblingNodes(Node *dstNode) {
     DenseSet<unsigned> visitedSibNodeIds;
     std::pair<unsigned, Value *> idAndMemref;
-    while (findSiblingNodeToFuse(dstNode, &visitedSibNodeIds, &idAndMemref)) {
-      unsigned sibId = idAndMemref.first;
-      Value *memref = idAndMemref.second;
-      // TODO(andydavis) Check that 'sibStoreOpInst' post-dominates all other
-      // stores to the same memref in 'sibNode' loop nest.
-      auto *sibNode = mdg->getNode(sibId);
-      // Compute an operation list insertion point for the fused loop
-      // nest which preserves dependences.
-      assert(sibNode->op->getBlock() == dstNode->op->getBlock());
-      Operation *insertPointInst =
-          sibNode->op->isBeforeInBlock(dstNode->op)
-              ? mdg->getFusedLoopNestInsertionPoint(sibNode->id, dstNode->id)
-              : mdg->getFusedLoopNestInsertionPoint(dstNode->id, sibNode->id);
-      if (insertPointInst == nullptr)
-        continue;
-
-      // Check if fusion would be profitable and at what depth.
+    while (findSiblingNodeToFuse(dstNode, &visitedSibNodeIds, &idAndMemref))
+      fuseSiblings(idAndMemref.first, dstNode->id, idAndMemref.second);
+  }
 
-      // Get unique 'sibNode' load op to 'memref'.
-      SmallVector<Operation *, 2> sibLoadOpInsts;
-      sibNode->getLoadOpsForMemref(memref, &sibLoadOpInsts);
-      // Currently findSiblingNodeToFuse searches for siblings with one load.
-      assert(sibLoadOpInsts.size() == 1);
-      Operation *sibLoadOpInst = sibLoadOpInsts[0];
-      assert(!sibNode->stores.empty());
-      // TODO(andydavis) Choose the store which postdominates all other stores.
-      auto *sibStoreOpInst = sibNode->stores.back();
+  // Attempts to fuse a slice of the sibling node 'sibId' into node 'dstId',
+  // which both load from 'memref'. Returns true if the slice was fused. 'sibId'
+  // is removed from the graph if it has no remaining users.
+  bool fuseSiblings(unsigned sibId, unsigned dstId, Value *memref) {
+    // TODO(andydavis) Check that 'sibStoreOpInst' post-dominates all other
+    // stores to the same memref in 'sibNode' loop nest.
+    auto *sibNode = mdg->getNode(sibId);
+    auto *dstNode = mdg->getNode(dstId);
+    // Compute an operation list insertion point for the fused loop
+    // nest which preserves dependences.
+    assert(sibNode->op->getBlock() == dstNode->op->getBlock());
+    Operation *insertPointInst =
+        sibNode->op->isBeforeInBlock(dstNode->op)
+            ? mdg->getFusedLoopNestInsertionPoint(sibNode->id, dstNode->id)
+            : mdg->getFusedLoopNestInsertionPoint(dstNode->id, sibNode->id);
+    if (insertPointInst == nullptr)
+      return false;
 
-      // Gather 'dstNode' load ops to 'memref'.
-      SmallVector<Operation *, 2> dstLoadOpInsts;
-      dstNode->getLoadOpsForMemref(memref, &dstLoadOpInsts);
+    // Check if fusion would be profitable and at what depth.
+
+    // Get unique 'sibNode' load op to 'memref'.
+    SmallVector<Operation *, 2> sibLoadOpInsts;
+    sibNode->getLoadOpsForMemref(memref, &sibLoadOpInsts);
+    // Currently findSiblingNodeToFuse searches for siblings with one load.
+    assert(sibLoadOpInsts.size() == 1);
+    Operation *sibLoadOpInst = sibLoadOpInsts[0];
+    assert(!sibNode->stores.empty());
+    // TODO(andydavis) Choose the store which postdominates all other stores.
+    auto *sibStoreOpInst = sibNode->stores.back();
+
+    // Gather 'dstNode' load ops to 'memref'.
+    SmallVector<Operation *, 2> dstLoadOpInsts;
+    dstNode->getLoadOpsForMemref(memref, &dstLoadOpInsts);
+
+    // Gather 'dstNode' store ops to 'memref'.
+    SmallVector<Operation *, 2> dstStoreOpInsts;
+    dstNode->getStoreOpsForMemref(memref, &dstStoreOpInsts);
+
+    unsigned bestDstLoopDepth;
+    mlir::ComputationSliceState sliceState;
+    FusionEstimate estimate;
+
+    // Check if fusion would be profitable.
+    if (!isFusionProfitable(sibLoadOpInst, sibStoreOpInst, dstLoadOpInsts,
+                            dstStoreOpInsts, &sliceState, &bestDstLoopDepth,
+                            maximalFusion, depAnalysis, &estimate))
+      return false;
 
-      // Gather 'dstNode' store ops to 'memref'.
-      SmallVector<Operation *, 2> dstStoreOpInsts;
-      dstNode->getStoreOpsForMemref(memref, &dstStoreOpInsts);
+    // Fuse computation slice of 'sibLoopNest' into 'dstLoopNest'.
+    auto sliceLoopNest = mlir::insertBackwardComputationSlice(
+        sibLoadOpInst, dstLoadOpInsts[0], bestDstLoopDepth, &sliceState);
+    if (sliceLoopNest == nullptr)
+      return false;
 
-      unsigned bestDstLoopDepth;
-      mlir::ComputationSliceState sliceState;
+    depAnalysis.invalidate(dstNode->op);
+    auto dstForInst = cast<AffineForOp>(dstNode->op);
+    // Update operation position of fused loop nest (if needed).
+    if (insertPointInst != dstForInst.getOperation()) {
+      dstForInst.getOperation()->moveBefore(insertPointInst);
+    }
+    ++numFusions;
+    trafficSavedBytes += getTrafficSavedBytes(
+        estimate, /*isInputReuse=*/true, /*privatizesMemRef=*/false,
+        /*removesSrc=*/true);
+    // Update data dependence graph state post fusion.
+    updateStateAfterSiblingFusion(sliceLoopNest, sibNode, dstNode);
+    return true;
+  }
 
-      // Check if fusion would be profitable.
-      if (!isFusionProfitable(sibLoadOpInst, sibStoreOpInst, dstLoadOpInsts,
-                              dstStoreOpInsts, &sliceState, &bestDstLoopDepth,
-                              maximalFusion))
-        continue;
+  // Returns true if 'sibNode' can be fused with 'dstNode' for input reuse on
+  // 'memref'.
+  bool canFuseWithSibNode(Node *sibNode, Node *dstNode, Value *memref) {
+    // Skip if 'outEdge' is not a read-after-write dependence.
+    // TODO(andydavis) Remove restrict to single load op restriction.
+    if (sibNode->getLoadOpCount(memref) != 1)
+      return false;
+    // Skip if there exists a path of dependent edges between
+    // 'sibNode' and 'dstNode'.
+    if (mdg->hasDependencePath(sibNode->id, dstNode->id) ||
+        mdg->hasDependencePath(dstNode->id, sibNode->id))
+      return false;
+    // Skip sib node if it loads to (and stores from) the same memref on
+    // which it also has an input dependence edge.
+    DenseSet<Value *> loadAndStoreMemrefSet;
+    sibNode->getLoadAndStoreMemrefSet(&loadAndStoreMemrefSet);
+    if (llvm::any_of(loadAndStoreMemrefSet, [=](Value *memref) {
+          return mdg->getIncomingMemRefAccesses(sibNode->id, memref) > 0;
+        }))
+      return false;
 
-      // Fuse computation slice of 'sibLoopNest' into 'dstLoopNest'.
-      auto sliceLoopNest = mlir::insertBackwardComputationSlice(
-          sibLoadOpInst, dstLoadOpInsts[0], bestDstLoopDepth, &sliceState);
-      if (sliceLoopNest != nullptr) {
-        auto dstForInst = cast<AffineForOp>(dstNode->op);
-        // Update operation position of fused loop nest (if needed).
-        if (insertPointInst != dstForInst.getOperation()) {
-          dstForInst.getOperation()->moveBefore(insertPointInst);
-        }
-        // Update data dependence graph state post fusion.
-        updateStateAfterSiblingFusion(sliceLoopNest, sibNode, dstNode);
-      }
+    // Check that all stores are to the same memref.
+    DenseSet<Value *> storeMemrefs;
+    for (auto *storeOpInst : sibNode->stores) {
+      storeMemrefs.insert(cast<StoreOp>(storeOpInst).getMemRef());
     }
+    if (storeMemrefs.size() != 1)
+      return false;
+    return true;
   }
 
   // Searches function argument uses and the graph from 'dstNode' looking for a
@@ -1718,37 +1918,6 @@ public:
   bool findSiblingNodeToFuse(Node *dstNode,
                              DenseSet<unsigned> *visitedSibNodeIds,
                              std::pair<unsigned, Value *> *idAndMemrefToFuse) {
-    // Returns true if 'sibNode' can be fused with 'dstNode' for input reuse
-    // on 'memref'.
-    auto canFuseWithSibNode = [&](Node *sibNode, Value *memref) {
-      // Skip if 'outEdge' is not a read-after-write dependence.
-      // TODO(andydavis) Remove restrict to single load op restriction.
-      if (sibNode->getLoadOpCount(memref) != 1)
-        return false;
-      // Skip if there exists a path of dependent edges between
-      // 'sibNode' and 'dstNode'.
-      if (mdg->hasDependencePath(sibNode->id, dstNode->id) ||
-          mdg->hasDependencePath(dstNode->id, sibNode->id))
-        return false;
-      // Skip sib node if it loads to (and stores from) the same memref on
-      // which it also has an input dependence edge.
-      DenseSet<Value *> loadAndStoreMemrefSet;
-      sibNode->getLoadAndStoreMemrefSet(&loadAndStoreMemrefSet);
-      if (llvm::any_of(loadAndStoreMemrefSet, [=](Value *memref) {
-            return mdg->getIncomingMemRefAccesses(sibNode->id, memref) > 0;
-          }))
-        return false;
-
-      // Check that all stores are to the same memref.
-      DenseSet<Value *> storeMemrefs;
-      for (auto *storeOpInst : sibNode->stores) {
-        storeMemrefs.insert(cast<StoreOp>(storeOpInst).getMemRef());
-      }
-      if (storeMemrefs.size() != 1)
-        return false;
-      return true;
-    };
-
     // Search for siblings which load the same memref function argument.
     auto *fn = dstNode->op->getFunction();
     for (unsigned i = 0, e = fn->getNumArguments(); i != e; ++i) {
@@ -1773,7 +1942,7 @@ public:
           if (dstNode->getLoadOpCount(memref) == 0)
             continue;
           // Check if 'sibNode/dstNode' can be input-reuse fused on 'memref'.
-          if (canFuseWithSibNode(sibNode, memref)) {
+          if (canFuseWithSibNode(sibNode, dstNode, memref)) {
             visitedSibNodeIds->insert(sibNode->id);
             idAndMemrefToFuse->first = sibNode->id;
             idAndMemrefToFuse->second = memref;
@@ -1811,7 +1980,7 @@ public:
             if (!isa<AffineForOp>(sibNode->op))
               return;
             // Check if 'sibNode/dstNode' can be input-reuse fused on 'memref'.
-            if (canFuseWithSibNode(sibNode, outEdge.value)) {
+            if (canFuseWithSibNode(sibNode, dstNode, outEdge.value)) {
               // Add candidate 'outEdge' to sibling node.
               outEdges.push_back(outEdge);
             }
@@ -1853,8 +2022,10 @@ public:
     // edges, and it does not write to a memref which escapes the
     // function.
     if (mdg->getOutEdgeCount(sibNode->id) == 0) {
+      Operation *sibOp = sibNode->op;
       mdg->removeNode(sibNode->id);
-      sibNode->op->erase();
+      depAnalysis.invalidate(sibOp);
+      sibOp->erase();
     }
   }
 
@@ -1875,6 +2046,278 @@ public:
   }
 };
 
+// FusionPlanner chooses the fusions to perform in a function as a whole, where
+// GreedyFusion performs the first legal and profitable fusion found from each
+// node in turn:
+// *) The producer-consumer and input-reuse fusion candidates are collected once
+//    from the dependence graph, and the memory traffic that each of them saves
+//    is estimated with the cost model of 'isFusionProfitable'.
+// *) The candidates are visited by decreasing savings. Each one is added to the
+//    plan if its loop nests are not already planned to be fused together, and
+//    if fusing them would not create a cycle in the dependence graph between
+//    the groups of loop nests planned to be fused.
+// *) The plan is performed by 'GreedyFusion::runPlan', which checks each
+//    fusion again when it is performed.
+//
+// Evaluating the sibling candidates takes time quadratic in the number of loop
+// nests of the function.
+struct FusionPlanner {
+  using Node = MemRefDependenceGraph::Node;
+
+  explicit FusionPlanner(GreedyFusion &fusion)
+      : fusion(fusion), mdg(fusion.mdg) {}
+
+  // Returns the fusions to perform, in the order in which to perform them.
+  std::vector<FusionCandidate> plan() {
+    // Sink the sequential loops of the loop nests, as GreedyFusion does before
+    // fusing into them, so that the candidates are evaluated on the loop nests
+    // which are fused.
+    for (auto &idAndNode : mdg->nodes) {
+      Node *node = &idAndNode.second;
+      if (isa<AffineForOp>(node->op))
+        sinkSequentialLoops(node, fusion.depAnalysis);
+      groupOf[node->id] = node->id;
+      groupMembers[node->id].push_back(node->id);
+    }
+
+    std::vector<FusionCandidate> candidates;
+    for (auto &idAndNode : mdg->nodes) {
+      addProducerConsumerCandidates(&idAndNode.second, candidates);
+      addSiblingCandidates(&idAndNode.second, candidates);
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const FusionCandidate &a, const FusionCandidate &b) {
+                if (a.trafficSavedBytes != b.trafficSavedBytes)
+                  return a.trafficSavedBytes > b.trafficSavedBytes;
+                if (a.additionalComputeFraction !=
+                    b.additionalComputeFraction)
+                  return a.additionalComputeFraction <
+                         b.additionalComputeFraction;
+                return std::make_tuple(a.isSibling, a.dstId, a.srcId) <
+                       std::make_tuple(b.isSibling, b.dstId, b.srcId);
+              });
+
+    std::vector<FusionCandidate> producerConsumerPlan, siblingPlan;
+    for (const FusionCandidate &candidate : candidates) {
+      unsigned srcGroup = groupOf[candidate.srcId];
+      unsigned dstGroup = groupOf[candidate.dstId];
+      if (srcGroup == dstGroup ||
+          hasPathThroughOtherGroup(srcGroup, dstGroup) ||
+          hasPathThroughOtherGroup(dstGroup, srcGroup))
+        continue;
+      LLVM_DEBUG(llvm::dbgs() << "Planning fusion of node " << candidate.srcId
+                              << " into node " << candidate.dstId << ", saving "
+                              << candidate.trafficSavedBytes << " bytes\n");
+      if (candidate.isSibling) {
+        siblingPlan.push_back(candidate);
+        mergeGroups(dstGroup, srcGroup);
+        continue;
+      }
+      producerConsumerPlan.push_back(candidate);
+      // A source loop nest which is kept after the fusion can still be fused
+      // into its other consumers.
+      if (candidate.removesSrc)
+        mergeGroups(dstGroup, srcGroup);
+    }
+
+    // Perform the producer-consumer fusions into the last loop nests first, as
+    // GreedyFusion does, so that a loop nest has received the slices of its
+    // producers before it is itself fused into its consumers. The ids of the
+    // fused nodes are then resolved by 'runPlan'.
+    std::stable_sort(producerConsumerPlan.begin(), producerConsumerPlan.end(),
+                     [](const FusionCandidate &a, const FusionCandidate &b) {
+                       return std::make_tuple(a.dstId, a.srcId) >
+                              std::make_tuple(b.dstId, b.srcId);
+                     });
+    producerConsumerPlan.insert(producerConsumerPlan.end(), siblingPlan.begin(),
+                                siblingPlan.end());
+    return producerConsumerPlan;
+  }
+
+private:
+  // Adds the candidates for fusing the loop nest of 'srcNode' into each loop
+  // nest which loads the memref it stores to.
+  void addProducerConsumerCandidates(Node *srcNode,
+                                     std::vector<FusionCandidate> &candidates) {
+    // TODO(andydavis) Support fusing multi-output src loop nests.
+    if (!isa<AffineForOp>(srcNode->op) || srcNode->stores.size() != 1)
+      return;
+    unsigned srcId = srcNode->id;
+    if (mdg->outEdges.count(srcId) == 0)
+      return;
+    auto *srcStoreOpInst = srcNode->stores.front();
+    Value *memref = cast<StoreOp>(srcStoreOpInst).getMemRef();
+    bool writesToLiveInOrOut = mdg->writesToLiveInOrEscapingMemrefs(srcId);
+    // The fusion removes 'srcNode' if 'memref' is private to the function
+    // and the destination is its only consumer, or if 'srcNode' writes to a
+    // live-in or escaping memref, which is only fused in that case.
+    bool removesSrc =
+        writesToLiveInOrOut || mdg->getOutEdgeCount(srcId, memref) == 1;
+
+    SmallVector<MemRefDependenceGraph::Edge, 2> outEdges =
+        mdg->outEdges[srcId];
+    for (auto &outEdge : outEdges) {
+      if (outEdge.value != memref)
+        continue;
+      unsigned dstId = outEdge.id;
+      auto *dstNode = mdg->getNode(dstId);
+      if (!isa<AffineForOp>(dstNode->op))
+        continue;
+      SmallVector<Operation *, 4> dstLoadOpInsts;
+      dstNode->getLoadOpsForMemref(memref, &dstLoadOpInsts);
+      if (dstLoadOpInsts.empty())
+        continue;
+      if (writesToLiveInOrOut &&
+          !canFuseSrcWhichWritesToLiveOut(srcId, dstId, memref, mdg))
+        continue;
+      if (mdg->getFusedLoopNestInsertionPoint(srcId, dstId) == nullptr)
+        continue;
+
+      SmallVector<Operation *, 2> dstStoreOpInsts;
+      dstNode->getStoreOpsForMemref(memref, &dstStoreOpInsts);
+      unsigned bestDstLoopDepth;
+      mlir::ComputationSliceState sliceState;
+      FusionEstimate estimate;
+      if (!isFusionProfitable(srcStoreOpInst, srcStoreOpInst, dstLoadOpInsts,
+                              dstStoreOpInsts, &sliceState, &bestDstLoopDepth,
+                              fusion.maximalFusion, fusion.depAnalysis,
+                              &estimate))
+        continue;
+      int64_t savedBytes =
+          getTrafficSavedBytes(estimate, /*isInputReuse=*/false,
+                               /*privatizesMemRef=*/!writesToLiveInOrOut,
+                               removesSrc);
+      if (savedBytes <= 0)
+        continue;
+      candidates.push_back({srcId, dstId, memref, /*isSibling=*/false,
+                            removesSrc, savedBytes,
+                            estimate.additionalComputeFraction});
+    }
+  }
+
+  // Adds the candidates for fusing each loop nest which precedes 'dstNode'
+  // and loads a memref that 'dstNode' also loads into 'dstNode'. Only the most
+  // profitable memref is kept for each pair of loop nests.
+  void addSiblingCandidates(Node *dstNode,
+                            std::vector<FusionCandidate> &candidates) {
+    if (!isa<AffineForOp>(dstNode->op))
+      return;
+    for (auto &idAndNode : mdg->nodes) {
+      Node *sibNode = &idAndNode.second;
+      if (sibNode->id >= dstNode->id || !isa<AffineForOp>(sibNode->op) ||
+          sibNode->stores.empty())
+        continue;
+      if (mdg->getFusedLoopNestInsertionPoint(sibNode->id, dstNode->id) ==
+          nullptr)
+        continue;
+
+      Optional<FusionCandidate> best;
+      for (auto *sibLoadOpInst : sibNode->loads) {
+        Value *memref = cast<LoadOp>(sibLoadOpInst).getMemRef();
+        if (dstNode->getLoadOpCount(memref) == 0 ||
+            !isSiblingMemRef(sibNode, dstNode, memref) ||
+            !fusion.canFuseWithSibNode(sibNode, dstNode, memref))
+          continue;
+
+        SmallVector<Operation *, 2> dstLoadOpInsts;
+        dstNode->getLoadOpsForMemref(memref, &dstLoadOpInsts);
+        SmallVector<Operation *, 2> dstStoreOpInsts;
+        dstNode->getStoreOpsForMemref(memref, &dstStoreOpInsts);
+        unsigned bestDstLoopDepth;
+        mlir::ComputationSliceState sliceState;
+        FusionEstimate estimate;
+        // TODO(andydavis) Choose the store which postdominates all other
+        // stores.
+        if (!isFusionProfitable(sibLoadOpInst, sibNode->stores.back(),
+                                dstLoadOpInsts, dstStoreOpInsts, &sliceState,
+                                &bestDstLoopDepth, fusion.maximalFusion,
+                                fusion.depAnalysis, &estimate))
+          continue;
+        // The sibling node is always removed, as all its edges are moved to
+        // 'dstNode'.
+        int64_t savedBytes = getTrafficSavedBytes(
+            estimate, /*isInputReuse=*/true, /*privatizesMemRef=*/false,
+            /*removesSrc=*/true);
+        if (savedBytes <= 0 ||
+            (best.hasValue() && savedBytes <= best->trafficSavedBytes))
+          continue;
+        best = FusionCandidate{sibNode->id,
+                               dstNode->id,
+                               memref,
+                               /*isSibling=*/true,
+                               /*removesSrc=*/true,
+                               savedBytes,
+                               estimate.additionalComputeFraction};
+      }
+      if (best.hasValue())
+        candidates.push_back(best.getValue());
+    }
+  }
+
+  // Returns true if 'memref' is loaded by 'sibNode' and 'dstNode' as siblings,
+  // i.e. if it is a function argument or if it is written by a node which both
+  // loop nests depend on, as searched for by GreedyFusion.
+  bool isSiblingMemRef(Node *sibNode, Node *dstNode, Value *memref) {
+    if (!memref->getDefiningOp())
+      return true;
+    if (mdg->inEdges.count(dstNode->id) == 0)
+      return false;
+    for (auto &inEdge : mdg->inEdges[dstNode->id]) {
+      if (inEdge.value == memref &&
+          mdg->getNode(inEdge.id)->getStoreOpCount(memref) > 0 &&
+          mdg->hasEdge(inEdge.id, sibNode->id, memref))
+        return true;
+    }
+    return false;
+  }
+
+  // Returns true if there is a path in the dependence graph from a node of
+  // 'srcGroup' to a node of 'dstGroup' which goes through a node of another
+  // group. Fusing 'srcGroup' and 'dstGroup' would then create a cycle
+  // between the groups.
+  bool hasPathThroughOtherGroup(unsigned srcGroup, unsigned dstGroup) {
+    SmallVector<unsigned, 8> worklist;
+    DenseSet<unsigned> visitedGroups;
+    worklist.push_back(srcGroup);
+    visitedGroups.insert(srcGroup);
+    while (!worklist.empty()) {
+      unsigned group = worklist.pop_back_val();
+      for (unsigned id : groupMembers[group]) {
+        if (mdg->outEdges.count(id) == 0)
+          continue;
+        for (auto &outEdge : mdg->outEdges[id]) {
+          unsigned succGroup = groupOf[outEdge.id];
+          if (succGroup == dstGroup) {
+            if (group != srcGroup)
+              return true;
+            continue;
+          }
+          if (visitedGroups.insert(succGroup).second)
+            worklist.push_back(succGroup);
+        }
+      }
+    }
+    return false;
+  }
+
+  // Moves the nodes of 'otherGroup' to 'group'.
+  void mergeGroups(unsigned group, unsigned otherGroup) {
+    SmallVector<unsigned, 4> otherMembers = std::move(groupMembers[otherGroup]);
+    groupMembers.erase(otherGroup);
+    for (unsigned id : otherMembers)
+      groupOf[id] = group;
+    auto &members = groupMembers[group];
+    members.append(otherMembers.begin(), otherMembers.end());
+  }
+
+  GreedyFusion &fusion;
+  MemRefDependenceGraph *mdg;
+  // The group of loop nests which each node is planned to be fused in, and
+  // the nodes of each group. A group is identified by one of its nodes.
+  DenseMap<unsigned, unsigned> groupOf;
+  DenseMap<unsigned, SmallVector<unsigned, 4>> groupMembers;
+};
+
 } // end anonymous namespace
 
 void LoopFusion::runOnFunction() {
@@ -1892,9 +2335,19 @@ void LoopFusion::runOnFunction() {
     maximalFusion = clMaximalLoopFusion;
 
   MemRefDependenceGraph g;
-  if (g.init(getFunction()))
-    GreedyFusion(&g, localBufSizeThreshold, fastMemorySpace, maximalFusion)
-        .run();
+  if (!g.init(getFunction()))
+    return;
+  GreedyFusion fusion(&g, localBufSizeThreshold, fastMemorySpace,
+                      maximalFusion, getAnalysis<MemRefDependenceAnalysis>());
+  if (clFusionGlobalPlanner)
+    fusion.runPlan(FusionPlanner(fusion).plan());
+  else
+    fusion.run();
+
+  if (clFusionReport)
+    getFunction().emitRemark("fused ")
+        << fusion.numFusions << " loop nest pair(s), saving an estimated "
+        << fusion.trafficSavedBytes << " bytes of memory traffic";
 }
 
 static PassRegistration<LoopFusion> pass("affine-loop-fusion",
@@ -26,9 +26,12 @@
 #include "mlir/Analysis/Utils.h"
 #include "mlir/IR/Builders.h"
 #include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
 #include "mlir/Transforms/LoopUtils.h"
 #include "mlir/Transforms/Passes.h"
+#include "mlir/Transforms/TuningDatabase.h"
 #include "mlir/Transforms/Utils.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 using namespace mlir;
@@ -42,6 +45,20 @@ static llvm::cl::opt<unsigned long long>
                    llvm::cl::desc("Set size of cache to tile for in KiB"),
                    llvm::cl::cat(clOptionsCategory));
 
+// Sizes of the levels of the cache hierarchy, in any order. Loop nests are
+// tiled once for each level, from the smallest level outwards.
+static llvm::cl::list<unsigned long long> clCacheSizesKiB(
+    "tile-cache-sizes",
+    llvm::cl::desc("List of cache sizes in KiB to tile for at each level "
+                   "(overrides -tile-cache-size)"),
+    llvm::cl::CommaSeparated, llvm::cl::ZeroOrMore,
+    llvm::cl::cat(clOptionsCategory));
+
+static llvm::cl::opt<unsigned> clCacheLineSize(
+    "tile-cache-line-size",
+    llvm::cl::desc("Set size of a cache line in bytes for the tile size model"),
+    llvm::cl::cat(clOptionsCategory));
+
 // Tile size to use for all loops (overrides -tile-sizes if provided).
 static llvm::cl::opt<unsigned>
     clTileSize("tile-size", llvm::cl::desc("Use this tile size for all loops"),
@@ -65,14 +82,22 @@ struct LoopTiling : public FunctionPass<LoopTiling> {
 
   void runOnFunction() override;
   void getTileSizes(ArrayRef<AffineForOp> band,
-                    SmallVectorImpl<unsigned> *tileSizes);
+                    SmallVectorImpl<SmallVector<unsigned, 6>> *tileSizes);
 
   // Default tile size if nothing is provided.
   constexpr static unsigned kDefaultTileSize = 4;
   constexpr static uint64_t kDefaultCacheMemCapacity = 512 * 1024UL;
+  constexpr static unsigned kDefaultCacheLineSize = 64;
+  // Largest tile size picked by the model for a loop.
+  constexpr static unsigned kMaxTileSize = 1024;
 
   // Capacity of the cache to tile for.
   uint64_t cacheSizeBytes;
+  // Capacities of the levels of the cache hierarchy to tile for, by increasing
+  // capacity.
+  SmallVector<uint64_t, 3> cacheLevelSizesBytes;
+  // Size of a cache line.
+  unsigned cacheLineSizeBytes = kDefaultCacheLineSize;
   // If true, tile sizes are set to avoid max/min in bounds if possible.
   bool avoidMaxMinBounds;
 };
@@ -183,7 +208,8 @@ constructTiledIndexSetHyperRect(MutableArrayRef<AffineForOp> origLoops,
 /// and intra-tile loops. A band is a contiguous set of loops.
 //  TODO(bondhugula): handle non hyper-rectangular spaces.
 LogicalResult mlir::tileCodeGen(MutableArrayRef<AffineForOp> band,
-                                ArrayRef<unsigned> tileSizes) {
+                                ArrayRef<unsigned> tileSizes,
+                                SmallVectorImpl<AffineForOp> *tiledNest) {
   assert(!band.empty());
   assert(band.size() == tileSizes.size() && "Incorrect number of tile sizes");
 
@@ -255,6 +281,8 @@ LogicalResult mlir::tileCodeGen(MutableArrayRef<AffineForOp> band,
   // Erase the old loop nest.
   rootAffineForOp.erase();
 
+  if (tiledNest)
+    tiledNest->assign(newLoops.begin(), newLoops.end());
   return success();
 }
 
@@ -279,17 +307,17 @@ static void getTileableBands(Function &f,
 
 // Reduce each tile size to the largest divisor of the corresponding trip count
 // (if the trip count is known).
-static void adjustToDivisorsOfTripCounts(ArrayRef<AffineForOp> band,
-                                         SmallVectorImpl<unsigned> *tileSizes) {
-  assert(band.size() == tileSizes->size() && "invalid tile size count");
-  for (unsigned i = 0, e = band.size(); i < e; i++) {
+static void
+adjustToDivisorsOfTripCounts(ArrayRef<Optional<uint64_t>> tripCounts,
+                             SmallVectorImpl<unsigned> *tileSizes) {
+  assert(tripCounts.size() == tileSizes->size() && "invalid tile size count");
+  for (unsigned i = 0, e = tripCounts.size(); i < e; i++) {
     unsigned &tSizeAdjusted = (*tileSizes)[i];
-    auto mayConst = getConstantTripCount(band[i]);
-    if (!mayConst.hasValue())
+    if (!tripCounts[i].hasValue())
       continue;
     // Adjust the tile size to largest factor of the trip count less than
     // tSize.
-    uint64_t constTripCount = mayConst.getValue();
+    uint64_t constTripCount = tripCounts[i].getValue();
     if (constTripCount > 1 && tSizeAdjusted > constTripCount / 2)
       tSizeAdjusted = constTripCount / 2;
     while (constTripCount % tSizeAdjusted != 0)
@@ -297,92 +325,316 @@ static void adjustToDivisorsOfTripCounts(ArrayRef<AffineForOp> band,
   }
 }
 
-// Returns tile sizes to use. Checks CL options; if none are specified, sets it
-// based on a simple model that looks at the memory footprint and determines
-// tile sizes assuming identity accesses / 1:1 tile size proportional footprint
-// along each of the dimensions being tiled.
-// TODO(mlir-team): evolve this model. Tile size determination is a large area
-// to play with in general.
-void LoopTiling::getTileSizes(ArrayRef<AffineForOp> band,
-                              SmallVectorImpl<unsigned> *tileSizes) {
+namespace {
+
+/// Models the amount of data accessed by a tile of a band of loops, i.e., by
+/// one iteration of the tile-space loops, as a function of the tile sizes.
+/// Each access is assumed to touch all the cache lines of the bounding box of
+/// the elements it accesses in a tile, and the accesses to the same memref are
+/// assumed to overlap.
+class TileFootprintModel {
+public:
+  /// Builds the model of the loads and stores nested in 'band'. Returns
+  /// failure if one of them cannot be modeled.
+  LogicalResult build(ArrayRef<AffineForOp> band, unsigned lineSizeBytes);
+
+  /// Returns the footprint in bytes of a tile of sizes 'tileSizes'.
+  uint64_t getFootprint(ArrayRef<unsigned> tileSizes) const;
+
+private:
+  struct Access {
+    /// The absolute value of the coefficient of each loop IV of the band in
+    /// each memref dimension, with a row per memref dimension.
+    SmallVector<uint64_t, 8> coefficients;
+    /// The size of the region accessed by the whole band if it is known,
+    /// which bounds the footprint of a tile.
+    Optional<int64_t> regionSize;
+  };
+
+  struct MemRefAccesses {
+    unsigned rank;
+    unsigned eltSizeInBytes;
+    SmallVector<Access, 2> accesses;
+  };
+
+  unsigned bandWidth = 0;
+  unsigned lineSizeBytes = 1;
+  llvm::MapVector<Value *, MemRefAccesses> memrefs;
+};
+
+} // end anonymous namespace
+
+LogicalResult TileFootprintModel::build(ArrayRef<AffineForOp> band,
+                                        unsigned lineSizeBytes) {
+  this->bandWidth = band.size();
+  this->lineSizeBytes = std::max(lineSizeBytes, 1U);
+  SmallVector<Value *, 6> ivs;
+  extractForInductionVars(band, &ivs);
+  unsigned bandDepth = getNestingDepth(*band[0].getOperation());
+
+  bool modeled = true;
+  band[0].getOperation()->walk([&](Operation *op) {
+    if (!modeled || (!isa<LoadOp>(op) && !isa<StoreOp>(op)))
+      return;
+    MemRefAccess access(op);
+    auto memRefType = access.memref->getType().cast<MemRefType>();
+    auto elementType = memRefType.getElementType();
+    if (!elementType.isIntOrFloat() && !elementType.isa<VectorType>()) {
+      modeled = false;
+      return;
+    }
+    AffineValueMap accessMap;
+    access.getAccessMap(&accessMap);
+    std::vector<SmallVector<int64_t, 8>> flatExprs;
+    if (!getFlattenedAffineExprs(accessMap.getAffineMap(), &flatExprs)) {
+      modeled = false;
+      return;
+    }
+
+    // The flattened expressions hold the coefficients of the dimensions, then
+    // of the symbols and of the local identifiers introduced for mod and div
+    // expressions, and finally the constant.
+    unsigned rank = memRefType.getRank();
+    unsigned numDims = accessMap.getNumDims();
+    unsigned numSymbols = accessMap.getNumSymbols();
+    Access tileAccess;
+    tileAccess.coefficients.resize(rank * bandWidth);
+    for (unsigned d = 0; d < rank; ++d) {
+      ArrayRef<int64_t> flatExpr = flatExprs[d];
+      // Expressions with mods and divs are assumed to vary by at least one
+      // element per iteration of each loop they depend on.
+      bool hasLocals = llvm::any_of(
+          flatExpr.slice(numDims + numSymbols,
+                         flatExpr.size() - numDims - numSymbols - 1),
+          [](int64_t coeff) { return coeff != 0; });
+      for (unsigned j = 0; j < numDims; ++j) {
+        auto it = llvm::find(ivs, accessMap.getOperand(j));
+        if (it == ivs.end())
+          continue;
+        uint64_t &coeff =
+            tileAccess.coefficients[d * bandWidth + (it - ivs.begin())];
+        coeff += std::abs(flatExpr[j]);
+        if (hasLocals)
+          coeff = std::max<uint64_t>(coeff, 1);
+      }
+    }
+
+    MemRefRegion region(op->getLoc());
+    if (succeeded(region.compute(op, bandDepth)))
+      tileAccess.regionSize = region.getRegionSize();
+
+    auto &memrefAccesses = memrefs[access.memref];
+    memrefAccesses.rank = rank;
+    memrefAccesses.eltSizeInBytes = getMemRefEltSizeInBytes(memRefType);
+    memrefAccesses.accesses.push_back(std::move(tileAccess));
+  });
+  return success(modeled);
+}
+
+uint64_t TileFootprintModel::getFootprint(ArrayRef<unsigned> tileSizes) const {
+  assert(tileSizes.size() == bandWidth && "invalid tile size count");
+  uint64_t footprint = 0;
+  for (auto &memrefAndAccesses : memrefs) {
+    const MemRefAccesses &info = memrefAndAccesses.second;
+    uint64_t memrefFootprint = 0;
+    for (const Access &access : info.accesses) {
+      // Along the fastest varying dimension, the elements are contiguous and
+      // the footprint is a number of cache lines. Each combination of the
+      // indices along the other dimensions starts a new row of lines.
+      uint64_t numRows = 1, rowSizeBytes = info.eltSizeInBytes;
+      for (unsigned d = 0; d < info.rank; ++d) {
+        uint64_t extent = 1;
+        for (unsigned i = 0; i < bandWidth; ++i)
+          extent += access.coefficients[d * bandWidth + i] * (tileSizes[i] - 1);
+        if (d == info.rank - 1)
+          rowSizeBytes *= extent;
+        else
+          numRows *= extent;
+      }
+      uint64_t accessFootprint =
+          numRows * llvm::alignTo(rowSizeBytes, lineSizeBytes);
+      if (access.regionSize.hasValue())
+        accessFootprint = std::min<uint64_t>(accessFootprint,
+                                             access.regionSize.getValue());
+      memrefFootprint = std::max(memrefFootprint, accessFootprint);
+    }
+    footprint += memrefFootprint;
+  }
+  return footprint;
+}
+
+// Grows 'tileSizes' by repeatedly doubling the tile size of the loop that
+// increases the footprint of a tile the least, for as long as the footprint
+// fits in 'capacity'. Ties are broken in favor of the innermost loop. Tile
+// sizes are not grown beyond the trip counts when they are known, or beyond
+// 'maxTileSize'.
+static void growTileSizes(const TileFootprintModel &model,
+                          ArrayRef<Optional<uint64_t>> tripCounts,
+                          uint64_t capacity, unsigned maxTileSize,
+                          SmallVectorImpl<unsigned> *tileSizes) {
+  SmallVector<unsigned, 6> candidate(tileSizes->begin(), tileSizes->end());
+  while (true) {
+    Optional<unsigned> bestLoop;
+    unsigned bestTileSize = 0;
+    uint64_t bestFootprint = 0;
+    for (int i = candidate.size() - 1; i >= 0; --i) {
+      uint64_t limit = maxTileSize;
+      if (tripCounts[i].hasValue())
+        limit = std::min(limit, tripCounts[i].getValue());
+      unsigned tileSize = candidate[i];
+      if (tileSize >= limit)
+        continue;
+      candidate[i] = std::min<uint64_t>(2 * tileSize, limit);
+      uint64_t footprint = model.getFootprint(candidate);
+      if (footprint <= capacity &&
+          (!bestLoop.hasValue() || footprint < bestFootprint)) {
+        bestLoop = static_cast<unsigned>(i);
+        bestTileSize = candidate[i];
+        bestFootprint = footprint;
+      }
+      candidate[i] = tileSize;
+    }
+    if (!bestLoop.hasValue())
+      break;
+    candidate[bestLoop.getValue()] = bestTileSize;
+  }
+  tileSizes->assign(candidate.begin(), candidate.end());
+}
+
+// Returns tile sizes to use for each level of tiling, from the outermost level
+// inwards. Checks CL options and then the tuning database; if neither provides
+// tile sizes, uses a model of the footprint of a tile in each level of the
+// cache hierarchy. From the innermost level outwards, the tile sizes of the
+// previous level are grown for as long as a tile fits in the level. The
+// footprint is counted in cache lines, which favors growing the loops along
+// which the accesses are contiguous, and the loops with reuse, along which some
+// accesses are invariant, so that the tile sizes are in general not uniform.
+void LoopTiling::getTileSizes(
+    ArrayRef<AffineForOp> band,
+    SmallVectorImpl<SmallVector<unsigned, 6>> *tileSizes) {
   if (band.empty())
     return;
 
-  tileSizes->resize(band.size());
+  SmallVector<unsigned, 6> uniformTileSizes(band.size());
 
   // Use clTileSize for all loops if specified.
   if (clTileSize.getNumOccurrences() > 0) {
-    std::fill(tileSizes->begin(), tileSizes->end(), clTileSize);
+    std::fill(uniformTileSizes.begin(), uniformTileSizes.end(), clTileSize);
+    tileSizes->push_back(uniformTileSizes);
     return;
   }
 
   // Use clTileSizes and fill them with default tile size if it's short.
   if (!clTileSizes.empty()) {
-    std::fill(tileSizes->begin(), tileSizes->end(),
+    std::fill(uniformTileSizes.begin(), uniformTileSizes.end(),
               LoopTiling::kDefaultTileSize);
     std::copy(clTileSizes.begin(),
               clTileSizes.begin() + std::min(clTileSizes.size(), band.size()),
-              tileSizes->begin());
+              uniformTileSizes.begin());
+    tileSizes->push_back(uniformTileSizes);
     return;
   }
 
   // The first loop in the band.
   auto rootForOp = band[0];
-  (void)rootForOp;
-
-  // Obtain memory footprint and set tile sizes so that a tile fits in
-  // the cache size. This is an approximation with the assumption that the
-  // footprint increases with the tile size linearly in that dimension (i.e.,
-  // assumes one-to-one access function).
-  auto fp = getMemoryFootprintBytes(band[0], 0);
-  if (!fp.hasValue()) {
+
+  // Use the tile sizes tuned for the band if there are any. No tile sizes mean
+  // that the band is best left untiled.
+  if (auto *database = getCommandLineTuningDatabase()) {
+    auto *record = database->lookup(TuningParameterKind::TileSizes,
+                                    hashLoopNest(rootForOp));
+    if (record && record->parameters.empty())
+      return;
+    if (record && record->parameters.size() == band.size()) {
+      tileSizes->push_back(record->parameters);
+      return;
+    }
+  }
+
+  SmallVector<Optional<uint64_t>, 6> tripCounts;
+  for (auto forOp : band)
+    tripCounts.push_back(getConstantTripCount(forOp));
+
+  TileFootprintModel model;
+  if (failed(model.build(band, cacheLineSizeBytes))) {
     // Fill with default tile sizes if footprint is unknown.
-    std::fill(tileSizes->begin(), tileSizes->end(),
+    std::fill(uniformTileSizes.begin(), uniformTileSizes.end(),
               LoopTiling::kDefaultTileSize);
     if (avoidMaxMinBounds)
-      adjustToDivisorsOfTripCounts(band, tileSizes);
+      adjustToDivisorsOfTripCounts(tripCounts, &uniformTileSizes);
+    tileSizes->push_back(uniformTileSizes);
     LLVM_DEBUG(
         rootForOp.emitWarning("memory footprint unknown: using default tile "
                               "sizes adjusted to trip count divisors"));
     return;
   }
 
-  // Check how many times larger the cache size is when compared to footprint.
-  uint64_t excessFactor = llvm::divideCeil(fp.getValue(), cacheSizeBytes);
-  if (excessFactor <= 1) {
+  // Levels of the cache that hold all the data accessed by the band need no
+  // tiling.
+  bool allTripCountsKnown = llvm::all_of(
+      tripCounts, [](Optional<uint64_t> count) { return count.hasValue(); });
+  Optional<uint64_t> bandFootprint;
+  if (allTripCountsKnown) {
+    SmallVector<unsigned, 6> bandSizes;
+    for (auto count : tripCounts)
+      bandSizes.push_back(static_cast<unsigned>(std::max<uint64_t>(
+          std::min<uint64_t>(count.getValue(),
+                             std::numeric_limits<unsigned>::max()),
+          1)));
+    bandFootprint = model.getFootprint(bandSizes);
+  }
+
+  SmallVector<unsigned, 6> levelTileSizes(band.size(), 1);
+  for (uint64_t capacity : cacheLevelSizesBytes) {
+    if (bandFootprint.hasValue() && bandFootprint.getValue() <= capacity)
+      break;
+    growTileSizes(model, tripCounts, capacity, kMaxTileSize, &levelTileSizes);
+    // Skip the levels that would not change the tile sizes.
+    bool isUnitTile = llvm::all_of(levelTileSizes,
+                                   [](unsigned tSize) { return tSize == 1; });
+    if (isUnitTile ||
+        (!tileSizes->empty() && tileSizes->back() == levelTileSizes))
+      continue;
+    tileSizes->push_back(levelTileSizes);
+  }
+
+  if (tileSizes->empty()) {
     // No need of any tiling - set tile size to 1.
-    std::fill(tileSizes->begin(), tileSizes->end(), 1);
+    std::fill(uniformTileSizes.begin(), uniformTileSizes.end(), 1);
+    tileSizes->push_back(uniformTileSizes);
     return;
   }
+  std::reverse(tileSizes->begin(), tileSizes->end());
 
-  // Divide all loops equally in an attempt to reduce footprint.
-  // TODO(bondhugula): this is approximate. Ideally, obtain reuse factor /
-  // profitability along each dimension and weight tile sizes based on that as
-  // one possible approach. Or compute a polynomial in tile sizes and solve for
-  // it.
-
-  // For an n-d tilable band, compute n^th root of the excess.
-  unsigned tSize =
-      static_cast<unsigned>(floorl(std::pow(excessFactor, 1.0 / band.size())));
-  // We'll keep a running product to determine the last tile size better.
-  unsigned cumulProductOfTileSizes = 1;
-  for (unsigned i = 0, e = band.size(); i < e; i++) {
-    if (i < e - 1)
-      (*tileSizes)[i] = tSize;
-    else
-      // Set last tile size to cover the balance.
-      (*tileSizes)[i] = std::max(
-          1U, static_cast<unsigned>(excessFactor / cumulProductOfTileSizes));
-    cumulProductOfTileSizes *= (*tileSizes)[i];
+  if (!avoidMaxMinBounds)
+    return;
+  // The intra-tile loops of each level have the tile sizes of the level
+  // around it as trip counts.
+  adjustToDivisorsOfTripCounts(tripCounts, &tileSizes->front());
+  for (unsigned i = 1, e = tileSizes->size(); i < e; ++i) {
+    SmallVector<Optional<uint64_t>, 6> intraTileTripCounts(
+        (*tileSizes)[i - 1].begin(), (*tileSizes)[i - 1].end());
+    adjustToDivisorsOfTripCounts(intraTileTripCounts, &(*tileSizes)[i]);
   }
-  if (avoidMaxMinBounds)
-    adjustToDivisorsOfTripCounts(band, tileSizes);
 }
 
 void LoopTiling::runOnFunction() {
   // Override cache size if provided on command line.
   if (clCacheSizeKiB.getNumOccurrences() > 0)
     cacheSizeBytes = clCacheSizeKiB * 1024;
+  if (clCacheLineSize.getNumOccurrences() > 0)
+    cacheLineSizeBytes = clCacheLineSize;
+
+  // Tile for a single cache of size 'cacheSizeBytes' unless a hierarchy was
+  // provided.
+  cacheLevelSizesBytes.clear();
+  for (auto sizeKiB : clCacheSizesKiB)
+    cacheLevelSizesBytes.push_back(sizeKiB * 1024);
+  if (cacheLevelSizesBytes.empty())
+    cacheLevelSizesBytes.push_back(cacheSizeBytes);
+  // The tile sizes of a level are grown from those of the smaller level inside
+  // it, so the levels are visited by increasing capacity.
+  llvm::sort(cacheLevelSizesBytes);
 
   // Bands of loops to tile.
   std::vector<SmallVector<AffineForOp, 6>> bands;
@@ -391,20 +643,30 @@ void LoopTiling::runOnFunction() {
   for (auto &band : bands) {
     // Set up tile sizes; fill missing tile sizes at the end with default tile
     // size or clTileSize if one was provided.
-    SmallVector<unsigned, 6> tileSizes;
+    SmallVector<SmallVector<unsigned, 6>, 2> tileSizes;
     getTileSizes(band, &tileSizes);
-    if (llvm::DebugFlag) {
-      auto diag = band[0].emitRemark("using tile sizes [");
-      for (auto tSize : tileSizes)
-        diag << tSize << " ";
-      diag << "]\n";
+
+    // Tile the band once per level, from the outermost level inwards: the
+    // intra-tile loops of a level form the band tiled at the next one.
+    SmallVector<AffineForOp, 6> levelBand(band.begin(), band.end());
+    for (auto &levelTileSizes : tileSizes) {
+      if (llvm::DebugFlag) {
+        auto diag = levelBand[0].emitRemark("using tile sizes [");
+        for (auto tSize : levelTileSizes)
+          diag << tSize << " ";
+        diag << "]\n";
+      }
+      SmallVector<AffineForOp, 12> tiledNest;
+      if (failed(tileCodeGen(levelBand, levelTileSizes, &tiledNest)))
+        return signalPassFailure();
+      levelBand.assign(tiledNest.begin() + band.size(), tiledNest.end());
     }
-    if (failed(tileCodeGen(band, tileSizes)))
-      return signalPassFailure();
   }
 }
 
 constexpr unsigned LoopTiling::kDefaultTileSize;
 constexpr uint64_t LoopTiling::kDefaultCacheMemCapacity;
+constexpr unsigned LoopTiling::kDefaultCacheLineSize;
+constexpr unsigned LoopTiling::kMaxTileSize;
 
 static PassRegistration<LoopTiling> pass("affine-loop-tile", "Tile loop nests");
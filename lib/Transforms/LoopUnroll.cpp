@@ -28,6 +28,7 @@
 #include "mlir/IR/Builders.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/LoopUtils.h"
+#include "mlir/Transforms/TuningDatabase.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
@@ -175,6 +176,13 @@ LogicalResult LoopUnroll::runOnAffineForOp(AffineForOp forOp) {
   if (clUnrollFull.getNumOccurrences() > 0 ||
       (unrollFull.hasValue() && unrollFull.getValue()))
     return loopUnrollFull(forOp);
+  // Unroll by the factor tuned for this loop if there is one.
+  if (auto *database = getCommandLineTuningDatabase()) {
+    auto *record = database->lookup(TuningParameterKind::UnrollFactor,
+                                    hashLoopNest(forOp));
+    if (record && record->parameters.size() == 1)
+      return loopUnrollByFactor(forOp, record->parameters[0]);
+  }
 
   // Unroll by four otherwise.
   return loopUnrollByFactor(forOp, kDefaultUnrollFactor);
@@ -51,6 +51,7 @@
 #include "mlir/IR/Builders.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/LoopUtils.h"
+#include "mlir/Transforms/TuningDatabase.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/CommandLine.h"
 
@@ -105,6 +106,13 @@ LogicalResult LoopUnrollAndJam::runOnAffineForOp(AffineForOp forOp) {
   // Otherwise, unroll jam by the command-line factor if one was specified.
   if (clUnrollJamFactor.getNumOccurrences() > 0)
     return loopUnrollJamByFactor(forOp, clUnrollJamFactor);
+  // Otherwise, unroll jam by the factor tuned for this loop if there is one.
+  if (auto *database = getCommandLineTuningDatabase()) {
+    auto *record = database->lookup(TuningParameterKind::UnrollJamFactor,
+                                    hashLoopNest(forOp));
+    if (record && record->parameters.size() == 1)
+      return loopUnrollJamByFactor(forOp, record->parameters[0]);
+  }
 
   // Unroll and jam by four otherwise.
   return loopUnrollJamByFactor(forOp, kDefaultUnrollJamFactor);
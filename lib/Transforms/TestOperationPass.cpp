@@ -0,0 +1,46 @@
+//===- TestOperationPass.cpp - Test operation pass pipelines --------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a test pass that is run over the operations within a
+// function whose regions are isolated from above.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/IR/Operation.h"
+#include "mlir/Pass/Pass.h"
+
+using namespace mlir;
+
+namespace {
+/// A test operation pass that emits a remark on each operation that it is run
+/// on, describing the number of operations nested within it.
+struct TestOperationPass : public OperationPass<TestOperationPass> {
+  void runOnOperation() override {
+    Operation &op = getOperation();
+    unsigned numNestedOps = 0;
+    for (auto &region : op.getRegions())
+      region.walk([&](Operation *) { ++numNestedOps; });
+    op.emitRemark() << "isolated operation with " << numNestedOps
+                    << " nested operations";
+    markAllAnalysesPreserved();
+  }
+};
+} // end anonymous namespace
+
+static PassRegistration<TestOperationPass>
+    pass("test-operation-pass",
+         "Test an operation pass run over isolated operations");
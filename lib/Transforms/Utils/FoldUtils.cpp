@@ -23,6 +23,7 @@
 #include "mlir/Transforms/FoldUtils.h"
 
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
 #include "mlir/IR/Matchers.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/StandardOps/Ops.h"
@@ -33,11 +34,16 @@ using namespace mlir;
 // OperationFolder
 //===----------------------------------------------------------------------===//
 
+OperationFolder::OperationFolder(Function *f) : region(&f->getBody()) {}
+
 LogicalResult
 OperationFolder::tryToFold(Operation *op,
-                           std::function<void(Operation *)> preReplaceAction) {
-  assert(op->getFunction() == function &&
-         "cannot constant fold op from another function");
+                           std::function<void(Operation *)> preReplaceAction,
+                           bool *inPlaceUpdate) {
+  assert(region->isAncestor(op->getContainingRegion()) &&
+         "cannot constant fold op from another region");
+  if (inPlaceUpdate)
+    *inPlaceUpdate = false;
 
   // The constant op also implements the constant fold hook; it can be folded
   // into the value it contains. We need to consider constants before the
@@ -66,8 +72,11 @@ OperationFolder::tryToFold(Operation *op,
     preReplaceAction(op);
 
   // Check to see if the operation was just updated in place.
-  if (results.empty())
+  if (results.empty()) {
+    if (inPlaceUpdate)
+      *inPlaceUpdate = true;
     return success();
+  }
 
   // Otherwise, replace all of the result values and erase the operation.
   for (unsigned i = 0, e = results.size(); i != e; ++i)
@@ -80,8 +89,8 @@ OperationFolder::tryToFold(Operation *op,
 /// `results` with the results of the folding.
 LogicalResult OperationFolder::tryToFold(Operation *op,
                                          SmallVectorImpl<Value *> &results) {
-  assert(op->getFunction() == function &&
-         "cannot constant fold op from another function");
+  assert(region->isAncestor(op->getContainingRegion()) &&
+         "cannot constant fold op from another region");
 
   SmallVector<Attribute, 8> operandConstants;
   SmallVector<OpFoldResult, 8> foldResults;
@@ -142,8 +151,8 @@ LogicalResult OperationFolder::tryToFold(Operation *op,
 }
 
 void OperationFolder::notifyRemoval(Operation *op) {
-  assert(op->getFunction() == function &&
-         "cannot remove constant from another function");
+  assert(region->isAncestor(op->getContainingRegion()) &&
+         "cannot remove constant from another region");
 
   Attribute constValue;
   if (!matchPattern(op, m_Constant(&constValue)))
@@ -169,7 +178,7 @@ LogicalResult OperationFolder::tryToUnify(Operation *op) {
       return failure();
 
     // Otherwise replace this redundant constant with the uniqued one.  We know
-    // this is safe because we move constants to the top of the function when
+    // this is safe because we move constants to the top of the region when
     // they are uniqued, so we know they dominate all uses.
     op->getResult(0)->replaceAllUsesWith(constInst->getResult(0));
     op->erase();
@@ -178,7 +187,7 @@ LogicalResult OperationFolder::tryToUnify(Operation *op) {
 
   // If we have no entry, then we should unique this constant as the
   // canonical version.  To ensure safe dominance, move the operation to the
-  // entry block of the function.
+  // entry block of the region.
   constInst = op;
   moveConstantToEntryBlock(op);
   return failure();
@@ -186,6 +195,6 @@ LogicalResult OperationFolder::tryToUnify(Operation *op) {
 
 void OperationFolder::moveConstantToEntryBlock(Operation *op) {
   // Insert at the very top of the entry block.
-  auto &entryBB = function->front();
+  auto &entryBB = region->front();
   op->moveBefore(&entryBB, entryBB.begin());
 }
@@ -20,13 +20,17 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/PatternMatch.h"
+#include "mlir/Pass/PassManager.h"
 #include "mlir/StandardOps/Ops.h"
 #include "mlir/Transforms/FoldUtils.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
+#include <numeric>
 
 using namespace mlir;
 
@@ -40,19 +44,52 @@ static llvm::cl::opt<unsigned> maxPatternMatchIterations(
 
 namespace {
 
+/// The results of rewriting a set of regions.
+struct RewriteResult {
+  explicit RewriteResult(size_t numPatterns, bool collectPatternStats)
+      : patternStats(collectPatternStats ? numPatterns : 0) {}
+
+  /// Merge the results of another rewrite into this one.
+  void merge(const RewriteResult &other) {
+    converged &= other.converged;
+    numRegions += other.numRegions;
+    numIterations += other.numIterations;
+    numSkippedRescans += other.numSkippedRescans;
+    for (unsigned i = 0, e = patternStats.size(); i != e; ++i) {
+      patternStats[i].numAttempts += other.patternStats[i].numAttempts;
+      patternStats[i].numSuccesses += other.patternStats[i].numSuccesses;
+      patternStats[i].time += other.patternStats[i].time;
+    }
+  }
+
+  bool converged = true;
+  unsigned numRegions = 0;
+  unsigned numIterations = 0;
+  unsigned numSkippedRescans = 0;
+
+  /// The counters for each pattern of the matcher, or empty if the counters
+  /// are not being collected.
+  std::vector<PatternStatistics> patternStats;
+};
+
 /// This is a worklist-driven driver for the PatternMatcher, which repeatedly
-/// applies the locally optimal patterns in a roughly "bottom up" way.
+/// applies the locally optimal patterns in a roughly "bottom up" way. The
+/// driver rewrites a single region, and does not visit the regions of nested
+/// operations that are isolated from above; these are rewritten by their own
+/// driver.
 class GreedyPatternRewriteDriver : public PatternRewriter {
 public:
-  explicit GreedyPatternRewriteDriver(Function &fn,
-                                      OwningRewritePatternList &&patterns)
-      : PatternRewriter(fn.getBody()), matcher(std::move(patterns)) {
+  explicit GreedyPatternRewriteDriver(Region &region,
+                                      const RewritePatternMatcher &matcher,
+                                      RewriteResult &result)
+      : PatternRewriter(region), matcher(matcher), folder(&region),
+        result(result) {
     worklist.reserve(64);
   }
 
   /// Perform the rewrites. Return true if the rewrite converges in
   /// `maxIterations`.
-  bool simplifyFunction(int maxIterations);
+  bool simplify(int maxIterations);
 
   void addToWorklist(Operation *op) {
     // Check to see if the worklist already contains this op.
@@ -109,6 +146,20 @@ protected:
         addToWorklist(user);
   }
 
+  // The following modifications are not tracked by the worklist, and require
+  // a rescan of the region to find any new simplifications.
+  void notifyRootUpdated(Operation *op) override {
+    changedOutsideWorklist = true;
+  }
+  void inlineRegionBefore(Region &region, Region::iterator before) override {
+    changedOutsideWorklist = true;
+    PatternRewriter::inlineRegionBefore(region, before);
+  }
+  Block *splitBlock(Block *block, Block::iterator before) override {
+    changedOutsideWorklist = true;
+    return PatternRewriter::splitBlock(block, before);
+  }
+
 private:
   // Look over the provided operands for any defining operations that should
   // be re-added to the worklist. This function should be called when an
@@ -128,8 +179,41 @@ private:
     }
   }
 
+  /// Add the operations within the given region to the worklist in
+  /// post-order, skipping the regions of operations isolated from above.
+  void addRegionToWorklist(Region &region) {
+    for (auto &block : region) {
+      for (auto &op : block) {
+        if (!op.isKnownIsolatedFromAbove())
+          for (auto &nestedRegion : op.getRegions())
+            addRegionToWorklist(nestedRegion);
+        addToWorklist(&op);
+      }
+    }
+  }
+
+  /// Returns true if the given operation is rewritten by this driver, i.e. it
+  /// is not nested within an operation that is isolated from above.
+  bool isInScope(Operation *op) {
+    Region *region = getRegion();
+    for (Region *opRegion = op->getContainingRegion(); opRegion != region;) {
+      auto *parentOp = opRegion->getContainingOp();
+      if (!parentOp || parentOp->isKnownIsolatedFromAbove())
+        return false;
+      opRegion = parentOp->getContainingRegion();
+    }
+    return true;
+  }
+
   /// The low-level pattern matcher.
-  RewritePatternMatcher matcher;
+  const RewritePatternMatcher &matcher;
+
+  /// The folder used to fold operations and unique constants within the
+  /// region.
+  OperationFolder folder;
+
+  /// The results of the rewrite.
+  RewriteResult &result;
 
   /// The worklist for this transformation keeps track of the operations that
   /// need to be revisited, plus their index in the worklist.  This allows us to
@@ -137,21 +221,26 @@ private:
   /// the function, even if they aren't the root of a pattern.
   std::vector<Operation *> worklist;
   DenseMap<Operation *, unsigned> worklistMap;
+
+  /// Set if the current scan modified the IR in a way that is not tracked by
+  /// the worklist.
+  bool changedOutsideWorklist = false;
 };
 } // end anonymous namespace
 
 /// Perform the rewrites.
-bool GreedyPatternRewriteDriver::simplifyFunction(int maxIterations) {
+bool GreedyPatternRewriteDriver::simplify(int maxIterations) {
   Region *region = getRegion();
-
-  // TODO(riverriddle) OperationFolder should take a region to insert into.
-  OperationFolder helper(region->getContainingFunction());
+  ++result.numRegions;
 
   bool changed = false;
   int i = 0;
   do {
+    changedOutsideWorklist = false;
+    ++result.numIterations;
+
     // Add all operations to the worklist.
-    region->walk([&](Operation *op) { addToWorklist(op); });
+    addRegionToWorklist(*region);
 
     // These are scratch vectors used in the folding loop below.
     SmallVector<Value *, 8> originalOperands, resultValues;
@@ -161,16 +250,19 @@ bool GreedyPatternRewriteDriver::simplifyFunction(int maxIterations) {
       auto *op = popFromWorklist();
 
       // Nulls get added to the worklist when operations are removed, ignore
-      // them.
-      if (op == nullptr)
+      // them. Operations created within a nested isolated region are left to
+      // the driver of that region.
+      if (op == nullptr || !isInScope(op))
         continue;
 
       // If the operation has no side effects, and no users, then it is
       // trivially dead - remove it.
       if (op->hasNoSideEffect() && op->use_empty()) {
         // Be careful to update bookkeeping in OperationFolder to keep
-        // consistency if this is a constant op.
-        helper.notifyRemoval(op);
+        // consistency if this is a constant op. The operands are revisited,
+        // as they may have become dead as well.
+        folder.notifyRemoval(op);
+        addToWorklist(op->getOperands());
         op->erase();
         continue;
       }
@@ -189,9 +281,13 @@ bool GreedyPatternRewriteDriver::simplifyFunction(int maxIterations) {
             addToWorklist(operand);
       };
 
-      // Try to fold this op.
-      if (succeeded(helper.tryToFold(op, collectOperandsAndUses))) {
+      // Try to fold this op. An operation updated in place may fold further,
+      // which is only found by a rescan.
+      bool inPlaceUpdate;
+      if (succeeded(folder.tryToFold(op, collectOperandsAndUses,
+                                     &inPlaceUpdate))) {
         changed |= true;
+        changedOutsideWorklist |= inPlaceUpdate;
         continue;
       }
 
@@ -201,25 +297,121 @@ bool GreedyPatternRewriteDriver::simplifyFunction(int maxIterations) {
       // Try to match one of the canonicalization patterns. The rewriter is
       // automatically notified of any necessary changes, so there is nothing
       // else to do here.
-      changed |= matcher.matchAndRewrite(op, *this);
+      changed |= matcher.matchAndRewrite(op, *this, result.patternStats);
+    }
+
+    // If all of the changes made during this scan were revisited by the
+    // worklist, a rescan would not find any new simplifications.
+    if (changed && !changedOutsideWorklist) {
+      ++result.numSkippedRescans;
+      changed = false;
     }
   } while (changed && ++i < maxIterations);
   // Whether the rewrite converges, i.e. wasn't changed in the last iteration.
   return !changed;
 }
 
+/// Collect the outermost operations nested within the given region that are
+/// isolated from above.
+static void collectIsolatedOperations(Region &region,
+                                      SmallVectorImpl<Operation *> &ops) {
+  for (auto &block : region) {
+    for (auto &op : block) {
+      if (op.isKnownIsolatedFromAbove()) {
+        ops.push_back(&op);
+        continue;
+      }
+      for (auto &nestedRegion : op.getRegions())
+        collectIsolatedOperations(nestedRegion, ops);
+    }
+  }
+}
+
+/// Rewrite the given region with a greedy driver.
+static void simplifyRegion(Region &region, const RewritePatternMatcher &matcher,
+                           RewriteResult &result) {
+  if (region.empty())
+    return;
+  GreedyPatternRewriteDriver driver(region, matcher, result);
+  result.converged &= driver.simplify(maxPatternMatchIterations);
+}
+
+/// Rewrite the regions of the given operation that is isolated from above.
+/// The regions of any nested isolated operations are rewritten first.
+static void simplifyIsolatedOperation(Operation *op,
+                                      const RewritePatternMatcher &matcher,
+                                      RewriteResult &result) {
+  for (auto &region : op->getRegions()) {
+    SmallVector<Operation *, 4> nestedOps;
+    collectIsolatedOperations(region, nestedOps);
+    for (auto *nestedOp : nestedOps)
+      simplifyIsolatedOperation(nestedOp, matcher, result);
+    simplifyRegion(region, matcher, result);
+  }
+}
+
 /// Rewrite the specified function by repeatedly applying the highest benefit
 /// patterns in a greedy work-list driven manner. Return true if no more
 /// patterns can be matched in the result function.
 ///
 bool mlir::applyPatternsGreedily(Function &fn,
-                                 OwningRewritePatternList &&patterns) {
-  GreedyPatternRewriteDriver driver(fn, std::move(patterns));
-  bool converged = driver.simplifyFunction(maxPatternMatchIterations);
-  LLVM_DEBUG(if (!converged) {
+                                 OwningRewritePatternList &&patterns,
+                                 GreedyRewriteStatistics *stats) {
+  RewritePatternMatcher matcher(std::move(patterns));
+  size_t numPatterns = matcher.getPatterns().size();
+  bool collectPatternStats = stats != nullptr;
+
+  // The regions of operations isolated from above are independent of each
+  // other, and of the function body, and are rewritten first. Each of them
+  // collects its results separately, so that they may be rewritten
+  // concurrently.
+  SmallVector<Operation *, 4> isolatedOps;
+  collectIsolatedOperations(fn.getBody(), isolatedOps);
+  std::vector<RewriteResult> isolatedResults(
+      isolatedOps.size(), RewriteResult(numPatterns, collectPatternStats));
+  if (isolatedOps.size() > 1 && isParallelWorkAllowedOnCurrentThread()) {
+    // A parallel diagnostic handler that provides deterministic diagnostic
+    // ordering.
+    ParallelDiagnosticHandler diagHandler(fn.getContext());
+    std::vector<unsigned> indices(isolatedOps.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    llvm::parallel::for_each(llvm::parallel::par, indices.begin(),
+                             indices.end(), [&](unsigned index) {
+                               diagHandler.setOrderIDForThread(index);
+                               simplifyIsolatedOperation(
+                                   isolatedOps[index], matcher,
+                                   isolatedResults[index]);
+                             });
+  } else {
+    for (unsigned i = 0, e = isolatedOps.size(); i != e; ++i)
+      simplifyIsolatedOperation(isolatedOps[i], matcher, isolatedResults[i]);
+  }
+
+  // Rewrite the function body.
+  RewriteResult result(numPatterns, collectPatternStats);
+  for (auto &isolatedResult : isolatedResults)
+    result.merge(isolatedResult);
+  simplifyRegion(fn.getBody(), matcher, result);
+
+  LLVM_DEBUG(if (!result.converged) {
     llvm::dbgs()
         << "The pattern rewrite doesn't converge after scanning the function "
         << maxPatternMatchIterations << " times";
   });
-  return converged;
+
+  // Populate the statistics of the rewrite.
+  if (stats) {
+    stats->numRegions = result.numRegions;
+    stats->numIterations = result.numIterations;
+    stats->numSkippedRescans = result.numSkippedRescans;
+    stats->hitIterationLimit = !result.converged;
+    stats->patterns.clear();
+    for (unsigned i = 0; i != numPatterns; ++i) {
+      auto &pattern = matcher.getPatterns()[i];
+      stats->patterns.push_back({pattern->getRootKind().getStringRef(),
+                                 pattern->getBenefit(),
+                                 result.patternStats[i]});
+    }
+  }
+  return result.converged;
 }
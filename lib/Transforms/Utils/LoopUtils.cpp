@@ -543,14 +543,15 @@ static bool checkLoopInterchangeDependences(
 
 /// Checks if the loop interchange permutation 'loopPermMap' of the perfectly
 /// nested sequence of loops in 'loops' would violate dependences.
-bool mlir::isValidLoopInterchangePermutation(ArrayRef<AffineForOp> loops,
-                                             ArrayRef<unsigned> loopPermMap) {
+bool mlir::isValidLoopInterchangePermutation(
+    ArrayRef<AffineForOp> loops, ArrayRef<unsigned> loopPermMap,
+    MemRefDependenceAnalysis *depAnalysis) {
   // Gather dependence components for dependences between all ops in loop nest
   // rooted at 'loops[0]', at loop depths in range [1, maxLoopDepth].
   assert(loopPermMap.size() == loops.size());
   unsigned maxLoopDepth = loops.size();
   std::vector<llvm::SmallVector<DependenceComponent, 2>> depCompsVec;
-  getDependenceComponents(loops[0], maxLoopDepth, &depCompsVec);
+  getDependenceComponents(loops[0], maxLoopDepth, &depCompsVec, depAnalysis);
   return checkLoopInterchangeDependences(depCompsVec, loops, loopPermMap);
 }
 
@@ -576,7 +577,8 @@ unsigned mlir::interchangeLoops(ArrayRef<AffineForOp> loops,
 // Sinks all sequential loops to the innermost levels (while preserving
 // relative order among them) and moves all parallel loops to the
 // outermost (while again preserving relative order among them).
-AffineForOp mlir::sinkSequentialLoops(AffineForOp forOp) {
+AffineForOp mlir::sinkSequentialLoops(AffineForOp forOp,
+                                      MemRefDependenceAnalysis *depAnalysis) {
   SmallVector<AffineForOp, 4> loops;
   getPerfectlyNestedLoops(loops, forOp);
   if (loops.size() < 2)
@@ -586,7 +588,7 @@ AffineForOp mlir::sinkSequentialLoops(AffineForOp forOp) {
   // rooted at 'loops[0]', at loop depths in range [1, maxLoopDepth].
   unsigned maxLoopDepth = loops.size();
   std::vector<llvm::SmallVector<DependenceComponent, 2>> depCompsVec;
-  getDependenceComponents(loops[0], maxLoopDepth, &depCompsVec);
+  getDependenceComponents(loops[0], maxLoopDepth, &depCompsVec, depAnalysis);
 
   // Mark loops as either parallel or sequential.
   llvm::SmallVector<bool, 8> isParallelLoop(maxLoopDepth, true);
@@ -625,6 +627,13 @@ AffineForOp mlir::sinkSequentialLoops(AffineForOp forOp) {
     return forOp;
   // Perform loop interchange according to permutation 'loopPermMap'.
   unsigned loopNestRootIndex = interchangeLoops(loops, loopPermMap);
+  // The dependences of the accesses in the nest are relative to its loops,
+  // drop them from the cache if the loops were reordered.
+  bool isIdentity = true;
+  for (unsigned i = 0; i < maxLoopDepth; ++i)
+    isIdentity &= loopPermMap[i] == i;
+  if (depAnalysis && !isIdentity)
+    depAnalysis->invalidate(loops[loopNestRootIndex].getOperation());
   return loops[loopNestRootIndex];
 }
 
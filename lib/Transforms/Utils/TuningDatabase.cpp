@@ -0,0 +1,270 @@
+//===- TuningDatabase.cpp - Tuned loop transformation parameters ----------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements the database of tuned loop transformation parameters
+// and the structural hash of loop nests.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Transforms/TuningDatabase.h"
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Support/FileUtilities.h"
+#include "mlir/Support/STLExtras.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace mlir;
+
+static llvm::cl::opt<std::string> clTuningDatabase(
+    "tuning-db",
+    llvm::cl::desc("File of tuned loop transformation parameters, consulted by "
+                   "the loop tiling and unrolling passes and updated by the "
+                   "autotuner of mlir-cpu-runner"),
+    llvm::cl::value_desc("filename"), llvm::cl::init(""));
+
+//===----------------------------------------------------------------------===//
+// Structural hash
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// Prints the structure of the operations of a loop nest. Values and blocks
+/// are numbered in the order in which they are encountered, and the values
+/// defined outside of the loop nest are printed with their type, and with their
+/// value if they are constants.
+class StructurePrinter {
+public:
+  explicit StructurePrinter(raw_ostream &os) : os(os) {}
+
+  void print(Operation *op);
+
+private:
+  void print(Region &region);
+  void printValue(Value *value);
+  void printBlock(Block *block);
+
+  raw_ostream &os;
+  llvm::DenseMap<Value *, unsigned> valueIds;
+  llvm::DenseMap<Block *, unsigned> blockIds;
+};
+
+} // end anonymous namespace
+
+void StructurePrinter::printValue(Value *value) {
+  auto it = valueIds.find(value);
+  if (it != valueIds.end()) {
+    os << '%' << it->second;
+    return;
+  }
+  unsigned id = valueIds.size();
+  valueIds[value] = id;
+  os << '%' << id << ':' << value->getType();
+  if (auto constOp = dyn_cast_or_null<ConstantOp>(value->getDefiningOp()))
+    os << '=' << constOp.getValue();
+}
+
+void StructurePrinter::printBlock(Block *block) {
+  auto it = blockIds.insert({block, blockIds.size()}).first;
+  os << '^' << it->second;
+}
+
+void StructurePrinter::print(Operation *op) {
+  os << op->getName() << '(';
+  interleaveComma(op->getOperands(), os,
+                  [&](Value *operand) { printValue(operand); });
+  os << ')';
+  for (unsigned i = 0, e = op->getNumSuccessors(); i < e; ++i) {
+    os << ' ';
+    printBlock(op->getSuccessor(i));
+  }
+  for (auto &attr : op->getAttrs())
+    os << ' ' << attr.first << '=' << attr.second;
+  os << " ->";
+  for (auto *result : op->getResults()) {
+    valueIds.insert({result, valueIds.size()});
+    os << ' ' << result->getType();
+  }
+  for (auto &region : op->getRegions())
+    print(region);
+  os << '\n';
+}
+
+void StructurePrinter::print(Region &region) {
+  os << " {\n";
+  for (auto &block : region) {
+    printBlock(&block);
+    os << '(';
+    interleaveComma(block.getArguments(), os, [&](BlockArgument *arg) {
+      valueIds.insert({arg, valueIds.size()});
+      os << arg->getType();
+    });
+    os << ")\n";
+    for (auto &op : block)
+      print(&op);
+  }
+  os << '}';
+}
+
+uint64_t mlir::hashLoopNest(AffineForOp forOp) {
+  std::string structure;
+  llvm::raw_string_ostream os(structure);
+  StructurePrinter(os).print(forOp.getOperation());
+  os.flush();
+
+  llvm::MD5 hasher;
+  hasher.update(structure);
+  llvm::MD5::MD5Result result;
+  hasher.final(result);
+  return result.low();
+}
+
+//===----------------------------------------------------------------------===//
+// TuningDatabase
+//===----------------------------------------------------------------------===//
+
+static StringRef getKindName(TuningParameterKind kind) {
+  switch (kind) {
+  case TuningParameterKind::TileSizes:
+    return "tile";
+  case TuningParameterKind::UnrollFactor:
+    return "unroll";
+  case TuningParameterKind::UnrollJamFactor:
+    return "unroll-jam";
+  }
+  llvm_unreachable("unknown tuning parameter kind");
+}
+
+static Optional<TuningParameterKind> parseKindName(StringRef name) {
+  for (auto kind :
+       {TuningParameterKind::TileSizes, TuningParameterKind::UnrollFactor,
+        TuningParameterKind::UnrollJamFactor})
+    if (getKindName(kind) == name)
+      return kind;
+  return llvm::None;
+}
+
+const TuningRecord *TuningDatabase::lookup(TuningParameterKind kind,
+                                           uint64_t hash) const {
+  auto it = records.find({kind, hash});
+  return it == records.end() ? nullptr : &it->second;
+}
+
+void TuningDatabase::insert(TuningParameterKind kind, uint64_t hash,
+                            ArrayRef<unsigned> parameters,
+                            double executionTime) {
+  TuningRecord &record = records[{kind, hash}];
+  record.parameters.assign(parameters.begin(), parameters.end());
+  record.executionTime = executionTime;
+}
+
+LogicalResult TuningDatabase::parse(StringRef contents,
+                                    std::string *errorMessage) {
+  SmallVector<StringRef, 16> lines;
+  contents.split(lines, '\n');
+  for (unsigned i = 0, e = lines.size(); i < e; ++i) {
+    StringRef line = lines[i].trim();
+    if (line.empty() || line.startswith("#"))
+      continue;
+
+    auto emitError = [&](const Twine &message) {
+      if (errorMessage)
+        *errorMessage = ("line " + Twine(i + 1) + ": " + message).str();
+      return failure();
+    };
+
+    SmallVector<StringRef, 8> fields;
+    llvm::SplitString(line, fields);
+    if (fields.size() < 3)
+      return emitError("expected a kind, a hash and an execution time");
+    auto kind = parseKindName(fields[0]);
+    if (!kind.hasValue())
+      return emitError("unknown kind '" + fields[0] + "'");
+    uint64_t hash;
+    if (fields[1].getAsInteger(16, hash))
+      return emitError("invalid hash '" + fields[1] + "'");
+    double executionTime;
+    if (fields[2].getAsDouble(executionTime))
+      return emitError("invalid execution time '" + fields[2] + "'");
+
+    SmallVector<unsigned, 6> parameters;
+    for (StringRef field : ArrayRef<StringRef>(fields).drop_front(3)) {
+      unsigned parameter;
+      if (field.getAsInteger(10, parameter))
+        return emitError("invalid parameter '" + field + "'");
+      parameters.push_back(parameter);
+    }
+    insert(kind.getValue(), hash, parameters, executionTime);
+  }
+  return success();
+}
+
+void TuningDatabase::print(raw_ostream &os) const {
+  for (auto &keyAndRecord : records) {
+    const TuningRecord &record = keyAndRecord.second;
+    os << getKindName(keyAndRecord.first.first) << ' '
+       << llvm::format_hex_no_prefix(keyAndRecord.first.second, 16) << ' '
+       << llvm::format("%.6e", record.executionTime);
+    for (unsigned parameter : record.parameters)
+      os << ' ' << parameter;
+    os << '\n';
+  }
+}
+
+LogicalResult TuningDatabase::load(StringRef filename,
+                                   std::string *errorMessage) {
+  auto file = openInputFile(filename, errorMessage);
+  if (!file)
+    return failure();
+  return parse(file->getBuffer(), errorMessage);
+}
+
+LogicalResult TuningDatabase::save(StringRef filename,
+                                   std::string *errorMessage) const {
+  auto file = openOutputFile(filename, errorMessage);
+  if (!file)
+    return failure();
+  print(file->os());
+  file->keep();
+  return success();
+}
+
+StringRef mlir::getTuningDatabaseFilename() { return clTuningDatabase; }
+
+const TuningDatabase *mlir::getCommandLineTuningDatabase() {
+  static std::unique_ptr<TuningDatabase> database =
+      []() -> std::unique_ptr<TuningDatabase> {
+    if (clTuningDatabase.empty())
+      return nullptr;
+    auto loaded = llvm::make_unique<TuningDatabase>();
+    std::string errorMessage;
+    if (failed(loaded->load(clTuningDatabase, &errorMessage))) {
+      llvm::errs() << "error: could not load the tuning database '"
+                   << clTuningDatabase << "': " << errorMessage << "\n";
+      return llvm::make_unique<TuningDatabase>();
+    }
+    return loaded;
+  }();
+  return database.get();
+}
@@ -0,0 +1,80 @@
+// RUN: mlir-opt %s -mlir-print-debuginfo > %t.text
+// RUN: mlir-opt %s -emit-bytecode -o %t.mlirbc
+// RUN: mlir-opt %t.mlirbc -mlir-print-debuginfo > %t.bytecode
+// RUN: diff %t.text %t.bytecode
+// RUN: mlir-opt %t.mlirbc -mlir-print-debuginfo | FileCheck %s
+
+// This test checks that modules round trip through the bytecode format.
+
+#map0 = (d0) -> (d0 + 1)
+
+// CHECK-LABEL: func @external(i32 {bytecode.arg: 4 : i64}, f32)
+// CHECK-SAME: attributes {bytecode.func: "external"}
+func @external(i32 {bytecode.arg: 4}, f32)
+    attributes {bytecode.func: "external"}
+
+// CHECK-LABEL: func @attributes
+func @attributes() {
+  // Check that the order of the attributes is preserved.
+  // CHECK: "foo"() {type: i1, array: [1 : i32, 2.500000e+00 : f16, "str"],
+  // CHECK-SAME: bool: true, dict: {a, b: false}, fn: @external,
+  // CHECK-SAME: map: #map0, int: 7 : i123}
+  "foo"() {type: i1, array: [1 : i32, 2.5 : f16, "str"], bool: true,
+           dict: {b: false, a}, fn: @external, map: #map0,
+           int: 7 : i123} : () -> ()
+
+  // CHECK: constant dense<tensor<3xi32>, [1, -2, 3]> : tensor<3xi32>
+  %0 = constant dense<tensor<3xi32>, [1, -2, 3]> : tensor<3xi32>
+  // CHECK: constant dense<vector<3xi1>, {{.*}}> : vector<3xi1>
+  %1 = constant dense<vector<3xi1>, [true, false, true]> : vector<3xi1>
+  // CHECK: constant dense<tensor<2x2xf32>, 1.500000e+00> : tensor<2x2xf32>
+  %2 = constant dense<tensor<2x2xf32>, 1.5> : tensor<2x2xf32>
+  // CHECK: constant -123456789012 : i64
+  %3 = constant -123456789012 : i64
+  // CHECK: constant 4.300000e+01 : bf16
+  %4 = constant 43.0 : bf16
+  // CHECK: constant -2.500000e-01 : f64
+  %5 = constant -0.25 : f64
+  return
+}
+
+// CHECK-LABEL: func @forward_references
+func @forward_references(%arg0 : i1, %arg1 : index) -> index {
+  // CHECK: br ^bb2(%arg1 : index)
+  br ^bb2(%arg1 : index)
+^bb1:
+  // CHECK: return %1 : index
+  return %1 : index
+// CHECK: ^bb2(%0: index):
+^bb2(%0 : index):
+  // CHECK: %1 = addi %0, %0 : index
+  %1 = addi %0, %0 : index
+  // CHECK: cond_br %arg0, ^bb1, ^bb2(%1 : index)
+  cond_br %arg0, ^bb1, ^bb2(%1 : index)
+}
+
+// CHECK-LABEL: func @regions
+func @regions(%arg0 : memref<8xf32>) {
+  %cst = constant 1.0 : f32
+  // CHECK: affine.for %i0 = 0 to 8 {
+  affine.for %i = 0 to 8 {
+    // CHECK: affine.apply #map0(%i0)
+    %0 = affine.apply #map0(%i)
+    // CHECK: store %cst, %arg0[%i0] : memref<8xf32>
+    store %cst, %arg0[%i] : memref<8xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: func @locations
+func @locations() -> i32 loc("mysource.cc":10:8) {
+  // CHECK: -> i32 loc("foo")
+  %1 = "foo"() : () -> i32 loc("foo")
+  // CHECK: constant 4 : index loc(callsite("foo" at "mysource.cc":10:8))
+  %2 = constant 4 : index loc(callsite("foo" at "mysource.cc":10:8))
+  // CHECK: } loc(fused<"myPass">["foo", "mysource.cc":10:8])
+  affine.for %i0 = 0 to 8 {
+  } loc(fused<"myPass">["foo", "mysource.cc":10:8])
+  // CHECK: return %0 : i32 loc(unknown)
+  return %1 : i32 loc(unknown)
+}
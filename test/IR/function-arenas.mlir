@@ -0,0 +1,69 @@
+// RUN: mlir-opt %s -mlir-function-arenas -canonicalize | FileCheck %s
+
+// Check that the IR allocated from the function arenas can be parsed and
+// rewritten.
+
+// CHECK-LABEL: func @fold_and_rewrite
+func @fold_and_rewrite(%arg0: i32) -> i32 {
+  // CHECK: %[[C3:.*]] = constant 3 : i32
+  // CHECK-NEXT: br ^bb1(%[[C3]] : i32)
+  %c1 = constant 1 : i32
+  %c2 = constant 2 : i32
+  %0 = addi %c1, %c2 : i32
+  %true = constant 1 : i1
+  cond_br %true, ^bb1(%0 : i32), ^bb2(%arg0 : i32)
+^bb1(%1: i32):
+  return %1 : i32
+^bb2(%2: i32):
+  return %2 : i32
+}
+
+// CHECK-LABEL: func @nested_regions
+func @nested_regions(%arg0: index) {
+  // CHECK-NEXT: affine.for
+  affine.for %i = 0 to 10 {
+    // CHECK-NEXT: affine.for
+    affine.for %j = 0 to %arg0 {
+      // CHECK-NEXT: "foo.bar"
+      "foo.bar"(%i, %j) : (index, index) -> ()
+    }
+  }
+  return
+}
+
+// The regions isolated from above are rewritten in parallel, and the folded
+// constants of each are allocated from the arena of the function.
+// CHECK-LABEL: func @parallel_rewrite
+func @parallel_rewrite(%sz : index) {
+  // CHECK: gpu.launch
+  // CHECK-NEXT: constant 3 : i32
+  gpu.launch blocks(%bx, %by, %bz) in (%grid_x = %sz, %grid_y = %sz, %grid_z = %sz)
+             threads(%tx, %ty, %tz) in (%block_x = %sz, %block_y = %sz, %block_z = %sz) {
+    %c1 = constant 1 : i32
+    %c2 = constant 2 : i32
+    %0 = addi %c1, %c2 : i32
+    "use"(%0) : (i32) -> ()
+    gpu.return
+  }
+  // CHECK: gpu.launch
+  // CHECK-NEXT: constant 7 : i32
+  gpu.launch blocks(%bx, %by, %bz) in (%grid_x = %sz, %grid_y = %sz, %grid_z = %sz)
+             threads(%tx, %ty, %tz) in (%block_x = %sz, %block_y = %sz, %block_z = %sz) {
+    %c3 = constant 3 : i32
+    %c4 = constant 4 : i32
+    %0 = addi %c3, %c4 : i32
+    "use"(%0) : (i32) -> ()
+    gpu.return
+  }
+  // CHECK: gpu.launch
+  // CHECK-NEXT: constant 11 : i32
+  gpu.launch blocks(%bx, %by, %bz) in (%grid_x = %sz, %grid_y = %sz, %grid_z = %sz)
+             threads(%tx, %ty, %tz) in (%block_x = %sz, %block_y = %sz, %block_z = %sz) {
+    %c5 = constant 5 : i32
+    %c6 = constant 6 : i32
+    %0 = addi %c5, %c6 : i32
+    "use"(%0) : (i32) -> ()
+    gpu.return
+  }
+  return
+}
@@ -604,6 +604,15 @@ func @elementsattr_shape_mismatch() -> () {
 
 // -----
 
+// The storage of the elements of a huge type is not reserved for a short
+// literal.
+func @elementsattr_huge_shape_mismatch() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<1024x1024x1024x16xf32>, [4.0, 5.0]>} : () -> () // expected-error {{inferred shape of elements literal ([2]) does not match type ([1024, 1024, 1024, 16])}}
+}
+
+// -----
+
 func @elementsattr_invalid() -> () {
 ^bb0:
   "foo"(){bar: dense<tensor<2xi32>, [4, [5]]>} : () -> () // expected-error {{tensor literal is invalid; ranks are not consistent between elements}}
@@ -656,6 +665,41 @@ func @elementsattr_toolarge2() -> () {
 
 // -----
 
+func @elementsattr_bool_non_i1() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<1xi8>, [true]>} : () -> () // expected-error {{expected i1 type for 'true' or 'false' values}}
+}
+
+// -----
+
+func @elementsattr_index() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<1xindex>, [1]>} : () -> () // expected-error {{expected integer or floating point element type}}
+}
+
+// -----
+
+func @elementsattr_hex_no_prefix() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<1xi8>, "01">} : () -> () // expected-error {{hex elements literal should start with '0x'}}
+}
+
+// -----
+
+func @elementsattr_hex_odd_digits() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<1xi8>, "0x012">} : () -> () // expected-error {{hex elements literal should only contain pairs of hex digits}}
+}
+
+// -----
+
+func @elementsattr_hex_size_mismatch() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<3xi16>, "0x01000200">} : () -> () // expected-error {{hex elements literal has 4 bytes, which does not match type 'tensor<3xi16>'}}
+}
+
+// -----
+
 func @elementsattr_malformed_opaque() -> () {
 ^bb0:
   "foo"(){bar: opaque<tensor<1xi8>, "0xQZz123">} : () -> () // expected-error {{expected dialect namespace}}
@@ -1061,3 +1105,30 @@ func @invalid_region_dominance() {
   }) : () -> ()
   return
 }
+
+// -----
+
+// Only the first invalid function of a module is reported, even when the
+// functions are verified concurrently.
+
+func @verify_valid() {
+  return
+}
+
+func @verify_first_invalid() {
+^bb0:
+  "foo"(%x) : (i32) -> ()    // expected-error {{operand #0 does not dominate this use}}
+  br ^bb1
+^bb1:
+  %x = "bar"() : () -> i32    // expected-note {{operand defined here}}
+  return
+}
+
+func @verify_second_invalid() {
+^bb0:
+  "foo"(%x) : (i32) -> ()
+  br ^bb1
+^bb1:
+  %x = "bar"() : () -> i32
+  return
+}
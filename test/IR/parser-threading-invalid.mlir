@@ -0,0 +1,32 @@
+// RUN: mlir-opt %s -split-input-file -verify-diagnostics -mlir-parallel-parse
+
+// Check that the errors of a parallel parse are reported as in a sequential
+// parse: only the first error of the module is reported.
+
+func @valid() {
+  return
+}
+
+func @first_invalid() {
+  %0 = "foo"() : () -> i32
+  // expected-error@+1 {{use of undeclared SSA value name}}
+  "bar"(%1) : (i32) -> ()
+  return
+}
+
+func @second_invalid() {
+  "bar"(%2) : (i32) -> ()
+  return
+}
+
+// -----
+
+// Check that an alias is not visible from the function bodies before it.
+
+func @use_before_alias() {
+  // expected-error@+1 {{undefined symbol alias id 'later'}}
+  "foo"() : () -> !later
+  return
+}
+
+!later = type i32
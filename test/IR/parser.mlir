@@ -674,6 +674,20 @@ func @densetensorattr() -> () {
   return
 }
 
+// CHECK-LABEL: func @densetensorattr_hex
+func @densetensorattr_hex() -> () {
+^bb0:
+// CHECK: "hexi32"() {bar: dense<tensor<2x2xi32>, {{\[\[}}1, -2], [3, 4]]>} : () -> ()
+  "hexi32"(){bar: dense<tensor<2x2xi32>, "0x01000000FEFFFFFF0300000004000000">} : () -> ()
+// CHECK: "hexsplat"() {bar: dense<tensor<4xi16>, 258>} : () -> ()
+  "hexsplat"(){bar: dense<tensor<4xi16>, "0x0201">} : () -> ()
+// CHECK: "hexi1"() {bar: dense<vector<4xi1>, [1, 0, 1, 1]>} : () -> ()
+  "hexi1"(){bar: dense<vector<4xi1>, "0x0D">} : () -> ()
+// CHECK: "hexf32"() {bar: dense<tensor<2xf32>, [1.000000e+00, -2.000000e+00]>} : () -> ()
+  "hexf32"(){bar: dense<tensor<2xf32>, "0x0000803F000000C0">} : () -> ()
+  return
+}
+
 // CHECK-LABEL: func @densevectorattr
 func @densevectorattr() -> () {
 ^bb0:
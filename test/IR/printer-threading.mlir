@@ -0,0 +1,63 @@
+// RUN: mlir-opt %s -mlir-disable-printer-threading > %t.sequential
+// RUN: mlir-opt %s > %t.parallel
+// RUN: diff %t.sequential %t.parallel
+// RUN: mlir-opt %s | FileCheck %s
+
+// Check that functions printed concurrently are written in order, with their
+// values numbered per function, and that the output is identical to that of
+// the sequential printer.
+
+#map0 = (d0) -> (d0 + 1)
+
+// CHECK: #map0 = (d0) -> (d0 + 1)
+
+// CHECK-LABEL: func @external(i32)
+func @external(i32)
+
+// CHECK-LABEL: func @first(%arg0: i32) -> i32 {
+func @first(%arg0: i32) -> i32 {
+  // CHECK-NEXT: %0 = addi %arg0, %arg0 : i32
+  %0 = addi %arg0, %arg0 : i32
+  // CHECK-NEXT: return %0 : i32
+  return %0 : i32
+}
+
+// CHECK-LABEL: func @second(%arg0: memref<8xf32>) {
+func @second(%arg0: memref<8xf32>) {
+  // CHECK-NEXT: %cst = constant 1.000000e+00 : f32
+  %cst = constant 1.0 : f32
+  // CHECK-NEXT: affine.for %i0 = 0 to 7 {
+  affine.for %i = 0 to 7 {
+    // CHECK-NEXT: %0 = affine.apply #map0(%i0)
+    %0 = affine.apply #map0(%i)
+    // CHECK-NEXT: store %cst, %arg0[%0] : memref<8xf32>
+    store %cst, %arg0[%0] : memref<8xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: func @third(%arg0: i1) -> index {
+func @third(%arg0: i1) -> index {
+  // CHECK-NEXT: %c0 = constant 0 : index
+  %c0 = constant 0 : index
+  // CHECK-NEXT: cond_br %arg0, ^bb1, ^bb2(%c0 : index)
+  cond_br %arg0, ^bb1, ^bb2(%c0 : index)
+// CHECK-NEXT: ^bb1:
+^bb1:
+  // CHECK-NEXT: %0 = call @fourth() : () -> index
+  %0 = call @fourth() : () -> index
+  // CHECK-NEXT: br ^bb2(%0 : index)
+  br ^bb2(%0 : index)
+// CHECK-NEXT: ^bb2(%1: index):
+^bb2(%1: index):
+  // CHECK-NEXT: return %1 : index
+  return %1 : index
+}
+
+// CHECK-LABEL: func @fourth() -> index {
+func @fourth() -> index {
+  // CHECK-NEXT: %c1 = constant 1 : index
+  %c1 = constant 1 : index
+  // CHECK-NEXT: return %c1 : index
+  return %c1 : index
+}
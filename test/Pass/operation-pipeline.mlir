@@ -0,0 +1,40 @@
+// RUN: mlir-opt %s -disable-pass-threading=true -test-operation-pass -verify-diagnostics
+// RUN: mlir-opt %s -disable-pass-threading=false -test-operation-pass -verify-diagnostics
+// RUN: mlir-opt %s -disable-pass-threading=false -test-operation-pass -test-operation-pass -cse | FileCheck %s
+
+// CHECK-LABEL: func @launches
+func @launches(%sz : index, %float : f32) {
+  gpu.launch blocks(%bx, %by, %bz) in (%grid_x = %sz, %grid_y = %sz, %grid_z = %sz)
+             threads(%tx, %ty, %tz) in (%block_x = %sz, %block_y = %sz, %block_z = %sz) {
+    // expected-remark@-2 {{isolated operation with 1 nested operations}}
+    gpu.return
+  }
+  gpu.launch blocks(%bx, %by, %bz) in (%grid_x = %sz, %grid_y = %sz, %grid_z = %sz)
+             threads(%tx, %ty, %tz) in (%block_x = %sz, %block_y = %sz, %block_z = %sz)
+             args(%arg = %float) : f32 {
+    // expected-remark@-3 {{isolated operation with 2 nested operations}}
+    "use"(%arg) : (f32) -> ()
+    gpu.return
+  }
+  // CHECK: gpu.launch
+  // CHECK: gpu.launch
+  return
+}
+
+// CHECK-LABEL: func @loop_nests
+func @loop_nests(%A : memref<10xf32>) {
+  // This loop nest only uses values defined within it, so its region is
+  // isolated from above.
+  affine.for %i = 0 to 10 {
+    // expected-remark@-1 {{isolated operation with 4 nested operations}}
+    %0 = alloc() : memref<10xf32>
+    %1 = load %0[%i] : memref<10xf32>
+    dealloc %0 : memref<10xf32>
+  }
+
+  // This loop nest uses a value defined above, and is not run on.
+  affine.for %i = 0 to 10 {
+    %2 = load %A[%i] : memref<10xf32>
+  }
+  return
+}
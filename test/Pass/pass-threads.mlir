@@ -0,0 +1,38 @@
+// RUN: mlir-opt %s -disable-pass-threading=false -pass-threads=2 -cse -pass-thread-statistics 2>&1 | FileCheck %s
+// RUN: mlir-opt %s -disable-pass-threading=false -pass-threads=1 -cse | FileCheck -check-prefix=OUTPUT %s
+
+// CHECK: Function pipeline thread utilization
+// CHECK: Total Execution Time:
+// CHECK: Worker  Functions  Steals   Busy Time  Utilization
+// CHECK-NEXT: 0
+// CHECK-NEXT: 1
+
+// The output must not depend on the order in which functions are scheduled.
+// OUTPUT-LABEL: func @small
+// OUTPUT-LABEL: func @large
+// OUTPUT: affine.for
+// OUTPUT-NEXT: affine.for
+// OUTPUT-LABEL: func @medium
+
+func @small() {
+  return
+}
+
+func @large(%arg0 : memref<10x10xf32>) {
+  affine.for %i = 0 to 10 {
+    affine.for %j = 0 to 10 {
+      %0 = load %arg0[%i, %j] : memref<10x10xf32>
+      %1 = load %arg0[%i, %j] : memref<10x10xf32>
+      %2 = addf %0, %1 : f32
+      store %2, %arg0[%i, %j] : memref<10x10xf32>
+    }
+  }
+  return
+}
+
+func @medium(%arg0 : f32) -> f32 {
+  %0 = addf %arg0, %arg0 : f32
+  %1 = addf %arg0, %arg0 : f32
+  %2 = mulf %0, %1 : f32
+  return %2 : f32
+}
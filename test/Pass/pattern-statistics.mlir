@@ -0,0 +1,15 @@
+// RUN: mlir-opt %s -canonicalize -pass-pattern-statistics -o /dev/null 2>&1 | FileCheck %s
+
+// CHECK: ... Pattern rewrite statistics ...
+// CHECK: Canonicalizer
+// CHECK-NEXT: Rewrites: 1, Regions: 1, Scans: 1, Skipped rescans: 1, Unconverged: 0
+// CHECK-NEXT: ---Attempts---  ---Successes---  ---Time (s)---  --- Pattern ---
+// CHECK-NEXT: {{ +}}1{{ +}}1{{ +}}{{[0-9.]+}}  #{{[0-9]+}} std.cond_br (benefit 1)
+func @cond_br_const(%arg0 : i32) -> i32 {
+  %true = constant 1 : i1
+  cond_br %true, ^bb1, ^bb2
+^bb1:
+  return %arg0 : i32
+^bb2:
+  return %arg0 : i32
+}
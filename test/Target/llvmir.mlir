@@ -1,4 +1,5 @@
 // RUN: mlir-translate -mlir-to-llvmir %s | FileCheck %s
+// RUN: mlir-opt %s -emit-bytecode -o %t && mlir-translate -mlir-to-llvmir %t | FileCheck %s
 
 //
 // Declarations of the allocation functions to be linked against.
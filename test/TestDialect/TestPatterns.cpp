@@ -76,6 +76,40 @@ struct TestDropOp : public ConversionPattern {
     return matchSuccess();
   }
 };
+/// This pattern erases the first operand of the given operation in place.
+struct TestDropOperandInPlace : public ConversionPattern {
+  TestDropOperandInPlace(MLIRContext *ctx)
+      : ConversionPattern("test.drop_operand_in_place", 1, ctx) {}
+  PatternMatchResult matchAndRewrite(Operation *op, ArrayRef<Value *> operands,
+                                     PatternRewriter &rewriter) const final {
+    if (operands.empty())
+      return matchFailure();
+    rewriter.startRootUpdate(op);
+    op->eraseOperand(0);
+    rewriter.updatedRootInPlace(op);
+    return matchSuccess();
+  }
+};
+/// This pattern replaces the first operand of the given operation in place
+/// with the result of a newly created operation.
+struct TestReplaceOperandInPlace : public ConversionPattern {
+  TestReplaceOperandInPlace(MLIRContext *ctx)
+      : ConversionPattern("test.replace_operand_in_place", 1, ctx) {}
+  PatternMatchResult matchAndRewrite(Operation *op, ArrayRef<Value *> operands,
+                                     PatternRewriter &rewriter) const final {
+    if (operands.empty())
+      return matchFailure();
+    auto status =
+        rewriter.getNamedAttr("status", rewriter.getStringAttr("Success"));
+    auto newOp = rewriter.create<LegalOpA>(
+        op->getLoc(), ArrayRef<Type>(operands[0]->getType()),
+        ArrayRef<Value *>(), ArrayRef<NamedAttribute>(status));
+    rewriter.startRootUpdate(op);
+    op->setOperand(0, newOp.getResult());
+    rewriter.updatedRootInPlace(op);
+    return matchSuccess();
+  }
+};
 } // namespace
 
 namespace {
@@ -99,17 +133,30 @@ struct TestTypeConverter : public TypeConverter {
   }
 };
 
+struct TestConversionTarget : public ConversionTarget {
+  TestConversionTarget(MLIRContext &ctx) : ConversionTarget(ctx) {
+    addLegalOp<LegalOpA>();
+    setOpAction(OperationName("test.drop_operand_in_place", &ctx),
+                LegalizationAction::Dynamic);
+    setOpAction(OperationName("test.replace_operand_in_place", &ctx),
+                LegalizationAction::Dynamic);
+  }
+
+  /// Operations updated in place are legal once they have no operands.
+  bool isLegal(Operation *op) const final { return op->getNumOperands() == 0; }
+};
+
 struct TestLegalizePatternDriver
     : public ModulePass<TestLegalizePatternDriver> {
   void runOnModule() override {
     mlir::OwningRewritePatternList patterns;
     populateWithGenerated(&getContext(), &patterns);
-    RewriteListBuilder<TestRegionRewriteBlockMovement, TestDropOp>::build(
-        patterns, &getContext());
+    RewriteListBuilder<
+        TestRegionRewriteBlockMovement, TestDropOp, TestDropOperandInPlace,
+        TestReplaceOperandInPlace>::build(patterns, &getContext());
 
     TestTypeConverter converter;
-    ConversionTarget target(getContext());
-    target.addLegalOp<LegalOpA>();
+    TestConversionTarget target(getContext());
     if (failed(applyConversionPatterns(getModule(), target, converter,
                                        std::move(patterns))))
       signalPassFailure();
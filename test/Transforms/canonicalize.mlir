@@ -531,3 +531,23 @@ func @cast_values(%arg0: tensor<*xi32>, %arg1: memref<?xi32>) -> (tensor<2xi32>,
   // CHECK-NEXT: return %0, %1 : tensor<2xi32>, memref<2xi32>
   return %4, %5 : tensor<2xi32>, memref<2xi32>
 }
+
+// Checks that operations within regions isolated from above are folded
+// within the region.
+// CHECK-LABEL: func @fold_isolated_region
+func @fold_isolated_region(%sz : index) {
+  // CHECK-NOT: constant
+  // CHECK: gpu.launch
+  gpu.launch blocks(%bx, %by, %bz) in (%grid_x = %sz, %grid_y = %sz, %grid_z = %sz)
+             threads(%tx, %ty, %tz) in (%block_x = %sz, %block_y = %sz, %block_z = %sz) {
+    // CHECK-NEXT: %[[C:.*]] = constant 3 : i32
+    // CHECK-NEXT: "use"(%[[C]]) : (i32) -> ()
+    %c1 = constant 1 : i32
+    %c2 = constant 2 : i32
+    %0 = addi %c1, %c2 : i32
+    "use"(%0) : (i32) -> ()
+    // CHECK-NEXT: gpu.return
+    gpu.return
+  }
+  return
+}
@@ -220,3 +220,145 @@ func @up_propagate_region() -> i32 {
   }) : () -> (i32)
   return %0 : i32
 }
+
+// CHECK-LABEL: func @redundant_load
+func @redundant_load(%A : memref<10xf32>, %i : index) -> (f32, f32) {
+  // CHECK-NEXT: %0 = load %arg0[%arg1] : memref<10xf32>
+  %0 = load %A[%i] : memref<10xf32>
+  %1 = load %A[%i] : memref<10xf32>
+
+  // CHECK-NEXT: return %0, %0 : f32, f32
+  return %0, %1 : f32, f32
+}
+
+// CHECK-LABEL: func @store_to_load_forwarding
+func @store_to_load_forwarding(%A : memref<10xf32>, %v : f32) -> f32 {
+  %c0 = constant 0 : index
+  // CHECK: store %arg1, %arg0[%c0] : memref<10xf32>
+  store %v, %A[%c0] : memref<10xf32>
+  %0 = load %A[%c0] : memref<10xf32>
+
+  // CHECK-NEXT: return %arg1 : f32
+  return %0 : f32
+}
+
+// CHECK-LABEL: func @redundant_store
+func @redundant_store(%A : memref<10xf32>, %i : index) {
+  // CHECK-NEXT: %0 = load %arg0[%arg1] : memref<10xf32>
+  %0 = load %A[%i] : memref<10xf32>
+  store %0, %A[%i] : memref<10xf32>
+
+  // CHECK-NEXT: return
+  return
+}
+
+// CHECK-LABEL: func @load_after_aliasing_store
+func @load_after_aliasing_store(%A : memref<10xf32>, %B : memref<10xf32>,
+                                %i : index, %v : f32) -> (f32, f32) {
+  // CHECK-NEXT: %0 = load %arg0[%arg2] : memref<10xf32>
+  %0 = load %A[%i] : memref<10xf32>
+  // CHECK-NEXT: store %arg3, %arg1[%arg2] : memref<10xf32>
+  store %v, %B[%i] : memref<10xf32>
+  // CHECK-NEXT: %1 = load %arg0[%arg2] : memref<10xf32>
+  %1 = load %A[%i] : memref<10xf32>
+
+  // CHECK-NEXT: return %0, %1 : f32, f32
+  return %0, %1 : f32, f32
+}
+
+// CHECK-LABEL: func @load_after_store_to_distinct_alloc
+func @load_after_store_to_distinct_alloc(%i : index, %v : f32) -> (f32, f32) {
+  // CHECK-NEXT: %0 = alloc() : memref<10xf32>
+  // CHECK-NEXT: %1 = alloc() : memref<10xf32>
+  %B = alloc() : memref<10xf32>
+  %C = alloc() : memref<10xf32>
+  // CHECK-NEXT: %2 = load %0[%arg0] : memref<10xf32>
+  %0 = load %B[%i] : memref<10xf32>
+  // CHECK-NEXT: store %arg1, %1[%arg0] : memref<10xf32>
+  store %v, %C[%i] : memref<10xf32>
+  %1 = load %B[%i] : memref<10xf32>
+
+  // CHECK-NEXT: return %2, %2 : f32, f32
+  return %0, %1 : f32, f32
+}
+
+// CHECK-LABEL: func @load_across_loop
+func @load_across_loop(%A : memref<10xf32>, %B : memref<10xf32>) -> f32 {
+  %c0 = constant 0 : index
+  %C = alloc() : memref<10xf32>
+  // CHECK: %1 = load %arg0[%c0] : memref<10xf32>
+  %0 = load %A[%c0] : memref<10xf32>
+  // CHECK-NEXT: affine.for %i0 = 0 to 10 {
+  affine.for %i = 0 to 10 {
+    // CHECK-NEXT: %2 = load %arg1[%i0] : memref<10xf32>
+    // CHECK-NEXT: %3 = addf %1, %2 : f32
+    // CHECK-NEXT: store %3, %0[%i0] : memref<10xf32>
+    %1 = load %A[%c0] : memref<10xf32>
+    %2 = load %B[%i] : memref<10xf32>
+    %3 = addf %1, %2 : f32
+    store %3, %C[%i] : memref<10xf32>
+  }
+  // CHECK: return %1 : f32
+  %4 = load %A[%c0] : memref<10xf32>
+  return %4 : f32
+}
+
+// CHECK-LABEL: func @load_in_loop_with_store
+func @load_in_loop_with_store(%A : memref<10xf32>, %v : f32) {
+  %c0 = constant 0 : index
+  // CHECK: %0 = load %arg0[%c0] : memref<10xf32>
+  %0 = load %A[%c0] : memref<10xf32>
+  // CHECK-NEXT: affine.for %i0 = 0 to 10 {
+  affine.for %i = 0 to 10 {
+    // CHECK-NEXT: %1 = load %arg0[%c0] : memref<10xf32>
+    %1 = load %A[%c0] : memref<10xf32>
+    // CHECK-NEXT: store %arg1, %arg0[%i0] : memref<10xf32>
+    store %v, %A[%i] : memref<10xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: func @load_in_loop_nest_with_store
+func @load_in_loop_nest_with_store(%A : memref<10xf32>) {
+  %c0 = constant 0 : index
+  %C = alloc() : memref<10xf32>
+  // CHECK: %1 = load %arg0[%c0] : memref<10xf32>
+  // CHECK-NEXT: %2 = load %0[%c0] : memref<10xf32>
+  %0 = load %A[%c0] : memref<10xf32>
+  %1 = load %C[%c0] : memref<10xf32>
+  // CHECK-NEXT: affine.for %i0 = 0 to 10 {
+  affine.for %i = 0 to 10 {
+    // The store to %A two loops deeper invalidates the load of %A, but not
+    // the load of the distinct allocation %C.
+    // CHECK-NEXT: %3 = load %arg0[%c0] : memref<10xf32>
+    // CHECK-NEXT: %4 = addf %3, %2 : f32
+    %2 = load %A[%c0] : memref<10xf32>
+    %3 = load %C[%c0] : memref<10xf32>
+    %4 = addf %2, %3 : f32
+    affine.for %j = 0 to 10 {
+      affine.for %k = 0 to 10 {
+        store %4, %A[%k] : memref<10xf32>
+      }
+    }
+  }
+  return
+}
+
+// CHECK-LABEL: func @load_at_join
+func @load_at_join(%A : memref<10xf32>, %cond : i1, %i : index,
+                   %v : f32) -> f32 {
+  // CHECK-NEXT: %0 = load %arg0[%arg2] : memref<10xf32>
+  %0 = load %A[%i] : memref<10xf32>
+  cond_br %cond, ^bb1, ^bb2
+
+^bb1:
+  store %v, %A[%i] : memref<10xf32>
+  br ^bb2
+
+^bb2:
+  // CHECK: ^bb2:
+  // CHECK-NEXT: %1 = load %arg0[%arg2] : memref<10xf32>
+  %1 = load %A[%i] : memref<10xf32>
+  // CHECK-NEXT: return %1 : f32
+  return %1 : f32
+}
@@ -0,0 +1,256 @@
+// RUN: mlir-opt %s -affine-loop-fusion -fusion-global-planner -split-input-file | FileCheck %s
+// RUN: mlir-opt %s -affine-loop-fusion -fusion-global-planner -fusion-report -split-input-file 2>&1 >/dev/null | FileCheck %s --check-prefix=REPORT --check-prefix=GLOBAL
+// RUN: mlir-opt %s -affine-loop-fusion -fusion-report -split-input-file 2>&1 >/dev/null | FileCheck %s --check-prefix=REPORT --check-prefix=GREEDY
+
+// -----
+
+// CHECK: [[MAP0:#map[0-9]+]] = (d0, d1) -> (-d0 + d1)
+
+// The source loop nest writes 40 bytes, which the slice replaces with a private
+// memref of 4 bytes: 2 * (40 - 4) bytes are neither written nor read anymore.
+// REPORT: remark: fused 1 loop nest pair(s), saving an estimated 72 bytes of memory traffic
+
+// CHECK-LABEL: func @should_fuse_raw_dep_for_locality() {
+func @should_fuse_raw_dep_for_locality() {
+  %m = alloc() : memref<10xf32>
+  %cf7 = constant 7.0 : f32
+
+  affine.for %i0 = 0 to 10 {
+    store %cf7, %m[%i0] : memref<10xf32>
+  }
+  affine.for %i1 = 0 to 10 {
+    %v0 = load %m[%i1] : memref<10xf32>
+  }
+  // CHECK:      affine.for %i0 = 0 to 10 {
+  // CHECK-NEXT:   %1 = affine.apply [[MAP0]](%i0, %i0)
+  // CHECK-NEXT:   store %cst, %0[%1] : memref<1xf32>
+  // CHECK-NEXT:   %2 = affine.apply [[MAP0]](%i0, %i0)
+  // CHECK-NEXT:   %3 = load %0[%2] : memref<1xf32>
+  // CHECK-NEXT: }
+  // CHECK-NEXT: return
+  return
+}
+
+// -----
+
+// CHECK: [[MAP0:#map[0-9]+]] = (d0, d1) -> (-d0 + d1)
+
+// Greedy fusion first fuses the single-use producer of '%a' into the producer
+// of '%b', which then stores to two memrefs and can no longer be fused into
+// the two users of '%b'. The planner fuses the producer of '%b' into its users
+// first, which removes '%b', and then fuses the producer of '%a' into the first
+// of them, where it is kept for the second one.
+// GLOBAL: remark: fused 3 loop nest pair(s), saving an estimated 136 bytes of memory traffic
+// GREEDY: remark: fused 1 loop nest pair(s), saving an estimated 72 bytes of memory traffic
+
+// CHECK-LABEL: func @should_fuse_multi_use_producer_into_all_users() {
+func @should_fuse_multi_use_producer_into_all_users() {
+  %a = alloc() : memref<10xf32>
+  %b = alloc() : memref<10xf32>
+  %cf7 = constant 7.0 : f32
+
+  affine.for %i0 = 0 to 10 {
+    store %cf7, %a[%i0] : memref<10xf32>
+  }
+  affine.for %i1 = 0 to 10 {
+    %v0 = load %a[%i1] : memref<10xf32>
+    store %v0, %b[%i1] : memref<10xf32>
+  }
+  affine.for %i2 = 0 to 10 {
+    %v1 = load %b[%i2] : memref<10xf32>
+  }
+  affine.for %i3 = 0 to 10 {
+    %v2 = load %b[%i3] : memref<10xf32>
+  }
+  // CHECK:      %0 = alloc() : memref<1xf32>
+  // CHECK-NEXT: %1 = alloc() : memref<1xf32>
+  // CHECK-NEXT: %2 = alloc() : memref<1xf32>
+  // CHECK-NEXT: %3 = alloc() : memref<10xf32>
+  // CHECK-NEXT: %cst = constant 7.000000e+00 : f32
+  // CHECK-NEXT: affine.for %i0 = 0 to 10 {
+  // CHECK-NEXT:   store %cst, %3[%i0] : memref<10xf32>
+  // CHECK-NEXT: }
+  // CHECK-NEXT: affine.for %i1 = 0 to 10 {
+  // CHECK-NEXT:   %4 = affine.apply [[MAP0]](%i1, %i1)
+  // CHECK-NEXT:   store %cst, %0[%4] : memref<1xf32>
+  // CHECK-NEXT:   %5 = affine.apply [[MAP0]](%i1, %i1)
+  // CHECK-NEXT:   %6 = load %0[%5] : memref<1xf32>
+  // CHECK-NEXT:   %7 = affine.apply [[MAP0]](%i1, %i1)
+  // CHECK-NEXT:   store %6, %1[%7] : memref<1xf32>
+  // CHECK-NEXT:   %8 = affine.apply [[MAP0]](%i1, %i1)
+  // CHECK-NEXT:   %9 = load %1[%8] : memref<1xf32>
+  // CHECK-NEXT: }
+  // CHECK-NEXT: affine.for %i2 = 0 to 10 {
+  // CHECK-NEXT:   %10 = load %3[%i2] : memref<10xf32>
+  // CHECK-NEXT:   %11 = affine.apply [[MAP0]](%i2, %i2)
+  // CHECK-NEXT:   store %10, %2[%11] : memref<1xf32>
+  // CHECK-NEXT:   %12 = affine.apply [[MAP0]](%i2, %i2)
+  // CHECK-NEXT:   %13 = load %2[%12] : memref<1xf32>
+  // CHECK-NEXT: }
+  // CHECK-NEXT: return
+  return
+}
+
+// -----
+
+// The two loop nests both read '%arg0', which is read once instead of twice
+// after fusion.
+// REPORT: remark: fused 1 loop nest pair(s), saving an estimated 400 bytes of memory traffic
+
+// CHECK-LABEL: func @should_fuse_sibling_loop_nests(%arg0: memref<10x10xf32>) {
+func @should_fuse_sibling_loop_nests(%arg0: memref<10x10xf32>) {
+  %out0 = alloc() : memref<10xf32>
+  %out1 = alloc() : memref<10xf32>
+
+  affine.for %i0 = 0 to 10 {
+    affine.for %i1 = 0 to 10 {
+      %v0 = load %arg0[%i0, %i1] : memref<10x10xf32>
+      %v1 = load %out0[%i1] : memref<10xf32>
+      %v2 = addf %v0, %v1 : f32
+      store %v2, %out0[%i1] : memref<10xf32>
+    }
+  }
+  affine.for %i2 = 0 to 10 {
+    affine.for %i3 = 0 to 10 {
+      %v3 = load %arg0[%i2, %i3] : memref<10x10xf32>
+      %v4 = load %out1[%i3] : memref<10xf32>
+      %v5 = addf %v3, %v4 : f32
+      store %v5, %out1[%i3] : memref<10xf32>
+    }
+  }
+  // CHECK:      affine.for %i0 = 0 to 10 {
+  // CHECK-NEXT:   affine.for %i1 = 0 to 10 {
+  // CHECK-NEXT:     %2 = load %arg0[%i1, %i0] : memref<10x10xf32>
+  // CHECK-NEXT:     %3 = load %0[%i0] : memref<10xf32>
+  // CHECK-NEXT:     %4 = addf %2, %3 : f32
+  // CHECK-NEXT:     store %4, %0[%i0] : memref<10xf32>
+  // CHECK-NEXT:   }
+  // CHECK-NEXT:   affine.for %i2 = 0 to 10 {
+  // CHECK-NEXT:     %5 = load %arg0[%i2, %i0] : memref<10x10xf32>
+  // CHECK-NEXT:     %6 = load %1[%i0] : memref<10xf32>
+  // CHECK-NEXT:     %7 = addf %5, %6 : f32
+  // CHECK-NEXT:     store %7, %1[%i0] : memref<10xf32>
+  // CHECK-NEXT:   }
+  // CHECK-NEXT: }
+  // CHECK-NEXT: return
+  return
+}
+
+// -----
+
+// CHECK: [[MAP0:#map[0-9]+]] = (d0, d1) -> (-d0 + d1)
+
+// Fusing the second loop nest into the third one saves the most memory traffic
+// and is planned first. Fusing the first loop nest into the last one would then
+// create a cycle between the two fused loop nests: the third loop nest writes
+// '%w' after the first one reads it, and the last loop nest writes '%z' after
+// the second one reads it.
+// GLOBAL: remark: fused 1 loop nest pair(s), saving an estimated 152 bytes of memory traffic
+
+// CHECK-LABEL: func @should_not_fuse_across_planned_fusion() {
+func @should_not_fuse_across_planned_fusion() {
+  %w = alloc() : memref<20xf32>
+  %x = alloc() : memref<10xf32>
+  %y = alloc() : memref<20xf32>
+  %z = alloc() : memref<20xf32>
+  %cf7 = constant 7.0 : f32
+
+  affine.for %i0 = 0 to 10 {
+    %v0 = load %w[%i0] : memref<20xf32>
+    store %v0, %x[%i0] : memref<10xf32>
+  }
+  affine.for %i1 = 0 to 20 {
+    %v1 = load %z[%i1] : memref<20xf32>
+    store %v1, %y[%i1] : memref<20xf32>
+  }
+  affine.for %i2 = 0 to 20 {
+    %v2 = load %y[%i2] : memref<20xf32>
+    store %cf7, %w[%i2] : memref<20xf32>
+  }
+  affine.for %i3 = 0 to 10 {
+    %v3 = load %x[%i3] : memref<10xf32>
+    store %cf7, %z[%i3] : memref<20xf32>
+  }
+  // CHECK:      affine.for %i0 = 0 to 10 {
+  // CHECK-NEXT:   %4 = load %1[%i0] : memref<20xf32>
+  // CHECK-NEXT:   store %4, %2[%i0] : memref<10xf32>
+  // CHECK-NEXT: }
+  // CHECK-NEXT: affine.for %i1 = 0 to 20 {
+  // CHECK-NEXT:   %5 = load %3[%i1] : memref<20xf32>
+  // CHECK-NEXT:   %6 = affine.apply [[MAP0]](%i1, %i1)
+  // CHECK-NEXT:   store %5, %0[%6] : memref<1xf32>
+  // CHECK-NEXT:   %7 = affine.apply [[MAP0]](%i1, %i1)
+  // CHECK-NEXT:   %8 = load %0[%7] : memref<1xf32>
+  // CHECK-NEXT:   store %cst, %1[%i1] : memref<20xf32>
+  // CHECK-NEXT: }
+  // CHECK-NEXT: affine.for %i2 = 0 to 10 {
+  // CHECK-NEXT:   %9 = load %2[%i2] : memref<10xf32>
+  // CHECK-NEXT:   store %cst, %3[%i2] : memref<20xf32>
+  // CHECK-NEXT: }
+  // CHECK-NEXT: return
+  return
+}
+
+// -----
+
+// The three loop nests all read '%arg0'. The planner fuses the first loop nest
+// into the second one, and then the first one, i.e. the fused second one, into
+// the third one. The second one now reads '%arg0' twice, which sibling fusion
+// does not support, and this last fusion is skipped.
+// GLOBAL: remark: fused 1 loop nest pair(s), saving an estimated 400 bytes of memory traffic
+
+// CHECK-LABEL: func @should_skip_fusion_made_illegal_by_plan(%arg0: memref<10x10xf32>) {
+func @should_skip_fusion_made_illegal_by_plan(%arg0: memref<10x10xf32>) {
+  %out0 = alloc() : memref<10xf32>
+  %out1 = alloc() : memref<10xf32>
+  %out2 = alloc() : memref<10xf32>
+
+  affine.for %i0 = 0 to 10 {
+    affine.for %i1 = 0 to 10 {
+      %v0 = load %arg0[%i0, %i1] : memref<10x10xf32>
+      %v1 = load %out0[%i1] : memref<10xf32>
+      %v2 = addf %v0, %v1 : f32
+      store %v2, %out0[%i1] : memref<10xf32>
+    }
+  }
+  affine.for %i2 = 0 to 10 {
+    affine.for %i3 = 0 to 10 {
+      %v3 = load %arg0[%i2, %i3] : memref<10x10xf32>
+      %v4 = load %out1[%i3] : memref<10xf32>
+      %v5 = addf %v3, %v4 : f32
+      store %v5, %out1[%i3] : memref<10xf32>
+    }
+  }
+  affine.for %i4 = 0 to 10 {
+    affine.for %i5 = 0 to 10 {
+      %v6 = load %arg0[%i4, %i5] : memref<10x10xf32>
+      %v7 = load %out2[%i5] : memref<10xf32>
+      %v8 = addf %v6, %v7 : f32
+      store %v8, %out2[%i5] : memref<10xf32>
+    }
+  }
+  // CHECK:      affine.for %i0 = 0 to 10 {
+  // CHECK-NEXT:   affine.for %i1 = 0 to 10 {
+  // CHECK-NEXT:     %3 = load %arg0[%i1, %i0] : memref<10x10xf32>
+  // CHECK-NEXT:     %4 = load %0[%i0] : memref<10xf32>
+  // CHECK-NEXT:     %5 = addf %3, %4 : f32
+  // CHECK-NEXT:     store %5, %0[%i0] : memref<10xf32>
+  // CHECK-NEXT:   }
+  // CHECK-NEXT:   affine.for %i2 = 0 to 10 {
+  // CHECK-NEXT:     %6 = load %arg0[%i2, %i0] : memref<10x10xf32>
+  // CHECK-NEXT:     %7 = load %1[%i0] : memref<10xf32>
+  // CHECK-NEXT:     %8 = addf %6, %7 : f32
+  // CHECK-NEXT:     store %8, %1[%i0] : memref<10xf32>
+  // CHECK-NEXT:   }
+  // CHECK-NEXT: }
+  // CHECK-NEXT: affine.for %i3 = 0 to 10 {
+  // CHECK-NEXT:   affine.for %i4 = 0 to 10 {
+  // CHECK-NEXT:     %9 = load %arg0[%i4, %i3] : memref<10x10xf32>
+  // CHECK-NEXT:     %10 = load %2[%i3] : memref<10xf32>
+  // CHECK-NEXT:     %11 = addf %9, %10 : f32
+  // CHECK-NEXT:     store %11, %2[%i3] : memref<10xf32>
+  // CHECK-NEXT:   }
+  // CHECK-NEXT: }
+  // CHECK-NEXT: return
+  return
+}
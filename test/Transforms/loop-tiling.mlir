@@ -1,5 +1,7 @@
 // RUN: mlir-opt %s -split-input-file  -affine-loop-tile -tile-size=32 | FileCheck %s
 // RUN: mlir-opt %s -split-input-file -affine-loop-tile -tile-cache-size=512 | FileCheck %s --check-prefix=MODEL
+// RUN: mlir-opt %s -split-input-file -affine-loop-tile -tile-cache-sizes=32,512 | FileCheck %s --check-prefix=MULTI
+// RUN: mlir-opt %s -split-input-file -affine-loop-tile -tile-cache-sizes=512,32 | FileCheck %s --check-prefix=MULTI
 
 // -----
 
@@ -78,11 +80,15 @@ func @loop_max_min_bound(%A : memref<? x i32>, %L : index, %U : index) {
 
 // -----
 
-// Cache size is set to 512 KiB. This loop nest accesses about 49 MiB, and the
-// tile sizes chosen would be 6 x 6 x 6. However, to avoid min/max, which is
-// possible here, they are adjusted to 4 x 4 x 5.
+// Cache size is set to 512 KiB. This loop nest accesses about 49 MiB. A tile
+// of sizes ti x tj x tk accesses ti * tk + tk * tj + ti * tj elements of 256
+// bytes, and the largest tile that fits is 16 x 32 x 32. However, to avoid
+// min/max, which is possible here, the sizes are adjusted to 16 x 32 x 25.
+// With a 32 KiB cache inside the 512 KiB one, the tiles are themselves tiled
+// with sizes 4 x 8 x 8, adjusted to 4 x 8 x 5 to divide the outer tile sizes.
 
 // MODEL-LABEL: func @simple_matmul
+// MULTI-LABEL: func @simple_matmul
 func @simple_matmul(%arg0: memref<256x256xvector<64xf32>>, %arg1: memref<256x256xvector<64xf32>>, %arg2: memref<256x256xvector<64xf32>>) -> memref<256x256xvector<64xf32>> {
   affine.for %i = 0 to 256 {
     affine.for %j = 0 to 256 {
@@ -98,9 +104,18 @@ func @simple_matmul(%arg0: memref<256x256xvector<64xf32>>, %arg1: memref<256x256
   }
   return %arg2 : memref<256x256xvector<64xf32>>
 }
-// MODEL:       affine.for %i0 = 0 to 256 step 4 {
-// MODEL-NEXT:    affine.for %i1 = 0 to 256 step 4 {
-// MODEL-NEXT:      affine.for %i2 = 0 to 250 step 5 {
+// MODEL:       affine.for %i0 = 0 to 256 step 16 {
+// MODEL-NEXT:    affine.for %i1 = 0 to 256 step 32 {
+// MODEL-NEXT:      affine.for %i2 = 0 to 250 step 25 {
+// MODEL-NEXT:        affine.for %i3 = #map{{[0-9]+}}(%i0) to #map{{[0-9]+}}(%i0) {
+
+// MULTI:       affine.for %i0 = 0 to 256 step 16 {
+// MULTI-NEXT:    affine.for %i1 = 0 to 256 step 32 {
+// MULTI-NEXT:      affine.for %i2 = 0 to 250 step 25 {
+// MULTI-NEXT:        affine.for %i3 = #map{{[0-9]+}}(%i0) to #map{{[0-9]+}}(%i0) step 4 {
+// MULTI-NEXT:          affine.for %i4 = #map{{[0-9]+}}(%i1) to #map{{[0-9]+}}(%i1) step 8 {
+// MULTI-NEXT:            affine.for %i5 = #map{{[0-9]+}}(%i2) to #map{{[0-9]+}}(%i2) step 5 {
+// MULTI-NEXT:              affine.for %i6 = #map{{[0-9]+}}(%i3) to #map{{[0-9]+}}(%i3) {
 
 
 // -----
@@ -64,6 +64,31 @@ func @remap_drop_region() {
   return
 }
 
+// CHECK-LABEL: func @drop_operand_in_place
+func @drop_operand_in_place(%arg0: i32) {
+  // CHECK-NEXT: "test.drop_operand_in_place"() : () -> ()
+  "test.drop_operand_in_place"(%arg0) : (i32) -> ()
+  return
+}
+
+// CHECK-LABEL: func @undo_drop_operand_in_place
+func @undo_drop_operand_in_place(%arg0: i32, %arg1: i32) {
+  // The operation is still illegal after the update, which is undone.
+  // CHECK-NEXT: "test.drop_operand_in_place"(%arg0, %arg1) : (i32, i32) -> ()
+  "test.drop_operand_in_place"(%arg0, %arg1) : (i32, i32) -> ()
+  return
+}
+
+// CHECK-LABEL: func @undo_replace_operand_in_place
+func @undo_replace_operand_in_place(%arg0: i32) {
+  // The update uses a created operation. Both are undone, and the operation
+  // keeps its original operand.
+  // CHECK-NEXT: "test.replace_operand_in_place"(%arg0) : (i32) -> ()
+  // CHECK-NEXT: return
+  "test.replace_operand_in_place"(%arg0) : (i32) -> ()
+  return
+}
+
 // -----
 
 func @dropped_input_in_use(%arg: i16, %arg2: i64) {
@@ -0,0 +1,70 @@
+// RUN: sed -n 's,^// DB: ,,p' %s > %t
+// RUN: mlir-opt %s -affine-loop-tile -tuning-db=%t | FileCheck %s --check-prefix=TILE
+// RUN: mlir-opt %s -affine-loop-unroll-jam -tuning-db=%t | FileCheck %s --check-prefix=JAM
+// RUN: mlir-opt %s -affine-loop-unroll -tuning-db=%t | FileCheck %s --check-prefix=UNROLL
+// RUN: mlir-opt %s -affine-loop-tile -affine-loop-unroll-jam -affine-loop-unroll -tuning-db=%t | FileCheck %s --check-prefix=PIPELINE
+
+// The records are keyed by the structural hash of the loops of @tuned and
+// @replay, as computed by hashLoopNest.
+
+// The nest of @tuned is tiled by 4x2, unroll-and-jammed by 2, and its
+// innermost loop unrolled by 2.
+// DB: tile bfe1227ffcad288f 1.0 4 2
+// DB: unroll-jam bfe1227ffcad288f 1.0 2
+// DB: unroll 4f26f986cd27d8e0 1.0 2
+
+// The nest of @replay is left untiled and not unroll-and-jammed, as recorded
+// by the autotuner, and its innermost loop is unrolled by 2.
+// DB: tile fcb545e8898603fe 1.0
+// DB: unroll-jam fcb545e8898603fe 1.0 1
+// DB: unroll 321575089c78d269 1.0 2
+
+// TILE-LABEL: func @tuned
+// TILE-NEXT:    affine.for %i0 = 0 to 8 step 4 {
+// TILE-NEXT:      affine.for %i1 = 0 to 8 step 2 {
+
+// JAM-LABEL: func @tuned
+// JAM-NEXT:     affine.for %i0 = 0 to 8 step 2 {
+// JAM-NEXT:       affine.for %i1 = 0 to 8 {
+
+// UNROLL-LABEL: func @tuned
+// UNROLL-NEXT:  affine.for %i0 = 0 to 8 {
+// UNROLL-NEXT:    affine.for %i1 = 0 to 8 step 2 {
+
+// PIPELINE-LABEL: func @tuned
+// PIPELINE-NEXT:  affine.for %i0 = 0 to 8 step 4 {
+// PIPELINE-NEXT:    affine.for %i1 = 0 to 8 step 2 {
+func @tuned(%A : memref<8x8xf32>) {
+  affine.for %i = 0 to 8 {
+    affine.for %j = 0 to 8 {
+      %v = load %A[%i, %j] : memref<8x8xf32>
+      store %v, %A[%i, %j] : memref<8x8xf32>
+    }
+  }
+  return
+}
+
+// TILE-LABEL: func @replay
+// TILE-NEXT:    affine.for %i0 = 0 to 16 {
+// TILE-NEXT:      affine.for %i1 = 0 to 16 {
+
+// JAM-LABEL: func @replay
+// JAM-NEXT:     affine.for %i0 = 0 to 16 {
+// JAM-NEXT:       affine.for %i1 = 0 to 16 {
+
+// UNROLL-LABEL: func @replay
+// UNROLL-NEXT:  affine.for %i0 = 0 to 16 {
+// UNROLL-NEXT:    affine.for %i1 = 0 to 16 step 2 {
+
+// PIPELINE-LABEL: func @replay
+// PIPELINE-NEXT:  affine.for %i0 = 0 to 16 {
+// PIPELINE-NEXT:    affine.for %i1 = 0 to 16 step 2 {
+func @replay(%A : memref<16x16xf32>) {
+  affine.for %i = 0 to 16 {
+    affine.for %j = 0 to 16 {
+      %v = load %A[%i, %j] : memref<16x16xf32>
+      store %v, %A[%i, %j] : memref<16x16xf32>
+    }
+  }
+  return
+}
@@ -0,0 +1,26 @@
+// RUN: rm -f %t
+// RUN: mlir-cpu-runner %s -autotune -autotune-max-variants=4 -autotune-repetitions=1 -tuning-db=%t | FileCheck %s
+// RUN: FileCheck -check-prefix=DB %s < %t
+// RUN: not mlir-cpu-runner %s -autotune 2>&1 | FileCheck -check-prefix=NODB %s
+
+// CHECK: loop nest 0: 4 variants, best time
+
+// DB-DAG: {{^}}tile {{[0-9a-f]+}}
+// DB-DAG: {{^}}unroll-jam {{[0-9a-f]+ [0-9.e+-]+ [124]}}
+// DB-DAG: {{^}}unroll {{[0-9a-f]+ [0-9.e+-]+ [1248]}}
+
+// NODB: Error: -autotune requires a -tuning-db file
+
+// The unroll-and-jam pass only visits the first operation of a function, so
+// the loop nest starts the entry point for its factor to be tuned.
+func @main(%A : memref<16x16xf32>) {
+  affine.for %i = 0 to 16 {
+    affine.for %j = 0 to 16 {
+      %cst = constant 1.0 : f32
+      %v = load %A[%i, %j] : memref<16x16xf32>
+      %s = addf %v, %cst : f32
+      store %s, %A[%i, %j] : memref<16x16xf32>
+    }
+  }
+  return
+}
@@ -3,6 +3,24 @@
 // RUN: mlir-cpu-runner %s -O3 | FileCheck %s
 // RUN: mlir-cpu-runner %s -O3 -loop-distribute -loop-vectorize | FileCheck %s
 // RUN: mlir-cpu-runner %s -loop-distribute -loop-vectorize | FileCheck %s
+// RUN: rm -rf %t && mlir-cpu-runner %s -O3 -object-cache-dir=%t | FileCheck %s
+// RUN: mlir-cpu-runner %s -O3 -object-cache-dir=%t | FileCheck %s
+// RUN: ls %t | count 1
+// RUN: mlir-cpu-runner %s -O0 -object-cache-dir=%t | FileCheck %s
+// RUN: ls %t | count 2
+// A truncated object is a cache miss: the module is optimized and compiled
+// again, and the object is replaced.
+// RUN: find %t -name "*.o" -exec truncate -s 0 {} +
+// RUN: mlir-cpu-runner %s -O3 -object-cache-dir=%t | FileCheck %s
+// RUN: mlir-cpu-runner %s -O3 -object-cache-dir=%t | FileCheck %s
+// RUN: ls %t | count 2
+// RUN: mlir-cpu-runner %s -lazy-jit | FileCheck %s
+// RUN: mlir-cpu-runner %s -O3 -lazy-jit | FileCheck %s
+// RUN: mlir-cpu-runner -e foo -init-value 1000 %s -lazy-jit | FileCheck -check-prefix=NOMAIN %s
+// RUN: mlir-cpu-runner %s -compile-threads=4 | FileCheck %s
+// RUN: mlir-cpu-runner %s -O3 -compile-threads=2 | FileCheck %s
+// RUN: mlir-cpu-runner -e foo -init-value 1000 %s -compile-threads=4 | FileCheck -check-prefix=NOMAIN %s
+// RUN: mlir-cpu-runner %s -lazy-jit -jit-timing 2>&1 >/dev/null | FileCheck -check-prefix=TIMING %s
 
 func @fabsf(f32) -> f32
 
@@ -31,3 +49,8 @@ func @foo(%a : memref<1x1xf32>) -> memref<1x1xf32> {
 }
 // NOMAIN: 2.234000e+03
 // NOMAIN-NEXT: 2.234000e+03
+
+// TIMING: Time to first call
+// TIMING-DAG: Engine creation
+// TIMING-DAG: Entry point lookup
+// TIMING-DAG: Entry point execution
@@ -17,9 +17,14 @@
 //
 // This is a command line utility that executes an MLIR file on the CPU by
 // translating MLIR to LLVM IR before JIT-compiling and executing the latter.
+// With -autotune, it instead searches the parameters of the loop
+// transformations applied to the entry point for those that make it run the
+// fastest, and records them in a tuning database.
 //
 //===----------------------------------------------------------------------===//
 
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/LoopAnalysis.h"
 #include "mlir/Conversion/StandardToLLVM/ConvertStandardToLLVMPass.h"
 #include "mlir/ExecutionEngine/ExecutionEngine.h"
 #include "mlir/ExecutionEngine/MemRefUtils.h"
@@ -32,21 +37,28 @@
 #include "mlir/Pass/Pass.h"
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Support/FileUtilities.h"
+#include "mlir/Transforms/LoopUtils.h"
 #include "mlir/Transforms/Passes.h"
+#include "mlir/Transforms/TuningDatabase.h"
 
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassNameParser.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FileUtilities.h"
 #include "llvm/Support/InitLLVM.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/StringSaver.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include <chrono>
 #include <numeric>
+#include <random>
+#include <set>
 
 using namespace mlir;
 using llvm::Error;
@@ -89,6 +101,29 @@ static llvm::cl::list<std::string>
                  llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated,
                  llvm::cl::cat(clOptionsCategory));
 
+static llvm::cl::opt<std::string> objectCacheDir(
+    "object-cache-dir",
+    llvm::cl::desc("Directory in which JIT-compiled objects are cached across "
+                   "runs"),
+    llvm::cl::value_desc("directory"), llvm::cl::init(""));
+
+static llvm::cl::OptionCategory jitOptionsCategory("JIT options");
+static llvm::cl::opt<bool>
+    lazyJIT("lazy-jit",
+            llvm::cl::desc("Compile each function on its first call instead of "
+                           "compiling the whole module upfront"),
+            llvm::cl::init(false), llvm::cl::cat(jitOptionsCategory));
+static llvm::cl::opt<unsigned> compileThreads(
+    "compile-threads",
+    llvm::cl::desc("Split the module and compile the partitions on this many "
+                   "threads"),
+    llvm::cl::init(1), llvm::cl::cat(jitOptionsCategory));
+static llvm::cl::opt<bool> jitTiming(
+    "jit-timing",
+    llvm::cl::desc("Report the time to the first call of the entry point, "
+                   "split into engine creation, lookup and execution"),
+    llvm::cl::init(false), llvm::cl::cat(jitOptionsCategory));
+
 static std::unique_ptr<Module> parseMLIRInput(StringRef inputFilename,
                                               MLIRContext *context) {
   // Set up the input file.
@@ -160,9 +195,64 @@ static LogicalResult convertAffineStandardToLLVMIR(Module *module) {
   return manager.run(module);
 }
 
+// Timers measuring the time to the first call of the entry point.  With eager
+// compilation, the whole module is compiled during the engine creation.  With
+// lazy compilation, the entry point is compiled during its execution, as is any
+// function it calls for the first time.
+struct JITTimers {
+  JITTimers()
+      : group("mlir-cpu-runner", "Time to first call"),
+        creation("creation", "Engine creation", group),
+        lookup("lookup", "Entry point lookup", group),
+        execution("execution", "Entry point execution", group) {}
+
+  // The group prints the report when its last timer is destroyed, so it must
+  // outlive the timers.
+  llvm::TimerGroup group;
+  llvm::Timer creation, lookup, execution;
+};
+
+// Create an execution engine for `module` and call the packed entry point with
+// `args`.
+static Error createEngineAndCall(
+    Module *module, StringRef entryPoint,
+    std::function<llvm::Error(llvm::Module *)> transformer,
+    StringRef transformerKey, void **args) {
+  JITTimers timers;
+  auto getTimer = [&](llvm::Timer &timer) -> llvm::Timer * {
+    return jitTiming ? &timer : nullptr;
+  };
+
+  SmallVector<StringRef, 4> libs(clSharedLibs.begin(), clSharedLibs.end());
+  std::unique_ptr<mlir::ExecutionEngine> engine;
+  {
+    llvm::TimeRegion region(getTimer(timers.creation));
+    auto expectedEngine = mlir::ExecutionEngine::create(
+        module, transformer, libs, objectCacheDir, transformerKey, lazyJIT,
+        compileThreads);
+    if (!expectedEngine)
+      return expectedEngine.takeError();
+    engine = std::move(*expectedEngine);
+  }
+
+  void (*fptr)(void **);
+  {
+    llvm::TimeRegion region(getTimer(timers.lookup));
+    auto expectedFPtr = engine->lookup(entryPoint);
+    if (!expectedFPtr)
+      return expectedFPtr.takeError();
+    fptr = *expectedFPtr;
+  }
+
+  llvm::TimeRegion region(getTimer(timers.execution));
+  (*fptr)(args);
+  return Error::success();
+}
+
 static Error compileAndExecuteFunctionWithMemRefs(
     Module *module, StringRef entryPoint,
-    std::function<llvm::Error(llvm::Module *)> transformer) {
+    std::function<llvm::Error(llvm::Module *)> transformer,
+    StringRef transformerKey) {
   Function *mainFunction = module->getNamedFunction(entryPoint);
   if (!mainFunction || mainFunction->getBlocks().empty()) {
     return make_string_error("entry point not found");
@@ -185,18 +275,10 @@ static Error compileAndExecuteFunctionWithMemRefs(
   if (failed(convertAffineStandardToLLVMIR(module)))
     return make_string_error("conversion to the LLVM IR dialect failed");
 
-  SmallVector<StringRef, 4> libs(clSharedLibs.begin(), clSharedLibs.end());
-  auto expectedEngine =
-      mlir::ExecutionEngine::create(module, transformer, libs);
-  if (!expectedEngine)
-    return expectedEngine.takeError();
-
-  auto engine = std::move(*expectedEngine);
-  auto expectedFPtr = engine->lookup(entryPoint);
-  if (!expectedFPtr)
-    return expectedFPtr.takeError();
-  void (*fptr)(void **) = *expectedFPtr;
-  (*fptr)(expectedArguments->data());
+  if (auto error = createEngineAndCall(module, entryPoint, transformer,
+                                       transformerKey,
+                                       expectedArguments->data()))
+    return error;
   printMemRefArguments(argTypes, resTypes, *expectedArguments);
   freeMemRefArguments(*expectedArguments);
 
@@ -205,7 +287,8 @@ static Error compileAndExecuteFunctionWithMemRefs(
 
 static Error compileAndExecuteSingleFloatReturnFunction(
     Module *module, StringRef entryPoint,
-    std::function<llvm::Error(llvm::Module *)> transformer) {
+    std::function<llvm::Error(llvm::Module *)> transformer,
+    StringRef transformerKey) {
   Function *mainFunction = module->getNamedFunction(entryPoint);
   if (!mainFunction || mainFunction->isExternal()) {
     return make_string_error("entry point not found");
@@ -224,24 +307,14 @@ static Error compileAndExecuteSingleFloatReturnFunction(
   if (llvmTy != llvmTy->getFloatTy(llvmTy->getContext()))
     return make_string_error("only single llvm.f32 function result supported");
 
-  SmallVector<StringRef, 4> libs(clSharedLibs.begin(), clSharedLibs.end());
-  auto expectedEngine =
-      mlir::ExecutionEngine::create(module, transformer, libs);
-  if (!expectedEngine)
-    return expectedEngine.takeError();
-
-  auto engine = std::move(*expectedEngine);
-  auto expectedFPtr = engine->lookup(entryPoint);
-  if (!expectedFPtr)
-    return expectedFPtr.takeError();
-  void (*fptr)(void **) = *expectedFPtr;
-
   float res;
   struct {
     void *data;
   } data;
   data.data = &res;
-  (*fptr)((void **)&data);
+  if (auto error = createEngineAndCall(module, entryPoint, transformer,
+                                       transformerKey, (void **)&data))
+    return error;
 
   // Intentional printing of the output so we can test.
   llvm::outs() << res;
@@ -249,6 +322,350 @@ static Error compileAndExecuteSingleFloatReturnFunction(
   return Error::success();
 }
 
+namespace {
+// The transformations applied to a loop nest by a variant. The perfectly
+// nested loops at the root of the nest are tiled first, the root of the
+// resulting nest is then unroll-and-jammed if it is the first operation of the
+// entry point, and its innermost loops are unrolled.
+struct LoopNestConfig {
+  // Empty if the nest is not tiled.
+  SmallVector<unsigned, 6> tileSizes;
+  unsigned unrollJamFactor = 1;
+  unsigned unrollFactor = 1;
+};
+
+// A record of the tuning database, keyed by the structural hash of the loop
+// the transformation is applied to.
+struct TunedParameters {
+  TuningParameterKind kind;
+  uint64_t hash;
+  SmallVector<unsigned, 6> parameters;
+};
+
+// The parameters that can be tried on a loop nest.
+struct LoopNestSpace {
+  // The tile sizes tried for each of the perfectly nested loops at its root.
+  SmallVector<SmallVector<unsigned, 4>, 6> tileSizeChoices;
+  SmallVector<unsigned, 3> unrollJamFactorChoices;
+  SmallVector<unsigned, 4> unrollFactorChoices;
+};
+} // end anonymous namespace
+
+// Returns true if the unroll-and-jam pass applies to the loop nest rooted at
+// 'rootForOp' of the entry block: the pass only visits the first operation of
+// the entry block.
+static bool isUnrollJammedByPass(AffineForOp rootForOp) {
+  Operation *op = rootForOp.getOperation();
+  return &op->getBlock()->front() == op;
+}
+
+static LoopNestSpace getLoopNestSpace(AffineForOp rootForOp) {
+  LoopNestSpace space;
+  SmallVector<AffineForOp, 6> band;
+  getPerfectlyNestedLoops(band, rootForOp);
+  for (auto forOp : band) {
+    // Powers of two from 4 to the trip count, up to 256.
+    Optional<uint64_t> tripCount = getConstantTripCount(forOp);
+    SmallVector<unsigned, 4> choices;
+    for (unsigned tSize = 4; tSize <= 256; tSize *= 2)
+      if (!tripCount.hasValue() || tSize <= tripCount.getValue())
+        choices.push_back(tSize);
+    if (choices.empty())
+      choices.push_back(1);
+    space.tileSizeChoices.push_back(choices);
+  }
+  space.unrollJamFactorChoices.push_back(1);
+  if (band.size() > 1 && isUnrollJammedByPass(rootForOp)) {
+    space.unrollJamFactorChoices.push_back(2);
+    space.unrollJamFactorChoices.push_back(4);
+  }
+  for (unsigned factor = 1; factor <= 8; factor *= 2)
+    space.unrollFactorChoices.push_back(factor);
+  return space;
+}
+
+// Returns the configurations tried on a loop nest: all of those of 'space' if
+// there are at most 'maxVariants' of them, and a sample of them otherwise. The
+// first one leaves the nest untransformed.
+static std::vector<LoopNestConfig>
+getLoopNestConfigs(const LoopNestSpace &space, unsigned maxVariants,
+                   std::mt19937 &generator) {
+  // The configurations are numbered in a mixed radix whose digits select
+  // whether the nest is tiled, the unroll-and-jam factor, the unroll factor,
+  // and the tile size of each loop.
+  SmallVector<uint64_t, 8> radices = {2, space.unrollJamFactorChoices.size(),
+                                      space.unrollFactorChoices.size()};
+  for (auto &choices : space.tileSizeChoices)
+    radices.push_back(choices.size());
+  uint64_t numConfigs = 1;
+  for (uint64_t radix : radices)
+    numConfigs = std::min<uint64_t>(numConfigs * radix, 1ULL << 32);
+
+  auto getConfig = [&](uint64_t index) {
+    SmallVector<uint64_t, 8> digits;
+    for (uint64_t radix : radices) {
+      digits.push_back(index % radix);
+      index /= radix;
+    }
+    LoopNestConfig config;
+    config.unrollJamFactor = space.unrollJamFactorChoices[digits[1]];
+    config.unrollFactor = space.unrollFactorChoices[digits[2]];
+    if (digits[0] == 1)
+      for (unsigned i = 0, e = space.tileSizeChoices.size(); i < e; ++i)
+        config.tileSizes.push_back(space.tileSizeChoices[i][digits[i + 3]]);
+    return config;
+  };
+
+  // Untiled configurations differ in fewer digits than they have, so they
+  // are deduplicated on their parameters.
+  std::vector<LoopNestConfig> configs;
+  std::set<std::vector<unsigned>> seen;
+  auto addConfig = [&](uint64_t index) {
+    LoopNestConfig config = getConfig(index);
+    std::vector<unsigned> key = {config.unrollJamFactor, config.unrollFactor};
+    key.insert(key.end(), config.tileSizes.begin(), config.tileSizes.end());
+    if (seen.insert(key).second)
+      configs.push_back(config);
+  };
+
+  addConfig(0);
+  if (numConfigs <= maxVariants) {
+    for (uint64_t index = 1; index < numConfigs; ++index)
+      addConfig(index);
+    return configs;
+  }
+  std::uniform_int_distribution<uint64_t> distribution(1, numConfigs - 1);
+  // Bound the number of draws in case most of them are duplicates.
+  for (unsigned i = 0; configs.size() < maxVariants && i < 16 * maxVariants;
+       ++i)
+    addConfig(distribution(generator));
+  return configs;
+}
+
+// Returns true if 'forOp' has no loop nested in it.
+static bool isInnermostLoop(AffineForOp forOp) {
+  bool hasInnerLoops = false;
+  forOp.getOperation()->walk<AffineForOp>([&](AffineForOp innerForOp) {
+    hasInnerLoops |= innerForOp != forOp;
+  });
+  return !hasInnerLoops;
+}
+
+// Applies 'config' to the loop nest rooted at 'rootForOp', and appends to
+// 'records' the parameters that make the loop tiling and unrolling passes
+// apply the same transformations. A record is appended for every loop that
+// the passes look up, so that they never fall back to their default
+// parameters on the tuned loop nests.
+static Error applyLoopNestConfig(AffineForOp rootForOp,
+                                 const LoopNestConfig &config,
+                                 std::vector<TunedParameters> *records) {
+  // The transformations may replace the root of the nest or, for
+  // unroll-and-jam, insert a cleanup loop after it. The innermost loops are
+  // therefore collected between the operations around the nest.
+  Block *block = rootForOp.getOperation()->getBlock();
+  Operation *prevOp = rootForOp.getOperation()->getPrevNode();
+  Operation *nextOp = rootForOp.getOperation()->getNextNode();
+  bool isUnrollJammed = isUnrollJammedByPass(rootForOp);
+  SmallVector<AffineForOp, 6> band;
+  getPerfectlyNestedLoops(band, rootForOp);
+  records->push_back({TuningParameterKind::TileSizes, hashLoopNest(rootForOp),
+                      config.tileSizes});
+  if (!config.tileSizes.empty()) {
+    SmallVector<AffineForOp, 12> tiledNest;
+    if (failed(tileCodeGen(band, config.tileSizes, &tiledNest)))
+      return make_string_error("tiling failed");
+    rootForOp = tiledNest.front();
+  }
+
+  // A factor of 1 is recorded too, so that the pass does not unroll-and-jam
+  // the nest by its default factor.
+  if (isUnrollJammed) {
+    records->push_back({TuningParameterKind::UnrollJamFactor,
+                        hashLoopNest(rootForOp),
+                        {config.unrollJamFactor}});
+    // Unroll-and-jam may fail, e.g. if the trip count is smaller than the
+    // factor, in which case the pass also leaves the loop unchanged.
+    (void)loopUnrollJamByFactor(rootForOp, config.unrollJamFactor);
+  }
+
+  std::vector<AffineForOp> innermostLoops;
+  Operation *firstOp = prevOp ? prevOp->getNextNode() : &block->front();
+  for (Operation *op = firstOp; op != nextOp; op = op->getNextNode())
+    op->walk<AffineForOp>([&](AffineForOp forOp) {
+      if (isInnermostLoop(forOp))
+        innermostLoops.push_back(forOp);
+    });
+  for (auto forOp : innermostLoops) {
+    records->push_back({TuningParameterKind::UnrollFactor, hashLoopNest(forOp),
+                        {config.unrollFactor}});
+    (void)loopUnrollByFactor(forOp, config.unrollFactor);
+  }
+  return Error::success();
+}
+
+// Parses 'source', applies 'configs' to the outermost loop nests of the entry
+// point in order, and returns the fastest of the execution times of the entry
+// point. The tuned parameters of the variant are appended to 'records'.
+static llvm::Expected<double>
+timeVariant(StringRef source, MLIRContext *context, StringRef entryPoint,
+            std::function<llvm::Error(llvm::Module *)> transformer,
+            ArrayRef<LoopNestConfig> configs,
+            std::vector<TunedParameters> *records) {
+  std::unique_ptr<Module> module(parseSourceString(source, context));
+  if (!module)
+    return make_string_error("could not parse the input IR");
+  Function *mainFunction = module->getNamedFunction(entryPoint);
+  if (!mainFunction || mainFunction->getBlocks().empty())
+    return make_string_error("entry point not found");
+
+  SmallVector<AffineForOp, 4> rootForOps;
+  for (auto &op : mainFunction->front())
+    if (auto forOp = dyn_cast<AffineForOp>(op))
+      rootForOps.push_back(forOp);
+  assert(rootForOps.size() >= configs.size() && "too many configurations");
+  for (unsigned i = 0, e = configs.size(); i < e; ++i)
+    if (auto error = applyLoopNestConfig(rootForOps[i], configs[i], records))
+      return std::move(error);
+
+  float init = std::stof(initValue.getValue());
+  auto expectedArguments = allocateMemRefArguments(mainFunction, init);
+  if (!expectedArguments)
+    return expectedArguments.takeError();
+
+  auto timeEntryPoint = [&]() -> llvm::Expected<double> {
+    if (failed(convertAffineStandardToLLVMIR(module.get())))
+      return make_string_error("conversion to the LLVM IR dialect failed");
+
+    // The variants are not cached: they would all be looked up with the same
+    // transformer.
+    SmallVector<StringRef, 4> libs(clSharedLibs.begin(), clSharedLibs.end());
+    auto expectedEngine = mlir::ExecutionEngine::create(
+        module.get(), transformer, libs, /*objectCacheDir=*/"",
+        /*transformerKey=*/"", /*lazy=*/false, compileThreads);
+    if (!expectedEngine)
+      return expectedEngine.takeError();
+    auto expectedFPtr = (*expectedEngine)->lookup(entryPoint);
+    if (!expectedFPtr)
+      return expectedFPtr.takeError();
+
+    double bestTime = std::numeric_limits<double>::infinity();
+    for (unsigned i = 0; i < std::max(1U, autotuneRepetitions.getValue());
+         ++i) {
+      auto start = std::chrono::steady_clock::now();
+      (**expectedFPtr)(expectedArguments->data());
+      std::chrono::duration<double> time =
+          std::chrono::steady_clock::now() - start;
+      bestTime = std::min(bestTime, time.count());
+    }
+    return bestTime;
+  };
+  auto expectedTime = timeEntryPoint();
+  freeMemRefArguments(*expectedArguments);
+  return expectedTime;
+}
+
+// Tunes the outermost loop nests of the entry point one after the other: the
+// variants of a loop nest are timed with the best configurations found for the
+// loop nests before it and the loop nests after it untransformed. The tuned
+// parameters of the best configuration of every loop nest are then recorded in
+// the tuning database.
+static Error autotuneEntryPoint(
+    StringRef inputFilename, MLIRContext *context, StringRef entryPoint,
+    std::function<llvm::Error(llvm::Module *)> transformer) {
+  StringRef databaseFilename = getTuningDatabaseFilename();
+  if (databaseFilename.empty())
+    return make_string_error("-autotune requires a -tuning-db file");
+  if (mainFuncType.getValue() != "memrefs")
+    return make_string_error("-autotune requires an entry point on memrefs");
+
+  std::string errorMessage;
+  TuningDatabase database;
+  if (llvm::sys::fs::exists(databaseFilename) &&
+      failed(database.load(databaseFilename, &errorMessage)))
+    return make_string_error(errorMessage);
+
+  auto file = openInputFile(inputFilename, &errorMessage);
+  if (!file)
+    return make_string_error(errorMessage);
+  std::string source = file->getBuffer();
+
+  // Find the parameters to try on each loop nest.
+  std::vector<LoopNestSpace> spaces;
+  {
+    std::unique_ptr<Module> module(parseSourceString(source, context));
+    if (!module)
+      return make_string_error("could not parse the input IR");
+    Function *mainFunction = module->getNamedFunction(entryPoint);
+    if (!mainFunction || mainFunction->getBlocks().empty())
+      return make_string_error("entry point not found");
+    for (auto &op : mainFunction->front())
+      if (auto forOp = dyn_cast<AffineForOp>(op))
+        spaces.push_back(getLoopNestSpace(forOp));
+  }
+  if (spaces.empty())
+    return make_string_error("no loop nest to tune in the entry point");
+
+  std::mt19937 generator(autotuneSeed);
+  std::vector<LoopNestConfig> bestConfigs;
+  std::vector<TunedParameters> bestRecords;
+  double bestTime = 0.0;
+  for (unsigned i = 0, e = spaces.size(); i < e; ++i) {
+    auto configs =
+        getLoopNestConfigs(spaces[i], autotuneMaxVariants, generator);
+    bestConfigs.emplace_back();
+    double baselineTime = 0.0;
+    Optional<unsigned> bestIndex;
+    for (unsigned j = 0, f = configs.size(); j < f; ++j) {
+      bestConfigs.back() = configs[j];
+      std::vector<TunedParameters> records;
+      auto expectedTime = timeVariant(source, context, entryPoint, transformer,
+                                      bestConfigs, &records);
+      if (!expectedTime) {
+        // Only the untransformed variant is required to run.
+        if (j == 0)
+          return expectedTime.takeError();
+        llvm::consumeError(expectedTime.takeError());
+        continue;
+      }
+      if (j == 0)
+        baselineTime = *expectedTime;
+      if (!bestIndex.hasValue() || *expectedTime < bestTime) {
+        bestIndex = j;
+        bestTime = *expectedTime;
+        bestRecords = std::move(records);
+      }
+    }
+    bestConfigs.back() = configs[bestIndex.getValue()];
+
+    const LoopNestConfig &best = bestConfigs.back();
+    llvm::outs() << "loop nest " << i << ": " << configs.size()
+                 << " variants, best time " << bestTime << " s (untransformed "
+                 << baselineTime << " s) with tile sizes [";
+    interleaveComma(best.tileSizes, llvm::outs());
+    llvm::outs() << "], unroll-and-jam factor " << best.unrollJamFactor
+                 << ", unroll factor " << best.unrollFactor << "\n";
+  }
+
+  for (auto &record : bestRecords)
+    database.insert(record.kind, record.hash, record.parameters, bestTime);
+  if (failed(database.save(databaseFilename, &errorMessage)))
+    return make_string_error(errorMessage);
+  return Error::success();
+}
+
+// Prints the errors in 'error' and returns the exit code of the runner.
+static int reportErrors(Error error) {
+  int exitCode = EXIT_SUCCESS;
+  llvm::handleAllErrors(std::move(error),
+                        [&exitCode](const llvm::ErrorInfoBase &info) {
+                          llvm::errs() << "Error: ";
+                          info.log(llvm::errs());
+                          llvm::errs() << '\n';
+                          exitCode = EXIT_FAILURE;
+                        });
+  return exitCode;
+}
+
 int run(int argc, char **argv) {
   llvm::PrettyStackTraceProgram x(argc, argv);
   llvm::InitLLVM y(argc, argv);
@@ -285,28 +702,36 @@ int run(int argc, char **argv) {
     }
   }
 
+  auto transformer =
+      mlir::makeLLVMPassesTransformer(passes, optLevel, optPosition);
+
   MLIRContext context;
+  if (autotune)
+    return reportErrors(autotuneEntryPoint(inputFilename, &context,
+                                           mainFuncName.getValue(),
+                                           transformer));
+
   auto m = parseMLIRInput(inputFilename, &context);
   if (!m) {
     llvm::errs() << "could not parse the input IR\n";
     return 1;
   }
 
-  auto transformer =
-      mlir::makeLLVMPassesTransformer(passes, optLevel, optPosition);
-  auto error = mainFuncType.getValue() == "f32"
-                   ? compileAndExecuteSingleFloatReturnFunction(
-                         m.get(), mainFuncName.getValue(), transformer)
-                   : compileAndExecuteFunctionWithMemRefs(
-                         m.get(), mainFuncName.getValue(), transformer);
-  int exitCode = EXIT_SUCCESS;
-  llvm::handleAllErrors(std::move(error),
-                        [&exitCode](const llvm::ErrorInfoBase &info) {
-                          llvm::errs() << "Error: ";
-                          info.log(llvm::errs());
-                          llvm::errs() << '\n';
-                          exitCode = EXIT_FAILURE;
-                        });
-
-  return exitCode;
+  // Describe the transformer for the object cache: cached objects may only be
+  // reused with the same optimization level and pass pipeline.
+  std::string transformerKey;
+  llvm::raw_string_ostream keyStream(transformerKey);
+  keyStream << "O" << (optLevel ? std::to_string(*optLevel) : "-") << " at "
+            << optPosition << ":";
+  for (const llvm::PassInfo *pass : passes)
+    keyStream << " " << pass->getPassArgument();
+  keyStream.flush();
+
+  auto error =
+      mainFuncType.getValue() == "f32"
+          ? compileAndExecuteSingleFloatReturnFunction(
+                m.get(), mainFuncName.getValue(), transformer, transformerKey)
+          : compileAndExecuteFunctionWithMemRefs(
+                m.get(), mainFuncName.getValue(), transformer, transformerKey);
+  return reportErrors(std::move(error));
 }
@@ -23,6 +23,7 @@
 
 #include "mlir/Analysis/Passes.h"
 #include "mlir/IR/Attributes.h"
+#include "mlir/IR/Bytecode.h"
 #include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Function.h"
 #include "mlir/IR/Location.h"
@@ -69,6 +70,11 @@ static cl::opt<bool>
                  cl::desc("Run the verifier after each transformation pass"),
                  cl::init(true));
 
+static cl::opt<bool>
+    emitBytecode("emit-bytecode",
+                 cl::desc("Write the output module in the bytecode format"),
+                 cl::init(false));
+
 static std::vector<const mlir::PassRegistryEntry *> *passList;
 
 enum OptResult { OptSuccess, OptFailure };
@@ -104,7 +110,10 @@ static OptResult performActions(SourceMgr &sourceMgr, MLIRContext *context) {
   }
 
   // Print the output.
-  module->print(output->os());
+  if (emitBytecode)
+    writeBytecode(module.get(), output->os());
+  else
+    module->print(output->os());
   output->keep();
   return OptSuccess;
 }
@@ -0,0 +1,103 @@
+//===- SimplexTest.cpp - Simplex unit tests -------------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Analysis/Simplex.h"
+#include "mlir/Analysis/AffineStructures.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+TEST(SimplexTest, RationalEmptiness) {
+  // x >= 1 and x <= 0.
+  Simplex simplex(1);
+  simplex.addInequality({1, -1});
+  EXPECT_FALSE(simplex.isEmpty());
+  simplex.addInequality({-1, 0});
+  EXPECT_TRUE(simplex.isEmpty());
+  EXPECT_EQ(simplex.isIntegerEmpty(), Optional<bool>(true));
+}
+
+TEST(SimplexTest, IntegerEmptiness) {
+  // 1 <= 3x + 3y <= 2 has rational solutions but no integer one.
+  Simplex simplex(2);
+  simplex.addInequality({3, 3, -1});
+  simplex.addInequality({-3, -3, 2});
+  simplex.addInequality({1, 0, 0});
+  simplex.addInequality({-1, 0, 10});
+  EXPECT_FALSE(simplex.isEmpty());
+  EXPECT_EQ(simplex.isIntegerEmpty(), Optional<bool>(true));
+
+  // 2 <= 3x + 3y <= 3 does have integer solutions.
+  Simplex other(2);
+  other.addInequality({3, 3, -2});
+  other.addInequality({-3, -3, 3});
+  EXPECT_EQ(other.isIntegerEmpty(), Optional<bool>(false));
+}
+
+TEST(SimplexTest, Rollback) {
+  // 0 <= x <= 10 and y == 2x.
+  Simplex simplex(2);
+  simplex.addInequality({1, 0, 0});
+  simplex.addInequality({-1, 0, 10});
+  simplex.addEquality({2, -1, 0});
+
+  // Each query adds constraints to the base system and removes them again.
+  for (int64_t bound = 0; bound < 30; ++bound) {
+    unsigned snapshot = simplex.getSnapshot();
+    // y >= bound.
+    simplex.addInequality({0, 1, -bound});
+    EXPECT_EQ(simplex.isEmpty(), bound > 20);
+    // y <= bound.
+    simplex.addInequality({0, -1, bound});
+    EXPECT_EQ(simplex.isIntegerEmpty(),
+              Optional<bool>(bound > 20 || bound % 2 != 0));
+    simplex.rollback(snapshot);
+    EXPECT_EQ(simplex.getNumConstraints(), 4u);
+    EXPECT_FALSE(simplex.isEmpty());
+  }
+}
+
+TEST(SimplexTest, LargeCoefficients) {
+  // 1 <= 2^62 * (x - y) <= 2^62 - 1 and 0 <= x, y <= 10, whose tableau
+  // overflows 64 bits.
+  const int64_t large = int64_t(1) << 62;
+  Simplex simplex(2);
+  simplex.addInequality({large, -large, -1});
+  simplex.addInequality({-large, large, large - 1});
+  simplex.addInequality({1, 0, 0});
+  simplex.addInequality({-1, 0, 10});
+  simplex.addInequality({0, 1, 0});
+  simplex.addInequality({0, -1, 10});
+  EXPECT_FALSE(simplex.isEmpty());
+  EXPECT_EQ(simplex.isIntegerEmpty(), Optional<bool>(true));
+}
+
+TEST(SimplexTest, FlatAffineConstraints) {
+  // 1 <= 2x <= 1 has rational solutions but no integer one, which the
+  // elimination of 'x' by Fourier-Motzkin does not detect.
+  FlatAffineConstraints cst(/*numDims=*/2);
+  cst.addInequality({2, 0, -1});
+  cst.addInequality({-2, 0, 1});
+  cst.addInequality({0, 1, 0});
+  EXPECT_FALSE(Simplex(cst).isEmpty());
+  EXPECT_TRUE(cst.isEmpty());
+
+  cst.addEquality({1, -1, 0});
+  EXPECT_TRUE(cst.isEmpty());
+}
+} // end namespace
@@ -16,6 +16,7 @@
 // =============================================================================
 
 #include "mlir/IR/Attributes.h"
+#include "mlir/IR/Identifier.h"
 #include "mlir/IR/StandardTypes.h"
 #include "gtest/gtest.h"
 
@@ -144,4 +145,56 @@ TEST(DenseSplatTest, FloatAttrSplat) {
 
   testSplat(floatTy, value);
 }
+
+TEST(NamedAttributeListTest, SortedSetAndRemove) {
+  MLIRContext context;
+  Attribute unit = UnitAttr::get(&context);
+  Attribute other = IntegerAttr::get(IntegerType::get(32, &context), 1);
+
+  // Insert enough attributes out of order to exercise the binary search.
+  NamedAttributeList list;
+  for (unsigned i = 0; i != 16; ++i)
+    list.set(Identifier::get(("attr" + Twine(15 - i)).str(), &context), unit);
+  ASSERT_EQ(list.getAttrs().size(), 16u);
+  for (unsigned i = 0, e = list.getAttrs().size() - 1; i != e; ++i)
+    EXPECT_LT(list.getAttrs()[i].first.strref(),
+              list.getAttrs()[i + 1].first.strref());
+
+  Identifier name = Identifier::get("attr7", &context);
+  list.set(name, other);
+  EXPECT_EQ(list.get(name), other);
+  EXPECT_EQ(list.get("attr7"), other);
+  EXPECT_EQ(list.get("attr8"), unit);
+  EXPECT_EQ(list.get("attr16"), Attribute());
+
+  EXPECT_EQ(list.remove(name), NamedAttributeList::RemoveResult::Removed);
+  EXPECT_EQ(list.remove(name), NamedAttributeList::RemoveResult::NotFound);
+  EXPECT_EQ(list.get(name), Attribute());
+  EXPECT_EQ(list.getAttrs().size(), 15u);
+
+  // The dictionary is uniqued from the modified list on demand.
+  DictionaryAttr dict = list.getDictionary();
+  EXPECT_TRUE(dict.getValue() == list.getAttrs());
+  EXPECT_EQ(DictionaryAttr::get(list.getAttrs(), &context), dict);
+}
+
+TEST(NamedAttributeListTest, CopyOnWrite) {
+  MLIRContext context;
+  Attribute unit = UnitAttr::get(&context);
+  Identifier a = Identifier::get("a", &context);
+  Identifier b = Identifier::get("b", &context);
+
+  NamedAttributeList list;
+  list.set(a, unit);
+  NamedAttributeList copy = list;
+  copy.set(b, unit);
+  EXPECT_EQ(list.getAttrs().size(), 1u);
+  EXPECT_EQ(copy.getAttrs().size(), 2u);
+
+  // Removing the last attribute leaves an empty list.
+  EXPECT_EQ(list.remove(a), NamedAttributeList::RemoveResult::Removed);
+  EXPECT_TRUE(list.getAttrs().empty());
+  EXPECT_FALSE(list.getDictionary());
+  EXPECT_EQ(copy.get(a), unit);
+}
 } // end namespace
@@ -0,0 +1,81 @@
+//===- BytecodeTest.cpp - Bytecode unit tests -----------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/IR/Bytecode.h"
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+// Returns the bytecode of a module with a dense elements attribute. The module
+// is built in its own context, so that the attribute is not already uniqued in
+// the context of the reader.
+std::string getBytecode() {
+  MLIRContext context;
+  std::unique_ptr<Module> module(parseSourceString(
+      "func @f() attributes {cst: dense<tensor<4xi32>, [1, 2, 3, 4]>}",
+      &context));
+  std::string bytecode;
+  llvm::raw_string_ostream os(bytecode);
+  writeBytecode(module.get(), os);
+  return os.str();
+}
+
+// Returns the dense elements attribute of the module.
+DenseElementsAttr getAttr(Module *module) {
+  Function *function = module->getNamedFunction("f");
+  return function->getAttrOfType<DenseElementsAttr>("cst");
+}
+
+// Returns true if 'data' lies within 'buffer'.
+bool isWithin(ArrayRef<char> data, StringRef buffer) {
+  return data.begin() >= buffer.begin() && data.end() <= buffer.end();
+}
+
+TEST(BytecodeTest, PayloadUsedInPlace) {
+  // Memory buffer copies are aligned to 16 bytes, like memory mapped files are
+  // aligned to pages.
+  auto buffer = llvm::MemoryBuffer::getMemBufferCopy(getBytecode());
+  StringRef contents = buffer->getBuffer();
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(contents.data()) %
+                bytecode::kPayloadAlignment,
+            0u);
+
+  MLIRContext context;
+  std::unique_ptr<Module> module(parseBytecode(std::move(buffer), &context));
+  ASSERT_TRUE(module);
+  EXPECT_TRUE(isWithin(getAttr(module.get()).getRawData(), contents));
+  EXPECT_EQ(getAttr(module.get()).getValues<int32_t>(),
+            makeArrayRef<int32_t>({1, 2, 3, 4}));
+}
+
+TEST(BytecodeTest, PayloadCopiedFromUnownedBuffer) {
+  std::string bytecode = getBytecode();
+
+  MLIRContext context;
+  std::unique_ptr<Module> module(parseBytecode(bytecode, &context));
+  ASSERT_TRUE(module);
+  EXPECT_FALSE(isWithin(getAttr(module.get()).getRawData(), bytecode));
+}
+} // end namespace
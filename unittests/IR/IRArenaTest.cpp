@@ -0,0 +1,143 @@
+//===- IRArenaTest.cpp - IR arena unit tests ------------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/IR/IRArena.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/MLIRContext.h"
+#include "gtest/gtest.h"
+#include <thread>
+
+using namespace mlir;
+
+namespace {
+Function *createFunction(MLIRContext *context, bool withArena) {
+  auto *function =
+      new Function(UnknownLoc::get(context), "foo",
+                   FunctionType::get(llvm::None, llvm::None, context));
+  if (withArena)
+    function->enableArena();
+  return function;
+}
+
+Operation *createOp(OpBuilder &builder, unsigned numRegions = 0) {
+  OperationState state(builder.getContext(), builder.getUnknownLoc(),
+                       "foo.bar");
+  for (unsigned i = 0; i != numRegions; ++i)
+    state.addRegion();
+  return builder.createOperation(state);
+}
+
+TEST(IRArenaTest, HeapByDefault) {
+  MLIRContext context;
+  Function *function = createFunction(&context, /*withArena=*/false);
+  EXPECT_EQ(function->getArena(), nullptr);
+
+  OpBuilder builder(function->getBody());
+  Block *block = builder.createBlock();
+  Operation *op = createOp(builder);
+  EXPECT_EQ(IRArena::getArena(block), nullptr);
+  EXPECT_EQ(IRArena::getArena(op), nullptr);
+  delete function;
+}
+
+TEST(IRArenaTest, BuilderAllocatesFromArena) {
+  MLIRContext context;
+  Function *function = createFunction(&context, /*withArena=*/true);
+  IRArena *arena = function->getArena();
+  ASSERT_NE(arena, nullptr);
+
+  OpBuilder builder(function->getBody());
+  Block *block = builder.createBlock();
+  Operation *op = createOp(builder, /*numRegions=*/1);
+  EXPECT_EQ(IRArena::getArena(block), arena);
+  EXPECT_EQ(IRArena::getArena(op), arena);
+
+  // The IR nested in the operations of the function uses the same arena.
+  OpBuilder nestedBuilder(op->getRegion(0));
+  Block *nestedBlock = nestedBuilder.createBlock();
+  Operation *nestedOp = createOp(nestedBuilder);
+  EXPECT_EQ(IRArena::getArena(nestedBlock), arena);
+  EXPECT_EQ(IRArena::getArena(nestedOp), arena);
+
+  // Erasing operations does not release the arena.
+  for (unsigned i = 0; i != 100; ++i)
+    createOp(builder)->erase();
+  EXPECT_EQ(function->getArena(), arena);
+  EXPECT_GT(arena->getTotalMemory(), 0u);
+  delete function;
+}
+
+TEST(IRArenaTest, IROutlivesFunction) {
+  MLIRContext context;
+  Function *source = createFunction(&context, /*withArena=*/true);
+  Function *dest = createFunction(&context, /*withArena=*/false);
+
+  OpBuilder builder(source->getBody());
+  builder.createBlock();
+  for (unsigned i = 0; i != 8; ++i)
+    createOp(builder);
+
+  // Move the body to the other function and destroy the source, the arena
+  // must remain alive until the moved IR is destroyed.
+  IRArena *arena = source->getArena();
+  dest->getBody().takeBody(source->getBody());
+  delete source;
+
+  Block &block = dest->getBlocks().front();
+  EXPECT_EQ(IRArena::getArena(&block), arena);
+  EXPECT_EQ(block.getOperations().size(), 8u);
+  for (auto &op : block)
+    EXPECT_EQ(op.getName().getStringRef(), "foo.bar");
+  delete dest;
+}
+
+TEST(IRArenaTest, ConcurrentAllocation) {
+  MLIRContext context;
+  Function *function = createFunction(&context, /*withArena=*/true);
+  IRArena *arena = function->getArena();
+
+  // Allocate from several threads at once, and check that the objects don't
+  // overlap by filling each with the index of its thread.
+  constexpr unsigned numThreads = 4, numObjects = 1000, objectSize = 24;
+  std::vector<std::vector<char *>> objects(numThreads);
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i != numThreads; ++i) {
+    threads.emplace_back([&, i] {
+      for (unsigned j = 0; j != numObjects; ++j) {
+        auto *ptr = static_cast<char *>(
+            IRArena::allocate(arena, objectSize, alignof(void *)));
+        std::fill_n(ptr, objectSize, static_cast<char>(i));
+        objects[i].push_back(ptr);
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  for (unsigned i = 0; i != numThreads; ++i) {
+    for (char *ptr : objects[i]) {
+      EXPECT_EQ(IRArena::getArena(ptr), arena);
+      EXPECT_TRUE(std::all_of(ptr, ptr + objectSize,
+                              [&](char c) { return c == char(i); }));
+      IRArena::deallocate(ptr, alignof(void *));
+    }
+  }
+  delete function;
+}
+} // end anonymous namespace
@@ -0,0 +1,96 @@
+//===- OperationOrderTest.cpp - Operation ordering unit tests -------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/IR/Block.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+Operation *createOp(MLIRContext *context) {
+  return Operation::create(UnknownLoc::get(context),
+                           OperationName("foo.bar", context), llvm::None,
+                           llvm::None, llvm::None, llvm::None, 0,
+                           /*resizableOperandList=*/false, context);
+}
+
+/// Check that the ordering queries agree with the order of the operations in
+/// the block.
+void checkOrder(Block &block) {
+  Operation *prev = nullptr;
+  for (auto &op : block) {
+    if (prev) {
+      EXPECT_TRUE(prev->isBeforeInBlock(&op));
+      EXPECT_FALSE(op.isBeforeInBlock(prev));
+    }
+    prev = &op;
+  }
+  EXPECT_FALSE(block.verifyInstOrder());
+}
+
+TEST(OperationOrderTest, InsertAtSamePoint) {
+  MLIRContext context;
+  Block block;
+  for (unsigned i = 0; i != 8; ++i)
+    block.push_back(createOp(&context));
+  Operation *insertPt = &*std::next(block.begin(), 4);
+
+  // Repeatedly insert before the same operation, querying the order of the
+  // new operation after each insertion.
+  for (unsigned i = 0; i != 2000; ++i) {
+    Operation *op = createOp(&context);
+    block.getOperations().insert(Block::iterator(insertPt), op);
+    EXPECT_TRUE(op->isBeforeInBlock(insertPt));
+    EXPECT_FALSE(insertPt->isBeforeInBlock(op));
+    EXPECT_TRUE(block.front().isBeforeInBlock(op));
+  }
+  checkOrder(block);
+}
+
+TEST(OperationOrderTest, InsertAtFront) {
+  MLIRContext context;
+  Block block;
+  block.push_back(createOp(&context));
+  for (unsigned i = 0; i != 2000; ++i) {
+    Operation *op = createOp(&context);
+    block.push_front(op);
+    EXPECT_TRUE(op->isBeforeInBlock(&block.back()));
+  }
+  checkOrder(block);
+}
+
+TEST(OperationOrderTest, InsertRuns) {
+  MLIRContext context;
+  Block block;
+  for (unsigned i = 0; i != 4; ++i)
+    block.push_back(createOp(&context));
+  checkOrder(block);
+
+  // Insert runs of operations between each query, and move operations within
+  // the block.
+  for (unsigned i = 0; i != 50; ++i) {
+    Block::iterator insertPt = std::next(block.begin(), i % 3 + 1);
+    for (unsigned j = 0; j != 40; ++j)
+      block.getOperations().insert(insertPt, createOp(&context));
+    block.front().moveBefore(&block.back());
+    checkOrder(block);
+  }
+}
+} // end anonymous namespace
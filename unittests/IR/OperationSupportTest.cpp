@@ -61,7 +61,7 @@ TEST(OperandStorageTest, NonResizable) {
   useOp->destroy();
 }
 
-TEST(OperandStorageDeathTest, AddToNonResizable) {
+TEST(OperandStorageTest, GrowNonResizable) {
   MLIRContext context;
   Builder builder(&context);
 
@@ -74,11 +74,93 @@ TEST(OperandStorageDeathTest, AddToNonResizable) {
   Operation *user = createOp(&context, /*resizableOperands=*/false, operand,
                              builder.getIntegerType(16));
 
-  // Sanity check the storage.
-  EXPECT_EQ(user->hasResizableOperandsList(), false);
+  // Adding operands beyond the inline storage is okay.
+  user->setOperands({operand, operand, operand});
+  EXPECT_EQ(user->getNumOperands(), 3u);
+
+  // Removing them again is okay.
+  user->setOperands(operand);
+  EXPECT_EQ(user->getNumOperands(), 1u);
+
+  // Destroy the operations.
+  user->destroy();
+  useOp->destroy();
+}
+
+TEST(OperandStorageTest, SetOperandRange) {
+  MLIRContext context;
+  Builder builder(&context);
+
+  Type i16 = builder.getIntegerType(16);
+  Operation *useOp = createOp(&context, /*resizableOperands=*/false,
+                              /*operands=*/llvm::None, {i16, i16, i16});
+  Value *a = useOp->getResult(0), *b = useOp->getResult(1),
+        *c = useOp->getResult(2);
+
+  Operation *user = createOp(&context, /*resizableOperands=*/false, {a, b, c});
+
+  // Replace a range with more operands.
+  user->setOperands(/*start=*/1, /*length=*/1, {c, c});
+  EXPECT_EQ(user->getNumOperands(), 4u);
+  EXPECT_EQ(user->getOperand(0), a);
+  EXPECT_EQ(user->getOperand(1), c);
+  EXPECT_EQ(user->getOperand(3), c);
+  EXPECT_TRUE(b->use_empty());
+
+  // Insert operands.
+  user->insertOperands(/*index=*/0, {b, b});
+  EXPECT_EQ(user->getNumOperands(), 6u);
+  EXPECT_EQ(user->getOperand(0), b);
+  EXPECT_EQ(user->getOperand(2), a);
+
+  // Replace a range with fewer operands, and erase an operand.
+  user->setOperands(/*start=*/1, /*length=*/4, {a});
+  user->eraseOperand(0);
+  EXPECT_EQ(user->getNumOperands(), 2u);
+  EXPECT_EQ(user->getOperand(0), a);
+  EXPECT_EQ(user->getOperand(1), c);
+  EXPECT_TRUE(b->use_empty());
+
+  // Destroy the operations.
+  user->destroy();
+  useOp->destroy();
+}
 
-  // Adding operands to a non resizable operation should result in a failure.
-  ASSERT_DEATH(user->setOperands({operand, operand}), "");
+TEST(OperandStorageTest, SuccessorOperands) {
+  MLIRContext context;
+  Builder builder(&context);
+
+  Type i16 = builder.getIntegerType(16);
+  Operation *useOp = createOp(&context, /*resizableOperands=*/false,
+                              /*operands=*/llvm::None, {i16, i16});
+  Value *a = useOp->getResult(0), *b = useOp->getResult(1);
+
+  // Create an operation with one operand, and two successors with one and no
+  // operands respectively.
+  Block first, second;
+  Operation *user = Operation::create(
+      UnknownLoc::get(&context), OperationName("foo.br", &context),
+      {a, nullptr, b, nullptr}, llvm::None, llvm::None, {&first, &second}, 0,
+      /*resizableOperandList=*/false, &context);
+
+  user->addSuccessorOperands(1, {a, b});
+  EXPECT_EQ(user->getNumOperands(), 4u);
+  EXPECT_EQ(user->getNumSuccessorOperands(1), 2u);
+  EXPECT_EQ(user->getSuccessorOperand(1, 0), a);
+  EXPECT_EQ(user->getSuccessorOperand(1, 1), b);
+
+  user->setSuccessorOperands(0, llvm::None);
+  EXPECT_EQ(user->getNumSuccessorOperands(0), 0u);
+  EXPECT_EQ(user->getNumSuccessorOperands(1), 2u);
+
+  user->insertOperands(/*index=*/0, b);
+  EXPECT_EQ(user->getNumOperands(), 4u);
+  EXPECT_EQ(user->getSuccessorOperandIndex(1), 2u);
+  EXPECT_EQ(user->getSuccessorOperand(1, 0), a);
+
+  // Destroy the operations.
+  user->destroy();
+  useOp->destroy();
 }
 
 TEST(OperandStorageTest, Resizable) {
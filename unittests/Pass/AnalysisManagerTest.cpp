@@ -32,6 +32,21 @@ struct OtherAnalysis {
   OtherAnalysis(Function *) {}
   OtherAnalysis(Module *) {}
 };
+/// An analysis holding a value, used to check that it is set in place.
+struct ValueAnalysis {
+  ValueAnalysis(Function *) {}
+  explicit ValueAnalysis(int value) : value(value) {}
+  int value = 0;
+};
+/// An analysis that depends on OtherAnalysis.
+struct DependentAnalysis {
+  DependentAnalysis(Function *) {}
+  DependentAnalysis(Module *) {}
+
+  bool isInvalidated(const detail::PreservedAnalyses &pa) {
+    return !pa.isPreserved<OtherAnalysis>();
+  }
+};
 
 TEST(AnalysisManagerTest, FineGrainModuleAnalysisPreservation) {
   MLIRContext context;
@@ -109,4 +124,88 @@ TEST(AnalysisManagerTest, FineGrainChildFunctionAnalysisPreservation) {
   EXPECT_FALSE(mam.getCachedFunctionAnalysis<OtherAnalysis>(func1).hasValue());
 }
 
+TEST(AnalysisManagerTest, DependentAnalysisInvalidation) {
+  MLIRContext context;
+
+  std::unique_ptr<Module> module(new Module(&context));
+  ModuleAnalysisManager mam(&*module, /*passInstrumentor=*/nullptr);
+
+  // Query an analysis and its dependency, but only preserve the analysis.
+  mam.getAnalysis<DependentAnalysis>();
+  mam.getAnalysis<OtherAnalysis>();
+
+  detail::PreservedAnalyses pa;
+  pa.preserve<DependentAnalysis>();
+  mam.invalidate(pa);
+
+  // Check that the analysis was invalidated along with its dependency.
+  EXPECT_FALSE(mam.getCachedAnalysis<DependentAnalysis>().hasValue());
+  EXPECT_FALSE(mam.getCachedAnalysis<OtherAnalysis>().hasValue());
+
+  // Check that both are kept if the dependency is preserved too.
+  mam.getAnalysis<DependentAnalysis>();
+  mam.getAnalysis<OtherAnalysis>();
+  pa.preserve<OtherAnalysis>();
+  mam.invalidate(pa);
+
+  EXPECT_TRUE(mam.getCachedAnalysis<DependentAnalysis>().hasValue());
+  EXPECT_TRUE(mam.getCachedAnalysis<OtherAnalysis>().hasValue());
+}
+
+TEST(AnalysisManagerTest, ChangedFunctionAnalysisInvalidation) {
+  MLIRContext context;
+  Builder builder(&context);
+
+  // Create a module with two functions.
+  std::unique_ptr<Module> module(new Module(&context));
+  Function *func1 =
+      new Function(builder.getUnknownLoc(), "foo",
+                   builder.getFunctionType(llvm::None, llvm::None));
+  Function *func2 =
+      new Function(builder.getUnknownLoc(), "bar",
+                   builder.getFunctionType(llvm::None, llvm::None));
+  module->getFunctions().push_back(func1);
+  module->getFunctions().push_back(func2);
+
+  ModuleAnalysisManager mam(&*module, /*passInstrumentor=*/nullptr);
+  mam.getAnalysis<MyAnalysis>();
+  mam.getFunctionAnalysis<MyAnalysis>(func1);
+  mam.getFunctionAnalysis<MyAnalysis>(func2);
+
+  // Invalidate everything, but only report a change to the first function.
+  llvm::SmallPtrSet<Function *, 1> changedFunctions;
+  changedFunctions.insert(func1);
+  mam.invalidate(detail::PreservedAnalyses(), &changedFunctions);
+
+  // Check that the analyses of the unchanged function are preserved.
+  EXPECT_FALSE(mam.getCachedAnalysis<MyAnalysis>().hasValue());
+  EXPECT_FALSE(mam.getCachedFunctionAnalysis<MyAnalysis>(func1).hasValue());
+  EXPECT_TRUE(mam.getCachedFunctionAnalysis<MyAnalysis>(func2).hasValue());
+}
+
+TEST(AnalysisManagerTest, SetFunctionAnalysis) {
+  MLIRContext context;
+  Builder builder(&context);
+
+  // Create a function and a module.
+  std::unique_ptr<Module> module(new Module(&context));
+  Function *func1 =
+      new Function(builder.getUnknownLoc(), "foo",
+                   builder.getFunctionType(llvm::None, llvm::None));
+  module->getFunctions().push_back(func1);
+
+  ModuleAnalysisManager mam(&*module, /*passInstrumentor=*/nullptr);
+  FunctionAnalysisManager fam = mam.slice(func1);
+
+  // Setting an analysis that is not cached adds it to the cache.
+  fam.setAnalysis(ValueAnalysis(1));
+  ValueAnalysis &analysis = fam.getAnalysis<ValueAnalysis>();
+  EXPECT_EQ(analysis.value, 1);
+
+  // Setting a cached analysis updates the existing instance.
+  fam.setAnalysis(ValueAnalysis(2));
+  EXPECT_EQ(&fam.getAnalysis<ValueAnalysis>(), &analysis);
+  EXPECT_EQ(analysis.value, 2);
+}
+
 } // end namespace
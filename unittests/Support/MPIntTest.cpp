@@ -0,0 +1,77 @@
+//===- MPIntTest.cpp - MPInt unit tests -----------------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Support/MPInt.h"
+#include "gtest/gtest.h"
+#include <limits>
+
+using namespace mlir;
+
+namespace {
+const int64_t kMax = std::numeric_limits<int64_t>::max();
+const int64_t kMin = std::numeric_limits<int64_t>::min();
+
+TEST(MPIntTest, SmallArithmetic) {
+  EXPECT_EQ(MPInt(7) + MPInt(-3), MPInt(4));
+  EXPECT_EQ(MPInt(7) - MPInt(10), MPInt(-3));
+  EXPECT_EQ(MPInt(-7) * MPInt(6), MPInt(-42));
+  EXPECT_EQ(MPInt(-7) / MPInt(2), MPInt(-3));
+  EXPECT_EQ(MPInt(-7) % MPInt(2), MPInt(-1));
+  EXPECT_TRUE((MPInt(kMax) - MPInt(1)).isSmall());
+}
+
+TEST(MPIntTest, Overflow) {
+  MPInt sum = MPInt(kMax) + MPInt(1);
+  EXPECT_FALSE(sum.isSmall());
+  EXPECT_GT(sum, MPInt(kMax));
+  EXPECT_EQ(sum - MPInt(1), MPInt(kMax));
+  EXPECT_TRUE((sum - MPInt(1)).isSmall());
+
+  MPInt product = MPInt(kMax) * MPInt(kMax);
+  EXPECT_EQ(product / MPInt(kMax), MPInt(kMax));
+  EXPECT_EQ(product % MPInt(kMax), MPInt(0));
+  EXPECT_LT(-product, MPInt(kMin));
+
+  MPInt negMin = -MPInt(kMin);
+  EXPECT_FALSE(negMin.isSmall());
+  EXPECT_EQ(negMin, MPInt(kMax) + MPInt(1));
+  EXPECT_EQ(MPInt(kMin) / MPInt(-1), negMin);
+  EXPECT_EQ(MPInt(kMin) % MPInt(-1), MPInt(0));
+}
+
+TEST(MPIntTest, Division) {
+  EXPECT_EQ(floorDiv(MPInt(-7), MPInt(2)), MPInt(-4));
+  EXPECT_EQ(floorDiv(MPInt(7), MPInt(-2)), MPInt(-4));
+  EXPECT_EQ(floorDiv(MPInt(6), MPInt(2)), MPInt(3));
+  EXPECT_EQ(ceilDiv(MPInt(-7), MPInt(2)), MPInt(-3));
+  EXPECT_EQ(ceilDiv(MPInt(7), MPInt(2)), MPInt(4));
+
+  MPInt large = MPInt(kMax) * MPInt(4);
+  EXPECT_EQ(floorDiv(-large - MPInt(1), MPInt(4)), -MPInt(kMax) - MPInt(1));
+}
+
+TEST(MPIntTest, GCD) {
+  EXPECT_EQ(gcd(MPInt(12), MPInt(-18)), MPInt(6));
+  EXPECT_EQ(gcd(MPInt(0), MPInt(-5)), MPInt(5));
+  EXPECT_EQ(lcm(MPInt(4), MPInt(-6)), MPInt(12));
+
+  MPInt large = MPInt(kMax) * MPInt(6);
+  EXPECT_EQ(gcd(large, MPInt(kMax) * MPInt(4)), MPInt(kMax) * MPInt(2));
+  EXPECT_EQ(gcd(large, MPInt(5)), MPInt(1));
+  EXPECT_EQ(gcd(MPInt(kMin), MPInt(kMin)), -MPInt(kMin));
+}
+} // end namespace
@@ -0,0 +1,113 @@
+//===- StorageUniquerTest.cpp - StorageUniquer unit tests -----------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Support/StorageUniquer.h"
+#include "gtest/gtest.h"
+#include <thread>
+
+using namespace mlir;
+
+namespace {
+/// A simple storage class uniqued by an integer value.
+struct IntStorage : public StorageUniquer::BaseStorage {
+  using KeyTy = unsigned;
+
+  bool operator==(const KeyTy &key) const { return value == key; }
+
+  static IntStorage *construct(StorageUniquer::StorageAllocator &allocator,
+                               const KeyTy &key) {
+    auto *result = allocator.allocate<IntStorage>();
+    result->value = key;
+    return result;
+  }
+
+  void cleanup() {}
+
+  unsigned value;
+};
+
+/// A storage class uniqued solely by its kind.
+struct KindStorage : public StorageUniquer::BaseStorage {};
+
+enum Kind { IntKind, OtherIntKind, SimpleKind };
+
+TEST(StorageUniquerTest, UniqueInstances) {
+  StorageUniquer uniquer;
+
+  // Create enough instances to force several rehashes of each shard.
+  std::vector<IntStorage *> instances;
+  for (unsigned i = 0; i != 4096; ++i)
+    instances.push_back(uniquer.get<IntStorage>({}, IntKind, i));
+
+  for (unsigned i = 0; i != 4096; ++i) {
+    EXPECT_EQ(instances[i], uniquer.get<IntStorage>({}, IntKind, i));
+    EXPECT_EQ(instances[i]->value, i);
+    EXPECT_EQ(instances[i]->getKind(), unsigned(IntKind));
+  }
+
+  // Instances with the same key but a different kind are distinct.
+  EXPECT_NE(instances[0], uniquer.get<IntStorage>({}, OtherIntKind, 0u));
+
+  // Simple instances are uniqued by kind.
+  auto *simple = uniquer.get<KindStorage>({}, SimpleKind);
+  EXPECT_EQ(simple, uniquer.get<KindStorage>({}, SimpleKind));
+  EXPECT_EQ(simple->getKind(), unsigned(SimpleKind));
+}
+
+TEST(StorageUniquerTest, EraseInstances) {
+  StorageUniquer uniquer;
+  for (unsigned i = 0; i != 256; ++i)
+    uniquer.get<IntStorage>({}, IntKind, i);
+
+  // Erasing an instance must not affect the uniquing of other instances.
+  IntStorage *kept = uniquer.get<IntStorage>({}, IntKind, 1u);
+  for (unsigned i = 0; i != 256; i += 2)
+    uniquer.erase<IntStorage>(IntKind, i);
+  EXPECT_EQ(kept, uniquer.get<IntStorage>({}, IntKind, 1u));
+
+  // Erased instances are recreated on demand.
+  EXPECT_EQ(uniquer.get<IntStorage>({}, IntKind, 0u)->value, 0u);
+}
+
+TEST(StorageUniquerTest, ConcurrentGetOrCreate) {
+  StorageUniquer uniquer;
+  const unsigned numThreads = 8, numValues = 2048;
+
+  // Each thread uniques the same set of values, in a different order, and the
+  // results must agree across threads.
+  std::vector<std::vector<IntStorage *>> results(numThreads);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t != numThreads; ++t) {
+    threads.emplace_back([&, t] {
+      auto &threadResults = results[t];
+      threadResults.resize(numValues);
+      for (unsigned i = 0; i != numValues; ++i) {
+        unsigned value = (i * (2 * t + 1)) % numValues;
+        threadResults[value] = uniquer.get<IntStorage>({}, IntKind, value);
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  for (unsigned i = 0; i != numValues; ++i) {
+    EXPECT_EQ(results[0][i]->value, i);
+    for (unsigned t = 1; t != numThreads; ++t)
+      EXPECT_EQ(results[0][i], results[t][i]);
+  }
+}
+} // end anonymous namespace
@@ -0,0 +1,105 @@
+//===- LoopUtilsTest.cpp - Loop utilities unit tests ----------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Transforms/LoopUtils.h"
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/AffineAnalysis.h"
+#include "mlir/Analysis/AffineStructures.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
+#include "mlir/StandardOps/Ops.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+// Returns the distances of the dependence from 'srcOp' to 'dstOp' at
+// 'loopDepth' as "[lb, ub]" pairs, or "none" if there is no dependence. Checks
+// that 'depAnalysis' gives the same answer as an uncached check.
+std::string getDependence(MemRefDependenceAnalysis &depAnalysis,
+                          Operation *srcOp, Operation *dstOp,
+                          unsigned loopDepth) {
+  MemRefAccess srcAccess(srcOp), dstAccess(dstOp);
+  llvm::SmallVector<DependenceComponent, 2> components;
+  DependenceResult result =
+      depAnalysis.checkDependence(srcAccess, dstAccess, loopDepth, &components);
+
+  FlatAffineConstraints dependenceConstraints;
+  llvm::SmallVector<DependenceComponent, 2> uncachedComponents;
+  DependenceResult uncachedResult =
+      checkMemrefAccessDependence(srcAccess, dstAccess, loopDepth,
+                                  &dependenceConstraints, &uncachedComponents);
+  EXPECT_EQ(result.value, uncachedResult.value);
+
+  if (!hasDependence(result))
+    return "none";
+  EXPECT_EQ(components.size(), uncachedComponents.size());
+  std::string str;
+  for (unsigned i = 0, e = components.size(); i < e; ++i) {
+    EXPECT_EQ(components[i].lb, uncachedComponents[i].lb);
+    EXPECT_EQ(components[i].ub, uncachedComponents[i].ub);
+    str += "[" + std::to_string(components[i].lb.getValue()) + ", " +
+           std::to_string(components[i].ub.getValue()) + "]";
+  }
+  return str;
+}
+
+TEST(LoopUtilsTest, SinkSequentialLoopsInvalidatesDependences) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(parseSourceString(R"mlir(
+    func @f(%A : memref<10x10xf32>) {
+      affine.for %i = 1 to 10 {
+        affine.for %j = 0 to 10 {
+          %im1 = affine.apply (d0) -> (d0 - 1)(%i)
+          %v = load %A[%im1, %j] : memref<10x10xf32>
+          store %v, %A[%i, %j] : memref<10x10xf32>
+        }
+      }
+      return
+    }
+  )mlir",
+                                                   &context));
+  ASSERT_TRUE(module != nullptr);
+
+  Function *function = module->getNamedFunction("f");
+  auto forOp = cast<AffineForOp>(function->front().front());
+  Operation *loadOp = nullptr, *storeOp = nullptr;
+  function->walk([&](Operation *op) {
+    if (isa<LoadOp>(op))
+      loadOp = op;
+    else if (isa<StoreOp>(op))
+      storeOp = op;
+  });
+
+  // The store to A[i][j] is read at the next iteration of the outer loop.
+  MemRefDependenceAnalysis depAnalysis;
+  EXPECT_EQ(getDependence(depAnalysis, storeOp, loadOp, 1), "[1, 1][0, 0]");
+  EXPECT_EQ(getDependence(depAnalysis, storeOp, loadOp, 2), "none");
+
+  // The sequential outer loop is sunk below the parallel inner one, which
+  // invalidates the cached dependences of the nest.
+  AffineForOp newRoot = sinkSequentialLoops(forOp, &depAnalysis);
+  ASSERT_NE(newRoot.getOperation(), forOp.getOperation());
+
+  unsigned numMisses = depAnalysis.getNumMisses();
+  EXPECT_EQ(getDependence(depAnalysis, storeOp, loadOp, 1), "none");
+  EXPECT_EQ(getDependence(depAnalysis, storeOp, loadOp, 2), "[0, 0][1, 1]");
+  EXPECT_EQ(depAnalysis.getNumMisses(), numMisses + 2);
+}
+} // end anonymous namespace
@@ -0,0 +1,147 @@
+//===- TuningDatabaseTest.cpp - Tuning database unit tests ----------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Transforms/TuningDatabase.h"
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+// Returns the first loop of the function named 'name' in 'module'.
+AffineForOp getFirstLoop(Module *module, StringRef name) {
+  Function *function = module->getNamedFunction(name);
+  for (auto &op : function->front())
+    if (auto forOp = dyn_cast<AffineForOp>(op))
+      return forOp;
+  llvm_unreachable("no loop in the function");
+}
+
+TEST(TuningDatabaseTest, PrintAndParse) {
+  TuningDatabase database;
+  database.insert(TuningParameterKind::TileSizes, 0x1234, {32, 8}, 1.5e-3);
+  database.insert(TuningParameterKind::TileSizes, 0x5678, {}, 2.0);
+  database.insert(TuningParameterKind::UnrollFactor, 0x1234, {4}, 1.0);
+  database.insert(TuningParameterKind::UnrollJamFactor, 0xffffffffffffffff,
+                  {2}, 0.5);
+
+  std::string contents;
+  llvm::raw_string_ostream os(contents);
+  database.print(os);
+  os.flush();
+
+  TuningDatabase parsed;
+  ASSERT_TRUE(succeeded(parsed.parse("# Comment.\n\n" + contents)));
+  EXPECT_EQ(parsed.size(), 4u);
+
+  auto *record = parsed.lookup(TuningParameterKind::TileSizes, 0x1234);
+  ASSERT_NE(record, nullptr);
+  EXPECT_EQ(record->parameters, (SmallVector<unsigned, 6>{32, 8}));
+  EXPECT_DOUBLE_EQ(record->executionTime, 1.5e-3);
+
+  record = parsed.lookup(TuningParameterKind::TileSizes, 0x5678);
+  ASSERT_NE(record, nullptr);
+  EXPECT_TRUE(record->parameters.empty());
+
+  record = parsed.lookup(TuningParameterKind::UnrollJamFactor,
+                         0xffffffffffffffff);
+  ASSERT_NE(record, nullptr);
+  EXPECT_EQ(record->parameters, (SmallVector<unsigned, 6>{2}));
+
+  // The kind is part of the key.
+  EXPECT_EQ(parsed.lookup(TuningParameterKind::UnrollJamFactor, 0x1234),
+            nullptr);
+}
+
+TEST(TuningDatabaseTest, ParseErrors) {
+  std::string errorMessage;
+  TuningDatabase database;
+  EXPECT_TRUE(failed(database.parse("tile 12ab", &errorMessage)));
+  EXPECT_EQ(errorMessage,
+            "line 1: expected a kind, a hash and an execution time");
+  EXPECT_TRUE(failed(database.parse("\nfuse 12ab 1.0", &errorMessage)));
+  EXPECT_EQ(errorMessage, "line 2: unknown kind 'fuse'");
+  EXPECT_TRUE(failed(database.parse("unroll xyz 1.0 4", &errorMessage)));
+  EXPECT_EQ(errorMessage, "line 1: invalid hash 'xyz'");
+  EXPECT_TRUE(failed(database.parse("unroll 12ab 1.0 -4", &errorMessage)));
+  EXPECT_EQ(errorMessage, "line 1: invalid parameter '-4'");
+}
+
+TEST(TuningDatabaseTest, StructuralHash) {
+  MLIRContext context;
+  std::unique_ptr<Module> module(parseSourceString(R"mlir(
+    func @f(%A : memref<64x64xf32>) {
+      %cst = constant 1.0 : f32
+      affine.for %i = 0 to 64 {
+        affine.for %j = 0 to 64 {
+          %v = load %A[%i, %j] : memref<64x64xf32>
+          %s = addf %v, %cst : f32
+          store %s, %A[%i, %j] : memref<64x64xf32>
+        }
+      }
+      return
+    }
+    func @g(%B : memref<64x64xf32>) {
+      %one = constant 1.0 : f32
+      affine.for %k = 0 to 64 {
+        affine.for %l = 0 to 64 {
+          %w = load %B[%k, %l] : memref<64x64xf32>
+          %t = addf %w, %one : f32
+          store %t, %B[%k, %l] : memref<64x64xf32>
+        }
+      }
+      return
+    }
+    func @h(%A : memref<64x64xf32>) {
+      %cst = constant 1.0 : f32
+      affine.for %i = 0 to 64 {
+        affine.for %j = 0 to 32 {
+          %v = load %A[%i, %j] : memref<64x64xf32>
+          %s = addf %v, %cst : f32
+          store %s, %A[%i, %j] : memref<64x64xf32>
+        }
+      }
+      return
+    }
+    func @k(%A : memref<64x64xf32>) {
+      %cst = constant 2.0 : f32
+      affine.for %i = 0 to 64 {
+        affine.for %j = 0 to 64 {
+          %v = load %A[%i, %j] : memref<64x64xf32>
+          %s = addf %v, %cst : f32
+          store %s, %A[%i, %j] : memref<64x64xf32>
+        }
+      }
+      return
+    }
+  )mlir",
+                                                   &context));
+  ASSERT_TRUE(module != nullptr);
+
+  // The names of the values and of the function do not matter.
+  uint64_t hash = hashLoopNest(getFirstLoop(module.get(), "f"));
+  EXPECT_EQ(hash, hashLoopNest(getFirstLoop(module.get(), "g")));
+  // The bounds of the loops and the values of the constants do.
+  EXPECT_NE(hash, hashLoopNest(getFirstLoop(module.get(), "h")));
+  EXPECT_NE(hash, hashLoopNest(getFirstLoop(module.get(), "k")));
+}
+} // end anonymous namespace